@@ -0,0 +1,167 @@
+#include "pch.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "ChunkCache.h"
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+#include "testTerrain.h"
+
+static std::shared_ptr<const cache::CachedChunk> makeChunk(int resolution, float height)
+{
+	auto chunk = std::make_shared<cache::CachedChunk>();
+	chunk->heights.assign(resolution * resolution, height);
+	chunk->biomes.assign(resolution * resolution, 1);
+	chunk->trees = { {1, 2} };
+	return chunk;
+}
+
+//Biomes cover the whole world, so every chunk gets some vegetation
+static void setupTerrain(TerrainGenerator& terrainGen, cache::ChunkCache* chunkCache)
+{
+	std::vector<biome::Biome> biomes = {
+		biome::Biome(0, "Grassplains",	{0, 4}, {0, 4}, {0, 5}, {0, 7}, 3, 5 * 5 * 0.3f),
+		biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 5}, {0, 7}, 5, 5 * 5 * 0.3f)
+	};
+	std::vector<std::vector<RangedLevel>> ranges = {
+		{{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}
+	};
+
+	terrainGen.setChunkCache(chunkCache);
+	setupTestTerrain(terrainGen, 5, 4, 6, layout::MapLayout::ROW_MAJOR, biomes, ranges);
+}
+
+static void expectEqualTerrain(TerrainGenerator& expected, TerrainGenerator& result)
+{
+	for (int y = 0; y < expected.getHeight(); y++) {
+		for (int x = 0; x < expected.getWidth(); x++) {
+			ASSERT_EQ(expected.getHeightAt(x, y), result.getHeightAt(x, y)) << "FAILED! Heights differ at " << x << ", " << y;
+			ASSERT_EQ(expected.getBiomeAt(x, y), result.getBiomeAt(x, y)) << "FAILED! Biomes differ at " << x << ", " << y;
+		}
+	}
+	auto expectedX = expected.getVegetation().getX(), resultX = result.getVegetation().getX();
+	auto expectedY = expected.getVegetation().getY(), resultY = result.getVegetation().getY();
+	EXPECT_GT(expected.getTreeCount(), 0);
+	EXPECT_TRUE(std::equal(expectedX.begin(), expectedX.end(), resultX.begin(), resultX.end())) << "FAILED! Vegetation differs";
+	EXPECT_TRUE(std::equal(expectedY.begin(), expectedY.end(), resultY.begin(), resultY.end())) << "FAILED! Vegetation differs";
+}
+
+TEST(chunkCacheUnitTests, leastRecentlyUsedEvictionTest) {
+	//Given
+	size_t chunkBytes = makeChunk(8, 0.0f)->getBytes();
+	cache::ChunkCache chunkCache(chunkBytes * 2);
+	chunkCache.insert({ 1, 0, 0 }, makeChunk(8, 0.0f));
+	chunkCache.insert({ 1, 1, 0 }, makeChunk(8, 1.0f));
+
+	//When
+	auto first = chunkCache.find({ 1, 0, 0 });
+	chunkCache.insert({ 1, 2, 0 }, makeChunk(8, 2.0f));
+	auto evicted = chunkCache.find({ 1, 1, 0 });
+	auto otherConfig = chunkCache.find({ 2, 0, 0 });
+
+	//Then
+	ASSERT_NE(first, nullptr) << "FAILED! Stored chunk not found.";
+	EXPECT_EQ(first->heights[0], 0.0f);
+	EXPECT_EQ(evicted, nullptr) << "FAILED! Least recently used chunk was not evicted.";
+	EXPECT_EQ(otherConfig, nullptr) << "FAILED! Chunk of the different config returned.";
+	EXPECT_TRUE(chunkCache.contains({ 1, 0, 0 }) && chunkCache.contains({ 1, 2, 0 }));
+
+	cache::CacheStats stats = chunkCache.getStats();
+	EXPECT_EQ(stats.hits, 1);
+	EXPECT_EQ(stats.misses, 2);
+	EXPECT_EQ(stats.evictions, 1);
+	EXPECT_EQ(stats.chunkCount, 2);
+	EXPECT_EQ(stats.bytes, chunkBytes * 2);
+
+	EXPECT_FALSE(chunkCache.insert({ 1, 3, 0 }, makeChunk(16, 0.0f))) << "FAILED! Chunk over the budget stored.";
+	chunkCache.setBudget(chunkBytes);
+	EXPECT_EQ(chunkCache.getStats().chunkCount, 1) << "FAILED! Lowering the budget didnt evict.";
+	EXPECT_EQ(first->heights.size(), 64) << "FAILED! Evicted chunk released while still in use.";
+}
+
+TEST(chunkCacheUnitTests, concurrentAccessTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(8);
+	size_t chunkBytes = makeChunk(4, 0.0f)->getBytes();
+	cache::ChunkCache chunkCache(chunkBytes * 50);
+	std::atomic<int> wrongChunks{ 0 };
+
+	//When
+	jobs::JobSystem::get().parallel_for2D(64, 64, 4, 4, [&chunkCache, &wrongChunks](int x, int y) {
+		int chunkX = (x * 7 + y) % 100;
+		auto chunk = chunkCache.find({ 0, chunkX, 0 });
+		if (!chunk)
+			chunkCache.insert({ 0, chunkX, 0 }, makeChunk(4, static_cast<float>(chunkX)));
+		else if (chunk->heights[0] != static_cast<float>(chunkX))
+			wrongChunks++;
+	});
+
+	//Then
+	cache::CacheStats stats = chunkCache.getStats();
+	EXPECT_EQ(wrongChunks.load(), 0) << "FAILED! Lookup returned the chunk of the different key.";
+	EXPECT_EQ(stats.hits + stats.misses, 64 * 64);
+	EXPECT_LE(stats.bytes, chunkCache.getBudget()) << "FAILED! Budget exceeded.";
+	EXPECT_EQ(stats.bytes, stats.chunkCount * chunkBytes);
+	EXPECT_GT(stats.evictions, 0);
+}
+
+TEST(chunkCacheUnitTests, generatorReusesCachedChunksTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	cache::ChunkCache chunkCache;
+	TerrainGenerator generated, reused, otherSeed;
+	setupTerrain(generated, &chunkCache);
+	setupTerrain(reused, &chunkCache);
+	setupTerrain(otherSeed, &chunkCache);
+	otherSeed.setSeed(743);
+	std::atomic<int> meshedChunks{ 0 };
+	reused.setChunkMeshCallback([&meshedChunks](int, int) { meshedChunks++; });
+
+	//When
+	generated.performTerrainGeneration();
+	cache::CacheStats afterGeneration = chunkCache.getStats();
+	bool result = reused.performTerrainGeneration();
+	cache::CacheStats afterReuse = chunkCache.getStats();
+	otherSeed.performTerrainGeneration();
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Terrain generation from the cache failed.";
+	EXPECT_EQ(afterGeneration.misses, 5 * 4);
+	EXPECT_EQ(afterGeneration.chunkCount, 5 * 4) << "FAILED! Generated chunks were not cached.";
+	EXPECT_EQ(afterReuse.hits, 5 * 4) << "FAILED! Cached chunks were generated again.";
+	EXPECT_EQ(chunkCache.getStats().misses, 2 * 5 * 4) << "FAILED! Different config hit the cache.";
+	EXPECT_EQ(meshedChunks.load(), 5 * 4) << "FAILED! Cached chunks were not meshed.";
+	expectEqualTerrain(generated, reused);
+}
+
+TEST(chunkCacheUnitTests, partiallyCachedGenerationTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	TerrainGenerator uncached;
+	setupTerrain(uncached, nullptr);
+	uncached.performTerrainGeneration();
+
+	cache::ChunkCache chunkCache;
+	TerrainGenerator generated, partial;
+	setupTerrain(generated, &chunkCache);
+	setupTerrain(partial, &chunkCache);
+	generated.performTerrainGeneration();
+	//Only some of the chunks are left, the rest has to be generated next to the cached neighbours
+	size_t fullBytes = chunkCache.getStats().bytes;
+	chunkCache.setBudget(fullBytes / 3);
+	size_t leftChunks = chunkCache.getStats().chunkCount;
+	//Budget is restored, so the newly generated chunks dont evict the left ones before they are looked up
+	chunkCache.setBudget(fullBytes);
+	chunkCache.resetStats();
+
+	//When
+	bool result = partial.performTerrainGeneration();
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Terrain generation failed.";
+	EXPECT_GT(leftChunks, 0);
+	EXPECT_EQ(chunkCache.getStats().hits, leftChunks) << "FAILED! Left chunks were generated again.";
+	expectEqualTerrain(uncached, partial);
+}
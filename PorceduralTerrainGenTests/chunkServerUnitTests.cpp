@@ -0,0 +1,172 @@
+#include "pch.h"
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "ChunkServer.h"
+#include "GenerationConfig.h"
+
+static bool generateWorld(TerrainGenerator& terrainGen)
+{
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	generationConfig.width = 3;
+	generationConfig.height = 2;
+	generationConfig.chunkResolution = 16;
+	terrainGen.setChunkCache(nullptr);
+	return config::applyConfig(generationConfig, terrainGen) && terrainGen.performTerrainGeneration();
+}
+
+static std::string socketPath(const std::string& name)
+{
+	return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(chunkServerUnitTests, batchedRequestTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	ASSERT_TRUE(generateWorld(terrainGen)) << "FAILED! World couldnt be generated.";
+	server::ChunkServer chunkServer(terrainGen);
+	ASSERT_TRUE(chunkServer.start(socketPath("chunkServerBatch.sock"))) << "FAILED! Server couldnt be started.";
+	server::ChunkClient client;
+	ASSERT_TRUE(client.connect(socketPath("chunkServerBatch.sock"))) << "FAILED! Client couldnt connect.";
+	std::vector<server::RequestedChunk> chunks = { { 0, 0, 0 }, { 2, 1, 0 }, { 1, 1, 2 }, { 3, 0, 0 }, { 0, 1, 5 } };
+
+	//When
+	server::Response response;
+	bool result = client.sendRequest(7, server::FIELD_ALL, chunks) && client.receiveResponse(response);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Response not received.";
+	EXPECT_EQ(response.requestId, 7);
+	EXPECT_EQ(response.status, server::STATUS_OK);
+	ASSERT_EQ(response.chunks.size(), chunks.size());
+	for (int i = 0; i < 2; i++) {
+		const server::ReceivedChunk& chunk = response.chunks[i];
+		int chunkX = chunks[i].chunkX, chunkY = chunks[i].chunkY;
+		ASSERT_EQ(chunk.header.status, server::CHUNK_OK);
+		EXPECT_EQ(chunk.header.resolution, 16);
+		std::span<const float> heights = terrainGen.getHeightChunk(chunkX, chunkY);
+		std::span<const int> biomes = terrainGen.getBiomeChunk(chunkX, chunkY);
+		EXPECT_TRUE(std::equal(chunk.heights.begin(), chunk.heights.end(), heights.begin(), heights.end())) << "FAILED! Wrong heights of the chunk " << i;
+		EXPECT_TRUE(std::equal(chunk.biomes.begin(), chunk.biomes.end(), biomes.begin(), biomes.end())) << "FAILED! Wrong biomes of the chunk " << i;
+		std::span<const float> treeX = terrainGen.getVegetation().getX(chunkX, chunkY);
+		EXPECT_TRUE(std::equal(chunk.treeX.begin(), chunk.treeX.end(), treeX.begin(), treeX.end())) << "FAILED! Wrong trees of the chunk " << i;
+		EXPECT_EQ(chunk.treeHeight.size(), treeX.size());
+	}
+
+	const server::ReceivedChunk& lowDetail = response.chunks[2];
+	ASSERT_EQ(lowDetail.header.status, server::CHUNK_OK);
+	EXPECT_EQ(lowDetail.header.resolution, 4);
+	ASSERT_EQ(lowDetail.heights.size(), 16);
+	for (int y = 0; y < 4; y++)
+		for (int x = 0; x < 4; x++)
+			EXPECT_EQ(lowDetail.heights[y * 4 + x], terrainGen.getHeightAt(16 + x * 4, 16 + y * 4)) << "FAILED! Wrong sample of the level of detail.";
+
+	EXPECT_EQ(response.chunks[3].header.status, server::CHUNK_OUT_OF_RANGE);
+	EXPECT_EQ(response.chunks[4].header.status, server::CHUNK_INVALID_LOD);
+	EXPECT_TRUE(response.chunks[3].heights.empty());
+
+	client.close();
+	chunkServer.stop();
+	EXPECT_FALSE(std::filesystem::exists(socketPath("chunkServerBatch.sock"))) << "FAILED! Socket file not removed.";
+}
+
+TEST(chunkServerUnitTests, pipelinedRequestsTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	ASSERT_TRUE(generateWorld(terrainGen)) << "FAILED! World couldnt be generated.";
+	server::ChunkServer chunkServer(terrainGen);
+	ASSERT_TRUE(chunkServer.start(socketPath("chunkServerPipeline.sock")));
+	server::ChunkClient first, second;
+	ASSERT_TRUE(first.connect(socketPath("chunkServerPipeline.sock")) && second.connect(socketPath("chunkServerPipeline.sock")));
+	server::RequestedChunk heightChunk[] = { { 1, 0, 0 } };
+	server::RequestedChunk biomeChunks[] = { { 0, 0, 1 }, { 2, 1, 1 } };
+
+	//When
+	//Every request is sent before any response is read
+	bool sent = true;
+	for (uint32_t requestId = 0; requestId < 50; requestId++)
+		sent &= first.sendRequest(requestId, requestId % 2 ? server::FIELD_BIOME : server::FIELD_HEIGHT,
+			requestId % 2 ? std::span<const server::RequestedChunk>(biomeChunks) : std::span<const server::RequestedChunk>(heightChunk));
+	server::Response secondResponse;
+	bool secondResult = second.sendRequest(99, server::FIELD_VEGETATION, heightChunk) && second.receiveResponse(secondResponse);
+
+	//Then
+	ASSERT_TRUE(sent) << "FAILED! Requests couldnt be sent.";
+	ASSERT_TRUE(secondResult) << "FAILED! Second connection not served.";
+	EXPECT_EQ(secondResponse.requestId, 99);
+	EXPECT_TRUE(secondResponse.chunks[0].heights.empty()) << "FAILED! Fields not requested were sent.";
+	for (uint32_t requestId = 0; requestId < 50; requestId++) {
+		server::Response response;
+		ASSERT_TRUE(first.receiveResponse(response)) << "FAILED! Response " << requestId << " not received.";
+		ASSERT_EQ(response.requestId, requestId) << "FAILED! Responses out of the order of the requests.";
+		if (requestId % 2) {
+			ASSERT_EQ(response.chunks.size(), 2);
+			EXPECT_EQ(response.chunks[1].biomes.size(), 8 * 8);
+			EXPECT_TRUE(response.chunks[1].heights.empty());
+		}
+		else {
+			ASSERT_EQ(response.chunks.size(), 1);
+			EXPECT_EQ(response.chunks[0].heights.size(), 16 * 16);
+		}
+	}
+	server::ServerStats stats = chunkServer.getStats();
+	EXPECT_EQ(stats.connections, 2);
+	EXPECT_EQ(stats.requests, 51);
+}
+
+TEST(chunkServerUnitTests, unreadResponsesTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	ASSERT_TRUE(generateWorld(terrainGen)) << "FAILED! World couldnt be generated.";
+	server::ChunkServer chunkServer(terrainGen);
+	ASSERT_TRUE(chunkServer.start(socketPath("chunkServerUnread.sock")));
+	server::ChunkClient client;
+	ASSERT_TRUE(client.connect(socketPath("chunkServerUnread.sock")));
+	//Requests and their responses are both larger than the buffers of the socket
+	std::vector<server::RequestedChunk> chunks(server::MAX_BATCH_CHUNKS, { 5, 5, 0 });
+	constexpr uint32_t requestCount = 40;
+
+	//When
+	//Client sends everything before reading, the server has to keep reading while its responses are not read
+	bool sent = true;
+	for (uint32_t requestId = 0; requestId < requestCount; requestId++)
+		sent &= client.sendRequest(requestId, server::FIELD_ALL, chunks);
+
+	//Then
+	ASSERT_TRUE(sent) << "FAILED! Requests couldnt be sent.";
+	for (uint32_t requestId = 0; requestId < requestCount; requestId++) {
+		server::Response response;
+		ASSERT_TRUE(client.receiveResponse(response)) << "FAILED! Response " << requestId << " not received.";
+		ASSERT_EQ(response.requestId, requestId);
+		ASSERT_EQ(response.chunks.size(), chunks.size());
+		EXPECT_EQ(response.chunks.back().header.status, server::CHUNK_OUT_OF_RANGE);
+	}
+}
+
+TEST(chunkServerUnitTests, malformedRequestTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	ASSERT_TRUE(generateWorld(terrainGen)) << "FAILED! World couldnt be generated.";
+	server::ChunkServer chunkServer(terrainGen);
+	ASSERT_TRUE(chunkServer.start(socketPath("chunkServerMalformed.sock")));
+	server::ChunkClient client;
+	ASSERT_TRUE(client.connect(socketPath("chunkServerMalformed.sock")));
+	server::RequestHeader header;
+	header.requestId = 3;
+	header.chunkCount = server::MAX_BATCH_CHUNKS + 1;
+	std::vector<uint8_t> bytes(sizeof(header));
+	std::memcpy(bytes.data(), &header, sizeof(header));
+
+	//When
+	server::Response response, afterClose;
+	bool result = client.sendRaw(bytes) && client.receiveResponse(response);
+	bool closed = !client.receiveResponse(afterClose);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Malformed request not answered.";
+	EXPECT_EQ(response.status, server::STATUS_BAD_REQUEST);
+	EXPECT_TRUE(response.chunks.empty());
+	EXPECT_TRUE(closed) << "FAILED! Connection not closed after the malformed request.";
+}
@@ -0,0 +1,147 @@
+#include "pch.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "ChunkCodec.h"
+#include "TerrainGenerator.h"
+#include "testTerrain.h"
+
+//Height and biome maps of the generated terrain, chunk-major so every chunk is one block
+static void generateTerrain(TerrainGenerator& terrainGen, int size, int chunkRes)
+{
+	//Ocean without the vegetation
+	std::vector<biome::Biome> biomes = testBiomes();
+	biomes[5] = biome::Biome(5, "Ocean", {0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, 5 * 5 * 0.0f);
+	setupTestTerrain(terrainGen, size, size, chunkRes, layout::MapLayout::CHUNK_MAJOR, biomes);
+	terrainGen.generateHeightMap();
+	terrainGen.generateBiomes();
+}
+
+TEST(codecUnitTests, losslessHeightsRoundTripTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	generateTerrain(terrainGen, 2, 20);
+	std::span<const float> chunk = terrainGen.getHeightChunk(1, 0);
+	std::vector<uint8_t> encoded;
+	std::vector<float> decoded(chunk.size());
+
+	//When
+	bool encodeResult = codec::encodeHeights(chunk, 20, 0.0f, encoded);
+	std::span<const uint8_t> input = encoded;
+	bool decodeResult = codec::decodeHeights(input, decoded);
+
+	//Then
+	EXPECT_TRUE(encodeResult && decodeResult) << "FAILED! Heights couldnt be coded.";
+	EXPECT_TRUE(std::equal(chunk.begin(), chunk.end(), decoded.begin(), decoded.end())) << "FAILED! Lossless coding changed the heights.";
+	EXPECT_TRUE(input.empty()) << "FAILED! Stream not consumed.";
+	EXPECT_LT(encoded.size(), chunk.size() * sizeof(float));
+}
+
+TEST(codecUnitTests, boundedErrorHeightsTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	generateTerrain(terrainGen, 2, 20);
+	std::span<const float> chunk = terrainGen.getHeightChunk(0, 1);
+	float errorBound = 0.01f;
+	std::vector<uint8_t> encoded;
+	std::vector<float> decoded(chunk.size());
+
+	//When
+	codec::encodeHeights(chunk, 20, errorBound, encoded);
+	std::span<const uint8_t> input = encoded;
+	bool result = codec::decodeHeights(input, decoded);
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Heights couldnt be decoded.";
+	for (size_t i = 0; i < chunk.size(); i++)
+		EXPECT_LE(std::abs(decoded[i] - chunk[i]), errorBound * 1.001f) << "FAILED! Error bound exceeded at " << i;
+	EXPECT_LT(encoded.size() * 3, chunk.size() * sizeof(float)) << "FAILED! Quantized heights are not compressed.";
+}
+
+TEST(codecUnitTests, biomesAndConcatenatedStreamsTest) {
+	//Given
+	std::vector<int> biomes(400, 3);
+	std::fill(biomes.begin() + 100, biomes.begin() + 150, 5);
+	biomes[399] = -1;
+	std::vector<float> heights(400);
+	for (int i = 0; i < 400; i++)
+		heights[i] = std::sin(i * 0.1f) * 50.0f;
+	std::vector<uint8_t> encoded;
+	std::vector<int> decodedBiomes(400);
+	std::vector<float> decodedHeights(400);
+
+	//When
+	codec::encodeBiomes(biomes, encoded);
+	size_t biomeBytes = encoded.size();
+	codec::encodeHeights(heights, 20, 0.0f, encoded);
+	std::span<const uint8_t> input = encoded;
+	bool biomeResult = codec::decodeBiomes(input, decodedBiomes);
+	bool heightResult = codec::decodeHeights(input, decodedHeights);
+
+	//Then
+	EXPECT_TRUE(biomeResult && heightResult) << "FAILED! Streams couldnt be decoded one after another.";
+	EXPECT_EQ(decodedBiomes, biomes);
+	EXPECT_EQ(decodedHeights, heights);
+	EXPECT_LT(biomeBytes, 20) << "FAILED! Runs of biomes are not compressed.";
+}
+
+TEST(codecUnitTests, nonValidStreamTest) {
+	//Given
+	std::vector<float> heights(64, 1.0f);
+	std::vector<uint8_t> encoded;
+	codec::encodeHeights(heights, 8, 0.0f, encoded);
+	encoded.resize(encoded.size() - 1);
+	std::vector<float> decoded(64);
+	std::vector<float> wrongSize(32);
+
+	//When
+	std::span<const uint8_t> truncated = encoded;
+	bool truncatedResult = codec::decodeHeights(truncated, decoded);
+	std::span<const uint8_t> input = encoded;
+	bool sizeResult = codec::decodeHeights(input, wrongSize);
+
+	//Then
+	EXPECT_FALSE(truncatedResult) << "FAILED! Truncated stream decoded.";
+	EXPECT_FALSE(sizeResult) << "FAILED! Stream decoded into the output of the wrong size.";
+	EXPECT_FALSE(codec::encodeHeights(heights, 7, 0.0f, encoded)) << "FAILED! Heights not divisible into rows encoded.";
+}
+
+//Ratio and decode throughput on the generated map, printed for the comparison between the changes
+TEST(codecUnitTests, generatedMapBenchmarkTest) {
+	//Given
+	int size = 8, chunkRes = 32;
+	TerrainGenerator terrainGen;
+	generateTerrain(terrainGen, size, chunkRes);
+	size_t rawBytes = static_cast<size_t>(size) * size * chunkRes * chunkRes * (sizeof(float) + sizeof(int));
+	std::vector<float> heights(chunkRes * chunkRes);
+	std::vector<int> biomes(chunkRes * chunkRes);
+
+	for (float errorBound : { 0.0f, 0.01f, 0.1f }) {
+		std::vector<std::vector<uint8_t>> chunks(size * size);
+		size_t encodedBytes = 0;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				codec::encodeHeights(terrainGen.getHeightChunk(x, y), chunkRes, errorBound, chunks[y * size + x]);
+				codec::encodeBiomes(terrainGen.getBiomeChunk(x, y), chunks[y * size + x]);
+				encodedBytes += chunks[y * size + x].size();
+			}
+		}
+
+		//When
+		bool result = true;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (auto& chunk : chunks) {
+			std::span<const uint8_t> input = chunk;
+			result = codec::decodeHeights(input, heights) && codec::decodeBiomes(input, biomes) && result;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		//Then
+		double ratio = static_cast<double>(rawBytes) / encodedBytes;
+		std::cout << "[LOG] Codec error bound " << errorBound << ": ratio " << ratio << ", decode " << rawBytes / (seconds * 1024.0 * 1024.0) << " MB/s" << std::endl;
+		EXPECT_TRUE(result) << "FAILED! Chunks couldnt be decoded.";
+		EXPECT_GT(ratio, 1.0) << "FAILED! Chunks are not compressed.";
+	}
+}
@@ -1,6 +1,6 @@
 #include "pch.h"
 
-#include "erosion.h"
+#include "Erosion.h"
 
 TEST(erosionIntegrationTests, positionTest) {
 	//Given
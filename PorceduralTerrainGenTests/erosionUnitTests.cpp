@@ -1,6 +1,29 @@
 #include "pch.h"
 
+#include <cmath>
+#include <cstring>
+#include <vector>
+
 #include "Erosion.h"
+#include "JobSystem.h"
+
+static std::vector<float> erodedHills(int width, int height, erosion::ParallelMode mode, unsigned int threadCount)
+{
+	std::vector<float> map(width * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			map[y * width + x] = 0.5f + 0.3f * sinf(x * 0.1f) * cosf(y * 0.13f) + x * 0.001f;
+
+	unsigned int previousThreadCount = jobs::JobSystem::get().getThreadCount();
+	jobs::JobSystem::get().setThreadCount(threadCount);
+	erosion::Erosion e(width, height);
+	e.SetDropletCount(5000);
+	e.SetSeed(42);
+	e.SetMap(map.data());
+	EXPECT_TRUE(e.ErodeParallel(mode));
+	jobs::JobSystem::get().setThreadCount(previousThreadCount);
+	return std::vector<float>(e.getMap(), e.getMap() + width * height);
+}
 
 TEST(erosionUnitTests, adjustingVelocityTest) {
 	//Given
@@ -107,3 +130,436 @@ TEST(erosionUnitTests, isOnMapTest) {
 	//Then
 	EXPECT_FALSE(result) << "FAILED! Result should be: false, but was: true";
 }
+
+TEST(erosionUnitTests, dropletPoolRemoveTest) {
+	//Given
+	erosion::DropletPool pool;
+	for (int i = 0; i < 4; i++)
+		pool.add(i, erosion::vec2(static_cast<float>(i), 0.0f), 1.0f, static_cast<float>(i), 1.0f);
+
+	//When
+	pool.remove(1);
+	pool.remove(2);
+
+	//Then
+	ASSERT_EQ(pool.size(), 2);
+	EXPECT_EQ(pool.positionX[0], 0.0f);
+	EXPECT_EQ(pool.positionX[1], 3.0f) << "FAILED! Last droplet should take the place of the removed one.";
+	EXPECT_EQ(pool.water[1], 3.0f) << "FAILED! Attributes of the moved droplet dont match.";
+	EXPECT_EQ(pool.id[1], 3);
+	EXPECT_EQ(pool.sediment[1], 0.0f);
+}
+
+TEST(erosionUnitTests, fusedSampleTest) {
+	//Given
+	erosion::vec2 pos(1.3f, 0.6f);
+	erosion::Erosion e(3, 3);
+	float map[9] = { 0.2f, 0.3f, 0.4f, 0.3f, 0.5f, 0.4f, 0.4f, 0.5f, 0.6f };
+	e.SetMap(map);
+
+	//When
+	erosion::HeightAndGradient result = e.sampleHeightAndGradient(pos);
+
+	//Then
+	EXPECT_EQ(result.height, e.getInterpolatedGridHeight(pos)) << "FAILED! Fused height differs from the interpolated height.";
+	EXPECT_EQ(result.gradient.x, e.getGradient(pos).x) << "FAILED! Fused gradient differs from the gradient.";
+	EXPECT_EQ(result.gradient.y, e.getGradient(pos).y) << "FAILED! Fused gradient differs from the gradient.";
+}
+
+TEST(erosionUnitTests, parallelErosionDeterministicTest) {
+	for (erosion::ParallelMode mode : { erosion::ParallelMode::CHECKERBOARD, erosion::ParallelMode::FIXED_POINT }) {
+		//Given
+		int width = 200, height = 150;
+		std::vector<float> original = erodedHills(width, height, mode, 1);
+
+		//When
+		std::vector<float> single = erodedHills(width, height, mode, 1);
+		std::vector<float> parallel = erodedHills(width, height, mode, 6);
+
+		//Then
+		EXPECT_EQ(std::memcmp(single.data(), original.data(), single.size() * sizeof(float)), 0) << "FAILED! Same seed gave a different map.";
+		EXPECT_EQ(std::memcmp(parallel.data(), single.data(), single.size() * sizeof(float)), 0) << "FAILED! Map depends on the number of threads.";
+		int changed = 0, finite = 0;
+		for (int i = 0; i < width * height; i++) {
+			float hill = 0.5f + 0.3f * sinf((i % width) * 0.1f) * cosf((i / width) * 0.13f) + (i % width) * 0.001f;
+			changed += parallel[i] != hill;
+			finite += std::isfinite(parallel[i]);
+		}
+		EXPECT_GT(changed, width * height / 10) << "FAILED! Map barely eroded.";
+		EXPECT_EQ(finite, width * height);
+	}
+}
+
+TEST(erosionUnitTests, parallelErosionTileSizeTest) {
+	//Given
+	erosion::Erosion e(64, 64);
+	std::vector<float> map(64 * 64, 0.5f);
+	e.SetMap(map.data());
+
+	//When
+	bool tooSmall = e.ErodeParallel(erosion::ParallelMode::CHECKERBOARD, e.getMinTileSize() - 1);
+	bool smallest = e.ErodeParallel(erosion::ParallelMode::CHECKERBOARD, e.getMinTileSize());
+
+	//Then
+	EXPECT_FALSE(tooSmall) << "FAILED! Tiles overlapping in one phase accepted.";
+	EXPECT_TRUE(smallest);
+}
+
+TEST(erosionUnitTests, brushWeightsTest) {
+	//Given
+	int radius = 3;
+	erosion::vec2 pos(4.0f + 5.5f / erosion::ErosionBrush::SUBCELLS, 2.0f + 0.5f / erosion::ErosionBrush::SUBCELLS);
+	erosion::ErosionBrush brush;
+
+	//When
+	brush.build(radius);
+	int bucket = brush.bucket(pos);
+
+	//Then
+	ASSERT_EQ(bucket, 5) << "FAILED! Wrong bucket of the position.";
+	uint32_t i = brush.offsets[bucket];
+	for (int y = -radius; y < radius; y++) {
+		for (int x = -radius; x < radius; x++) {
+			float distance = sqrtf((x + 4.0f - pos.x) * (x + 4.0f - pos.x) + (y + 2.0f - pos.y) * (y + 2.0f - pos.y));
+			if (distance >= radius)
+				continue;
+			ASSERT_LT(i, brush.offsets[bucket + 1]) << "FAILED! Brush misses cells of the radius.";
+			EXPECT_EQ(brush.cellX[i], x);
+			EXPECT_EQ(brush.cellY[i], y);
+			EXPECT_NEAR(brush.weights[i], 1.0f - distance / radius, 1e-5f);
+			i++;
+		}
+	}
+	EXPECT_EQ(i, brush.offsets[bucket + 1]) << "FAILED! Brush has cells outside of the radius.";
+}
+
+TEST(erosionUnitTests, erodeRadiusAtEdgeTest) {
+	//Given
+	std::vector<float> map(8 * 8, 1.0f);
+	map[1 * 8 + 1] = 0.0f;
+	erosion::Erosion e(8, 8);
+	e.SetMap(map.data());
+
+	//When
+	float eroded = e.erodeRadius(erosion::vec2(0.2f, 0.3f), erosion::vec2(1.5f, 1.5f), 0.5f);
+
+	//Then
+	EXPECT_NEAR(eroded, 0.5f, 1e-5f) << "FAILED! Brush clipped by the edge didnt erode the whole amount.";
+	float sum = 0.0f;
+	for (int i = 0; i < 64; i++)
+		sum += e.getMap()[i];
+	EXPECT_NEAR(sum, 63.0f - 0.5f, 1e-4f);
+	EXPECT_EQ(e.getMap()[1 * 8 + 1], 0.0f) << "FAILED! Point lower than the new position eroded.";
+	EXPECT_EQ(e.getMap()[7 * 8 + 7], 1.0f) << "FAILED! Point out of the radius eroded.";
+}
+
+static std::vector<float> erodedRidges(int seed)
+{
+	//Integer pattern, the map doesnt depend on the math library
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+
+	erosion::Erosion e(48, 48);
+	e.SetSeed(seed);
+	e.SetDropletCount(400);
+	e.SetMap(map.data());
+	e.Erode(std::nullopt);
+	return std::vector<float>(e.getMap(), e.getMap() + map.size());
+}
+
+TEST(erosionUnitTests, seededErosionTest) {
+	//Given
+	int seed = 7;
+
+	//When
+	std::vector<float> first = erodedRidges(seed);
+	std::vector<float> second = erodedRidges(seed);
+	std::vector<float> otherSeed = erodedRidges(seed + 1);
+
+	//Then
+	EXPECT_EQ(std::memcmp(first.data(), second.data(), first.size() * sizeof(float)), 0) << "FAILED! Same seed eroded the map differently.";
+	EXPECT_NE(std::memcmp(first.data(), otherSeed.data(), first.size() * sizeof(float)), 0) << "FAILED! Seed not used.";
+	//Eroded values of the points changed by the droplets
+	EXPECT_FLOAT_EQ(first[10 * 48 + 10], 0.240921199f);
+	EXPECT_FLOAT_EQ(first[24 * 48 + 30], 0.624712288f);
+	EXPECT_FLOAT_EQ(first[40 * 48 + 5], 0.482962906f);
+}
+
+TEST(erosionUnitTests, dropletRandomTest) {
+	//Given
+	erosion::DropletRandom first(3, 10, 2), same(3, 10, 2), otherDroplet(3, 11, 2), otherStep(3, 10, 3);
+
+	//When
+	float value = first.next();
+
+	//Then
+	EXPECT_EQ(value, same.next()) << "FAILED! Same key gave a different number.";
+	EXPECT_NE(value, otherDroplet.next());
+	EXPECT_NE(value, otherStep.next());
+	EXPECT_NE(value, first.next()) << "FAILED! Counter not advanced.";
+	for (int i = 0; i < 1000; i++) {
+		float number = first.next(-1.0f, 1.0f);
+		ASSERT_TRUE(number >= -1.0f && number < 1.0f) << "FAILED! Number out of the range: " << number;
+	}
+}
+
+TEST(erosionUnitTests, mapViewInPlaceTest) {
+	//Given
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion e(1, 1);
+	e.SetSeed(7);
+	e.SetDropletCount(400);
+
+	//When
+	bool viewSet = e.SetMapView(map.data(), 48, 48);
+	e.Erode(std::nullopt);
+
+	//Then
+	ASSERT_TRUE(viewSet);
+	EXPECT_TRUE(e.isMapView());
+	EXPECT_EQ(e.getMap(), map.data()) << "FAILED! Map copied instead of viewed.";
+	std::vector<float> copied = erodedRidges(7);
+	EXPECT_EQ(std::memcmp(map.data(), copied.data(), map.size() * sizeof(float)), 0) << "FAILED! View eroded differently than the copy.";
+	EXPECT_FALSE(e.SetMapView(map.data(), 48, 48, 47)) << "FAILED! Overlapping rows accepted.";
+	EXPECT_FALSE(e.SetMapView(nullptr, 48, 48));
+}
+
+TEST(erosionUnitTests, mapViewRectangleTest) {
+	//Given
+	const int parentWidth = 60, parentHeight = 56, originX = 5, originY = 3;
+	const float outside = -1.0f;
+	std::vector<float> parent(parentWidth * parentHeight, outside);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			parent[(originY + y) * parentWidth + originX + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion e(1, 1);
+	e.SetSeed(7);
+	e.SetDropletCount(400);
+
+	//When
+	ASSERT_TRUE(e.SetMapView(parent.data() + originY * parentWidth + originX, 48, 48, parentWidth));
+	e.Erode(std::nullopt);
+
+	//Then
+	std::vector<float> expected = erodedRidges(7);
+	for (int y = 0; y < parentHeight; y++) {
+		for (int x = 0; x < parentWidth; x++) {
+			bool inside = x >= originX && x < originX + 48 && y >= originY && y < originY + 48;
+			float value = parent[y * parentWidth + x];
+			if (inside)
+				ASSERT_EQ(value, expected[(y - originY) * 48 + x - originX]) << "FAILED! Rectangle eroded differently at " << x << ", " << y;
+			else
+				ASSERT_EQ(value, outside) << "FAILED! Sample outside of the rectangle changed at " << x << ", " << y;
+		}
+	}
+}
+
+TEST(erosionUnitTests, slicedSessionTest) {
+	//Given
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion e(48, 48);
+	e.SetSeed(7);
+	e.SetDropletCount(400);
+	e.SetMap(map.data());
+	erosion::ErosionSession session(e);
+
+	//When
+	ASSERT_TRUE(session.start());
+	int calls = 0;
+	float progress = 0.0f;
+	bool progressGrows = true;
+	while (session.advance({ 37, 0.0 })) {
+		progressGrows &= session.getProgress() >= progress;
+		progress = session.getProgress();
+		calls++;
+	}
+
+	//Then
+	EXPECT_GT(calls, 10) << "FAILED! Budget not respected.";
+	EXPECT_TRUE(progressGrows) << "FAILED! Progress went back.";
+	EXPECT_EQ(session.getState(), erosion::SessionState::FINISHED);
+	EXPECT_FLOAT_EQ(session.getProgress(), 1.0f);
+	std::vector<float> whole = erodedRidges(7);
+	EXPECT_EQ(std::memcmp(session.getMap(), whole.data(), whole.size() * sizeof(float)), 0) << "FAILED! Sliced erosion differs from the erosion at once.";
+}
+
+TEST(erosionUnitTests, slicedThermalSessionTest) {
+	//Given
+	std::vector<float> map(48 * 48), whole(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	std::memcpy(whole.data(), map.data(), map.size() * sizeof(float));
+	erosion::Erosion atOnce(48, 48), sliced(48, 48);
+	for (erosion::Erosion* e : { &atOnce, &sliced }) {
+		e->SetSeed(7);
+		e->SetDropletCount(400);
+		e->getConfigRef().thermalInterval = 8;
+	}
+	atOnce.SetMap(whole.data());
+	atOnce.Erode(std::nullopt);
+	sliced.SetMap(map.data());
+	erosion::ErosionSession session(sliced);
+	ASSERT_TRUE(session.start());
+
+	//When
+	//Call of the thermal pass moves no droplets, so the progress stays while the map changes
+	int thermalCalls = 0;
+	bool thermalChangedMap = true;
+	std::vector<float> previous(map.size());
+	bool hasWork = true;
+	while (hasWork) {
+		float progress = session.getProgress();
+		std::memcpy(previous.data(), sliced.getMap(), map.size() * sizeof(float));
+		hasWork = session.advance({ 37, 0.0 });
+		if (hasWork && session.getProgress() == progress) {
+			thermalCalls++;
+			thermalChangedMap &= std::memcmp(previous.data(), sliced.getMap(), map.size() * sizeof(float)) != 0;
+		}
+	}
+
+	//Then
+	EXPECT_GT(thermalCalls, 0) << "FAILED! Thermal passes not run in the calls of their own.";
+	EXPECT_TRUE(thermalChangedMap) << "FAILED! Call without the droplets didnt run the thermal pass.";
+	EXPECT_EQ(session.getState(), erosion::SessionState::FINISHED);
+	EXPECT_EQ(std::memcmp(sliced.getMap(), atOnce.getMap(), map.size() * sizeof(float)), 0) << "FAILED! Sliced thermal erosion differs from the erosion at once.";
+}
+
+TEST(erosionUnitTests, sessionSettingsSnapshotTest) {
+	//Given
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion e(48, 48);
+	e.SetSeed(7);
+	e.SetDropletCount(400);
+	e.SetMap(map.data());
+	erosion::ErosionSession session(e);
+	std::vector<float> trace((e.getConfigRef().dropletLifetime + 1) * 400 * 3);
+	ASSERT_TRUE(session.start(trace.data()));
+
+	//When
+	//Settings edited while the session runs, e.g. in the viewer
+	session.advance({ 100, 0.0 });
+	e.getConfigRef().dropletLifetime *= 4;
+	e.SetDropletCount(4000);
+	e.getConfigRef().thermalInterval = 1;
+	while (session.advance({ 100, 0.0 }));
+
+	//Then
+	EXPECT_EQ(session.getState(), erosion::SessionState::FINISHED);
+	std::vector<float> whole = erodedRidges(7);
+	EXPECT_EQ(std::memcmp(session.getMap(), whole.data(), whole.size() * sizeof(float)), 0) << "FAILED! Session used the settings changed after its start.";
+}
+
+TEST(erosionUnitTests, sessionControlTest) {
+	//Given
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = (x + y) / 96.0f;
+	erosion::Erosion e(48, 48);
+	e.SetDropletCount(400);
+	erosion::ErosionSession session(e);
+	EXPECT_FALSE(session.start()) << "FAILED! Session started without the map.";
+	e.SetMap(map.data());
+	ASSERT_TRUE(session.start());
+
+	//When
+	session.advance({ 100, 0.0 });
+	float progress = session.getProgress();
+	session.pause();
+	bool pausedHasWork = session.advance({});
+	float pausedProgress = session.getProgress();
+	session.resume();
+	session.advance({ 0, 0.5 });
+	float resumedProgress = session.getProgress();
+	session.cancel();
+
+	//Then
+	EXPECT_GT(progress, 0.0f);
+	EXPECT_TRUE(pausedHasWork);
+	EXPECT_EQ(pausedProgress, progress) << "FAILED! Paused session advanced.";
+	EXPECT_GT(resumedProgress, progress) << "FAILED! Resumed session didnt advance.";
+	EXPECT_EQ(session.getState(), erosion::SessionState::CANCELLED);
+	EXPECT_FALSE(session.advance({})) << "FAILED! Cancelled session has work left.";
+}
+
+TEST(erosionUnitTests, dirtyRegionRectsTest) {
+	//Given
+	const int T = erosion::DirtyRegion::TILE_SIZE;
+	erosion::DirtyRegion dirty;
+	dirty.resize(3 * T + 10, 3 * T);
+
+	//When
+	bool cleanAtStart = !dirty.isDirty();
+	dirty.mark(T, 0, T + 1, 2 * T - 1);		//column 1 of the rows 0 and 1
+	dirty.mark(2 * T + 5, 2 * T, 3 * T + 20, 3 * T + 5);	//clipped to the columns 2 and 3 of the row 2
+	dirty.mark(-10, -10, -1, -1);			//out of the map
+	std::vector<erosion::DirtyRect> rects = dirty.getRects(1);
+
+	//Then
+	EXPECT_TRUE(cleanAtStart);
+	ASSERT_EQ(rects.size(), 2) << "FAILED! Tiles not merged into the rectangles.";
+	EXPECT_EQ(rects[0].x, T - 1);
+	EXPECT_EQ(rects[0].y, 0);
+	EXPECT_EQ(rects[0].width, T + 2);
+	EXPECT_EQ(rects[0].height, 2 * T + 1);
+	EXPECT_EQ(rects[1].x, 2 * T - 1);
+	EXPECT_EQ(rects[1].y, 2 * T - 1);
+	EXPECT_EQ(rects[1].width, T + 11) << "FAILED! Rectangle not clipped to the map.";
+	EXPECT_EQ(rects[1].height, T + 1);
+	dirty.clear();
+	EXPECT_FALSE(dirty.isDirty());
+	EXPECT_TRUE(dirty.getRects().empty());
+}
+
+TEST(erosionUnitTests, dirtyTilesErosionTest) {
+	//Given
+	const int size = 256, T = erosion::DirtyRegion::TILE_SIZE;
+	std::vector<float> map(size * size);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			map[y * size + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion e(size, size);
+	e.SetDropletCount(20);
+	e.getConfigRef().dropletLifetime = 16;
+	e.SetMap(map.data());
+	e.SetSpawnArea(100, 100, 20, 20);
+
+	//When
+	bool dirtyBefore = e.getDirtyRegion().isDirty();
+	e.Erode(std::nullopt);
+	const erosion::DirtyRegion& dirty = e.getDirtyRegion();
+
+	//Then
+	EXPECT_FALSE(dirtyBefore) << "FAILED! Map dirty before the erosion.";
+	int changed = 0, dirtyTiles = 0;
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			if (e.getMap()[y * size + x] != map[y * size + x]) {
+				changed++;
+				EXPECT_TRUE(dirty.isTileDirty(x / T, y / T)) << "FAILED! Changed sample " << x << ", " << y << " not in the dirty tiles.";
+			}
+		}
+	}
+	for (int tileY = 0; tileY < dirty.getTilesY(); tileY++)
+		for (int tileX = 0; tileX < dirty.getTilesX(); tileX++)
+			dirtyTiles += dirty.isTileDirty(tileX, tileY);
+	EXPECT_GT(changed, 0);
+	EXPECT_LT(dirtyTiles, dirty.getTilesX() * dirty.getTilesY() / 4) << "FAILED! Local erosion marked most of the map.";
+
+	e.ClearDirtyRegion();
+	e.getConfigRef().thermalInterval = 1;
+	e.Erode(std::nullopt);
+	EXPECT_EQ(e.getDirtyRegion().getRects().size(), 1) << "FAILED! Thermal erosion didnt mark the whole map.";
+}
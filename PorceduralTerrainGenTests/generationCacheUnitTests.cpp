@@ -0,0 +1,99 @@
+#include "pch.h"
+
+#include <atomic>
+#include <filesystem>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+#include "testTerrain.h"
+
+TEST(generationCacheUnitTests, noiseConfigHashTest) {
+	//Given
+	noise::NoiseConfigParameters config(0, 1.0f, 2.0f);
+	noise::NoiseConfigParameters swapped(0, 2.0f, 1.0f);
+	noise::NoiseConfigParameters ridged = config;
+	ridged.ridge = true;
+	noise::NoiseConfigParameters otherOption = config;
+	otherOption.option = noise::Options::NOTHING;
+	noise::NoiseConfigParameters otherSeed = config;
+	otherSeed.seed = 5;
+
+	//When
+	uint64_t hash = config.getHash();
+
+	//Then
+	EXPECT_EQ(hash, noise::NoiseConfigParameters(0, 1.0f, 2.0f).getHash()) << "FAILED! Identical configs hashed differently.";
+	EXPECT_NE(hash, swapped.getHash()) << "FAILED! Swapped offsets collide.";
+	EXPECT_NE(hash, ridged.getHash()) << "FAILED! Ridge is not hashed.";
+	EXPECT_NE(hash, otherOption.getHash()) << "FAILED! Option is not hashed.";
+	EXPECT_NE(hash, otherSeed.getHash());
+	EXPECT_EQ(config.getHash(false), otherSeed.getHash(false)) << "FAILED! Seed hashed when it should be left out.";
+}
+
+TEST(generationCacheUnitTests, terrainConfigHashTest) {
+	//Given
+	TerrainGenerator first, second, otherSpline, otherBiome, otherSeeLevel;
+	setupTestTerrain(first, 4, 3, 6);
+	setupTestTerrain(second, 4, 3, 6);
+	setupTestTerrain(otherSpline, 4, 3, 6);
+	otherSpline.setSplines({ {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 71.0},
+							{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},
+							{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} });
+	setupTestTerrain(otherBiome, 4, 3, 6);
+	std::vector<biome::Biome> biomes = { biome::Biome(0, "Grassplains", {1, 3}, {1, 4}, {3, 5}, {0, 3}, 3, 5 * 5 * 0.2f) };
+	otherBiome.setBiomes(biomes);
+	setupTestTerrain(otherSeeLevel, 4, 3, 6);
+	otherSeeLevel.setSeeLevel(31.0f);
+
+	//When
+	uint64_t before = first.getConfigHash();
+	first.performTerrainGeneration();
+	uint64_t after = first.getConfigHash();
+
+	//Then
+	EXPECT_EQ(before, after) << "FAILED! Generation changed the config hash.";
+	EXPECT_EQ(before, second.getConfigHash()) << "FAILED! Identical configs hashed differently.";
+	EXPECT_NE(before, otherSpline.getConfigHash()) << "FAILED! Splines are not hashed.";
+	EXPECT_NE(before, otherBiome.getConfigHash()) << "FAILED! Biomes are not hashed.";
+	EXPECT_NE(before, otherSeeLevel.getConfigHash()) << "FAILED! See level is not hashed.";
+}
+
+TEST(generationCacheUnitTests, diskCacheTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "generationCacheTest";
+	std::filesystem::remove_all(directory);
+
+	TerrainGenerator generated;
+	setupTestTerrain(generated, 4, 3, 6);
+	generated.setCacheDirectory(directory.string());
+	generated.performTerrainGeneration();
+
+	TerrainGenerator cached;
+	setupTestTerrain(cached, 4, 3, 6);
+	cached.setCacheDirectory(directory.string());
+	std::atomic<int> meshedChunks{ 0 };
+	cached.setChunkMeshCallback([&meshedChunks](int, int) { meshedChunks++; });
+
+	//When
+	bool result = cached.performTerrainGeneration();
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Terrain couldnt be loaded from the cache.";
+	EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 1) << "FAILED! World was cached again.";
+	EXPECT_EQ(meshedChunks.load(), 4 * 3) << "FAILED! Cached chunks were not meshed.";
+	for (int y = 0; y < generated.getHeight(); y++)
+		for (int x = 0; x < generated.getWidth(); x++)
+			ASSERT_EQ(generated.getHeightAt(x, y), cached.getHeightAt(x, y)) << "FAILED! Cached heights differ at " << x << ", " << y;
+	EXPECT_EQ(generated.getTreeCount(), cached.getTreeCount());
+
+	TerrainGenerator otherSeed;
+	setupTestTerrain(otherSeed, 4, 3, 6);
+	otherSeed.setSeed(743);
+	otherSeed.setCacheDirectory(directory.string());
+	otherSeed.performTerrainGeneration();
+	EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 2) << "FAILED! Different config hit the cache.";
+
+	std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,125 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "GenerationConfig.h"
+
+static std::filesystem::path writeConfig(const std::string& name, const std::string& text)
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+	std::ofstream file(path);
+	file << text;
+	return path;
+}
+
+TEST(generationConfigUnitTests, saveLoadRoundTripTest) {
+	//Given
+	config::GenerationConfig saved = config::defaultConfig();
+	saved.seed = -17;
+	saved.width = 3;
+	saved.mapLayout = layout::MapLayout::ROW_MAJOR;
+	saved.continentalness.scale = 0.1234567f;
+	saved.mountainous.islandType = noise::IslandType::SQUIRCLE;
+	saved.PV.ridge = false;
+	saved.humidity.option = noise::Options::FLATTEN_NEGATIVES;
+	saved.splines[3] = { 0.0, 1.0e-7, 50.5, 60.0, 70.0, 80.0, 100.0, 170.25 };
+	saved.erosion.erosionRadius = 5;
+	saved.erosion.inertia = 0.3f;
+	saved.dropletCount = 12345;
+	saved.erosionEngine = erosion::ErosionEngine::PIPE;
+	saved.pipeErosion.rainRate = 0.125f;
+	saved.pipeErosion.iterations = 40;
+	saved.chunkedErosion = true;
+	saved.erosionHalo = 6;
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "generationConfigRoundTrip.ini";
+	config::GenerationConfig loaded = config::defaultConfig();
+
+	//When
+	bool result = config::saveConfig(path.string(), saved) && config::loadConfig(path.string(), loaded);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Config couldnt be saved and loaded.";
+	EXPECT_EQ(loaded.seed, -17);
+	EXPECT_EQ(loaded.width, 3);
+	EXPECT_EQ(loaded.mapLayout, layout::MapLayout::ROW_MAJOR);
+	EXPECT_EQ(loaded.continentalness.getHash(), saved.continentalness.getHash()) << "FAILED! Continentalness noise changed.";
+	EXPECT_EQ(loaded.mountainous.getHash(), saved.mountainous.getHash()) << "FAILED! Mountainous noise changed.";
+	EXPECT_EQ(loaded.PV.getHash(), saved.PV.getHash()) << "FAILED! PV noise changed.";
+	EXPECT_EQ(loaded.temperature.getHash(), saved.temperature.getHash());
+	EXPECT_EQ(loaded.humidity.getHash(), saved.humidity.getHash());
+	EXPECT_EQ(loaded.splines, saved.splines) << "FAILED! Spline points not read back exactly.";
+	EXPECT_EQ(loaded.erosion.erosionRadius, 5);
+	EXPECT_EQ(loaded.erosion.inertia, 0.3f);
+	EXPECT_EQ(loaded.dropletCount, 12345);
+	EXPECT_EQ(loaded.erosionEngine, erosion::ErosionEngine::PIPE);
+	EXPECT_EQ(loaded.pipeErosion.rainRate, 0.125f);
+	EXPECT_EQ(loaded.pipeErosion.iterations, 40);
+	EXPECT_TRUE(loaded.chunkedErosion);
+	EXPECT_EQ(loaded.erosionHalo, 6);
+
+	std::filesystem::remove(path);
+}
+
+TEST(generationConfigUnitTests, partialAndInvalidFilesTest) {
+	//Given
+	std::filesystem::path partial = writeConfig("generationConfigPartial.ini",
+		"# only a few keys\n\n[world]\nseed = 99\n  chunkResolution=32  \n[pv]\noption = nothing\nsplineX = -1, 0, 1\nsplineY = 1, 0.5, 0\n[erosion]\ndroplets = 500\n");
+	std::filesystem::path unknownKey = writeConfig("generationConfigUnknown.ini", "[world]\nseed = 1\n[mountainous]\nfrequency = 2\n");
+	std::filesystem::path badValue = writeConfig("generationConfigBadValue.ini", "[world]\nwidth = -4\n");
+	std::filesystem::path badSpline = writeConfig("generationConfigBadSpline.ini", "[continentalness]\nsplineX = -1, 1\nsplineY = 0, 1, 2\n");
+	config::GenerationConfig defaults = config::defaultConfig();
+	config::GenerationConfig loaded = defaults;
+	config::GenerationConfig untouched = defaults;
+
+	//When
+	bool result = config::loadConfig(partial.string(), loaded);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Partial config couldnt be loaded.";
+	EXPECT_EQ(loaded.seed, 99);
+	EXPECT_EQ(loaded.chunkResolution, 32);
+	EXPECT_EQ(loaded.width, defaults.width) << "FAILED! Missing key didnt keep the default.";
+	EXPECT_EQ(loaded.PV.option, noise::Options::NOTHING);
+	EXPECT_EQ(loaded.splines[4], std::vector<double>({ -1.0, 0.0, 1.0 }));
+	EXPECT_EQ(loaded.splines[0], defaults.splines[0]);
+	EXPECT_EQ(loaded.dropletCount, 500);
+
+	EXPECT_FALSE(config::loadConfig(unknownKey.string(), untouched)) << "FAILED! Unknown key accepted.";
+	EXPECT_FALSE(config::loadConfig(badValue.string(), untouched)) << "FAILED! Negative width accepted.";
+	EXPECT_FALSE(config::loadConfig(badSpline.string(), untouched)) << "FAILED! Spline of different sizes accepted.";
+	EXPECT_FALSE(config::loadConfig("missingGenerationConfig.ini", untouched));
+	EXPECT_EQ(untouched.seed, defaults.seed) << "FAILED! Config changed by the invalid file.";
+
+	for (auto& path : { partial, unknownKey, badValue, badSpline })
+		std::filesystem::remove(path);
+}
+
+TEST(generationConfigUnitTests, appliedConfigGenerationTest) {
+	//Given
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	generationConfig.width = 3;
+	generationConfig.height = 2;
+	generationConfig.chunkResolution = 16;
+	TerrainGenerator first, second, otherSeed;
+	for (TerrainGenerator* terrainGen : { &first, &second, &otherSeed })
+		terrainGen->setChunkCache(nullptr);
+
+	//When
+	bool result = config::applyConfig(generationConfig, first) && config::applyConfig(generationConfig, second);
+	generationConfig.seed++;
+	result = result && config::applyConfig(generationConfig, otherSeed);
+	bool generated = result && first.performTerrainGeneration() && second.performTerrainGeneration();
+
+	//Then
+	ASSERT_TRUE(generated) << "FAILED! Terrain couldnt be generated from the config.";
+	EXPECT_EQ(first.getWidth(), 3 * 16);
+	EXPECT_EQ(first.getHeight(), 2 * 16);
+	EXPECT_EQ(first.getMapLayout(), layout::MapLayout::CHUNK_MAJOR);
+	EXPECT_EQ(first.getConfigHash(), second.getConfigHash());
+	EXPECT_NE(first.getConfigHash(), otherSeed.getConfigHash()) << "FAILED! Seed of the config not applied.";
+	for (int y = 0; y < first.getHeight(); y++)
+		for (int x = 0; x < first.getWidth(); x++)
+			ASSERT_EQ(first.getHeightAt(x, y), second.getHeightAt(x, y)) << "FAILED! Same config generated different terrain.";
+}
@@ -0,0 +1,171 @@
+#include "pch.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Erosion.h"
+#include "HeightFile.h"
+
+static std::filesystem::path writeFile(const std::string& name, const std::string& header, const std::vector<uint8_t>& samples)
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / name;
+	std::ofstream file(path, std::ios::binary);
+	file.write(header.data(), header.size());
+	file.write(reinterpret_cast<const char*>(samples.data()), samples.size());
+	return path;
+}
+
+//16 bit samples of the 7 x 5 map, value of the sample is 1000 * y + x
+static std::vector<uint8_t> createSamples16(bool bigEndian)
+{
+	std::vector<uint8_t> samples;
+	for (int y = 0; y < 5; y++) {
+		for (int x = 0; x < 7; x++) {
+			uint16_t value = static_cast<uint16_t>(1000 * y + x);
+			samples.push_back(static_cast<uint8_t>(bigEndian ? value >> 8 : value & 0xFF));
+			samples.push_back(static_cast<uint8_t>(bigEndian ? value & 0xFF : value >> 8));
+		}
+	}
+	return samples;
+}
+
+TEST(heightFileUnitTests, raw16RegionImportTest) {
+	//Given
+	std::filesystem::path littlePath = writeFile("heightFileLittle.raw", "", createSamples16(false));
+	std::filesystem::path bigPath = writeFile("heightFileBig.raw", "", createSamples16(true));
+	heightfile::MappedHeightFile little, big;
+	std::vector<float> region(4 * 3, -1.0f);
+	std::vector<float> bigRegion(4 * 3, -1.0f);
+
+	//When
+	bool openResult = little.openRaw(littlePath.string(), 7, 5, heightfile::SampleFormat::UINT16) &&
+		big.openRaw(bigPath.string(), 7, 5, heightfile::SampleFormat::UINT16, true);
+	//Region 3 x 3 from (2, 1) into the destination with rows of 4 floats
+	bool readResult = little.readRegion(2, 1, 3, 3, region.data(), 4, 65535.0f, 10.0f) &&
+		big.readRegion(2, 1, 3, 3, bigRegion.data(), 4, 65535.0f, 10.0f);
+
+	//Then
+	ASSERT_TRUE(openResult && readResult) << "FAILED! RAW file couldnt be read.";
+	for (int y = 0; y < 3; y++) {
+		for (int x = 0; x < 3; x++) {
+			EXPECT_FLOAT_EQ(region[y * 4 + x], 1000.0f * (y + 1) + x + 2 + 10.0f) << "FAILED! Wrong sample at " << x << ", " << y;
+			EXPECT_FLOAT_EQ(bigRegion[y * 4 + x], region[y * 4 + x]) << "FAILED! Byte order not respected.";
+		}
+		EXPECT_EQ(region[y * 4 + 3], -1.0f) << "FAILED! Written past the region.";
+	}
+	EXPECT_FLOAT_EQ(little.getSample(6, 4), 4006.0f / 65535.0f);
+	EXPECT_FALSE(little.readRegion(5, 0, 3, 1, region.data(), 4)) << "FAILED! Region out of the file read.";
+
+	little.close();
+	big.close();
+	std::filesystem::remove(littlePath);
+	std::filesystem::remove(bigPath);
+}
+
+TEST(heightFileUnitTests, pgmImportTest) {
+	//Given
+	std::filesystem::path path16 = writeFile("heightFile16.pgm", "P5\n# exported by the test\n7 5\n# maxval\n5000\n", createSamples16(true));
+	std::vector<uint8_t> samples8(6 * 2);
+	for (size_t i = 0; i < samples8.size(); i++)
+		samples8[i] = static_cast<uint8_t>(i * 20);
+	std::filesystem::path path8 = writeFile("heightFile8.pgm", "P5 6 2 240 ", samples8);
+	std::filesystem::path truncated = writeFile("heightFileTruncated.pgm", "P5\n7 5\n65535\n", std::vector<uint8_t>(30));
+	std::filesystem::path wrongMagic = writeFile("heightFileMagic.pgm", "P2\n7 5\n65535\n", createSamples16(true));
+	heightfile::MappedHeightFile file16, file8, invalid;
+
+	//When
+	bool result16 = file16.openPgm(path16.string());
+	bool result8 = file8.openPgm(path8.string());
+
+	//Then
+	ASSERT_TRUE(result16 && result8) << "FAILED! PGM files couldnt be opened.";
+	EXPECT_EQ(file16.getWidth(), 7);
+	EXPECT_EQ(file16.getHeight(), 5);
+	EXPECT_EQ(file16.getFormat(), heightfile::SampleFormat::UINT16);
+	EXPECT_FLOAT_EQ(file16.getSample(3, 2), 2003.0f / 5000.0f) << "FAILED! Sample not normalized by maxval.";
+	EXPECT_EQ(file8.getFormat(), heightfile::SampleFormat::UINT8);
+	EXPECT_FLOAT_EQ(file8.getSample(5, 1), 220.0f / 240.0f);
+	EXPECT_FALSE(invalid.openPgm(truncated.string())) << "FAILED! Truncated PGM opened.";
+	EXPECT_FALSE(invalid.openPgm(wrongMagic.string())) << "FAILED! Text PGM opened as binary.";
+
+	file16.close();
+	file8.close();
+	for (auto& path : { path16, path8, truncated, wrongMagic })
+		std::filesystem::remove(path);
+}
+
+TEST(heightFileUnitTests, float32IntoErosionTest) {
+	//Given
+	std::vector<float> heights(9 * 6);
+	for (size_t i = 0; i < heights.size(); i++)
+		heights[i] = std::sin(i * 0.3f) * 20.0f;
+	std::vector<uint8_t> bytes(heights.size() * sizeof(float));
+	std::memcpy(bytes.data(), heights.data(), bytes.size());
+	std::filesystem::path path = writeFile("heightFileFloat.raw", "", bytes);
+	heightfile::MappedHeightFile file;
+	erosion::Erosion erosion(1, 1);
+
+	//When
+	bool result = file.openRaw(path.string(), 9, 6, heightfile::SampleFormat::FLOAT32) && erosion.LoadMap(file, 2.0f);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Float RAW couldnt be loaded into the erosion.";
+	EXPECT_EQ(erosion.getWidth(), 9);
+	EXPECT_EQ(erosion.getHeight(), 6);
+	for (size_t i = 0; i < heights.size(); i++)
+		ASSERT_EQ(erosion.getMap()[i], heights[i] * 2.0f) << "FAILED! Wrong height at " << i;
+	EXPECT_FALSE(file.openRaw(path.string(), 10, 6, heightfile::SampleFormat::FLOAT32)) << "FAILED! File smaller than the map opened.";
+
+	std::filesystem::remove(path);
+}
+
+TEST(heightFileUnitTests, tiledExportRoundTripTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 4);
+	float* heightMap = layout::allocateMap<float>(indexer.size());
+	for (int y = 0; y < 8; y++)
+		for (int x = 0; x < 15; x++)
+			heightMap[indexer.index(x, y)] = std::sin(x * 0.5f) * 40.0f + y * 3.0f + 60.0f;
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "heightFileTiles";
+	std::filesystem::create_directories(directory);
+	std::string prefix = (directory / "terrain").string();
+	heightfile::HeightRange range = heightfile::findHeightRange(heightMap, indexer);
+
+	//When
+	bool pgmResult = heightfile::exportTiles(prefix, heightMap, indexer, 4, heightfile::FileType::PGM, range);
+	bool rawResult = heightfile::exportTiles(prefix, heightMap, indexer, 4, heightfile::FileType::RAW, range);
+
+	//Then
+	ASSERT_TRUE(pgmResult && rawResult) << "FAILED! Tiles couldnt be exported.";
+	EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 2 * 4 * 2);
+
+	float step = (range.maxHeight - range.minHeight) / 65535.0f;
+	for (int tileY = 0; tileY < 2; tileY++) {
+		for (int tileX = 0; tileX < 4; tileX++) {
+			std::string name = prefix + "_x" + std::to_string(tileX) + "_y" + std::to_string(tileY);
+			int tileWidth = tileX == 3 ? 3 : 4;
+			heightfile::MappedHeightFile pgm, raw;
+			ASSERT_TRUE(pgm.openPgm(name + ".pgm")) << "FAILED! Tile " << name << " couldnt be opened.";
+			ASSERT_TRUE(raw.openRaw(name + ".raw", tileWidth, 4, heightfile::SampleFormat::UINT16));
+			EXPECT_EQ(pgm.getWidth(), tileWidth) << "FAILED! Border tile has the wrong size.";
+
+			std::vector<float> pgmHeights(tileWidth * 4), rawHeights(tileWidth * 4);
+			pgm.readRegion(0, 0, tileWidth, 4, pgmHeights.data(), tileWidth, range.maxHeight - range.minHeight, range.minHeight);
+			raw.readRegion(0, 0, tileWidth, 4, rawHeights.data(), tileWidth, range.maxHeight - range.minHeight, range.minHeight);
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < tileWidth; x++) {
+					float expected = heightMap[indexer.index(tileX * 4 + x, tileY * 4 + y)];
+					EXPECT_NEAR(pgmHeights[y * tileWidth + x], expected, step) << "FAILED! Height lost more than the quantization step.";
+					EXPECT_EQ(rawHeights[y * tileWidth + x], pgmHeights[y * tileWidth + x]);
+				}
+			}
+		}
+	}
+
+	layout::releaseMap(heightMap);
+	std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,232 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+
+TEST(jobSystemUnitTests, parallelForVisitsEveryCellTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	int width = 37, height = 23;
+	std::vector<int> visits(width * height, 0);
+
+	//When
+	jobs::JobSystem::get().parallel_for2D(width, height, 5, 3, [&](int x, int y) {
+		visits[y * width + x]++;
+	});
+
+	//Then
+	for (int i = 0; i < width * height; i++)
+		EXPECT_EQ(visits[i], 1) << "FAILED! Cell " << i << " was visited " << visits[i] << " times";
+}
+
+TEST(jobSystemUnitTests, nestedParallelForTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	int outer = 16, inner = 64;
+	std::vector<int> result(outer * inner, 0);
+
+	//When
+	jobs::JobSystem::get().parallel_for(0, outer, 1, [&](int i) {
+		jobs::JobSystem::get().parallel_for(0, inner, 4, [&](int j) {
+			result[i * inner + j] = i * j;
+		});
+	});
+
+	//Then
+	for (int i = 0; i < outer; i++)
+		for (int j = 0; j < inner; j++)
+			EXPECT_EQ(result[i * inner + j], i * j);
+}
+
+TEST(jobSystemUnitTests, submittedTasksFinishedTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(3);
+	jobs::TaskGroup group;
+	std::atomic<int> counter{ 0 };
+	int expected = 100;
+
+	//When
+	for (int i = 0; i < expected; i++)
+		jobs::JobSystem::get().submit(group, [&counter]() { counter++; });
+	jobs::JobSystem::get().wait(group);
+
+	//Then
+	EXPECT_EQ(counter.load(), expected) << "FAILED! Not every submitted task was executed";
+}
+
+TEST(jobSystemUnitTests, throwingTaskRethrownByWaitTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	jobs::TaskGroup group;
+	std::atomic<int> counter{ 0 };
+
+	//When
+	for (int i = 0; i < 20; i++) {
+		jobs::JobSystem::get().submit(group, [i, &counter]() {
+			counter++;
+			if (i == 7)
+				throw std::runtime_error("task failed");
+		});
+	}
+
+	//Then
+	EXPECT_THROW(jobs::JobSystem::get().wait(group), std::runtime_error) << "FAILED! Exception of the task was lost";
+	EXPECT_EQ(counter.load(), 20) << "FAILED! Not every task was executed";
+	EXPECT_EQ(group.pending.load(), 0);
+}
+
+TEST(jobSystemUnitTests, throwingGraphNodeSkipsSuccessorsTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	std::atomic<bool> successorRan{ false };
+	jobs::TaskGraph graph;
+	int failing = graph.addNode([]() { throw std::runtime_error("node failed"); });
+	int successor = graph.addNode([&successorRan]() { successorRan = true; });
+	graph.addDependency(failing, successor);
+
+	//When, Then
+	EXPECT_THROW(graph.run(), std::runtime_error) << "FAILED! Exception of the node was lost";
+	EXPECT_FALSE(successorRan.load()) << "FAILED! Successor of the failed node was executed";
+}
+
+TEST(jobSystemUnitTests, unchangedThreadCountNotLoggedTest) {
+	//Given
+	unsigned int threadCount = jobs::JobSystem::get().getThreadCount();
+	jobs::JobSystem::get().setThreadCount(3);
+
+	//When
+	testing::internal::CaptureStdout();
+	for (int i = 0; i < 10; i++)
+		jobs::JobSystem::get().setThreadCount(3);
+	std::string unchanged = testing::internal::GetCapturedStdout();
+
+	testing::internal::CaptureStdout();
+	jobs::JobSystem::get().setThreadCount(2);
+	std::string changed = testing::internal::GetCapturedStdout();
+	jobs::JobSystem::get().setThreadCount(threadCount);
+
+	//Then
+	EXPECT_TRUE(unchanged.empty()) << "FAILED! Setting the same thread count was logged: " << unchanged;
+	EXPECT_NE(changed.find("[LOG]"), std::string::npos) << "FAILED! Change of the thread count was not logged";
+}
+
+TEST(jobSystemUnitTests, heightMapThreadCountIndependenceTest) {
+	//Given
+	auto generate = [](unsigned int threads) {
+		jobs::JobSystem::get().setThreadCount(threads);
+		TerrainGenerator terrainGen;
+		terrainGen.setSize(6, 4);
+		terrainGen.setChunkResolution(8);
+		terrainGen.setSeed(742);
+		terrainGen.initializeMap();
+		terrainGen.setSplines({ {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 70.0},
+								{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},
+								{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} });
+		terrainGen.generateHeightMap();
+		return std::vector<float>(terrainGen.getHeightMap(), terrainGen.getHeightMap() + terrainGen.getWidth() * terrainGen.getHeight());
+	};
+
+	//When
+	std::vector<float> serial = generate(1);
+	std::vector<float> parallel = generate(4);
+
+	//Then
+	EXPECT_EQ(serial, parallel) << "FAILED! Height map depends on the number of threads";
+}
+
+TEST(jobSystemUnitTests, taskGraphDependencyOrderTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	int chainLength = 50;
+	std::vector<int> order;
+	std::mutex orderMutex;
+	jobs::TaskGraph graph;
+
+	int previous = -1;
+	for (int i = 0; i < chainLength; i++) {
+		int node = graph.addNode([i, &order, &orderMutex]() {
+			std::lock_guard<std::mutex> lock(orderMutex);
+			order.push_back(i);
+		});
+		if (previous >= 0)
+			graph.addDependency(previous, node);
+		previous = node;
+	}
+
+	//When
+	graph.run();
+
+	//Then
+	ASSERT_EQ(order.size(), chainLength) << "FAILED! Not every node of the graph was executed";
+	for (int i = 0; i < chainLength; i++)
+		EXPECT_EQ(order[i], i) << "FAILED! Node started before its dependency was finished";
+}
+
+TEST(jobSystemUnitTests, terrainPipelineMatchesStagedGenerationTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	std::vector<biome::Biome> biomes = {
+		biome::Biome(0, "Grassplains",	{1, 2}, {1, 4}, {3, 5}, {0, 3}, 3, 5 * 5 * 0.2f),
+		biome::Biome(1, "Desert",		{2, 4}, {0, 1}, {3, 5}, {0, 4}, 2, 5 * 5 * 0.01f),
+		biome::Biome(2, "Snow",			{0, 1}, {0, 4}, {3, 5}, {0, 4}, 7, 5 * 5 * 0.03f),
+		biome::Biome(3, "Sand",			{0, 4}, {0, 4}, {2, 3}, {0, 7}, 8, 5 * 5 * 0.01f),
+		biome::Biome(4, "Mountain",		{0, 4}, {0, 4}, {4, 5}, {4, 7}, 0, 5 * 5 * 0.02f),
+		biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, 5 * 5 * 0.0f)
+	};
+	std::vector<std::vector<RangedLevel>> ranges = {
+		{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+		{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+		{{-1.0f, -0.7f, 0},{-0.7f, -0.2f, 1},{ -0.2f, 0.03f, 2},{0.03f, 0.3f, 3},{0.3f, 1.1f, 4}},
+		{{-1.0f, -0.78f, 0},{-0.78f, -0.37f, 1},{-0.37f, -0.2f, 2},{-0.2f, 0.05f, 3},{0.05f, 0.45f, 4},{0.45f, 0.55f, 5},{0.55f, 1.1f, 6}}
+	};
+	auto setup = [&](TerrainGenerator& terrainGen) {
+		terrainGen.setSize(7, 5);
+		terrainGen.setChunkResolution(6);
+		terrainGen.setSeed(742);
+		terrainGen.getContinentalnessNoiseConfig().scale = 0.05f;
+		terrainGen.getMountainousNoiseConfig().scale = 0.05f;
+		terrainGen.getPVNoiseConfig().scale = 0.05f;
+		terrainGen.initializeMap();
+		terrainGen.setSplines({ {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 70.0},
+								{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},
+								{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} });
+		terrainGen.setBiomes(biomes);
+		terrainGen.setRanges(ranges);
+	};
+
+	TerrainGenerator staged;
+	setup(staged);
+	staged.generateHeightMap();
+	staged.generateBiomes();
+	staged.generateBiomeMapPerChunk();
+	staged.vegetationGeneration();
+
+	TerrainGenerator pipelined;
+	setup(pipelined);
+	std::atomic<int> meshedChunks{ 0 };
+	pipelined.setChunkMeshCallback([&meshedChunks](int, int) { meshedChunks++; });
+
+	//When
+	bool result = pipelined.performTerrainGeneration();
+
+	//Then
+	int size = staged.getWidth() * staged.getHeight();
+	EXPECT_TRUE(result) << "FAILED! Terrain generation failed.";
+	EXPECT_EQ(std::vector<float>(staged.getHeightMap(), staged.getHeightMap() + size),
+		std::vector<float>(pipelined.getHeightMap(), pipelined.getHeightMap() + size)) << "FAILED! Height maps differ";
+	EXPECT_EQ(std::vector<int>(staged.getBiomeMap(), staged.getBiomeMap() + size),
+		std::vector<int>(pipelined.getBiomeMap(), pipelined.getBiomeMap() + size)) << "FAILED! Biome maps differ";
+	auto stagedX = staged.getVegetation().getX(), pipelinedX = pipelined.getVegetation().getX();
+	auto stagedY = staged.getVegetation().getY(), pipelinedY = pipelined.getVegetation().getY();
+	EXPECT_TRUE(std::equal(stagedX.begin(), stagedX.end(), pipelinedX.begin(), pipelinedX.end())) << "FAILED! Vegetation differs";
+	EXPECT_TRUE(std::equal(stagedY.begin(), stagedY.end(), pipelinedY.begin(), pipelinedY.end())) << "FAILED! Vegetation differs";
+	EXPECT_EQ(staged.getTreeCount(), pipelined.getTreeCount());
+	EXPECT_EQ(meshedChunks.load(), 7 * 5) << "FAILED! Mesh callback was not called once per chunk";
+}
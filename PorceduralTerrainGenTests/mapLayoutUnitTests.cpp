@@ -0,0 +1,108 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MapLayout.h"
+#include "TerrainGenerator.h"
+#include "testTerrain.h"
+
+TEST(mapLayoutUnitTests, chunkMajorIndexerTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 5);
+	std::vector<int> visits(indexer.size(), 0);
+
+	//When
+	for (int y = 0; y < 2 * 5; y++)
+		for (int x = 0; x < 3 * 5; x++)
+			visits[indexer.index(x, y)]++;
+
+	//Then
+	EXPECT_EQ(indexer.chunkStride * sizeof(float) % layout::MAP_ALIGNMENT, 0) << "FAILED! Chunk blocks are not aligned.";
+	EXPECT_EQ(indexer.index(5, 0), indexer.chunkOffset(1, 0));
+	EXPECT_EQ(indexer.index(6, 5), indexer.chunkOffset(1, 1) + 1);
+	EXPECT_EQ(indexer.index(5, 1), indexer.chunkOffset(1, 0) + 5) << "FAILED! Rows of the chunk are not contiguous.";
+	EXPECT_EQ(std::count(visits.begin(), visits.end(), 1), 3 * 2 * 5 * 5) << "FAILED! Cells share the index.";
+	EXPECT_EQ(std::count(visits.begin(), visits.end(), 2), 0);
+}
+
+TEST(mapLayoutUnitTests, convertLayoutRoundTripTest) {
+	//Given
+	layout::MapIndexer rowMajor(layout::MapLayout::ROW_MAJOR, 3, 2, 5, 5);
+	layout::MapIndexer chunkMajor(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 5);
+	std::vector<float> source(rowMajor.size());
+	for (size_t i = 0; i < source.size(); i++)
+		source[i] = static_cast<float>(i);
+	float* converted = layout::allocateMap<float>(chunkMajor.size());
+	std::vector<float> result(rowMajor.size());
+
+	//When
+	bool toChunks = layout::convertLayout(source.data(), rowMajor, converted, chunkMajor);
+	bool toRows = layout::convertLayout(converted, chunkMajor, result.data(), rowMajor);
+
+	//Then
+	EXPECT_TRUE(toChunks && toRows) << "FAILED! Conversion failed.";
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(converted) % layout::MAP_ALIGNMENT, 0) << "FAILED! Map is not aligned.";
+	EXPECT_EQ(converted[chunkMajor.index(7, 8)], source[rowMajor.index(7, 8)]);
+	EXPECT_EQ(result, source) << "FAILED! Round trip changed the map.";
+	layout::releaseMap(converted);
+}
+
+TEST(mapLayoutUnitTests, chunkMajorGenerationTest) {
+	//Given
+	jobs::JobSystem::get().setThreadCount(4);
+	TerrainGenerator rowMajor, chunkMajor;
+	setupTestTerrain(rowMajor, 5, 3, 7, layout::MapLayout::ROW_MAJOR);
+	setupTestTerrain(chunkMajor, 5, 3, 7, layout::MapLayout::CHUNK_MAJOR);
+
+	//When
+	bool rowResult = rowMajor.performTerrainGeneration();
+	bool chunkResult = chunkMajor.performTerrainGeneration();
+
+	//Then
+	ASSERT_TRUE(rowResult && chunkResult) << "FAILED! Terrain generation failed.";
+	for (int y = 0; y < rowMajor.getHeight(); y++) {
+		for (int x = 0; x < rowMajor.getWidth(); x++) {
+			EXPECT_EQ(rowMajor.getHeightAt(x, y), chunkMajor.getHeightAt(x, y)) << "FAILED! Heights differ at " << x << ", " << y;
+			EXPECT_EQ(rowMajor.getBiomeAt(x, y), chunkMajor.getBiomeAt(x, y)) << "FAILED! Biomes differ at " << x << ", " << y;
+		}
+	}
+	auto rowX = rowMajor.getVegetation().getX(), chunkX = chunkMajor.getVegetation().getX();
+	auto rowHeights = rowMajor.getVegetation().getHeight(), chunkHeights = chunkMajor.getVegetation().getHeight();
+	EXPECT_GT(rowMajor.getTreeCount(), 0);
+	EXPECT_TRUE(std::equal(rowX.begin(), rowX.end(), chunkX.begin(), chunkX.end())) << "FAILED! Vegetation differs";
+	EXPECT_TRUE(std::equal(rowHeights.begin(), rowHeights.end(), chunkHeights.begin(), chunkHeights.end())) << "FAILED! Vegetation differs";
+
+	std::span<const float> chunk = chunkMajor.getHeightChunk(2, 1);
+	ASSERT_EQ(chunk.size(), 7 * 7);
+	EXPECT_EQ(chunk[3 * 7 + 4], rowMajor.getHeightAt(2 * 7 + 4, 1 * 7 + 3)) << "FAILED! Chunk block is not ordered row by row.";
+	EXPECT_TRUE(rowMajor.getHeightChunk(2, 1).empty());
+
+	std::vector<float> copy(chunkMajor.getWidth() * chunkMajor.getHeight());
+	EXPECT_TRUE(chunkMajor.copyHeightMap(copy.data()));
+	EXPECT_EQ(copy, std::vector<float>(rowMajor.getHeightMap(), rowMajor.getHeightMap() + copy.size())) << "FAILED! Row-major copy differs.";
+}
+
+TEST(mapLayoutUnitTests, setMapLayoutConvertsMapsTest) {
+	//Given
+	TerrainGenerator terrainGen;
+	setupTestTerrain(terrainGen, 5, 3, 7, layout::MapLayout::ROW_MAJOR);
+	terrainGen.performTerrainGeneration();
+	std::vector<float> heights(terrainGen.getHeightMap(), terrainGen.getHeightMap() + terrainGen.getWidth() * terrainGen.getHeight());
+	std::vector<int> biomes(terrainGen.getBiomeMap(), terrainGen.getBiomeMap() + terrainGen.getWidth() * terrainGen.getHeight());
+
+	//When
+	bool result = terrainGen.setMapLayout(layout::MapLayout::CHUNK_MAJOR);
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Maps couldnt be converted.";
+	EXPECT_EQ(terrainGen.getMapLayout(), layout::MapLayout::CHUNK_MAJOR);
+	for (int y = 0; y < terrainGen.getHeight(); y++) {
+		for (int x = 0; x < terrainGen.getWidth(); x++) {
+			EXPECT_EQ(terrainGen.getHeightAt(x, y), heights[y * terrainGen.getWidth() + x]);
+			EXPECT_EQ(terrainGen.getBiomeAt(x, y), biomes[y * terrainGen.getWidth() + x]);
+		}
+	}
+}
@@ -0,0 +1,197 @@
+#include "pch.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MeshExport.h"
+
+//Height map of 3 x 2 chunks of 5 x 4 samples, heights are a known function of the coordinates
+static float* createHeightMap(const layout::MapIndexer& indexer)
+{
+	float* heightMap = layout::allocateMap<float>(indexer.size());
+	for (int y = 0; y < indexer.height * indexer.chunkHeight; y++)
+		for (int x = 0; x < indexer.width * indexer.chunkWidth; x++)
+			heightMap[indexer.index(x, y)] = std::sin(x * 0.7f) * 3.0f + y * 0.25f;
+	return heightMap;
+}
+
+static std::vector<char> readFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST(meshExportUnitTests, glbStructureTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 4);
+	float* heightMap = createHeightMap(indexer);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "meshExportTest.glb";
+	int width = 15, height = 8;
+
+	//When
+	bool result = exporter::exportGlb(path.string(), heightMap, indexer, 2.0f);
+	std::vector<char> data = readFile(path);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Terrain couldnt be exported.";
+	ASSERT_GE(data.size(), 28);
+	uint32_t header[5];
+	std::memcpy(header, data.data(), sizeof(header));
+	EXPECT_EQ(header[0], 0x46546C67u) << "FAILED! Wrong magic.";
+	EXPECT_EQ(header[1], 2);
+	EXPECT_EQ(header[2], data.size()) << "FAILED! Length in the header doesnt match the file.";
+	EXPECT_EQ(header[3] % 4, 0);
+	EXPECT_EQ(header[4], 0x4E4F534Au);
+
+	std::string json(data.data() + 20, header[3]);
+	EXPECT_NE(json.find("\"count\":120"), std::string::npos) << "FAILED! Vertex count missing in the json.";
+	EXPECT_NE(json.find("\"count\":" + std::to_string(14 * 7 * 6)), std::string::npos) << "FAILED! Index count missing in the json.";
+
+	const char* binary = data.data() + 20 + header[3];
+	uint32_t binaryChunk[2];
+	std::memcpy(binaryChunk, binary, sizeof(binaryChunk));
+	EXPECT_EQ(binaryChunk[0], width * height * 32 + 14 * 7 * 6 * 4);
+	EXPECT_EQ(binaryChunk[1], 0x004E4942u);
+
+	float vertex[8];
+	int x = 7, y = 5;
+	std::memcpy(vertex, binary + 8 + (y * width + x) * 32, sizeof(vertex));
+	EXPECT_FLOAT_EQ(vertex[0], x * 2.0f);
+	EXPECT_FLOAT_EQ(vertex[1], heightMap[indexer.index(x, y)] * 2.0f);
+	EXPECT_FLOAT_EQ(vertex[2], y * 2.0f);
+	EXPECT_NEAR(vertex[3] * vertex[3] + vertex[4] * vertex[4] + vertex[5] * vertex[5], 1.0f, 1e-5f) << "FAILED! Normal not normalized.";
+	EXPECT_GT(vertex[4], 0.0f) << "FAILED! Normal points down.";
+
+	uint32_t indices[6];
+	std::memcpy(indices, binary + 8 + width * height * 32, sizeof(indices));
+	EXPECT_EQ(std::vector<uint32_t>(indices, indices + 6), std::vector<uint32_t>({ 0, 16, 1, 0, 15, 16 })) << "FAILED! Wrong triangles of the first cell.";
+
+	layout::releaseMap(heightMap);
+	std::filesystem::remove(path);
+}
+
+TEST(meshExportUnitTests, plyFacesPointUpTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::ROW_MAJOR, 3, 2, 5, 4);
+	float* heightMap = createHeightMap(indexer);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "meshExportTest.ply";
+	int vertexCount = 15 * 8, faceCount = 14 * 7 * 2;
+
+	//When
+	bool result = exporter::exportPly(path.string(), heightMap, indexer, 1.0f);
+	std::vector<char> data = readFile(path);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Terrain couldnt be exported.";
+	std::string text(data.begin(), data.end());
+	size_t headerEnd = text.find("end_header\n");
+	ASSERT_NE(headerEnd, std::string::npos) << "FAILED! Header not terminated.";
+	EXPECT_NE(text.find("element vertex " + std::to_string(vertexCount) + "\n"), std::string::npos);
+	EXPECT_NE(text.find("element face " + std::to_string(faceCount) + "\n"), std::string::npos);
+	const char* body = data.data() + headerEnd + 11;
+	ASSERT_EQ(data.size(), headerEnd + 11 + vertexCount * 32 + faceCount * 13) << "FAILED! Wrong size of the body.";
+
+	std::vector<float> vertices(vertexCount * 8);
+	std::memcpy(vertices.data(), body, vertexCount * 32);
+	for (int i = 0; i < faceCount; i++) {
+		const char* face = body + vertexCount * 32 + i * 13;
+		ASSERT_EQ(face[0], 3);
+		uint32_t index[3];
+		std::memcpy(index, face + 1, sizeof(index));
+		ASSERT_TRUE(index[0] < static_cast<uint32_t>(vertexCount) && index[1] < static_cast<uint32_t>(vertexCount) && index[2] < static_cast<uint32_t>(vertexCount)) << "FAILED! Index out of range.";
+
+		//Y of the cross product of the edges, counter-clockwise from above gives upward normal
+		const float* a = &vertices[index[0] * 8];
+		const float* b = &vertices[index[1] * 8];
+		const float* c = &vertices[index[2] * 8];
+		float normalY = (b[2] - a[2]) * (c[0] - a[0]) - (b[0] - a[0]) * (c[2] - a[2]);
+		EXPECT_GT(normalY, 0.0f) << "FAILED! Face " << i << " points down.";
+	}
+
+	layout::releaseMap(heightMap);
+	std::filesystem::remove(path);
+}
+
+TEST(meshExportUnitTests, objOneBasedFacesTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 4);
+	float* heightMap = createHeightMap(indexer);
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "meshExportTest.obj";
+
+	//When
+	bool result = exporter::exportObj(path.string(), heightMap, indexer, 1.0f);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Terrain couldnt be exported.";
+	std::ifstream file(path);
+	std::string line;
+	int positions = 0, texCoords = 0, normals = 0, faces = 0;
+	uint64_t minIndex = UINT64_MAX, maxIndex = 0;
+	bool heightsMatch = true;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		std::string type;
+		stream >> type;
+		if (type == "v") {
+			float x, y, z;
+			stream >> x >> y >> z;
+			heightsMatch = heightsMatch && y == heightMap[indexer.index(static_cast<int>(x), static_cast<int>(z))];
+			positions++;
+		}
+		else if (type == "vt")
+			texCoords++;
+		else if (type == "vn")
+			normals++;
+		else if (type == "f") {
+			std::string corner;
+			while (stream >> corner) {
+				//Vertices written so far have to be referenced only, with the same index of all three attributes
+				uint64_t index = std::stoull(corner.substr(0, corner.find('/')));
+				EXPECT_EQ(corner, std::to_string(index) + "/" + std::to_string(index) + "/" + std::to_string(index));
+				EXPECT_LE(index, positions) << "FAILED! Face references the vertex not written yet.";
+				minIndex = std::min(minIndex, index);
+				maxIndex = std::max(maxIndex, index);
+			}
+			faces++;
+		}
+	}
+	EXPECT_EQ(positions, 15 * 8);
+	EXPECT_EQ(texCoords, 15 * 8);
+	EXPECT_EQ(normals, 15 * 8);
+	EXPECT_EQ(faces, 14 * 7 * 2);
+	EXPECT_EQ(minIndex, 1) << "FAILED! Faces are not indexed from 1.";
+	EXPECT_EQ(maxIndex, 15 * 8);
+	EXPECT_TRUE(heightsMatch) << "FAILED! Heights didnt survive the formatting.";
+
+	file.close();
+	layout::releaseMap(heightMap);
+	std::filesystem::remove(path);
+}
+
+TEST(meshExportUnitTests, layoutIndependentExportTest) {
+	//Given
+	layout::MapIndexer rowIndexer(layout::MapLayout::ROW_MAJOR, 3, 2, 5, 4);
+	layout::MapIndexer chunkIndexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 4);
+	float* rowMap = createHeightMap(rowIndexer);
+	float* chunkMap = createHeightMap(chunkIndexer);
+	std::filesystem::path rowPath = std::filesystem::temp_directory_path() / "meshExportRow.glb";
+	std::filesystem::path chunkPath = std::filesystem::temp_directory_path() / "meshExportChunk.glb";
+
+	//When
+	exporter::exportGlb(rowPath.string(), rowMap, rowIndexer, 0.5f);
+	exporter::exportGlb(chunkPath.string(), chunkMap, chunkIndexer, 0.5f);
+
+	//Then
+	EXPECT_EQ(readFile(rowPath), readFile(chunkPath)) << "FAILED! Export depends on the layout of the map.";
+	EXPECT_FALSE(exporter::exportGlb(rowPath.string(), nullptr, rowIndexer, 1.0f)) << "FAILED! Empty map exported.";
+
+	layout::releaseMap(rowMap);
+	layout::releaseMap(chunkMap);
+	std::filesystem::remove(rowPath);
+	std::filesystem::remove(chunkPath);
+}
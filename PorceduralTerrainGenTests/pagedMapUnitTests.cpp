@@ -0,0 +1,178 @@
+#include "pch.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Erosion.h"
+#include "MeshExport.h"
+#include "PagedMap.h"
+
+static float heightAt(int x, int y)
+{
+	return std::sin(x * 0.7f) * 3.0f + y * 0.25f;
+}
+
+static std::vector<char> readFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+TEST(pagedMapUnitTests, windowRoundTripTest) {
+	//Given
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "pagedMapRoundTrip.tppm";
+	int width = 37, height = 23, tileSize = 8;
+	paging::PagedMap map;
+	std::vector<float> samples(static_cast<size_t>(width) * height * 2);
+	for (size_t i = 0; i < samples.size(); i++)
+		samples[i] = static_cast<float>(i);
+
+	//When
+	//Cache holds only two tiles, so writing the whole map has to write the tiles back to the file
+	bool createResult = map.create(path.string(), width, height, tileSize, 2, 2 * tileSize * tileSize * 2 * sizeof(float));
+	bool writeResult = createResult && map.writeWindow(0, 0, width, height, samples.data());
+	paging::TileCacheStats stats = map.getStats();
+	std::vector<float> window(static_cast<size_t>(11) * 9 * 2);
+	bool readResult = map.readWindow(5, 7, 11, 9, window.data());
+	map.close();
+
+	paging::PagedMap reopened;
+	bool openResult = reopened.open(path.string(), 1024 * 1024);
+	std::vector<float> all(samples.size());
+	bool reopenedReadResult = openResult && reopened.readWindow(0, 0, width, height, all.data());
+
+	//Then
+	ASSERT_TRUE(writeResult && readResult) << "FAILED! Window couldnt be copied.";
+	EXPECT_GT(stats.evictions, 0) << "FAILED! Tiles over the budget not evicted.";
+	EXPECT_GT(stats.bytesWritten, 0) << "FAILED! Evicted tiles not written back.";
+	for (int y = 0; y < 9; y++)
+		for (int x = 0; x < 11 * 2; x++)
+			ASSERT_EQ(window[y * 11 * 2 + x], samples[(static_cast<size_t>(y + 7) * width + 5) * 2 + x]) << "FAILED! Wrong sample at " << x << ", " << y;
+
+	ASSERT_TRUE(reopenedReadResult) << "FAILED! Map couldnt be reopened.";
+	EXPECT_EQ(reopened.getWidth(), width);
+	EXPECT_EQ(reopened.getTilesX(), 5);
+	EXPECT_EQ(reopened.getChannels(), 2);
+	EXPECT_EQ(all, samples) << "FAILED! Samples not persisted in the file.";
+	EXPECT_FALSE(reopened.readWindow(30, 0, 8, 1, all.data())) << "FAILED! Window out of the map read.";
+
+	reopened.close();
+	std::filesystem::remove(path);
+}
+
+TEST(pagedMapUnitTests, pagedNormalsTest) {
+	//Given
+	std::filesystem::path heightsPath = std::filesystem::temp_directory_path() / "pagedMapHeights.tppm";
+	std::filesystem::path normalsPath = std::filesystem::temp_directory_path() / "pagedMapNormals.tppm";
+	int width = 20, height = 13;
+	std::vector<float> samples(static_cast<size_t>(width) * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			samples[y * width + x] = heightAt(x, y);
+	paging::PagedMap heights, normals;
+	ASSERT_TRUE(heights.create(heightsPath.string(), width, height, 6, 1, 4 * 6 * 6 * sizeof(float)));
+	ASSERT_TRUE(normals.create(normalsPath.string(), width, height, 6, 3, 4 * 6 * 6 * 3 * sizeof(float)));
+	heights.writeWindow(0, 0, width, height, samples.data());
+
+	//When
+	bool result = paging::computeNormals(heights, normals);
+	std::vector<float> computed(samples.size() * 3);
+	normals.readWindow(0, 0, width, height, computed.data());
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Normals couldnt be computed.";
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int left = std::max(x - 1, 0), right = std::min(x + 1, width - 1);
+			int top = std::max(y - 1, 0), bottom = std::min(y + 1, height - 1);
+			float dx = (samples[y * width + right] - samples[y * width + left]) / (right - left);
+			float dz = (samples[bottom * width + x] - samples[top * width + x]) / (bottom - top);
+			float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+			const float* normal = computed.data() + (static_cast<size_t>(y) * width + x) * 3;
+			EXPECT_FLOAT_EQ(normal[0], -dx / length) << "FAILED! Wrong normal at " << x << ", " << y;
+			EXPECT_FLOAT_EQ(normal[1], 1.0f / length) << "FAILED! Wrong normal at " << x << ", " << y;
+			EXPECT_FLOAT_EQ(normal[2], -dz / length) << "FAILED! Wrong normal at " << x << ", " << y;
+		}
+	}
+
+	heights.close();
+	normals.close();
+	std::filesystem::remove(heightsPath);
+	std::filesystem::remove(normalsPath);
+}
+
+TEST(pagedMapUnitTests, pagedExportTest) {
+	//Given
+	layout::MapIndexer indexer(layout::MapLayout::CHUNK_MAJOR, 3, 2, 5, 4);
+	float* heightMap = layout::allocateMap<float>(indexer.size());
+	std::vector<float> samples(15 * 8);
+	for (int y = 0; y < 8; y++) {
+		for (int x = 0; x < 15; x++) {
+			heightMap[indexer.index(x, y)] = heightAt(x, y);
+			samples[y * 15 + x] = heightAt(x, y);
+		}
+	}
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "pagedMapExport";
+	std::filesystem::create_directories(directory);
+	//Tiles as high as the chunks, so the rows of the obj are interleaved with the faces the same way, cache holds one tile
+	paging::PagedMap heights;
+	ASSERT_TRUE(heights.create((directory / "heights.tppm").string(), 15, 8, 4, 1, 4 * 4 * sizeof(float)));
+	heights.writeWindow(0, 0, 15, 8, samples.data());
+
+	//When
+	bool result = true;
+	for (std::string extension : { ".glb", ".ply", ".obj" }) {
+		std::string memoryPath = (directory / ("memory" + extension)).string();
+		std::string pagedPath = (directory / ("paged" + extension)).string();
+		if (extension == ".glb")
+			result &= exporter::exportGlb(memoryPath, heightMap, indexer, 2.0f) && exporter::exportGlb(pagedPath, heights, 2.0f);
+		else if (extension == ".ply")
+			result &= exporter::exportPly(memoryPath, heightMap, indexer, 2.0f) && exporter::exportPly(pagedPath, heights, 2.0f);
+		else
+			result &= exporter::exportObj(memoryPath, heightMap, indexer, 2.0f) && exporter::exportObj(pagedPath, heights, 2.0f);
+	}
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Terrain couldnt be exported.";
+	for (std::string extension : { ".glb", ".ply", ".obj" })
+		EXPECT_EQ(readFile(directory / ("paged" + extension)), readFile(directory / ("memory" + extension)))
+			<< "FAILED! Paged " << extension << " differs from the export of the map in memory.";
+
+	heights.close();
+	layout::releaseMap(heightMap);
+	std::filesystem::remove_all(directory);
+}
+
+TEST(pagedMapUnitTests, pagedErosionTest) {
+	//Given
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "pagedMapErosion.tppm";
+	int size = 48;
+	std::vector<float> samples(static_cast<size_t>(size) * size);
+	for (int y = 0; y < size; y++)
+		for (int x = 0; x < size; x++)
+			samples[y * size + x] = heightAt(x, y) + x * 0.5f;
+	paging::PagedMap heights;
+	ASSERT_TRUE(heights.create(path.string(), size, size, 16, 1, 4 * 16 * 16 * sizeof(float)));
+	heights.writeWindow(0, 0, size, size, samples.data());
+	heights.resetStats();
+	erosion::Erosion erosion(1, 1);
+	erosion.SetDropletCount(3000);
+
+	//When
+	bool result = erosion.ErodePaged(heights, 8);
+	paging::TileCacheStats stats = heights.getStats();
+	std::vector<float> eroded(samples.size());
+	heights.readWindow(0, 0, size, size, eroded.data());
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Paged map couldnt be eroded.";
+	EXPECT_NE(eroded, samples) << "FAILED! Terrain not eroded.";
+	EXPECT_GT(stats.hits + stats.misses, 0) << "FAILED! Tile cache not used.";
+	EXPECT_FALSE(heights.forEachTile(17, [](paging::TileWindow&) { return true; })) << "FAILED! Halo larger than the tile accepted.";
+
+	heights.close();
+	std::filesystem::remove(path);
+}
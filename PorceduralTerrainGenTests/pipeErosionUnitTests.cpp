@@ -0,0 +1,95 @@
+#include "pch.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "JobSystem.h"
+#include "PipeErosion.h"
+
+//Valley along the y axis, the lowest column is in the middle of the map
+static std::vector<float> valley(int width, int height)
+{
+	std::vector<float> map(width * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			map[y * width + x] = std::abs(x - width / 2) * 0.05f + y * 0.001f;
+	return map;
+}
+
+static std::vector<float> erodedValley(int width, int height, int iterations, unsigned int threadCount)
+{
+	std::vector<float> map = valley(width, height);
+	unsigned int previousThreadCount = jobs::JobSystem::get().getThreadCount();
+	jobs::JobSystem::get().setThreadCount(threadCount);
+	erosion::PipeErosion pipeErosion(width, height);
+	erosion::PipeErosionConfig pipeConfig;
+	pipeConfig.iterations = iterations;
+	pipeErosion.SetConfig(erosion::ErosionConfig(), pipeConfig);
+	pipeErosion.SetMap(map.data());
+	EXPECT_TRUE(pipeErosion.Erode());
+	jobs::JobSystem::get().setThreadCount(previousThreadCount);
+	return std::vector<float>(pipeErosion.getMap(), pipeErosion.getMap() + map.size());
+}
+
+TEST(pipeErosionUnitTests, flatMapTest) {
+	//Given
+	std::vector<float> map(16 * 16, 0.5f);
+	erosion::PipeErosion pipeErosion(16, 16);
+	erosion::PipeErosionConfig pipeConfig;
+	pipeConfig.iterations = 50;
+	pipeErosion.SetConfig(erosion::ErosionConfig(), pipeConfig);
+	pipeErosion.SetMap(map.data());
+
+	//When
+	bool result = pipeErosion.Erode();
+
+	//Then
+	ASSERT_TRUE(result);
+	for (int i = 0; i < 16 * 16; i++) {
+		ASSERT_EQ(pipeErosion.getMap()[i], 0.5f) << "FAILED! Flat terrain eroded at " << i;
+		ASSERT_EQ(pipeErosion.getWater()[i], pipeErosion.getWater()[0]) << "FAILED! Rain on the flat terrain didnt stay in place at " << i;
+	}
+	EXPECT_GT(pipeErosion.getWater()[0], 0.0f) << "FAILED! No rain.";
+}
+
+TEST(pipeErosionUnitTests, waterFlowsDownhillTest) {
+	//Given
+	const int width = 32, height = 32;
+	std::vector<float> map = valley(width, height);
+	erosion::PipeErosion pipeErosion(width, height);
+	erosion::PipeErosionConfig pipeConfig;
+	pipeConfig.iterations = 200;
+	pipeErosion.SetConfig(erosion::ErosionConfig(), pipeConfig);
+	pipeErosion.SetMap(map.data());
+
+	//When
+	bool result = pipeErosion.Erode();
+
+	//Then
+	ASSERT_TRUE(result);
+	const float* water = pipeErosion.getWater();
+	size_t bottom = (height / 2) * width + width / 2, slope = (height / 2) * width + 2;
+	//Water levels its surface, the valley is deeper by at least half of the difference of the terrain
+	EXPECT_GT(water[bottom] - water[slope], 0.5f * (map[slope] - map[bottom])) << "FAILED! Water didnt gather in the valley.";
+	float changed = 0.0f;
+	for (size_t i = 0; i < map.size(); i++) {
+		ASSERT_GE(water[i], 0.0f) << "FAILED! Negative water at " << i;
+		changed += std::abs(pipeErosion.getMap()[i] - map[i]);
+	}
+	EXPECT_GT(changed, 0.0f) << "FAILED! Flowing water didnt erode the slopes.";
+}
+
+TEST(pipeErosionUnitTests, deterministicThreadsTest) {
+	//Given
+	const int width = 70, height = 90;
+
+	//When
+	std::vector<float> single = erodedValley(width, height, 30, 1);
+	std::vector<float> multi = erodedValley(width, height, 30, 4);
+
+	//Then
+	EXPECT_EQ(std::memcmp(single.data(), multi.data(), single.size() * sizeof(float)), 0) << "FAILED! Pipe erosion depends on the number of threads.";
+	erosion::PipeErosion empty(70, 90);
+	EXPECT_FALSE(empty.Erode()) << "FAILED! Erosion without the map succeeded.";
+}
@@ -0,0 +1,159 @@
+#include "pch.h"
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "Shard.h"
+#include "WorldStore.h"
+
+static config::GenerationConfig shardedConfig()
+{
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	generationConfig.width = 5;
+	generationConfig.height = 4;
+	generationConfig.chunkResolution = 16;
+	generationConfig.mountainous.island = true;
+	return generationConfig;
+}
+
+TEST(shardUnitTests, planShardsTest) {
+	//Given
+	int worldWidth = 7, worldHeight = 5;
+
+	//When
+	std::vector<shard::ShardRegion> shards = shard::planShards(worldWidth, worldHeight, 3, 2);
+
+	//Then
+	ASSERT_EQ(shards.size(), 6);
+	std::vector<int> covered(worldWidth * worldHeight, 0);
+	for (auto& region : shards)
+		for (int y = region.originY; y < region.originY + region.height; y++)
+			for (int x = region.originX; x < region.originX + region.width; x++)
+				covered[y * worldWidth + x]++;
+	for (int count : covered)
+		EXPECT_EQ(count, 1) << "FAILED! Chunk not owned by exactly one shard.";
+	EXPECT_TRUE(shard::planShards(worldWidth, worldHeight, 8, 1).empty()) << "FAILED! More shards than chunks accepted.";
+}
+
+TEST(shardUnitTests, mergedShardsMatchWholeWorldTest) {
+	//Given
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "shardMerge";
+	std::filesystem::create_directories(directory);
+	std::string wholePath = (directory / "whole.world").string();
+	std::string mergedPath = (directory / "merged.world").string();
+	config::GenerationConfig generationConfig = shardedConfig();
+
+	TerrainGenerator whole;
+	whole.setChunkCache(nullptr);
+	world::WorldStore wholeStore;
+	ASSERT_TRUE(config::applyConfig(generationConfig, whole) && whole.performTerrainGeneration()) << "FAILED! World couldnt be generated.";
+	ASSERT_TRUE(wholeStore.create(wholePath, whole.getWorldHeader()) && whole.saveWorld(wholeStore));
+
+	//When
+	bool generated = true;
+	for (int j = 0; j < 2; j++)
+		for (int i = 0; i < 2; i++)
+			generated &= shard::generateShard(generationConfig, 2, 2, i, j, 1, shard::shardPath(mergedPath, i, j));
+	shard::MergeReport report;
+	bool merged = generated && shard::mergeShards(mergedPath, 2, 2, report);
+
+	//Then
+	ASSERT_TRUE(merged) << "FAILED! Shards couldnt be merged.";
+	EXPECT_EQ(report.chunkCount, 5 * 4);
+	EXPECT_GT(report.seamChunks, 0) << "FAILED! Seams not checked.";
+	EXPECT_EQ(report.mismatchedChunks, 0);
+	EXPECT_EQ(report.treeConflicts, 0);
+
+	world::WorldStore mergedStore;
+	ASSERT_TRUE(mergedStore.open(mergedPath));
+	EXPECT_EQ(mergedStore.getHeader(), wholeStore.getHeader()) << "FAILED! Merged world has a different header.";
+	size_t treeCount = 0;
+	for (int y = 0; y < 4; y++) {
+		for (int x = 0; x < 5; x++) {
+			world::ChunkView expected = wholeStore.readChunk(x, y);
+			world::ChunkView actual = mergedStore.readChunk(x, y);
+			ASSERT_TRUE(actual.valid());
+			EXPECT_EQ(std::memcmp(actual.heights.data(), expected.heights.data(), expected.heights.size_bytes()), 0) << "FAILED! Heights of the chunk " << x << ", " << y << " not bit-identical.";
+			EXPECT_EQ(std::memcmp(actual.biomes.data(), expected.biomes.data(), expected.biomes.size_bytes()), 0) << "FAILED! Biomes of the chunk " << x << ", " << y << " differ.";
+			ASSERT_EQ(actual.treeCount(), expected.treeCount()) << "FAILED! Trees of the chunk " << x << ", " << y << " differ.";
+			EXPECT_TRUE(std::equal(actual.trees.begin(), actual.trees.end(), expected.trees.begin()));
+			treeCount += actual.treeCount();
+		}
+	}
+	EXPECT_GT(treeCount, 0) << "FAILED! World without trees doesnt test the vegetation seams.";
+
+	mergedStore.close();
+	wholeStore.close();
+	std::filesystem::remove_all(directory);
+}
+
+TEST(shardUnitTests, seamMismatchDetectedTest) {
+	//Given
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "shardMismatch";
+	std::filesystem::create_directories(directory);
+	std::string worldPath = (directory / "world.world").string();
+	config::GenerationConfig generationConfig = shardedConfig();
+	for (int i = 0; i < 2; i++)
+		ASSERT_TRUE(shard::generateShard(generationConfig, 2, 1, i, 0, 1, shard::shardPath(worldPath, i, 0)));
+
+	//Chunk 2, 0 is owned by the second shard and is on the margin of the first one
+	{
+		world::WorldStore store;
+		ASSERT_TRUE(store.open(shard::shardPath(worldPath, 0, 0)));
+		world::ChunkView view = store.readChunk(2, 0);
+		ASSERT_TRUE(view.valid()) << "FAILED! Margin chunk not stored in the shard.";
+		std::vector<float> heights(view.heights.begin(), view.heights.end());
+		std::vector<int> biomes(view.biomes.begin(), view.biomes.end());
+		heights[5] += 0.001f;
+		ASSERT_TRUE(store.writeChunk(2, 0, heights, biomes, {}));
+	}
+
+	//When
+	shard::MergeReport report;
+	bool merged = shard::mergeShards(worldPath, 2, 1, report);
+	bool wrongGrid = shard::mergeShards(worldPath, 3, 1, report);
+
+	//Then
+	EXPECT_FALSE(merged) << "FAILED! Seam mismatch not detected.";
+	EXPECT_FALSE(wrongGrid) << "FAILED! Missing shard not detected.";
+
+	std::filesystem::remove_all(directory);
+}
+
+TEST(shardUnitTests, chunkedErosionShardTest) {
+	//Given
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "shardErosion";
+	std::filesystem::create_directories(directory);
+	std::string path = (directory / "eroded.world").string();
+	config::GenerationConfig generationConfig = shardedConfig();
+	generationConfig.width = 13;
+	generationConfig.height = 2;
+	generationConfig.dropletCount = 13 * 2 * 100;
+	generationConfig.chunkedErosion = true;
+
+	TerrainGenerator whole;
+	whole.setChunkCache(nullptr);
+	ASSERT_TRUE(config::applyConfig(generationConfig, whole) && whole.performTerrainGeneration()) << "FAILED! World couldnt be generated.";
+
+	//When
+	bool generated = shard::generateShard(generationConfig, 3, 1, 2, 0, 1, shard::shardPath(path, 2, 0));
+
+	//Then
+	ASSERT_TRUE(generated) << "FAILED! Shard couldnt be generated.";
+	world::WorldStore store;
+	ASSERT_TRUE(store.open(shard::shardPath(path, 2, 0)));
+	std::vector<shard::ShardRegion> shards = shard::planShards(13, 2, 3, 1);
+	for (int y = 0; y < 2; y++) {
+		for (int x = shards[2].originX - 1; x < 13; x++) {
+			world::ChunkView chunk = store.readChunk(x, y);
+			ASSERT_TRUE(chunk.valid()) << "FAILED! Chunk " << x << ", " << y << " missing in the shard.";
+			std::span<const float> expected = whole.getHeightChunk(x, y);
+			EXPECT_EQ(std::memcmp(chunk.heights.data(), expected.data(), expected.size_bytes()), 0) << "FAILED! Eroded chunk " << x << ", " << y << " differs from the whole world.";
+		}
+	}
+	EXPECT_FALSE(store.readChunk(shards[2].originX - 2, 0).valid()) << "FAILED! Chunk beyond the margin written.";
+
+	store.close();
+	std::filesystem::remove_all(directory);
+}
@@ -1,6 +1,12 @@
 #include "pch.h"
 
+#include <vector>
+
 #include "TerrainGenerator.h"
+#include "GenerationConfig.h"
+#include "JobSystem.h"
+#include "SimplexNoise.h"
+#include "testTerrain.h"
 
 TEST(terrainGeneratorIntegrationTests, initializeMapTest) {
 	//Given
@@ -104,6 +110,30 @@ TEST(terrainGeneratorIntegrationTests, biomeMapGenerationTest) {
 }
 
 TEST(terrainGeneratorIntegrationTests, vegetationGeneratorTest) {
+	//Given
+	//Biomes of the application, Ocean has the vegetation of the coast, trees under the see level are rejected
+	TerrainGenerator terrainGen;
+	terrainGen.setChunkCache(nullptr);
+	setupTestTerrain(terrainGen, 10, 10, 5);
+	std::vector<std::pair<float, float>> expectedChunkTrees = { {12.0f, 5.0f}, {12.0f, 7.0f}, {11.0f, 9.0f} };
+	int expectedCount = 128;
+
+	//when
+	bool result = terrainGen.performTerrainGeneration();
+	const vegetation::VegetationMap& trees = terrainGen.getVegetation();
+	std::vector<std::pair<float, float>> resultChunkTrees;
+	for (size_t i = 0; i < trees.getX(2, 1).size(); i++)
+		resultChunkTrees.push_back({ trees.getX(2, 1)[i], trees.getY(2, 1)[i] });
+	int resCount = terrainGen.getTreeCount();
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Vegetation generation failed.";
+	EXPECT_EQ(resultChunkTrees, expectedChunkTrees) << "FAILED! Trees of the chunk moved.";
+	EXPECT_EQ(trees.getX(3, 0).size(), 5);
+	EXPECT_EQ(resCount, expectedCount);
+}
+
+TEST(terrainGeneratorIntegrationTests, vegetationMinDistanceTest) {
 	//Given
 	TerrainGenerator terrainGen;
 	terrainGen.setSize(10, 10);
@@ -132,7 +162,7 @@ TEST(terrainGeneratorIntegrationTests, vegetationGeneratorTest) {
 		biome::Biome(2, "Snow",			{0, 1}, {0, 4}, {3, 5}, {0, 4}, 7, 5 * 5 * 0.03f),
 		biome::Biome(3, "Sand",			{0, 4}, {0, 4}, {2, 3}, {0, 7}, 8, 5 * 5 * 0.01f),
 		biome::Biome(4, "Mountain",		{0, 4}, {0, 4}, {4, 5}, {4, 7}, 0, 5 * 5 * 0.02f),
-		biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, 5 * 5 * 0.0f)
+		biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, 5 * 5 * 0.2f)	//Coast vegetation, trees under the see level are still rejected
 	};
 
 	std::vector<std::vector<RangedLevel>> ranges = {
@@ -145,19 +175,84 @@ TEST(terrainGeneratorIntegrationTests, vegetationGeneratorTest) {
 	terrainGen.setBiomes(biomes);
 	terrainGen.setRanges(ranges);
 
-	std::pair<int, int> expected = { 11, 3 };
-	int expectedCount = 137;
+	float seeLevel = 30.0f;
+	float minDistance = 2.0f;
+	terrainGen.setSeeLevel(seeLevel);
 
 	//when
 	bool result = terrainGen.performTerrainGeneration();
-	auto vegetationPoints = terrainGen.getVegetationPoints();
-	std::pair<int, int> resultVegetation = vegetationPoints[2][4];
-	int resCount = terrainGen.getTreeCount();
+	const vegetation::VegetationMap& trees = terrainGen.getVegetation();
+	std::vector<std::pair<int, int>> allPoints;
+	for (size_t i = 0; i < trees.size(); i++)
+		allPoints.push_back({ static_cast<int>(trees.getX()[i]), static_cast<int>(trees.getY()[i]) });
 
 	//Then
 	EXPECT_TRUE(result) << "FAILED! Vegetation generation failed.";
-	EXPECT_EQ(resultVegetation, expected);
-	EXPECT_EQ(resCount, expectedCount);
+	EXPECT_GT(terrainGen.getTreeCount(), 0) << "FAILED! No vegetation generated.";
+	EXPECT_EQ(terrainGen.getTreeCount(), allPoints.size());
+	for (size_t i = 0; i < allPoints.size(); i++) {
+		EXPECT_GE(terrainGen.getHeightAt(allPoints[i].first, allPoints[i].second), seeLevel) << "FAILED! Tree placed under the see level.";
+		//Distance is checked between all trees, also the ones from different chunks
+		for (size_t j = i + 1; j < allPoints.size(); j++) {
+			float dx = static_cast<float>(allPoints[i].first - allPoints[j].first);
+			float dy = static_cast<float>(allPoints[i].second - allPoints[j].second);
+			EXPECT_GE(dx * dx + dy * dy, minDistance * minDistance) << "FAILED! Trees closer than the minimal distance.";
+		}
+	}
+}
+
+TEST(terrainGeneratorIntegrationTests, vegetationOrderIndependenceTest) {
+	//Given
+	auto generate = [](unsigned int threads, bool pipeline) {
+		jobs::JobSystem::get().setThreadCount(threads);
+		TerrainGenerator terrainGen;
+		//Every run has to generate the chunks, not take them from the previous one
+		terrainGen.setChunkCache(nullptr);
+		terrainGen.setSize(6, 5);
+		terrainGen.setChunkResolution(5);
+		terrainGen.setSeed(742);
+		terrainGen.getContinentalnessNoiseConfig().scale = 0.05f;
+		terrainGen.getMountainousNoiseConfig().scale = 0.05f;
+		terrainGen.getPVNoiseConfig().scale = 0.05f;
+		terrainGen.initializeMap();
+		terrainGen.setSplines({ {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 70.0},
+								{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},
+								{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} });
+		terrainGen.setSeeLevel(30.0f);
+		std::vector<biome::Biome> biomes = {
+			biome::Biome(0, "Grassplains",	{0, 4}, {0, 4}, {0, 5}, {0, 7}, 3, 5 * 5 * 0.3f),
+			biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 5}, {0, 7}, 5, 5 * 5 * 0.3f)
+		};
+		std::vector<std::vector<RangedLevel>> ranges = {
+			{{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}, {{-1.0f, 1.1f, 0}}
+		};
+		terrainGen.setBiomes(biomes);
+		terrainGen.setRanges(ranges);
+
+		if (pipeline) {
+			terrainGen.performTerrainGeneration();
+		}
+		else {
+			terrainGen.generateHeightMap();
+			terrainGen.generateBiomes();
+			terrainGen.generateBiomeMapPerChunk();
+			//Chunks generated backwards give the same trees as in any other order
+			for (int y = 4; y >= 0; y--)
+				for (int x = 5; x >= 0; x--)
+					terrainGen.vegetationGenerationChunk(x, y);
+			terrainGen.buildVegetation();
+		}
+		const vegetation::VegetationMap& trees = terrainGen.getVegetation();
+		return std::make_pair(std::vector<float>(trees.getX().begin(), trees.getX().end()), std::vector<float>(trees.getY().begin(), trees.getY().end()));
+	};
+
+	//When
+	auto serial = generate(1, false);
+	auto parallel = generate(4, true);
+
+	//Then
+	EXPECT_GT(serial.first.size(), 0) << "FAILED! No vegetation generated.";
+	EXPECT_EQ(serial, parallel) << "FAILED! Vegetation depends on the order of the chunks or the number of threads";
 }
 
 TEST(terrainGeneratorIntegrationTests, nosieGenerationTest) {
@@ -177,6 +272,20 @@ TEST(terrainGeneratorIntegrationTests, nosieGenerationTest) {
 	EXPECT_NEAR(result, expected, 0.000005f) << "FAILED! Noise generation failed.";
 }
 
+TEST(terrainGeneratorIntegrationTests, permutationGoldenTest) {
+	//Given
+	//Table of the seed pinned, the worlds of the same seed have to stay the same with every standard library
+	uint8_t permutation[256];
+	const uint8_t expected[] = { 150, 186, 136, 45, 13, 119, 0, 57, 5, 101, 171, 123, 252, 102, 17, 215 };
+
+	//When
+	SimplexNoise::shuffle(742, permutation);
+
+	//Then
+	for (int i = 0; i < 16; i++)
+		EXPECT_EQ(permutation[i], expected[i]) << "FAILED! Permutation of the seed changed at " << i;
+}
+
 TEST(terrainGeneratorIntegrationTests, nonValidMapGenTest) {
 	//Given
 	TerrainGenerator tg;
@@ -205,6 +314,25 @@ TEST(terrainGeneratorIntegrationTests, nonValidBiomeGenTest) {
 	EXPECT_FALSE(result) << "FAILED! Biome generation should fail.";
 }
 
+TEST(terrainGeneratorIntegrationTests, nonValidVegetationMinDistanceTest) {
+	//Given
+	TerrainGenerator tg;
+	tg.setSize(4, 4);
+	bool tooSmall = tg.setVegetationMinDistance(0.5f);
+	//Distance is accepted before the chunk resolution is set, it is checked by the generation
+	bool beforeResolution = tg.setVegetationMinDistance(8.0f);
+
+	//When
+	tg.setChunkResolution(4);
+	tg.initializeMap();
+	bool result = tg.performTerrainGeneration();
+
+	//Then
+	EXPECT_FALSE(tooSmall) << "FAILED! Distance smaller than 1 should be rejected.";
+	EXPECT_TRUE(beforeResolution) << "FAILED! Distance set before the chunk resolution should be accepted.";
+	EXPECT_FALSE(result) << "FAILED! Generation with the distance larger than the chunk resolution should fail.";
+}
+
 TEST(terrainGeneratorIntegrationTests, nonValidAverageBiomeCalculationTest) {
 	//Given
 	TerrainGenerator terrainGen;
@@ -255,3 +383,88 @@ TEST(terrainGeneratorIntegrationTests, nonValidAverageBiomeCalculationTest) {
 	EXPECT_FALSE(result);
 }
 
+//Small world with the chunked erosion of the droplets
+static config::GenerationConfig chunkedErosionConfig(layout::MapLayout mapLayout)
+{
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	generationConfig.width = 4;
+	generationConfig.height = 3;
+	generationConfig.chunkResolution = 16;
+	generationConfig.mapLayout = mapLayout;
+	generationConfig.dropletCount = 4 * 3 * 200;
+	generationConfig.chunkedErosion = true;
+	return generationConfig;
+}
+
+static std::vector<float> rowMajorHeights(const TerrainGenerator& terrainGen)
+{
+	const layout::MapIndexer& indexer = terrainGen.getMapIndexer();
+	std::vector<float> heights(indexer.size());
+	terrainGen.copyHeightMap(heights.data());
+	return heights;
+}
+
+TEST(terrainGeneratorIntegrationTests, chunkedErosionDeterministicTest) {
+	//Given
+	std::vector<std::vector<float>> results;
+	unsigned int threadCount = jobs::JobSystem::get().getThreadCount();
+
+	//When
+	for (layout::MapLayout mapLayout : { layout::MapLayout::ROW_MAJOR, layout::MapLayout::CHUNK_MAJOR }) {
+		for (unsigned int threads : { 1u, 4u }) {
+			jobs::JobSystem::get().setThreadCount(threads);
+			TerrainGenerator terrainGen;
+			terrainGen.setChunkCache(nullptr);
+			ASSERT_TRUE(config::applyConfig(chunkedErosionConfig(mapLayout), terrainGen) && terrainGen.performTerrainGeneration());
+			results.push_back(rowMajorHeights(terrainGen));
+		}
+	}
+	jobs::JobSystem::get().setThreadCount(threadCount);
+
+	TerrainGenerator staged;
+	ASSERT_TRUE(config::applyConfig(chunkedErosionConfig(layout::MapLayout::CHUNK_MAJOR), staged));
+	ASSERT_TRUE(staged.generateHeightMap() && staged.erodeHeightMap());
+	std::vector<float> stagedHeights = rowMajorHeights(staged);
+
+	config::GenerationConfig uneroded = chunkedErosionConfig(layout::MapLayout::ROW_MAJOR);
+	uneroded.chunkedErosion = false;
+	TerrainGenerator original;
+	ASSERT_TRUE(config::applyConfig(uneroded, original) && original.generateHeightMap());
+
+	//Then
+	for (size_t i = 1; i < results.size(); i++)
+		EXPECT_EQ(results[i], results[0]) << "FAILED! Chunked erosion depends on the layout or the number of threads.";
+	EXPECT_EQ(stagedHeights, results[0]) << "FAILED! Erosion of the whole height map differs from the generation graph.";
+	EXPECT_NE(rowMajorHeights(original), results[0]) << "FAILED! Heights not eroded.";
+}
+
+TEST(terrainGeneratorIntegrationTests, chunkedErosionHaloTest) {
+	//Given
+	config::GenerationConfig generationConfig = chunkedErosionConfig(layout::MapLayout::ROW_MAJOR);
+	generationConfig.erosionHalo = 4;
+	TerrainGenerator terrainGen;
+	ASSERT_TRUE(config::applyConfig(generationConfig, terrainGen) && terrainGen.generateHeightMap());
+	std::vector<float> before = rowMajorHeights(terrainGen);
+	int chunkX = 1, chunkY = 1, resolution = generationConfig.chunkResolution, halo = terrainGen.getErosionHalo();
+
+	//When
+	bool result = terrainGen.erodeChunk(chunkX, chunkY);
+	std::vector<float> after = rowMajorHeights(terrainGen);
+
+	//Then
+	ASSERT_TRUE(result) << "FAILED! Chunk couldnt be eroded.";
+	EXPECT_EQ(halo, 4);
+	int changedInHalo = 0, changedOutside = 0;
+	for (int y = 0; y < terrainGen.getHeight(); y++) {
+		for (int x = 0; x < terrainGen.getWidth(); x++) {
+			bool changed = before[y * terrainGen.getWidth() + x] != after[y * terrainGen.getWidth() + x];
+			bool inChunk = x >= chunkX * resolution && x < (chunkX + 1) * resolution && y >= chunkY * resolution && y < (chunkY + 1) * resolution;
+			bool inWindow = x >= chunkX * resolution - halo && x < (chunkX + 1) * resolution + halo && y >= chunkY * resolution - halo && y < (chunkY + 1) * resolution + halo;
+			changedInHalo += changed && inWindow && !inChunk;
+			changedOutside += changed && !inWindow;
+		}
+	}
+	EXPECT_GT(changedInHalo, 0) << "FAILED! Droplets didnt cross the border of the chunk.";
+	EXPECT_EQ(changedOutside, 0) << "FAILED! Erosion changed the samples beyond the halo.";
+	EXPECT_FALSE(terrainGen.setErosion(generationConfig.erosion, 10, resolution)) << "FAILED! Halo wider than half of the chunk accepted.";
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "TerrainGenerator.h"
+
+//Small worlds shared by the tests of the layout, the storage and the caches of the generated chunks
+
+//Biomes of the application, every one of them gets some vegetation
+inline std::vector<biome::Biome> testBiomes()
+{
+	return {
+		biome::Biome(0, "Grassplains",	{1, 2}, {1, 4}, {3, 5}, {0, 3}, 3, 5 * 5 * 0.2f),
+		biome::Biome(1, "Desert",		{2, 4}, {0, 1}, {3, 5}, {0, 4}, 2, 5 * 5 * 0.01f),
+		biome::Biome(2, "Snow",			{0, 1}, {0, 4}, {3, 5}, {0, 4}, 7, 5 * 5 * 0.03f),
+		biome::Biome(3, "Sand",			{0, 4}, {0, 4}, {2, 3}, {0, 7}, 8, 5 * 5 * 0.01f),
+		biome::Biome(4, "Mountain",		{0, 4}, {0, 4}, {4, 5}, {4, 7}, 0, 5 * 5 * 0.02f),
+		biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, 5 * 5 * 0.2f)
+	};
+}
+
+inline std::vector<std::vector<RangedLevel>> testRanges()
+{
+	return {
+		{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+		{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+		{{-1.0f, -0.7f, 0},{-0.7f, -0.2f, 1},{ -0.2f, 0.03f, 2},{0.03f, 0.3f, 3},{0.3f, 1.1f, 4}},
+		{{-1.0f, -0.78f, 0},{-0.78f, -0.37f, 1},{-0.37f, -0.2f, 2},{-0.2f, 0.05f, 3},{0.05f, 0.45f, 4},{0.45f, 0.55f, 5},{0.55f, 1.1f, 6}}
+	};
+}
+
+//Sets up the generator with the noise, splines, biomes and ranges of the tests, ready for performTerrainGeneration
+//
+//@param terrainGen - generator to be set up
+//@param width, height - size of the world in chunks
+//@param chunkResolution - samples per side of the chunk
+//@param mapLayout - layout of the maps of the generator
+//@param biomes, ranges - biomes of the world, the ones of the application by default
+inline void setupTestTerrain(TerrainGenerator& terrainGen, int width, int height, int chunkResolution,
+	layout::MapLayout mapLayout = layout::MapLayout::ROW_MAJOR,
+	std::vector<biome::Biome> biomes = testBiomes(), std::vector<std::vector<RangedLevel>> ranges = testRanges())
+{
+	terrainGen.setSize(width, height);
+	terrainGen.setChunkResolution(chunkResolution);
+	terrainGen.setSeed(742);
+	terrainGen.setSeeLevel(30.0f);
+	terrainGen.getContinentalnessNoiseConfig().scale = 0.05f;
+	terrainGen.getMountainousNoiseConfig().scale = 0.05f;
+	terrainGen.getPVNoiseConfig().scale = 0.05f;
+	terrainGen.setMapLayout(mapLayout);
+	terrainGen.initializeMap();
+	terrainGen.setSplines({ {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 70.0},
+							{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},
+							{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} });
+	terrainGen.setBiomes(biomes);
+	terrainGen.setRanges(ranges);
+}
@@ -0,0 +1,121 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Erosion.h"
+#include "JobSystem.h"
+#include "ThermalErosion.h"
+
+//Largest height difference between the neighbouring samples of the map
+static float steepestStep(const std::vector<float>& map, int width, int height)
+{
+	float steepest = 0.0f;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (x + 1 < width)
+				steepest = std::max(steepest, std::abs(map[y * width + x] - map[y * width + x + 1]));
+			if (y + 1 < height)
+				steepest = std::max(steepest, std::abs(map[y * width + x] - map[(y + 1) * width + x]));
+		}
+	}
+	return steepest;
+}
+
+TEST(thermalErosionUnitTests, spikeSlidesTest) {
+	//Given
+	const int width = 20, height = 20;
+	std::vector<float> map(width * height, 0.0f);
+	map[10 * width + 10] = 1.0f;
+	map[0] = 0.5f;
+	double before = 0.0;
+	for (float h : map)
+		before += h;
+	erosion::ThermalErosion thermal;
+	thermal.SetConfig(0.02f, 0.5f);
+
+	//When
+	for (int i = 0; i < 50; i++)
+		thermal.Erode(map.data(), width, height, width);
+
+	//Then
+	double after = 0.0;
+	for (float h : map) {
+		ASSERT_GE(h, 0.0f) << "FAILED! Material slid below the lowest neighbour.";
+		after += h;
+	}
+	EXPECT_NEAR(after, before, 1e-4) << "FAILED! Material not conserved.";
+	EXPECT_LT(map[10 * width + 10], 0.2f) << "FAILED! Spike didnt slide.";
+	EXPECT_GT(map[9 * width + 9], 0.0f) << "FAILED! Nothing slid to the diagonal neighbour.";
+	EXPECT_LT(steepestStep(map, width, height), 0.1f);
+}
+
+TEST(thermalErosionUnitTests, gentleSlopeKeptTest) {
+	//Given
+	const int width = 16, height = 12;
+	std::vector<float> map(width * height);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			map[y * width + x] = x * 0.01f + y * 0.005f;
+	std::vector<float> original = map;
+	erosion::ThermalErosion thermal;
+	thermal.SetConfig(0.02f, 1.0f);
+
+	//When
+	thermal.Erode(map.data(), width, height, width);
+
+	//Then
+	EXPECT_EQ(map, original) << "FAILED! Slope below the talus slope changed.";
+}
+
+TEST(thermalErosionUnitTests, stridedDeterministicTest) {
+	//Given
+	const int width = 50, height = 70, stride = 53;
+	std::vector<float> source(stride * height, -7.0f);
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			source[y * stride + x] = ((x * 37 + y * 91) % 17) / 17.0f;
+	std::vector<float> single = source, multi = source;
+	erosion::ThermalErosion thermal;
+
+	//When
+	jobs::JobSystem::get().setThreadCount(1);
+	thermal.Erode(single.data(), width, height, stride);
+	jobs::JobSystem::get().setThreadCount(4);
+	thermal.Erode(multi.data(), width, height, stride);
+
+	//Then
+	EXPECT_EQ(std::memcmp(single.data(), multi.data(), single.size() * sizeof(float)), 0) << "FAILED! Thermal erosion depends on the number of threads.";
+	EXPECT_NE(single, source) << "FAILED! Steep map not eroded.";
+	for (int y = 0; y < height; y++)
+		for (int x = width; x < stride; x++)
+			ASSERT_EQ(single[y * stride + x], -7.0f) << "FAILED! Sample out of the view changed.";
+}
+
+TEST(thermalErosionUnitTests, hydraulicIntervalTest) {
+	//Given
+	std::vector<float> map(48 * 48);
+	for (int y = 0; y < 48; y++)
+		for (int x = 0; x < 48; x++)
+			map[y * 48 + x] = ((x * 37 + y * 91) % 17) / 170.0f + (x + y) / 96.0f;
+	erosion::Erosion hydraulic(48, 48), combined(48, 48);
+	for (erosion::Erosion* e : { &hydraulic, &combined }) {
+		e->SetSeed(3);
+		e->SetDropletCount(300);
+		e->getConfigRef().erosionRadius = 1;
+		e->SetMap(map.data());
+	}
+	combined.getConfigRef().thermalInterval = 8;
+
+	//When
+	hydraulic.Erode(std::nullopt);
+	combined.Erode(std::nullopt);
+
+	//Then
+	std::vector<float> hydraulicMap(hydraulic.getMap(), hydraulic.getMap() + map.size());
+	std::vector<float> combinedMap(combined.getMap(), combined.getMap() + map.size());
+	EXPECT_NE(hydraulicMap, combinedMap) << "FAILED! Thermal erosion not run between the steps.";
+	EXPECT_LT(steepestStep(combinedMap, 48, 48), steepestStep(hydraulicMap, 48, 48)) << "FAILED! Thermal erosion didnt smooth the slopes.";
+}
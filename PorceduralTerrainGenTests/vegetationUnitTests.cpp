@@ -0,0 +1,83 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "Vegetation.h"
+
+//2 x 2 chunks of resolution 4, height of the cell is its index
+static std::vector<float> createHeightMap()
+{
+	std::vector<float> heightMap(8 * 8);
+	for (size_t i = 0; i < heightMap.size(); i++)
+		heightMap[i] = static_cast<float>(i);
+	return heightMap;
+}
+
+TEST(vegetationUnitTests, buildChunkSpansTest) {
+	//Given
+	std::vector<float> heightMap = createHeightMap();
+	std::vector<std::vector<std::pair<int, int>>> chunks = { { {1, 1}, {2, 3} }, {}, { {0, 5} }, { {6, 6}, {7, 4}, {5, 7} } };
+	vegetation::VegetationMap trees;
+
+	//When
+	bool result = trees.build(chunks, heightMap.data(), layout::MapIndexer(layout::MapLayout::ROW_MAJOR, 2, 2, 4, 4), 2);
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! Vegetation map build failed.";
+	EXPECT_EQ(trees.size(), 6);
+	EXPECT_EQ(trees.getChunkSize(0, 0), 2);
+	EXPECT_EQ(trees.getChunkSize(1, 0), 0);
+	EXPECT_EQ(trees.getChunkSize(1, 1), 3);
+	EXPECT_EQ(trees.getX(1, 1)[1], 7.0f) << "FAILED! Trees of the chunk are not contiguous.";
+	EXPECT_EQ(trees.getHeight(0, 1)[0], heightMap[5 * 8 + 0]) << "FAILED! Tree not placed on the ground.";
+}
+
+TEST(vegetationUnitTests, radiusQueryTest) {
+	//Given
+	std::vector<float> heightMap = createHeightMap();
+	std::vector<std::vector<std::pair<int, int>>> chunks(4);
+	for (int y = 0; y < 8; y++)
+		for (int x = 0; x < 8; x++)
+			chunks[(y / 4) * 2 + x / 4].push_back({ x, y });
+	vegetation::VegetationMap trees;
+	trees.build(chunks, heightMap.data(), layout::MapIndexer(layout::MapLayout::ROW_MAJOR, 2, 2, 4, 4), 3);
+	float centerX = 3.5f, centerY = 4.0f, radius = 2.2f;
+
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < trees.size(); i++) {
+		float dx = trees.getX()[i] - centerX, dy = trees.getY()[i] - centerY;
+		if (dx * dx + dy * dy <= radius * radius)
+			expected.push_back(i);
+	}
+
+	//When
+	std::vector<uint32_t> result = trees.queryRadius(centerX, centerY, radius);
+	std::sort(result.begin(), result.end());
+
+	//Then
+	EXPECT_FALSE(expected.empty());
+	EXPECT_EQ(result, expected) << "FAILED! Query result differs from the brute force search.";
+}
+
+TEST(vegetationUnitTests, rectQueryAndRemoveTest) {
+	//Given
+	std::vector<float> heightMap = createHeightMap();
+	std::vector<std::vector<std::pair<int, int>>> chunks = { { {1, 1}, {2, 3} }, { {5, 2} }, { {0, 5} }, { {6, 6}, {7, 4}, {5, 7} } };
+	vegetation::VegetationMap trees;
+	trees.build(chunks, heightMap.data(), layout::MapIndexer(layout::MapLayout::ROW_MAJOR, 2, 2, 4, 4), 2);
+
+	//When
+	std::vector<uint32_t> inside = trees.queryRect(1.0f, 2.0f, 6.0f, 7.0f);
+	bool result = trees.remove(inside);
+
+	//Then
+	EXPECT_EQ(inside.size(), 4) << "FAILED! Wrong number of trees inside of the rectangle.";
+	EXPECT_TRUE(result);
+	EXPECT_EQ(trees.size(), 3);
+	EXPECT_EQ(trees.getChunkSize(0, 0), 1);
+	EXPECT_EQ(trees.getChunkSize(1, 0), 0);
+	EXPECT_EQ(trees.getChunkSize(1, 1), 1);
+	EXPECT_TRUE(trees.queryRect(1.0f, 2.0f, 6.0f, 7.0f).empty()) << "FAILED! Removed trees are still indexed.";
+	EXPECT_EQ(trees.queryRadius(7.0f, 4.0f, 0.5f).size(), 1);
+}
@@ -0,0 +1,187 @@
+#include "pch.h"
+
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "TerrainGenerator.h"
+#include "WorldStore.h"
+#include "testTerrain.h"
+
+static std::string worldPath(const std::string& name)
+{
+	return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static world::WorldHeader createHeader()
+{
+	world::WorldHeader header;
+	header.width = 3;
+	header.height = 2;
+	header.chunkResolution = 4;
+	header.seed = 742;
+	header.seeLevel = 64.0f;
+	return header;
+}
+
+TEST(worldStoreUnitTests, chunkRoundTripTest) {
+	//Given
+	std::string path = worldPath("worldStoreRoundTrip.world");
+	std::vector<float> heights(16);
+	std::vector<int> biomes(16);
+	for (int i = 0; i < 16; i++) {
+		heights[i] = i * 0.5f;
+		biomes[i] = i % 6;
+	}
+	std::vector<std::pair<int, int>> trees = { {4, 1}, {6, 3} };
+	world::WorldStore store;
+
+	//When
+	bool created = store.create(path, createHeader());
+	bool written = store.writeChunk(1, 0, heights, biomes, trees);
+	world::ChunkView view = store.readChunk(1, 0);
+
+	//Then
+	EXPECT_TRUE(created && written) << "FAILED! World file couldnt be written.";
+	ASSERT_TRUE(view.valid()) << "FAILED! Stored chunk couldnt be read.";
+	EXPECT_TRUE(std::equal(view.heights.begin(), view.heights.end(), heights.begin(), heights.end()));
+	EXPECT_TRUE(std::equal(view.biomes.begin(), view.biomes.end(), biomes.begin(), biomes.end()));
+	EXPECT_EQ(view.treeCount(), 2);
+	EXPECT_EQ(view.trees[2], 6);
+	EXPECT_FALSE(store.readChunk(0, 0).valid()) << "FAILED! Chunk not written is readable.";
+	EXPECT_FALSE(store.hasChunk(3, 0));
+
+	store.close();
+	std::filesystem::remove(path);
+}
+
+TEST(worldStoreUnitTests, reopenAndRewriteTest) {
+	//Given
+	std::string path = worldPath("worldStoreReopen.world");
+	std::vector<float> heights(16, 1.0f), newHeights(16, 2.0f);
+	std::vector<int> biomes(16, 3);
+	{
+		world::WorldStore store;
+		store.create(path, createHeader());
+		store.writeChunk(2, 1, heights, biomes, {});
+		store.writeChunk(0, 1, heights, biomes, {});
+	}
+	world::WorldStore store;
+
+	//When
+	bool opened = store.open(path);
+	bool rewritten = store.writeChunk(2, 1, newHeights, biomes, {});
+	world::ChunkView view = store.readChunk(2, 1);
+
+	//Then
+	EXPECT_TRUE(opened) << "FAILED! World file couldnt be opened.";
+	EXPECT_TRUE(rewritten);
+	EXPECT_EQ(store.getHeader(), createHeader()) << "FAILED! Header differs after reopening.";
+	EXPECT_EQ(store.getStoredChunkCount(), 2);
+	ASSERT_TRUE(view.valid());
+	EXPECT_EQ(view.heights[5], 2.0f) << "FAILED! Rewritten chunk points at the old block.";
+	EXPECT_EQ(store.readChunk(0, 1).heights[5], 1.0f);
+
+	store.close();
+	std::filesystem::remove(path);
+}
+
+TEST(worldStoreUnitTests, viewsSurviveWritesUntilRemapTest) {
+	//Given
+	std::string path = worldPath("worldStoreViews.world");
+	std::vector<float> heights(16, 1.0f), otherHeights(16, 2.0f);
+	std::vector<int> biomes(16, 3);
+	world::WorldStore store;
+	store.create(path, createHeader());
+	store.writeChunk(0, 0, heights, biomes, {});
+	world::ChunkView first = store.readChunk(0, 0);
+
+	//When
+	for (int y = 0; y < 2; y++)
+		for (int x = 0; x < 3; x++)
+			if (x != 0 || y != 0)
+				store.writeChunk(x, y, otherHeights, biomes, {});
+	float firstHeight = first.heights[5];
+	bool remapped = store.remap();
+
+	std::vector<std::thread> readers;
+	std::atomic<int> validReads{ 0 };
+	for (int t = 0; t < 4; t++) {
+		readers.emplace_back([&store, &validReads]() {
+			for (int y = 0; y < 2; y++)
+				for (int x = 0; x < 3; x++)
+					if (store.readChunk(x, y).valid())
+						validReads++;
+		});
+	}
+	for (auto& it : readers)
+		it.join();
+
+	//Then
+	EXPECT_EQ(firstHeight, 1.0f) << "FAILED! View changed by the writes of other chunks.";
+	EXPECT_TRUE(remapped);
+	EXPECT_EQ(validReads.load(), 4 * 6) << "FAILED! Concurrent reads failed.";
+	EXPECT_EQ(store.readChunk(2, 1).heights[5], 2.0f);
+
+	store.close();
+	std::filesystem::remove(path);
+}
+
+TEST(worldStoreUnitTests, nonValidFileTest) {
+	//Given
+	std::string path = worldPath("worldStoreMissing.world");
+	std::filesystem::remove(path);
+	world::WorldStore store;
+
+	//When
+	bool result = store.open(path);
+
+	//Then
+	EXPECT_FALSE(result) << "FAILED! Missing file opened.";
+	EXPECT_FALSE(store.writeChunk(0, 0, std::vector<float>(16), std::vector<int>(16), {}));
+}
+
+TEST(worldStoreUnitTests, terrainSaveAndLoadTest) {
+	//Given
+	std::string path = worldPath("worldStoreTerrain.world");
+	TerrainGenerator generated;
+	setupTestTerrain(generated, 4, 3, 6);
+	generated.performTerrainGeneration();
+	{
+		world::WorldStore store;
+		store.create(path, generated.getWorldHeader());
+		generated.saveWorld(store);
+	}
+
+	TerrainGenerator loaded;
+	setupTestTerrain(loaded, 4, 3, 6);
+	loaded.setMapLayout(layout::MapLayout::CHUNK_MAJOR);
+	world::WorldStore store;
+	store.open(path);
+
+	//When
+	bool result = loaded.loadWorld(store);
+
+	//Then
+	EXPECT_TRUE(result) << "FAILED! World couldnt be loaded.";
+	for (int y = 0; y < generated.getHeight(); y++) {
+		for (int x = 0; x < generated.getWidth(); x++) {
+			EXPECT_EQ(generated.getHeightAt(x, y), loaded.getHeightAt(x, y)) << "FAILED! Heights differ at " << x << ", " << y;
+			EXPECT_EQ(generated.getBiomeAt(x, y), loaded.getBiomeAt(x, y)) << "FAILED! Biomes differ at " << x << ", " << y;
+		}
+	}
+	auto generatedX = generated.getVegetation().getX(), loadedX = loaded.getVegetation().getX();
+	auto generatedHeights = generated.getVegetation().getHeight(), loadedHeights = loaded.getVegetation().getHeight();
+	EXPECT_GT(generated.getTreeCount(), 0);
+	EXPECT_TRUE(std::equal(generatedX.begin(), generatedX.end(), loadedX.begin(), loadedX.end())) << "FAILED! Vegetation differs";
+	EXPECT_TRUE(std::equal(generatedHeights.begin(), generatedHeights.end(), loadedHeights.begin(), loadedHeights.end())) << "FAILED! Vegetation differs";
+
+	TerrainGenerator otherSeed;
+	setupTestTerrain(otherSeed, 4, 3, 6);
+	otherSeed.setSeed(743);
+	EXPECT_FALSE(otherSeed.loadWorld(store)) << "FAILED! World generated with a different seed loaded.";
+
+	store.close();
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,407 @@
+//Headless batch generator of the worlds, runs the generation, erosion and export without the window and the GL context
+//
+//Usage: TerrainGenCli [options]
+//	--config <file>			generation config, see GenerationConfig.h, defaults of the application are used without it
+//	--write-config <file>	writes the final config (defaults, file and options merged) and exits
+//	--seed <n>				world seed
+//	--size <w> <h>			size of the world in chunks
+//	--chunk-res <n>			samples per side of the chunk
+//	--droplets <n>			erosion droplets, 0 disables the erosion
+//	--erosion-mode <serial|checkerboard|fixed-point|chunked>	serial erosion (default) or parallel erosion, see Erosion.h, all seeded by the world seed,
+//							chunked erodes the chunks during the generation, see TerrainGenerator::erodeChunk
+//	--erosion-engine <droplets|pipe>	particle erosion (default) or grid erosion of the virtual pipes, see PipeErosion.h
+//	--pipe-iterations <n>	iterations of the pipe erosion, 0 disables the erosion
+//	--benchmark-erosion		erodes the map with 1 to all threads in both parallel modes and with the pipe engine and prints the scaling
+//							and the throughput of the engines
+//	--threads <n>			worker threads of the job system
+//	--cache <dir>			directory of the generation cache, generations with the same config are loaded from it
+//	--world <file>			world file of the generated chunks (before the erosion, unless it is chunked)
+//	--glb <file>, --ply <file>, --obj <file>	terrain meshes
+//	--tiles <prefix>		16 bit height tiles, see HeightFile.h
+//	--tile-size <n>			size of the tiles in samples (default 1024)
+//	--tile-format <pgm|raw>	format of the tiles (default pgm)
+//	--scale <f>				scale of the exported meshes (default 1)
+//	--shard <x> <y> <nx> <ny>	generates only the shard x, y of the nx x ny grid into the shard file of --world, see Shard.h
+//	--margin <n>			chunks generated around the shard (default 1)
+//	--merge <nx> <ny>		merges the shard files of --world into it and verifies the seams, nothing is generated
+//
+//Every stage prints its time and the summary of all of the stages is printed at the end.
+//Returns 0 on success, 1 if any stage failed and 2 on invalid arguments.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Erosion.h"
+#include "GenerationConfig.h"
+#include "HeightFile.h"
+#include "JobSystem.h"
+#include "MeshExport.h"
+#include "PipeErosion.h"
+#include "Shard.h"
+#include "TerrainGenerator.h"
+#include "WorldStore.h"
+
+struct BatchOptions {
+	std::string configPath, writeConfigPath;
+	std::string cacheDirectory, worldPath, glbPath, plyPath, objPath, tilesPrefix;
+	int seed = 0, width = 0, height = 0, chunkResolution = 0;
+	int dropletCount = -1;
+	std::string erosionMode = "serial";
+	std::string erosionEngine;
+	int pipeIterations = -1;
+	bool benchmarkErosion = false;
+	int threadCount = 0;
+	int tileSize = 1024;
+	heightfile::FileType tileFormat = heightfile::FileType::PGM;
+	float scalingFactor = 1.0f;
+	int shardX = -1, shardY = -1, shardsX = 0, shardsY = 0;
+	int margin = 1;
+	bool merge = false;
+	bool seedSet = false;
+	bool help = false;
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: TerrainGenCli [--config <file>] [--write-config <file>] [--seed <n>] [--size <w> <h>] [--chunk-res <n>]\n"
+		"                     [--droplets <n>] [--erosion-mode <serial|checkerboard|fixed-point|chunked>] [--erosion-engine <droplets|pipe>] [--pipe-iterations <n>]\n"
+		"                     [--benchmark-erosion] [--threads <n>] [--cache <dir>] [--world <file>]\n"
+		"                     [--glb <file>] [--ply <file>] [--obj <file>] [--tiles <prefix>] [--tile-size <n>]\n"
+		"                     [--tile-format <pgm|raw>] [--scale <f>] [--shard <x> <y> <nx> <ny>] [--margin <n>] [--merge <nx> <ny>] [--help]" << std::endl;
+}
+
+static bool parseInt(const char* text, int& value)
+{
+	char* end = nullptr;
+	long parsed = std::strtol(text, &end, 10);
+	if (end == text || *end != '\0')
+		return false;
+	value = static_cast<int>(parsed);
+	return true;
+}
+
+//@return bool - false if any of the options is unknown or has an invalid value
+static bool parseArguments(int argc, char** argv, BatchOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		//Options followed by one value, --size and --merge are followed by two, --shard by four, --help and --benchmark-erosion by none
+		static const std::string valueOptions[] = { "--config", "--write-config", "--cache", "--world", "--glb", "--ply", "--obj", "--tiles",
+			"--seed", "--chunk-res", "--droplets", "--erosion-mode", "--erosion-engine", "--pipe-iterations", "--threads", "--tile-size", "--tile-format", "--scale", "--margin" };
+		int needed = option == "--size" || option == "--merge" ? 2 : option == "--shard" ? 4 : option == "--help" || option == "--benchmark-erosion" ? 0 : 1;
+		if (needed == 1 && std::find(std::begin(valueOptions), std::end(valueOptions), option) == std::end(valueOptions)) {
+			std::cout << "[ERROR] Unknown option " << option << std::endl;
+			return false;
+		}
+		if (i + needed >= argc) {
+			std::cout << "[ERROR] Option " << option << " needs " << needed << " value(s)" << std::endl;
+			return false;
+		}
+
+		bool valid = true;
+		if (option == "--config") options.configPath = argv[++i];
+		else if (option == "--write-config") options.writeConfigPath = argv[++i];
+		else if (option == "--cache") options.cacheDirectory = argv[++i];
+		else if (option == "--world") options.worldPath = argv[++i];
+		else if (option == "--glb") options.glbPath = argv[++i];
+		else if (option == "--ply") options.plyPath = argv[++i];
+		else if (option == "--obj") options.objPath = argv[++i];
+		else if (option == "--tiles") options.tilesPrefix = argv[++i];
+		else if (option == "--seed") valid = options.seedSet = parseInt(argv[++i], options.seed);
+		else if (option == "--size") {
+			valid = parseInt(argv[i + 1], options.width) && parseInt(argv[i + 2], options.height) && options.width > 0 && options.height > 0;
+			i += 2;
+		}
+		else if (option == "--chunk-res") valid = parseInt(argv[++i], options.chunkResolution) && options.chunkResolution > 0;
+		else if (option == "--droplets") valid = parseInt(argv[++i], options.dropletCount) && options.dropletCount >= 0;
+		else if (option == "--erosion-mode") {
+			options.erosionMode = argv[++i];
+			valid = options.erosionMode == "serial" || options.erosionMode == "checkerboard" || options.erosionMode == "fixed-point" || options.erosionMode == "chunked";
+		}
+		else if (option == "--erosion-engine") {
+			options.erosionEngine = argv[++i];
+			valid = options.erosionEngine == "droplets" || options.erosionEngine == "pipe";
+		}
+		else if (option == "--pipe-iterations") valid = parseInt(argv[++i], options.pipeIterations) && options.pipeIterations >= 0;
+		else if (option == "--benchmark-erosion") options.benchmarkErosion = true;
+		else if (option == "--threads") valid = parseInt(argv[++i], options.threadCount) && options.threadCount > 0;
+		else if (option == "--tile-size") valid = parseInt(argv[++i], options.tileSize) && options.tileSize > 0;
+		else if (option == "--tile-format") {
+			std::string format = argv[++i];
+			valid = format == "pgm" || format == "raw";
+			options.tileFormat = format == "raw" ? heightfile::FileType::RAW : heightfile::FileType::PGM;
+		}
+		else if (option == "--scale") {
+			char* end = nullptr;
+			options.scalingFactor = std::strtof(argv[++i], &end);
+			valid = *end == '\0' && end != argv[i];
+		}
+		else if (option == "--shard") {
+			valid = parseInt(argv[i + 1], options.shardX) && parseInt(argv[i + 2], options.shardY) &&
+				parseInt(argv[i + 3], options.shardsX) && parseInt(argv[i + 4], options.shardsY) &&
+				options.shardX >= 0 && options.shardY >= 0 && options.shardX < options.shardsX && options.shardY < options.shardsY;
+			i += 4;
+		}
+		else if (option == "--margin") valid = parseInt(argv[++i], options.margin) && options.margin > 0;
+		else if (option == "--merge") {
+			valid = parseInt(argv[i + 1], options.shardsX) && parseInt(argv[i + 2], options.shardsY) && options.shardsX > 0 && options.shardsY > 0;
+			options.merge = true;
+			i += 2;
+		}
+		else if (option == "--help") options.help = true;
+
+		if (!valid) {
+			std::cout << "[ERROR] Invalid value of the option " << option << std::endl;
+			return false;
+		}
+	}
+	//Shard mode writes only the shard file, the exports need the whole world, only the chunked erosion is part of the shard
+	bool shardMode = options.shardX >= 0 || options.merge;
+	bool chunkedErosion = options.erosionMode == "chunked" && options.erosionEngine != "pipe";
+	if (shardMode && (options.worldPath.empty() || (options.shardX >= 0 && options.merge) || (options.dropletCount > 0 && !chunkedErosion) || options.pipeIterations > 0 || options.benchmarkErosion ||
+		!options.glbPath.empty() || !options.plyPath.empty() || !options.objPath.empty() || !options.tilesPrefix.empty())) {
+		std::cout << "[ERROR] --shard and --merge need --world and cant be combined with each other, the erosion other than chunked or the exports" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//Erodes the copies of the map with 1, 2, 4... up to threadCount threads in both parallel modes and with the pipe engine
+//and prints the time, the speedup against 1 thread and whether the map is the same as with 1 thread
+//Throughput of the engines is printed in the map cells per second, the number of the cells of the map divided by the time
+//of the erosion, the pipe engine also in the cell updates (one cell in one iteration) per second
+//@return bool - false if any map differs from the map eroded by 1 thread or the erosion failed
+static bool benchmarkErosion(const std::vector<float>& heights, const layout::MapIndexer& indexer, const config::GenerationConfig& generationConfig, unsigned int threadCount)
+{
+	int width = indexer.width * indexer.chunkWidth, height = indexer.height * indexer.chunkHeight;
+	int dropletCount = generationConfig.dropletCount > 0 ? generationConfig.dropletCount : width * height / 4;
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < threadCount; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(threadCount);
+
+	bool identical = true;
+	for (erosion::ParallelMode mode : { erosion::ParallelMode::CHECKERBOARD, erosion::ParallelMode::FIXED_POINT }) {
+		std::vector<float> reference;
+		double referenceTime = 0.0;
+		for (unsigned int threads : threadCounts) {
+			jobs::JobSystem::get().setThreadCount(threads);
+			erosion::Erosion erosion(width, height);
+			erosion.SetConfig(generationConfig.erosion);
+			erosion.SetDropletCount(dropletCount);
+			erosion.SetSeed(generationConfig.seed);
+			erosion.SetMap(heights.data());
+
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!erosion.ErodeParallel(mode))
+				return false;
+			std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+
+			bool same = true;
+			if (reference.empty()) {
+				reference.assign(erosion.getMap(), erosion.getMap() + heights.size());
+				referenceTime = duration.count();
+			}
+			else
+				same = std::equal(reference.begin(), reference.end(), erosion.getMap());
+			identical &= same;
+
+			std::cout << "[LOG] Erosion " << (mode == erosion::ParallelMode::CHECKERBOARD ? "checkerboard" : "fixed-point") << ", " << dropletCount << " droplets, "
+				<< threads << " threads: " << duration.count() << " ms, speedup " << referenceTime / duration.count() << ", "
+				<< heights.size() / duration.count() * 1000.0 << " map cells/s" << (same ? "" : ", MAP DIFFERS") << std::endl;
+		}
+	}
+	erosion::PipeErosionConfig pipeConfig = generationConfig.pipeErosion;
+	pipeConfig.iterations = pipeConfig.iterations > 0 ? pipeConfig.iterations : 100;
+	std::vector<float> reference;
+	double referenceTime = 0.0;
+	for (unsigned int threads : threadCounts) {
+		jobs::JobSystem::get().setThreadCount(threads);
+		erosion::PipeErosion pipeErosion(width, height);
+		pipeErosion.SetConfig(generationConfig.erosion, pipeConfig);
+		pipeErosion.SetMap(heights.data());
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!pipeErosion.Erode())
+			return false;
+		std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+
+		bool same = true;
+		if (reference.empty()) {
+			reference.assign(pipeErosion.getMap(), pipeErosion.getMap() + heights.size());
+			referenceTime = duration.count();
+		}
+		else
+			same = std::equal(reference.begin(), reference.end(), pipeErosion.getMap());
+		identical &= same;
+
+		std::cout << "[LOG] Erosion pipe, " << pipeConfig.iterations << " iterations, " << threads << " threads: " << duration.count() << " ms, speedup "
+			<< referenceTime / duration.count() << ", " << static_cast<double>(heights.size()) * pipeConfig.iterations / duration.count() * 1000.0 << " cell updates/s, "
+			<< heights.size() / duration.count() * 1000.0 << " map cells/s" << (same ? "" : ", MAP DIFFERS") << std::endl;
+	}
+	jobs::JobSystem::get().setThreadCount(threadCount);
+
+	if (!identical)
+		std::cout << "[ERROR] Parallel erosion depends on the number of threads" << std::endl;
+	return identical;
+}
+
+int main(int argc, char** argv)
+{
+	BatchOptions options;
+	if (!parseArguments(argc, argv, options)) {
+		printUsage();
+		return 2;
+	}
+	if (options.help) {
+		printUsage();
+		return 0;
+	}
+
+	std::vector<std::pair<std::string, double>> timings;
+	//Runs the stage and records its time, the following stages are skipped after the first failure
+	auto runStage = [&timings](const std::string& name, const std::function<bool()>& stage) {
+		auto start = std::chrono::high_resolution_clock::now();
+		bool result = stage();
+		std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+		timings.emplace_back(name, duration.count());
+		std::cout << "[LOG] Stage '" << name << "' " << (result ? "took: " : "failed after: ") << duration.count() << " ms" << std::endl;
+		return result;
+	};
+
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	if (!options.configPath.empty() && !config::loadConfig(options.configPath, generationConfig))
+		return 1;
+	if (options.seedSet)
+		generationConfig.seed = options.seed;
+	if (options.width > 0) {
+		generationConfig.width = options.width;
+		generationConfig.height = options.height;
+	}
+	if (options.chunkResolution > 0)
+		generationConfig.chunkResolution = options.chunkResolution;
+	if (options.dropletCount >= 0)
+		generationConfig.dropletCount = options.dropletCount;
+	if (!options.erosionEngine.empty())
+		generationConfig.erosionEngine = options.erosionEngine == "pipe" ? erosion::ErosionEngine::PIPE : erosion::ErosionEngine::DROPLETS;
+	if (options.pipeIterations >= 0)
+		generationConfig.pipeErosion.iterations = options.pipeIterations;
+	if (options.erosionMode == "chunked")
+		generationConfig.chunkedErosion = true;
+
+	if (!options.writeConfigPath.empty())
+		return config::saveConfig(options.writeConfigPath, generationConfig) ? 0 : 1;
+
+	if (options.merge) {
+		shard::MergeReport report;
+		bool merged = runStage("merge", [&]() { return shard::mergeShards(options.worldPath, options.shardsX, options.shardsY, report); });
+		return merged ? 0 : 1;
+	}
+
+	if (options.threadCount > 0)
+		jobs::JobSystem::get().setThreadCount(options.threadCount);
+	if (options.shardX >= 0) {
+		std::string path = shard::shardPath(options.worldPath, options.shardX, options.shardY);
+		bool generated = runStage("shard", [&]() {
+			return shard::generateShard(generationConfig, options.shardsX, options.shardsY, options.shardX, options.shardY, options.margin, path);
+		});
+		return generated ? 0 : 1;
+	}
+
+	std::cout << "[LOG] Generating world " << generationConfig.width << " x " << generationConfig.height << " chunks of " << generationConfig.chunkResolution
+		<< " samples, seed " << generationConfig.seed << ", " << jobs::JobSystem::get().getThreadCount() << " threads" << std::endl;
+
+	TerrainGenerator terrainGen;
+	terrainGen.setCacheDirectory(options.cacheDirectory);
+	bool result = runStage("setup", [&]() { return config::applyConfig(generationConfig, terrainGen); }) &&
+		runStage("generation", [&]() { return terrainGen.performTerrainGeneration(); });
+
+	if (result && !options.worldPath.empty()) {
+		result = runStage("world", [&]() {
+			world::WorldStore store;
+			return store.create(options.worldPath, terrainGen.getWorldHeader()) && terrainGen.saveWorld(store);
+		});
+	}
+
+	//Erosion works in place on the row-major map, the map of the generator is eroded straight away in the row-major layout
+	//and its row-major copy otherwise
+	const float* heightMap = terrainGen.getHeightMap();
+	layout::MapIndexer indexer = terrainGen.getMapIndexer();
+	layout::MapIndexer rowMajor(layout::MapLayout::ROW_MAJOR, indexer.width, indexer.height, indexer.chunkWidth, indexer.chunkHeight);
+	bool erodeInPlace = indexer.layout == layout::MapLayout::ROW_MAJOR;
+	bool pipeEngine = generationConfig.erosionEngine == erosion::ErosionEngine::PIPE;
+	bool erode = pipeEngine ? generationConfig.pipeErosion.iterations > 0 : generationConfig.dropletCount > 0 && !terrainGen.isErosionEnabled();
+	std::vector<float> heights;
+	if (result && ((erode && !erodeInPlace) || options.benchmarkErosion)) {
+		heights.resize(rowMajor.size());
+		result = terrainGen.copyHeightMap(heights.data());
+	}
+
+	if (result && options.benchmarkErosion) {
+		result = runStage("erosion benchmark", [&]() {
+			return benchmarkErosion(heights, rowMajor, generationConfig, jobs::JobSystem::get().getThreadCount());
+		});
+	}
+
+	erosion::Erosion erosion(terrainGen.getWidth(), terrainGen.getHeight());
+	erosion::PipeErosion pipeErosion(rowMajor.width * rowMajor.chunkWidth, rowMajor.height * rowMajor.chunkHeight);
+	if (result && erode && pipeEngine) {
+		result = runStage("erosion", [&]() {
+			pipeErosion.SetConfig(generationConfig.erosion, generationConfig.pipeErosion);
+			pipeErosion.SetMap(erodeInPlace ? terrainGen.getHeightMap() : heights.data());
+			if (!pipeErosion.Erode())
+				return false;
+			heightMap = pipeErosion.getMap();
+			indexer = rowMajor;
+			return true;
+		});
+	}
+	else if (result && erode) {
+		result = runStage("erosion", [&]() {
+			float* erodedMap = erodeInPlace ? terrainGen.getHeightMap() : heights.data();
+			if (!erosion.SetMapView(erodedMap, rowMajor.width * rowMajor.chunkWidth, rowMajor.height * rowMajor.chunkHeight))
+				return false;
+			erosion.SetConfig(generationConfig.erosion);
+			erosion.SetDropletCount(generationConfig.dropletCount);
+			erosion.SetSeed(generationConfig.seed);
+			if (options.erosionMode == "serial")
+				erosion.Erode(std::nullopt);
+			else if (!erosion.ErodeParallel(options.erosionMode == "checkerboard" ? erosion::ParallelMode::CHECKERBOARD : erosion::ParallelMode::FIXED_POINT))
+				return false;
+			heightMap = erodedMap;
+			indexer = rowMajor;
+			return true;
+		});
+	}
+
+	if (result && !options.glbPath.empty())
+		result = runStage("glb", [&]() { return exporter::exportGlb(options.glbPath, heightMap, indexer, options.scalingFactor); });
+	if (result && !options.plyPath.empty())
+		result = runStage("ply", [&]() { return exporter::exportPly(options.plyPath, heightMap, indexer, options.scalingFactor); });
+	if (result && !options.objPath.empty())
+		result = runStage("obj", [&]() { return exporter::exportObj(options.objPath, heightMap, indexer, options.scalingFactor); });
+	if (result && !options.tilesPrefix.empty()) {
+		result = runStage("tiles", [&]() {
+			return heightfile::exportTiles(options.tilesPrefix, heightMap, indexer, options.tileSize, options.tileFormat, heightfile::findHeightRange(heightMap, indexer));
+		});
+	}
+
+	double total = 0.0;
+	std::cout << "[LOG] Stage timings:" << std::endl;
+	for (auto& [name, milliseconds] : timings) {
+		std::cout << "[LOG]   " << name << ": " << milliseconds << " ms" << std::endl;
+		total += milliseconds;
+	}
+	std::cout << "[LOG]   total: " << total << " ms" << std::endl;
+
+	if (!result) {
+		std::cout << "[ERROR] Batch generation failed" << std::endl;
+		return 1;
+	}
+	return 0;
+}
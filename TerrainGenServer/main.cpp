@@ -0,0 +1,136 @@
+//Daemon serving the chunks of one generated world to the processes of the same host, see ChunkServer.h for the protocol
+//
+//Usage: TerrainGenServer [options]
+//	--socket <path>			path of the unix domain socket (default terrain.sock)
+//	--config <file>			generation config, see GenerationConfig.h, defaults of the application are used without it
+//	--seed <n>				world seed
+//	--size <w> <h>			size of the world in chunks
+//	--chunk-res <n>			samples per side of the chunk
+//	--threads <n>			worker threads of the job system used by the generation
+//	--cache <dir>			directory of the generation cache, restarted server loads the world from it
+//
+//World is generated once at the start in the chunk-major layout, then the server runs until it is interrupted (Ctrl+C
+//or SIGTERM). Only the chunks of that world are served, the chunks outside of it are not generated on demand.
+//Returns 0 after the clean shutdown, 1 if the world couldnt be generated or served and 2 on invalid arguments.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ChunkServer.h"
+#include "GenerationConfig.h"
+#include "JobSystem.h"
+#include "TerrainGenerator.h"
+
+static std::atomic<bool> interrupted{ false };
+
+static void onSignal(int)
+{
+	interrupted = true;
+}
+
+static void printUsage()
+{
+	std::cout << "Usage: TerrainGenServer [--socket <path>] [--config <file>] [--seed <n>] [--size <w> <h>] [--chunk-res <n>]\n"
+		"                        [--threads <n>] [--cache <dir>] [--help]" << std::endl;
+}
+
+static bool parseInt(const char* text, int& value)
+{
+	char* end = nullptr;
+	long parsed = std::strtol(text, &end, 10);
+	if (end == text || *end != '\0')
+		return false;
+	value = static_cast<int>(parsed);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string socketPath = "terrain.sock", configPath, cacheDirectory;
+	int seed = 0, width = 0, height = 0, chunkResolution = 0, threadCount = 0;
+	bool seedSet = false;
+
+	for (int i = 1; i < argc; i++) {
+		std::string option = argv[i];
+		if (option == "--help") {
+			printUsage();
+			return 0;
+		}
+
+		int needed = option == "--size" ? 2 : 1;
+		if (i + needed >= argc) {
+			std::cout << "[ERROR] Option " << option << " needs " << needed << " value(s)" << std::endl;
+			printUsage();
+			return 2;
+		}
+
+		bool valid = true;
+		if (option == "--socket") socketPath = argv[++i];
+		else if (option == "--config") configPath = argv[++i];
+		else if (option == "--cache") cacheDirectory = argv[++i];
+		else if (option == "--seed") valid = seedSet = parseInt(argv[++i], seed);
+		else if (option == "--size") {
+			valid = parseInt(argv[i + 1], width) && parseInt(argv[i + 2], height) && width > 0 && height > 0;
+			i += 2;
+		}
+		else if (option == "--chunk-res") valid = parseInt(argv[++i], chunkResolution) && chunkResolution > 0;
+		else if (option == "--threads") valid = parseInt(argv[++i], threadCount) && threadCount > 0;
+		else {
+			std::cout << "[ERROR] Unknown option " << option << std::endl;
+			valid = false;
+		}
+
+		if (!valid) {
+			std::cout << "[ERROR] Invalid value of the option " << option << std::endl;
+			printUsage();
+			return 2;
+		}
+	}
+
+	config::GenerationConfig generationConfig = config::defaultConfig();
+	if (!configPath.empty() && !config::loadConfig(configPath, generationConfig))
+		return 1;
+	if (seedSet)
+		generationConfig.seed = seed;
+	if (width > 0) {
+		generationConfig.width = width;
+		generationConfig.height = height;
+	}
+	if (chunkResolution > 0)
+		generationConfig.chunkResolution = chunkResolution;
+	//Chunks are served straight from the maps, which needs every chunk to be contiguous
+	generationConfig.mapLayout = layout::MapLayout::CHUNK_MAJOR;
+
+	if (threadCount > 0)
+		jobs::JobSystem::get().setThreadCount(threadCount);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	TerrainGenerator terrainGen;
+	terrainGen.setCacheDirectory(cacheDirectory);
+	if (!config::applyConfig(generationConfig, terrainGen) || !terrainGen.performTerrainGeneration()) {
+		std::cout << "[ERROR] World couldnt be generated" << std::endl;
+		return 1;
+	}
+	std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "[LOG] World " << generationConfig.width << " x " << generationConfig.height << " chunks generated in: " << duration.count() << " ms" << std::endl;
+
+	server::ChunkServer chunkServer(terrainGen);
+	if (!chunkServer.start(socketPath))
+		return 1;
+
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+	while (!interrupted)
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	chunkServer.stop();
+	server::ServerStats stats = chunkServer.getStats();
+	std::cout << "[LOG] Served " << stats.connections << " connections, " << stats.requests << " requests, " << stats.chunks << " chunks, "
+		<< stats.bytesSent << " bytes" << std::endl;
+	return 0;
+}
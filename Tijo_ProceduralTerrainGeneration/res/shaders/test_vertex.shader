@@ -2,7 +2,9 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec3 aColor;
-layout (location = 3) in vec3 aOffset;
+layout (location = 3) in float aOffsetX;
+layout (location = 4) in float aOffsetY;
+layout (location = 5) in float aOffsetZ;
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -11,10 +13,12 @@ out vec3 fColor;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform float offsetScale;
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos + aOffset, 1.0));
+    vec3 offset = vec3(aOffsetX, aOffsetY, aOffsetZ) * offsetScale;
+    FragPos = vec3(model * vec4(aPos + offset, 1.0));
     Normal = aNormal;  
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
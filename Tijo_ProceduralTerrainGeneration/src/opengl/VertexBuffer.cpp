@@ -28,3 +28,11 @@ void VertexBuffer::UpdateData(const void* data, unsigned int size)
 	GLCALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
 	GLCALL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
 }
+
+//Overwrites the part of the buffer, the buffer keeps its size
+//@param offset, size - range of the buffer in bytes
+void VertexBuffer::UpdateSubData(const void* data, unsigned int offset, unsigned int size)
+{
+	GLCALL(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+	GLCALL(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+}
@@ -11,6 +11,7 @@ public:
 	void Bind() const;
 	void Unbind() const;
 	void UpdateData(const void* data, unsigned int size);
+	void UpdateSubData(const void* data, unsigned int offset, unsigned int size);
 
 	unsigned int GetRendererID() const { return m_RendererID; }
 };
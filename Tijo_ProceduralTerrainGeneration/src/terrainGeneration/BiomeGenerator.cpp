@@ -1,8 +1,18 @@
 #include "BiomeGenerator.h"
+#include "JobSystem.h"
+
+#include <algorithm>
 #include <iostream>
 
 BiomeGenerator::BiomeGenerator()
 {
+	temperatureNoise.getConfigRef().option = noise::Options::NOTHING;
+	temperatureNoise.getConfigRef().scale = 0.01f;
+	temperatureNoise.getConfigRef().constrast = 1.5f;
+
+	humidityNoise.getConfigRef().option = noise::Options::NOTHING;
+	humidityNoise.getConfigRef().scale = 0.01f;
+	humidityNoise.getConfigRef().constrast = 1.5f;
 }
 
 BiomeGenerator::~BiomeGenerator()
@@ -60,21 +70,56 @@ int BiomeGenerator::determineBiome(const int& temperature, const int& humidity,
 	return 0;
 }
 
-bool BiomeGenerator::biomify(float* map, int* biomeMap, const int& width, const int& height, const int& chunkRes, const int& seed, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss)
+//Classifies every cell of the map into the biome
+//
+//@param map, biomeMap - height map and output biome map, both ordered by mapLayout
+//@param mapLayout - layout of the maps, temperature and humidity noises use the same one
+bool BiomeGenerator::biomify(float* map, int* biomeMap, const int& width, const int& height, const int& chunkRes, const int& seed, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss,
+	layout::MapLayout mapLayout)
 {
 	if (!biomeMap) {
 		std::cout << "[ERROR] BiomeMap not initialized" << std::endl;
 		return false;
 	}
 
+	if (!prepareNoise(width, height, chunkRes, seed, mapLayout))
+		return false;
+
+	layout::MapIndexer indexer(mapLayout, width, height, chunkRes, chunkRes);
+
+	std::cout << "[LOG] Evaluating biomeMap..." << std::endl;
+
+	//Chunks of the biome map are classified in parallel, lookups only read the ranges and biomes
+	jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [&](int chunkX, int chunkY) {
+		biomifyChunk(map, biomeMap, indexer, chunkX, chunkY, continenatlnes, mountainouss);
+	});
+	return true;
+}
+
+//Places the temperature and humidity maps into the larger world, see SimplexNoiseClass::setWorldRegion
+void BiomeGenerator::setWorldRegion(int originX, int originY, int worldWidth, int worldHeight)
+{
+	temperatureNoise.setWorldRegion(originX, originY, worldWidth, worldHeight);
+	humidityNoise.setWorldRegion(originX, originY, worldWidth, worldHeight);
+}
+
+//Configures temperature and humidity noises and allocates their maps, has to be called before biomifyChunk
+//
+//@param width, height - size of the map in chunks
+//@param chunkRes - resolution of the chunk
+//@param seed - seed of the world
+//@param mapLayout - layout of the noise maps
+//@return bool - false if the noise maps couldnt be allocated
+bool BiomeGenerator::prepareNoise(const int& width, const int& height, const int& chunkRes, const int& seed, layout::MapLayout mapLayout)
+{
+	temperatureNoise.setLayout(mapLayout);
+	humidityNoise.setLayout(mapLayout);
+
 	temperatureNoise.setSeed(seed);
 	temperatureNoise.setMapSize(width, height);
 	temperatureNoise.setChunkSize(chunkRes, chunkRes);
-	temperatureNoise.getConfigRef().option = noise::Options::NOTHING;
-	temperatureNoise.getConfigRef().scale = 0.01f;
-	temperatureNoise.getConfigRef().constrast = 1.5f;
 	temperatureNoise.initMap();
-	if (!temperatureNoise.generateFractalNoiseByChunks()) {
+	if (!temperatureNoise.getMap()) {
 		std::cout << "[ERROR] Failed to generate temperature noise" << std::endl;
 		return false;
 	}
@@ -82,22 +127,34 @@ bool BiomeGenerator::biomify(float* map, int* biomeMap, const int& width, const
 	humidityNoise.setSeed(seed/2);
 	humidityNoise.setMapSize(width, height);
 	humidityNoise.setChunkSize(chunkRes, chunkRes);
-	humidityNoise.getConfigRef().option = noise::Options::NOTHING;
-	humidityNoise.getConfigRef().scale = 0.01f;
-	humidityNoise.getConfigRef().constrast = 1.5f;
 	humidityNoise.initMap();
-	if (!humidityNoise.generateFractalNoiseByChunks()) {
+	if (!humidityNoise.getMap()) {
 		std::cout << "[ERROR] Failed to generate humidity noise" << std::endl;
 		return false;
 	}
+	return true;
+}
 
-	int T, H, C, M;
-	std::cout << "[LOG] Evaluating biomeMap..." << std::endl;
+//Generates temperature and humidity noise of the single chunk and classifies its cells into biomes
+//Only cells of the given chunk are read and written so chunks can be processed at the same time
+//
+//@param map - height map of the whole world, heights of the chunk have to be ready
+//@param biomeMap - output biome map of the whole world
+//@param indexer - layout of the height and biome maps
+//@param chunkX, chunkY - coordinates of the chunk
+//@return bool - false if the noises were not prepared
+bool BiomeGenerator::biomifyChunk(float* map, int* biomeMap, const layout::MapIndexer& indexer, int chunkX, int chunkY, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss)
+{
+	if (!map || !biomeMap || !temperatureNoise.generateFractalNoiseChunk(chunkX, chunkY) || !humidityNoise.generateFractalNoiseChunk(chunkX, chunkY))
+		return false;
 
-	for (int y = 0; y < height * chunkRes; y++) {
-		for (int x = 0; x < width * chunkRes; x++) {
-			if (map[y * width * chunkRes + x] <= 64.0f) {
-				biomeMap[y * width * chunkRes + x] = 5;
+	int T, H, C, M;
+	int chunkRes = indexer.chunkWidth;
+	for (int y = chunkY * chunkRes; y < (chunkY + 1) * chunkRes; y++) {
+		size_t row = indexer.index(chunkX * chunkRes, y) - chunkX * chunkRes;
+		for (int x = chunkX * chunkRes; x < (chunkX + 1) * chunkRes; x++) {
+			if (map[row + x] <= 64.0f) {
+				biomeMap[row + x] = 5;
 				continue;
 			}
 			H = determineLevel(WorldParameter::Humidity, humidityNoise.getVal(x, y));
@@ -105,15 +162,22 @@ bool BiomeGenerator::biomify(float* map, int* biomeMap, const int& width, const
 			C = determineLevel(WorldParameter::Continentalness, continenatlnes.getVal(x, y));
 			M = determineLevel(WorldParameter::Mountainousness, mountainouss.getVal(x, y));
 
-			biomeMap[y * width * chunkRes + x] = determineBiome(H, T, C, M);
+			biomeMap[row + x] = determineBiome(H, T, C, M);
 		}
 	}
 	return true;
 }
 
+//Returns the biome of the given id, unknown ids give the default biome
+//Lookup never inserts into the map so it is safe to call from many threads at once
 biome::Biome& BiomeGenerator::getBiome(int id)
 {
-	return m_Biomes[id];
+	static biome::Biome undefinedBiome;
+
+	auto it = m_Biomes.find(id);
+	if (it == m_Biomes.end())
+		return undefinedBiome;
+	return it->second;
 }
 
 noise::NoiseConfigParameters& BiomeGenerator::getTemperatureNoiseConfig()
@@ -155,3 +219,33 @@ bool BiomeGenerator::setBiomes(std::vector<biome::Biome>& biomes)
 	return true;
 }
 
+//Hash of everything the biomes depend on, ranges, biomes and temperature and humidity noise configs
+//Seeds of the noises are derived from the world seed, so they are not part of it
+//
+//@return uint64_t - hash of the config
+uint64_t BiomeGenerator::getConfigHash() const
+{
+	hashing::Hasher hasher;
+	hasher.add(temperatureNoise.getConfig().getHash(false)).add(humidityNoise.getConfig().getHash(false));
+
+	for (const auto* levels : { &m_ContinentalnessLevels, &m_HumidityLevels, &m_TemperatureLevels, &m_MountainousnessLevels }) {
+		hasher.add(levels->size());
+		for (const auto& it : *levels)
+			hasher.add(it.min).add(it.max).add(it.level);
+	}
+
+	//Order of the unordered map is not stable, biomes are hashed by their ids
+	std::vector<int> ids;
+	for (const auto& it : m_Biomes)
+		ids.push_back(it.first);
+	std::sort(ids.begin(), ids.end());
+
+	hasher.add(ids.size());
+	for (int id : ids) {
+		const biome::Biome& b = m_Biomes.at(id);
+		hasher.add(id).add(b.getName()).add(b.getVegetationLevel());
+		for (const biome::vec2& level : { b.getTemperatureLevel(), b.getHumidityLevel(), b.getContinentalnessLevel(), b.getMountainousnessLevel() })
+			hasher.add(level.x).add(level.y);
+	}
+	return hasher.get();
+}
@@ -35,7 +35,12 @@ public:
 
 	int determineLevel(WorldParameter p, float value);
 	int determineBiome(const int& temperature, const int& humidity, const int& continentalness, const int& mountainousness);
-	bool biomify(float* map, int* biomeMap, const int& width, const int& height, const int& chunkRes, const int& seed, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss);
+	bool biomify(float* map, int* biomeMap, const int& width, const int& height, const int& chunkRes, const int& seed, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss,
+		layout::MapLayout mapLayout = layout::MapLayout::ROW_MAJOR);
+	bool prepareNoise(const int& width, const int& height, const int& chunkRes, const int& seed, layout::MapLayout mapLayout = layout::MapLayout::ROW_MAJOR);
+	void setWorldRegion(int originX, int originY, int worldWidth, int worldHeight);
+	bool biomifyChunk(float* map, int* biomeMap, const layout::MapIndexer& indexer, int chunkX, int chunkY, const noise::SimplexNoiseClass& continenatlnes, const noise::SimplexNoiseClass& mountainouss);
+	uint64_t getConfigHash() const;
 
 private:
 	std::unordered_map<int, biome::Biome> m_Biomes;
@@ -0,0 +1,137 @@
+#include "ChunkCache.h"
+
+#include "Hash.h"
+
+namespace cache
+{
+	size_t ChunkKeyHash::operator()(const ChunkKey& key) const
+	{
+		return static_cast<size_t>(hashing::Hasher().add(key.configHash).add(key.chunkX).add(key.chunkY).get());
+	}
+
+	size_t CachedChunk::getBytes() const
+	{
+		return sizeof(CachedChunk) + heights.capacity() * sizeof(float) + biomes.capacity() * sizeof(int) +
+			trees.capacity() * sizeof(std::pair<int, int>);
+	}
+
+	ChunkCache& ChunkCache::get()
+	{
+		static ChunkCache instance;
+		return instance;
+	}
+
+	ChunkCache::ChunkCache(size_t budget) : budget(budget)
+	{
+	}
+
+	//Changes the maximal size of the stored chunks, chunks over the new budget are evicted straight away
+	//
+	//@param budget - size in bytes, 0 disables the cache
+	void ChunkCache::setBudget(size_t budget)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->budget = budget;
+		evict(budget);
+	}
+
+	size_t ChunkCache::getBudget() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return budget;
+	}
+
+	//Looks up the chunk and marks it as the most recently used one
+	//
+	//@param key - config hash and coordinates of the chunk
+	//@return std::shared_ptr<const CachedChunk> - stored chunk, nullptr on the miss
+	std::shared_ptr<const CachedChunk> ChunkCache::find(const ChunkKey& key)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = lookup.find(key);
+		if (it == lookup.end()) {
+			stats.misses++;
+			return nullptr;
+		}
+
+		stats.hits++;
+		entries.splice(entries.begin(), entries, it->second);
+		return it->second->second;
+	}
+
+	//Stores the chunk as the most recently used one, replaces the chunk stored under the same key
+	//
+	//@param key - config hash and coordinates of the chunk
+	//@param chunk - generated chunk, it must not be modified after it is inserted
+	//@return bool - false if the chunk alone doesnt fit into the budget
+	bool ChunkCache::insert(const ChunkKey& key, std::shared_ptr<const CachedChunk> chunk)
+	{
+		if (!chunk)
+			return false;
+
+		size_t chunkBytes = chunk->getBytes();
+		std::lock_guard<std::mutex> lock(mutex);
+		if (chunkBytes > budget)
+			return false;
+
+		auto it = lookup.find(key);
+		if (it != lookup.end()) {
+			stats.bytes -= it->second->second->getBytes();
+			it->second->second = std::move(chunk);
+			entries.splice(entries.begin(), entries, it->second);
+		}
+		else {
+			entries.emplace_front(key, std::move(chunk));
+			lookup.emplace(key, entries.begin());
+			stats.chunkCount++;
+		}
+		stats.bytes += chunkBytes;
+
+		evict(budget);
+		return true;
+	}
+
+	//Checks if the chunk is stored without counting the hit or the miss or changing the order of eviction
+	bool ChunkCache::contains(const ChunkKey& key) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return lookup.find(key) != lookup.end();
+	}
+
+	void ChunkCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		lookup.clear();
+		stats.bytes = 0;
+		stats.chunkCount = 0;
+	}
+
+	CacheStats ChunkCache::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	//Zeroes the hit, miss and eviction counters, stored chunks are kept
+	void ChunkCache::resetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.hits = 0;
+		stats.misses = 0;
+		stats.evictions = 0;
+	}
+
+	//Removes the least recently used chunks until the stored chunks fit into the budget, lock has to be held
+	void ChunkCache::evict(size_t budget)
+	{
+		while (stats.bytes > budget && !entries.empty()) {
+			const Entry& last = entries.back();
+			stats.bytes -= last.second->getBytes();
+			stats.chunkCount--;
+			stats.evictions++;
+			lookup.erase(last.first);
+			entries.pop_back();
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//In-memory cache of the generated chunks shared by every TerrainGenerator of the process
+//
+//Chunks are keyed by the config hash of the generator and the coordinates of the chunk, so generators with
+//the identical config share the results and changing any input of the generation never returns stale data.
+//Least recently used chunks are evicted as soon as the total size of the stored chunks exceeds the budget.
+//
+//Thread safety: every method takes the lock, so the workers of the job system can look up and insert
+//chunks at the same time. Chunks are handed out as shared pointers to immutable data, so the chunk stays
+//valid for the caller even when it is evicted meanwhile.
+
+namespace cache
+{
+	constexpr size_t DEFAULT_CACHE_BUDGET = 256 * 1024 * 1024;
+
+	struct ChunkKey {
+		uint64_t configHash;
+		int chunkX, chunkY;
+
+		bool operator==(const ChunkKey&) const = default;
+	};
+
+	struct ChunkKeyHash {
+		size_t operator()(const ChunkKey& key) const;
+	};
+
+	//Generation results of the single chunk, heights and biomes row by row
+	struct CachedChunk {
+		std::vector<float> heights;
+		std::vector<int> biomes;
+		std::vector<std::pair<int, int>> trees;
+
+		size_t getBytes() const;
+	};
+
+	struct CacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t bytes = 0;
+		size_t chunkCount = 0;
+	};
+
+	class ChunkCache
+	{
+	public:
+		//Returns the process-wide instance with the DEFAULT_CACHE_BUDGET, used by the generators unless set otherwise
+		static ChunkCache& get();
+
+		explicit ChunkCache(size_t budget = DEFAULT_CACHE_BUDGET);
+
+		void setBudget(size_t budget);
+		size_t getBudget() const;
+
+		std::shared_ptr<const CachedChunk> find(const ChunkKey& key);
+		bool insert(const ChunkKey& key, std::shared_ptr<const CachedChunk> chunk);
+		bool contains(const ChunkKey& key) const;
+		void clear();
+
+		CacheStats getStats() const;
+		void resetStats();
+
+	private:
+		using Entry = std::pair<ChunkKey, std::shared_ptr<const CachedChunk>>;
+
+		void evict(size_t budget);
+
+		mutable std::mutex mutex;
+		//Most recently used chunk is at the front
+		std::list<Entry> entries;
+		std::unordered_map<ChunkKey, std::list<Entry>::iterator, ChunkKeyHash> lookup;
+		size_t budget;
+		CacheStats stats;
+	};
+}
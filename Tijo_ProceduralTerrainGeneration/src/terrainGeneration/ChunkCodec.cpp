@@ -0,0 +1,254 @@
+#include "ChunkCodec.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace codec
+{
+	enum class HeightMode : uint8_t {
+		LOSSLESS,
+		QUANTIZED
+	};
+
+	struct HeightHeader {
+		HeightMode mode;
+		uint8_t reserved[3];
+		uint32_t count;
+		uint32_t width;
+		float step;
+	};
+
+	struct BiomeHeader {
+		uint32_t count;
+		uint32_t runs;
+	};
+
+	//Maps the bits of the float to the integer with the same order, so close heights give small differences
+	static uint32_t orderedBits(float value)
+	{
+		uint32_t bits = std::bit_cast<uint32_t>(value);
+		return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+	}
+
+	static float fromOrderedBits(uint32_t bits)
+	{
+		return std::bit_cast<float>((bits & 0x80000000u) ? bits & 0x7FFFFFFFu : ~bits);
+	}
+
+	static uint32_t zigzag(uint32_t value)
+	{
+		return (value << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(value) >> 31);
+	}
+
+	static uint32_t unzigzag(uint32_t value)
+	{
+		return (value >> 1) ^ (0u - (value & 1u));
+	}
+
+	static void writeVarint(uint32_t value, std::vector<uint8_t>& output)
+	{
+		while (value >= 0x80u) {
+			output.push_back(static_cast<uint8_t>(value | 0x80u));
+			value >>= 7;
+		}
+		output.push_back(static_cast<uint8_t>(value));
+	}
+
+	static bool readVarint(std::span<const uint8_t>& input, uint32_t& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35; shift += 7) {
+			if (input.empty())
+				return false;
+			uint8_t byte = input[0];
+			input = input.subspan(1);
+			value |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+			if (!(byte & 0x80u))
+				return true;
+		}
+		return false;
+	}
+
+	//Encodes the heights of the chunk
+	//
+	//@param heights - samples of the chunk, row after row
+	//@param width - number of samples in the row
+	//@param errorBound - maximal error of the decoded height, 0 means lossless coding
+	//@param output - encoded stream is appended to it
+	//@return bool - false if the sizes dont match or the heights cant be quantized
+	bool encodeHeights(std::span<const float> heights, int width, float errorBound, std::vector<uint8_t>& output)
+	{
+		if (width <= 0 || heights.size() % width != 0 || !(errorBound >= 0.0f) || heights.size() > UINT32_MAX) {
+			std::cout << "[ERROR] Heights couldnt be encoded" << std::endl;
+			return false;
+		}
+
+		HeightHeader header = { errorBound > 0.0f ? HeightMode::QUANTIZED : HeightMode::LOSSLESS, {0, 0, 0},
+			static_cast<uint32_t>(heights.size()), static_cast<uint32_t>(width), 2.0f * errorBound };
+
+		std::vector<uint32_t> values(heights.size());
+		for (size_t i = 0; i < heights.size(); i++) {
+			if (header.mode == HeightMode::LOSSLESS) {
+				values[i] = orderedBits(heights[i]);
+				continue;
+			}
+			float quantized = std::round(heights[i] / header.step);
+			if (!(std::abs(quantized) < 1073741824.0f)) {
+				std::cout << "[ERROR] Height " << heights[i] << " cant be quantized with the step " << header.step << std::endl;
+				return false;
+			}
+			values[i] = static_cast<uint32_t>(static_cast<int32_t>(quantized));
+		}
+
+		//Residuals of the prediction, differences wrap around so every value has one
+		std::vector<uint32_t> residuals((heights.size() + CODEC_BLOCK - 1) / CODEC_BLOCK * CODEC_BLOCK, 0);
+		for (size_t i = 0; i < values.size(); i++) {
+			uint32_t prediction = i >= static_cast<size_t>(width) ? values[i - width] : (i > 0 ? values[i - 1] : 0);
+			residuals[i] = zigzag(values[i] - prediction);
+		}
+
+		size_t start = output.size();
+		output.resize(start + sizeof(HeightHeader));
+		std::memcpy(output.data() + start, &header, sizeof(HeightHeader));
+
+		for (size_t block = 0; block < residuals.size(); block += CODEC_BLOCK) {
+			uint32_t bits = 0;
+			for (size_t i = 0; i < CODEC_BLOCK; i++)
+				bits = std::max(bits, static_cast<uint32_t>(std::bit_width(residuals[block + i])));
+
+			//Block of CODEC_BLOCK samples of the bits width takes exactly bits words
+			uint32_t words[CODEC_BLOCK + 1] = {};
+			for (size_t i = 0; i < CODEC_BLOCK && bits > 0; i++) {
+				size_t position = i * bits;
+				uint64_t shifted = static_cast<uint64_t>(residuals[block + i]) << (position & 31);
+				words[position >> 5] |= static_cast<uint32_t>(shifted);
+				words[(position >> 5) + 1] |= static_cast<uint32_t>(shifted >> 32);
+			}
+
+			output.push_back(static_cast<uint8_t>(bits));
+			size_t offset = output.size();
+			output.resize(offset + bits * sizeof(uint32_t));
+			std::memcpy(output.data() + offset, words, bits * sizeof(uint32_t));
+		}
+		return true;
+	}
+
+	//Decodes the heights encoded by encodeHeights
+	//
+	//@param input - encoded data, advanced past the decoded stream
+	//@param heights - output samples, the size has to match the encoded one
+	//@return bool - false if the data is corrupted or the sizes dont match
+	bool decodeHeights(std::span<const uint8_t>& input, std::span<float> heights)
+	{
+		HeightHeader header;
+		if (input.size() < sizeof(HeightHeader))
+			return false;
+		std::memcpy(&header, input.data(), sizeof(HeightHeader));
+		if (header.count != heights.size() || header.width == 0 || header.count % header.width != 0 || header.mode > HeightMode::QUANTIZED) {
+			std::cout << "[ERROR] Encoded heights dont match the output" << std::endl;
+			return false;
+		}
+		std::span<const uint8_t> data = input.subspan(sizeof(HeightHeader));
+
+		std::vector<uint32_t> values((heights.size() + CODEC_BLOCK - 1) / CODEC_BLOCK * CODEC_BLOCK);
+		for (size_t block = 0; block < values.size(); block += CODEC_BLOCK) {
+			if (data.empty() || data[0] > 32 || data.size() < 1 + data[0] * sizeof(uint32_t))
+				return false;
+
+			uint32_t bits = data[0];
+			uint32_t words[CODEC_BLOCK + 1] = {};
+			std::memcpy(words, data.data() + 1, bits * sizeof(uint32_t));
+			data = data.subspan(1 + bits * sizeof(uint32_t));
+
+			uint64_t mask = (uint64_t(1) << bits) - 1;
+			for (size_t i = 0; i < CODEC_BLOCK; i++) {
+				size_t position = i * bits;
+				uint64_t pair = words[position >> 5] | static_cast<uint64_t>(words[(position >> 5) + 1]) << 32;
+				values[block + i] = unzigzag(static_cast<uint32_t>((pair >> (position & 31)) & mask));
+			}
+		}
+
+		//First row is a running sum, every other row adds the row above, which is independent for every sample
+		size_t width = header.width;
+		for (size_t x = 1; x < width; x++)
+			values[x] += values[x - 1];
+		for (size_t i = width; i < heights.size(); i++)
+			values[i] += values[i - width];
+
+		if (header.mode == HeightMode::QUANTIZED) {
+			for (size_t i = 0; i < heights.size(); i++)
+				heights[i] = static_cast<float>(static_cast<int32_t>(values[i])) * header.step;
+		}
+		else {
+			for (size_t i = 0; i < heights.size(); i++)
+				heights[i] = fromOrderedBits(values[i]);
+		}
+
+		input = data;
+		return true;
+	}
+
+	//Encodes the biome ids of the chunk as runs of the same id
+	//
+	//@param biomes - biome ids of the chunk
+	//@param output - encoded stream is appended to it
+	bool encodeBiomes(std::span<const int> biomes, std::vector<uint8_t>& output)
+	{
+		if (biomes.size() > UINT32_MAX)
+			return false;
+
+		std::vector<uint8_t> runs;
+		uint32_t runCount = 0;
+		for (size_t i = 0; i < biomes.size();) {
+			size_t end = i + 1;
+			while (end < biomes.size() && biomes[end] == biomes[i])
+				end++;
+			writeVarint(static_cast<uint32_t>(end - i), runs);
+			writeVarint(zigzag(static_cast<uint32_t>(biomes[i])), runs);
+			runCount++;
+			i = end;
+		}
+
+		BiomeHeader header = { static_cast<uint32_t>(biomes.size()), runCount };
+		size_t start = output.size();
+		output.resize(start + sizeof(BiomeHeader));
+		std::memcpy(output.data() + start, &header, sizeof(BiomeHeader));
+		output.insert(output.end(), runs.begin(), runs.end());
+		return true;
+	}
+
+	//Decodes the biome ids encoded by encodeBiomes
+	//
+	//@param input - encoded data, advanced past the decoded stream
+	//@param biomes - output ids, the size has to match the encoded one
+	//@return bool - false if the data is corrupted or the sizes dont match
+	bool decodeBiomes(std::span<const uint8_t>& input, std::span<int> biomes)
+	{
+		BiomeHeader header;
+		if (input.size() < sizeof(BiomeHeader))
+			return false;
+		std::memcpy(&header, input.data(), sizeof(BiomeHeader));
+		if (header.count != biomes.size()) {
+			std::cout << "[ERROR] Encoded biomes dont match the output" << std::endl;
+			return false;
+		}
+		std::span<const uint8_t> data = input.subspan(sizeof(BiomeHeader));
+
+		size_t position = 0;
+		for (uint32_t run = 0; run < header.runs; run++) {
+			uint32_t length, value;
+			if (!readVarint(data, length) || !readVarint(data, value) || length > biomes.size() - position)
+				return false;
+			std::fill_n(biomes.begin() + position, length, static_cast<int>(unzigzag(value)));
+			position += length;
+		}
+		if (position != biomes.size())
+			return false;
+
+		input = data;
+		return true;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//Compression of the height and biome samples of the chunks, independent of the storage they are kept in
+//
+//Heights are turned into integers first, either losslessly (order preserving bits of the float) or by quantization
+//with the step of 2 * errorBound, so no decoded height is further than errorBound from the original one.
+//Every sample is predicted by the sample above it (first row by the sample to the left) and the zigzagged residuals
+//are bit-packed in the blocks of CODEC_BLOCK samples, every block with its own bit width.
+//Decoding works on whole blocks and rows without any branches per sample, so the compiler can vectorize it.
+//
+//Biome ids are stored as runs of the same id, chunks of the single biome take few bytes.
+//
+//Every encoded stream starts with its own header and is appended to the output, so streams can be concatenated
+//and decoded one after another from the same buffer.
+
+namespace codec
+{
+	constexpr size_t CODEC_BLOCK = 32;
+
+	bool encodeHeights(std::span<const float> heights, int width, float errorBound, std::vector<uint8_t>& output);
+	bool decodeHeights(std::span<const uint8_t>& input, std::span<float> heights);
+
+	bool encodeBiomes(std::span<const int> biomes, std::vector<uint8_t>& output);
+	bool decodeBiomes(std::span<const uint8_t>& input, std::span<int> biomes);
+}
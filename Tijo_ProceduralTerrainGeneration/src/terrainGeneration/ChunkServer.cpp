@@ -0,0 +1,626 @@
+#include "ChunkServer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(int) == 4 && sizeof(float) == 4, "Chunk server sends 4 byte samples");
+static_assert(sizeof(server::RequestHeader) == 16 && sizeof(server::RequestedChunk) == 12 && sizeof(server::ResponseHeader) == 32 &&
+	sizeof(server::ChunkHeader) == 24, "Framing structures must not change their size");
+
+namespace server
+{
+	//Time after which the blocked threads check if the server is stopping
+	constexpr int POLL_TIMEOUT_MS = 100;
+	constexpr size_t RECEIVE_BLOCK = 64 * 1024;
+	//Buffers handed to the single call of sendmsg, IOV_MAX is 1024 on the common systems
+	constexpr size_t MAX_SEND_BUFFERS = 1024;
+	//Bytes of the responses waiting for the client, above them the server stops reading its requests until it reads the responses
+	constexpr size_t MAX_PENDING_BYTES = 16 * 1024 * 1024;
+
+	//Memory sent as it is, it has to stay valid until it is sent
+	struct SendBuffer {
+		const void* data;
+		size_t size;
+	};
+
+	//Progress of the gather write, index of the first buffer not sent completely and the bytes of it already sent
+	struct SendProgress {
+		size_t first = 0;
+		size_t offset = 0;
+	};
+
+	//Responses to the requests of one read from the socket, sent together by the gather writes
+	//Headers and resampled chunks are kept in deques, so the buffers pointing to them stay valid while they grow
+	struct ResponseBatch {
+		std::deque<ResponseHeader> responseHeaders;
+		std::deque<ChunkHeader> chunkHeaders;
+		std::deque<std::vector<float>> heights;
+		std::deque<std::vector<int>> biomes;
+		std::vector<SendBuffer> buffers;
+		size_t bytes = 0;
+		SendProgress progress;
+
+		void add(const void* data, size_t size)
+		{
+			if (size == 0)
+				return;
+			buffers.push_back({ data, size });
+			bytes += size;
+		}
+	};
+
+	static bool initializeSockets()
+	{
+#ifdef _WIN32
+		static bool initialized = []() {
+			WSADATA data;
+			return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+		}();
+		return initialized;
+#else
+		return true;
+#endif
+	}
+
+	static void closeSocket(SocketHandle socket)
+	{
+#ifdef _WIN32
+		closesocket(static_cast<SOCKET>(socket));
+#else
+		::close(static_cast<int>(socket));
+#endif
+	}
+
+	//@return bool - false if the path doesnt fit into the address of the socket
+	static bool makeAddress(const std::string& path, sockaddr_un& address)
+	{
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(address.sun_path))
+			return false;
+		std::memcpy(address.sun_path, path.c_str(), path.size());
+		return true;
+	}
+
+	static SocketHandle openSocket()
+	{
+#ifdef _WIN32
+		SOCKET socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		return socket == INVALID_SOCKET ? invalidSocket : static_cast<SocketHandle>(socket);
+#else
+		int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		return socket < 0 ? invalidSocket : static_cast<SocketHandle>(socket);
+#endif
+	}
+
+	//@return long long - number of the received bytes, 0 if the other side closed the connection and negative on the error
+	static long long receiveSome(SocketHandle socket, void* destination, size_t size)
+	{
+#ifdef _WIN32
+		return recv(static_cast<SOCKET>(socket), static_cast<char*>(destination), static_cast<int>(std::min<size_t>(size, INT_MAX)), 0);
+#else
+		return recv(static_cast<int>(socket), destination, size, 0);
+#endif
+	}
+
+	//@return bool - true if the last call on the non-blocking socket failed only because it would block
+	static bool wouldBlock()
+	{
+#ifdef _WIN32
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+	}
+
+	static bool setNonBlocking(SocketHandle socket)
+	{
+#ifdef _WIN32
+		u_long enabled = 1;
+		return ioctlsocket(static_cast<SOCKET>(socket), FIONBIO, &enabled) == 0;
+#else
+		int flags = fcntl(static_cast<int>(socket), F_GETFL, 0);
+		return flags >= 0 && fcntl(static_cast<int>(socket), F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+	}
+
+	//@return int - combination of POLLIN and POLLOUT of the socket ready for them, 0 on the timeout and negative on the error
+	static int waitReady(SocketHandle socket, bool read, bool write, int timeoutMs)
+	{
+#ifdef _WIN32
+		WSAPOLLFD descriptor{ static_cast<SOCKET>(socket), static_cast<SHORT>((read ? POLLRDNORM : 0) | (write ? POLLWRNORM : 0)), 0 };
+		int result = WSAPoll(&descriptor, 1, timeoutMs);
+		int readable = POLLRDNORM, writable = POLLWRNORM;
+#else
+		pollfd descriptor{ static_cast<int>(socket), static_cast<short>((read ? POLLIN : 0) | (write ? POLLOUT : 0)), 0 };
+		int result = poll(&descriptor, 1, timeoutMs);
+		int readable = POLLIN, writable = POLLOUT;
+#endif
+		if (result <= 0)
+			return result;
+		//Closed or failed connection is reported to the waiting side, its recv or send finds out what happened
+		bool failed = descriptor.revents & (POLLERR | POLLHUP);
+		return ((read && (failed || (descriptor.revents & readable))) ? POLLIN : 0) |
+			((write && (failed || (descriptor.revents & writable))) ? POLLOUT : 0);
+	}
+
+	//Sends the buffers by the gather writes, without copying them into one block, until all of them are sent
+	//or the non-blocking socket would block
+	//
+	//@param progress - where the previous call stopped, updated to where this one stopped
+	//@return int - 1 if everything was sent, 0 if the socket would block and negative if the connection failed
+	static int sendBuffers(SocketHandle socket, std::span<const SendBuffer> buffers, SendProgress& progress)
+	{
+		size_t& first = progress.first;
+		size_t& offset = progress.offset;
+		while (first < buffers.size()) {
+			size_t count = std::min(buffers.size() - first, MAX_SEND_BUFFERS);
+#ifdef _WIN32
+			std::vector<WSABUF> parts(count);
+			for (size_t i = 0; i < count; i++) {
+				size_t skip = i == 0 ? offset : 0;
+				parts[i].buf = const_cast<char*>(static_cast<const char*>(buffers[first + i].data) + skip);
+				parts[i].len = static_cast<ULONG>(buffers[first + i].size - skip);
+			}
+			DWORD sentBytes = 0;
+			if (WSASend(static_cast<SOCKET>(socket), parts.data(), static_cast<DWORD>(count), &sentBytes, 0, nullptr, nullptr) != 0)
+				return wouldBlock() ? 0 : -1;
+			size_t sent = sentBytes;
+#else
+			std::vector<iovec> parts(count);
+			for (size_t i = 0; i < count; i++) {
+				size_t skip = i == 0 ? offset : 0;
+				parts[i].iov_base = const_cast<char*>(static_cast<const char*>(buffers[first + i].data) + skip);
+				parts[i].iov_len = buffers[first + i].size - skip;
+			}
+			msghdr message{};
+			message.msg_iov = parts.data();
+			message.msg_iovlen = count;
+			ssize_t result = sendmsg(static_cast<int>(socket), &message, MSG_NOSIGNAL);
+			if (result < 0 && wouldBlock())
+				return 0;
+			if (result <= 0)
+				return -1;
+			size_t sent = static_cast<size_t>(result);
+#endif
+			//Partial write, continues from the first byte not sent
+			while (sent > 0 && first < buffers.size()) {
+				size_t remaining = buffers[first].size - offset;
+				if (sent < remaining) {
+					offset += sent;
+					break;
+				}
+				sent -= remaining;
+				first++;
+				offset = 0;
+			}
+		}
+		return 1;
+	}
+
+	//Sends all of the buffers on the blocking socket
+	//
+	//@return bool - false if the connection failed before everything was sent
+	static bool sendAll(SocketHandle socket, std::span<const SendBuffer> buffers)
+	{
+		SendProgress progress;
+		return sendBuffers(socket, buffers, progress) > 0;
+	}
+
+	ChunkServer::ChunkServer(TerrainGenerator& terrainGen) : terrainGen(terrainGen), listener(invalidSocket), running(false)
+	{
+	}
+
+	ChunkServer::~ChunkServer()
+	{
+		stop();
+	}
+
+	//Starts listening on the socket, connections are served by their own threads until stop is called
+	//
+	//@param socketPath - path of the socket file, existing file of the same name is replaced
+	//@return bool - false if the world is not generated in the chunk-major layout or the socket couldnt be opened
+	bool ChunkServer::start(const std::string& socketPath)
+	{
+		if (running)
+			return false;
+		if (terrainGen.getMapLayout() != layout::MapLayout::CHUNK_MAJOR || !terrainGen.getHeightMap() || !terrainGen.getBiomeMap()) {
+			std::cout << "[ERROR] Chunk server needs the generated chunk-major world" << std::endl;
+			return false;
+		}
+
+		sockaddr_un address;
+		if (!initializeSockets() || !makeAddress(socketPath, address)) {
+			std::cout << "[ERROR] Invalid socket path: " << socketPath << std::endl;
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::remove(socketPath, error);
+		listener = openSocket();
+		if (listener == invalidSocket) {
+			std::cout << "[ERROR] Socket couldnt be created" << std::endl;
+			return false;
+		}
+#ifdef _WIN32
+		SOCKET socket = static_cast<SOCKET>(listener);
+#else
+		int socket = static_cast<int>(listener);
+#endif
+		if (bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(socket, SOMAXCONN) != 0) {
+			std::cout << "[ERROR] Socket couldnt be bound to: " << socketPath << std::endl;
+			closeSocket(listener);
+			listener = invalidSocket;
+			return false;
+		}
+
+		this->socketPath = socketPath;
+		running = true;
+		acceptThread = std::thread(&ChunkServer::acceptLoop, this);
+		std::cout << "[LOG] Chunk server listening on: " << socketPath << std::endl;
+		return true;
+	}
+
+	//Stops accepting the connections, waits for the connections being served and removes the socket file
+	void ChunkServer::stop()
+	{
+		if (!running)
+			return;
+
+		running = false;
+		acceptThread.join();
+		for (auto& connection : connections)
+			connection->thread.join();
+		connections.clear();
+
+		closeSocket(listener);
+		listener = invalidSocket;
+		std::error_code error;
+		std::filesystem::remove(socketPath, error);
+	}
+
+	ServerStats ChunkServer::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	void ChunkServer::acceptLoop()
+	{
+		while (running) {
+			int ready = waitReady(listener, true, false, POLL_TIMEOUT_MS);
+			if (ready < 0)
+				break;
+			if (ready == 0)
+				continue;
+
+#ifdef _WIN32
+			SOCKET accepted = accept(static_cast<SOCKET>(listener), nullptr, nullptr);
+			SocketHandle socket = accepted == INVALID_SOCKET ? invalidSocket : static_cast<SocketHandle>(accepted);
+#else
+			int accepted = accept(static_cast<int>(listener), nullptr, nullptr);
+			SocketHandle socket = accepted < 0 ? invalidSocket : static_cast<SocketHandle>(accepted);
+#endif
+			if (socket == invalidSocket)
+				continue;
+
+			//Threads of the closed connections are joined here, so long running server doesnt collect them
+			std::erase_if(connections, [](std::unique_ptr<Connection>& connection) {
+				if (!connection->finished)
+					return false;
+				connection->thread.join();
+				return true;
+			});
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.connections++;
+			}
+			auto connection = std::make_unique<Connection>();
+			connection->thread = std::thread(&ChunkServer::serve, this, socket, std::ref(*connection));
+			connections.push_back(std::move(connection));
+		}
+	}
+
+	//@return int - samples per side of the chunk at the level of detail, 0 if there is no such level
+	int ChunkServer::chunkResolution(int lod) const
+	{
+		int resolution = terrainGen.getMapIndexer().chunkWidth;
+		if (lod < 0 || lod >= 31 || (1 << lod) > resolution)
+			return 0;
+		return (resolution - 1) / (1 << lod) + 1;
+	}
+
+	//Reads the requests of the connection and answers them until the connection is closed or the server stops
+	//Every read can complete several pipelined requests, their responses are queued as one batch and sent by the gather writes
+	//whenever the socket takes more. Socket is non-blocking, so the requests are still read while the client is not reading
+	//the responses, until the queued responses reach MAX_PENDING_BYTES. Client that sends more than that without reading
+	//is then blocked by its own send, not by the server.
+	void ChunkServer::serve(SocketHandle socket, Connection& connection)
+	{
+		const layout::MapIndexer& indexer = terrainGen.getMapIndexer();
+		const vegetation::VegetationMap& vegetation = terrainGen.getVegetation();
+		std::vector<uint8_t> input;
+		size_t inputSize = 0;
+		std::deque<ResponseBatch> pending;
+		size_t pendingBytes = 0;
+		bool open = setNonBlocking(socket);
+		if (!open)
+			std::cout << "[ERROR] Socket of the connection couldnt be made non-blocking" << std::endl;
+
+		//After the bad request nothing more is read, the queued responses are sent and the connection is closed
+		while (running && (open || !pending.empty())) {
+			int ready = waitReady(socket, open && pendingBytes < MAX_PENDING_BYTES, !pending.empty(), POLL_TIMEOUT_MS);
+			if (ready < 0)
+				break;
+
+			bool failed = false;
+			while ((ready & POLLOUT) && !pending.empty()) {
+				ResponseBatch& sending = pending.front();
+				int result = sendBuffers(socket, sending.buffers, sending.progress);
+				failed = result < 0;
+				if (result <= 0)
+					break;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stats.bytesSent += sending.bytes;
+				}
+				pendingBytes -= sending.bytes;
+				pending.pop_front();
+			}
+			if (failed)
+				break;
+			if (!(ready & POLLIN))
+				continue;
+
+			input.resize(inputSize + RECEIVE_BLOCK);
+			long long received = receiveSome(socket, input.data() + inputSize, RECEIVE_BLOCK);
+			if (received < 0 && wouldBlock())
+				continue;
+			if (received <= 0)
+				break;
+			inputSize += static_cast<size_t>(received);
+
+			ResponseBatch& batch = pending.emplace_back();
+			size_t position = 0;
+			uint64_t requestCount = 0, chunkCount = 0;
+			while (inputSize - position >= sizeof(RequestHeader)) {
+				RequestHeader request;
+				std::memcpy(&request, input.data() + position, sizeof(request));
+				ResponseHeader& response = batch.responseHeaders.emplace_back();
+				response.requestId = request.requestId;
+				response.fields = request.fields;
+
+				if (request.magic != REQUEST_MAGIC || request.chunkCount > MAX_BATCH_CHUNKS) {
+					response.status = STATUS_BAD_REQUEST;
+					response.fields = 0;
+					batch.add(&response, sizeof(response));
+					open = false;
+					break;
+				}
+
+				size_t frameSize = sizeof(RequestHeader) + request.chunkCount * sizeof(RequestedChunk);
+				if (inputSize - position < frameSize) {
+					//Rest of the request is not received yet
+					batch.responseHeaders.pop_back();
+					break;
+				}
+
+				response.chunkCount = request.chunkCount;
+				batch.add(&response, sizeof(response));
+				size_t responseStart = batch.bytes;
+
+				const uint8_t* requested = input.data() + position + sizeof(RequestHeader);
+				for (uint32_t i = 0; i < request.chunkCount; i++) {
+					RequestedChunk chunk;
+					std::memcpy(&chunk, requested + i * sizeof(RequestedChunk), sizeof(chunk));
+
+					ChunkHeader& header = batch.chunkHeaders.emplace_back();
+					header = { chunk.chunkX, chunk.chunkY, chunk.lod, CHUNK_OK, 0, 0 };
+					int resolution = chunkResolution(chunk.lod);
+					if (chunk.chunkX < 0 || chunk.chunkY < 0 || chunk.chunkX >= indexer.width || chunk.chunkY >= indexer.height)
+						header.status = CHUNK_OUT_OF_RANGE;
+					else if (resolution == 0)
+						header.status = CHUNK_INVALID_LOD;
+					batch.add(&header, sizeof(header));
+					if (header.status != CHUNK_OK)
+						continue;
+
+					header.resolution = resolution;
+					std::span<const float> heights = terrainGen.getHeightChunk(chunk.chunkX, chunk.chunkY);
+					std::span<const int> biomes = terrainGen.getBiomeChunk(chunk.chunkX, chunk.chunkY);
+					size_t samples = static_cast<size_t>(resolution) * resolution;
+					if (chunk.lod == 0) {
+						if (request.fields & FIELD_HEIGHT)
+							batch.add(heights.data(), heights.size_bytes());
+						if (request.fields & FIELD_BIOME)
+							batch.add(biomes.data(), biomes.size_bytes());
+					}
+					else {
+						//Lower levels take every step-th sample of every step-th row, they are the only copied samples
+						int step = 1 << chunk.lod;
+						if (request.fields & FIELD_HEIGHT) {
+							std::vector<float>& sampled = batch.heights.emplace_back(samples);
+							for (int y = 0; y < resolution; y++)
+								for (int x = 0; x < resolution; x++)
+									sampled[y * resolution + x] = heights[static_cast<size_t>(y) * step * indexer.chunkWidth + x * step];
+							batch.add(sampled.data(), samples * sizeof(float));
+						}
+						if (request.fields & FIELD_BIOME) {
+							std::vector<int>& sampled = batch.biomes.emplace_back(samples);
+							for (int y = 0; y < resolution; y++)
+								for (int x = 0; x < resolution; x++)
+									sampled[y * resolution + x] = biomes[static_cast<size_t>(y) * step * indexer.chunkWidth + x * step];
+							batch.add(sampled.data(), samples * sizeof(int));
+						}
+					}
+					if (request.fields & FIELD_VEGETATION) {
+						std::span<const float> treeX = vegetation.getX(chunk.chunkX, chunk.chunkY);
+						header.treeCount = static_cast<uint32_t>(treeX.size());
+						batch.add(treeX.data(), treeX.size_bytes());
+						batch.add(vegetation.getY(chunk.chunkX, chunk.chunkY).data(), treeX.size_bytes());
+						batch.add(vegetation.getHeight(chunk.chunkX, chunk.chunkY).data(), treeX.size_bytes());
+					}
+				}
+
+				response.payloadBytes = batch.bytes - responseStart;
+				position += frameSize;
+				requestCount++;
+				chunkCount += request.chunkCount;
+			}
+
+			//Requests are counted before they are answered, so the client sees them in the stats after the response
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stats.requests += requestCount;
+				stats.chunks += chunkCount;
+			}
+			if (batch.buffers.empty())
+				pending.pop_back();
+			else
+				pendingBytes += batch.bytes;
+
+			//Incomplete request is moved to the front of the buffer
+			std::memmove(input.data(), input.data() + position, inputSize - position);
+			inputSize -= position;
+		}
+
+		closeSocket(socket);
+		connection.finished = true;
+	}
+
+	ChunkClient::ChunkClient() : socket(invalidSocket)
+	{
+	}
+
+	ChunkClient::~ChunkClient()
+	{
+		close();
+	}
+
+	bool ChunkClient::connect(const std::string& socketPath)
+	{
+		close();
+		sockaddr_un address;
+		if (!initializeSockets() || !makeAddress(socketPath, address))
+			return false;
+
+		socket = openSocket();
+		if (socket == invalidSocket)
+			return false;
+#ifdef _WIN32
+		bool connected = ::connect(static_cast<SOCKET>(socket), reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+#else
+		bool connected = ::connect(static_cast<int>(socket), reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+#endif
+		if (!connected) {
+			std::cout << "[ERROR] Couldnt connect to the chunk server: " << socketPath << std::endl;
+			close();
+		}
+		return connected;
+	}
+
+	void ChunkClient::close()
+	{
+		if (socket == invalidSocket)
+			return;
+		closeSocket(socket);
+		socket = invalidSocket;
+	}
+
+	//Sends the request without waiting for its response
+	//
+	//@param requestId - id repeated by the response
+	//@param fields - combination of the Field flags
+	//@param chunks - chunks and their levels of detail, at most MAX_BATCH_CHUNKS
+	bool ChunkClient::sendRequest(uint32_t requestId, uint32_t fields, std::span<const RequestedChunk> chunks)
+	{
+		RequestHeader header;
+		header.requestId = requestId;
+		header.fields = fields;
+		header.chunkCount = static_cast<uint32_t>(chunks.size());
+		SendBuffer buffers[] = { { &header, sizeof(header) }, { chunks.data(), chunks.size_bytes() } };
+		return socket != invalidSocket && sendAll(socket, std::span<const SendBuffer>(buffers, chunks.empty() ? 1 : 2));
+	}
+
+	//Sends the bytes as they are, e.g. the request built by hand
+	bool ChunkClient::sendRaw(std::span<const uint8_t> bytes)
+	{
+		SendBuffer buffer{ bytes.data(), bytes.size() };
+		return socket != invalidSocket && sendAll(socket, std::span<const SendBuffer>(&buffer, 1));
+	}
+
+	bool ChunkClient::receiveAll(void* destination, size_t size)
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(destination);
+		while (size > 0) {
+			long long received = receiveSome(socket, bytes, size);
+			if (received <= 0)
+				return false;
+			bytes += received;
+			size -= static_cast<size_t>(received);
+		}
+		return true;
+	}
+
+	//Waits for the response to the oldest request in flight
+	//
+	//@return bool - false if the connection was closed or the response is malformed
+	bool ChunkClient::receiveResponse(Response& response)
+	{
+		ResponseHeader header;
+		if (socket == invalidSocket || !receiveAll(&header, sizeof(header)) || header.magic != RESPONSE_MAGIC || header.chunkCount > MAX_BATCH_CHUNKS)
+			return false;
+
+		response.requestId = header.requestId;
+		response.status = header.status;
+		response.fields = header.fields;
+		response.chunks.assign(header.chunkCount, ReceivedChunk());
+		for (ReceivedChunk& chunk : response.chunks) {
+			if (!receiveAll(&chunk.header, sizeof(chunk.header)))
+				return false;
+			if (chunk.header.status != CHUNK_OK)
+				continue;
+
+			size_t samples = static_cast<size_t>(chunk.header.resolution) * chunk.header.resolution;
+			if (header.fields & FIELD_HEIGHT) {
+				chunk.heights.resize(samples);
+				if (!receiveAll(chunk.heights.data(), samples * sizeof(float)))
+					return false;
+			}
+			if (header.fields & FIELD_BIOME) {
+				chunk.biomes.resize(samples);
+				if (!receiveAll(chunk.biomes.data(), samples * sizeof(int)))
+					return false;
+			}
+			if (header.fields & FIELD_VEGETATION) {
+				for (std::vector<float>* trees : { &chunk.treeX, &chunk.treeY, &chunk.treeHeight }) {
+					trees->resize(chunk.header.treeCount);
+					if (!receiveAll(trees->data(), trees->size() * sizeof(float)))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+}
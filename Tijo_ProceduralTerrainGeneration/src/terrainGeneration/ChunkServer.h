@@ -0,0 +1,182 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TerrainGenerator.h"
+
+//Server of the generated chunks for the processes of the same host, listening on the unix domain socket
+//
+//Server shares one generated world between the processes instead of each of them regenerating the same chunks.
+//Chunks are requested in batches, every batch asks for any number of chunks at their level of detail and for
+//the subset of the fields (heights, biomes, vegetation).
+//
+//Limitation: only the world generated before start is served, it has to be generated in the chunk-major layout.
+//Chunks outside of it are not generated on demand and the ChunkCache is not used, they get CHUNK_OUT_OF_RANGE.
+//
+//Framing (little-endian, all of the sizes in bytes):
+//	request:	RequestHeader, RequestedChunk[chunkCount]
+//	response:	ResponseHeader, then for every requested chunk in the order of the request:
+//				ChunkHeader
+//				float heights[resolution * resolution]		- if FIELD_HEIGHT was requested, rows of the chunk
+//				int biomes[resolution * resolution]			- if FIELD_BIOME was requested
+//				float treeX[treeCount], treeY[treeCount], treeHeight[treeCount]	- if FIELD_VEGETATION was requested
+//
+//Chunk of the status other than CHUNK_OK has no samples and no trees. Level of detail k takes every 2^k-th sample
+//of the chunk, vegetation is the same at every level. Requests are pipelined, client can send any number of them
+//without waiting and responses come in the order of the requests. Samples of the level 0 and the trees are sent
+//straight from the maps of the generator, without copying them into the response.
+//
+//Responses are sent without blocking the connection, so the server keeps reading the pipelined requests while
+//the client is not reading. It stops reading them once the responses waiting for the client reach 16 MB.
+//
+//Malformed request (wrong magic, too large batch) gets the response with STATUS_BAD_REQUEST and no chunks,
+//after which the server closes the connection.
+
+namespace server
+{
+	constexpr uint32_t REQUEST_MAGIC = 0x51435054;		//"TPCQ"
+	constexpr uint32_t RESPONSE_MAGIC = 0x53435054;		//"TPCS"
+	constexpr uint32_t MAX_BATCH_CHUNKS = 4096;
+
+	enum Field : uint32_t {
+		FIELD_HEIGHT = 1,
+		FIELD_BIOME = 2,
+		FIELD_VEGETATION = 4,
+		FIELD_ALL = FIELD_HEIGHT | FIELD_BIOME | FIELD_VEGETATION
+	};
+
+	enum Status : uint32_t {
+		STATUS_OK = 0,
+		STATUS_BAD_REQUEST = 1
+	};
+
+	enum ChunkStatus : uint32_t {
+		CHUNK_OK = 0,
+		CHUNK_OUT_OF_RANGE = 1,
+		CHUNK_INVALID_LOD = 2
+	};
+
+	struct RequestHeader {
+		uint32_t magic = REQUEST_MAGIC;
+		uint32_t requestId = 0;
+		uint32_t fields = 0;
+		uint32_t chunkCount = 0;
+	};
+
+	struct RequestedChunk {
+		int32_t chunkX, chunkY;
+		int32_t lod;
+	};
+
+	struct ResponseHeader {
+		uint32_t magic = RESPONSE_MAGIC;
+		uint32_t requestId = 0;
+		uint32_t status = STATUS_OK;
+		uint32_t fields = 0;				//Fields of the request, they decide which arrays follow the chunk headers
+		uint32_t chunkCount = 0;
+		uint32_t reserved = 0;
+		uint64_t payloadBytes = 0;			//Size of the response after this header
+	};
+
+	struct ChunkHeader {
+		int32_t chunkX, chunkY;
+		int32_t lod;
+		uint32_t status;
+		uint32_t resolution;				//Samples per side of the chunk at its level of detail
+		uint32_t treeCount;
+	};
+
+	struct ServerStats {
+		uint64_t connections = 0;
+		uint64_t requests = 0;
+		uint64_t chunks = 0;
+		uint64_t bytesSent = 0;
+	};
+
+	//Socket handle of the platform, SOCKET on windows and the file descriptor elsewhere
+	using SocketHandle = intptr_t;
+	constexpr SocketHandle invalidSocket = -1;
+
+	class ChunkServer
+	{
+	public:
+		//@param terrainGen - generated chunk-major world, it must not be changed while the server is running
+		explicit ChunkServer(TerrainGenerator& terrainGen);
+		~ChunkServer();
+		ChunkServer(const ChunkServer&) = delete;
+		ChunkServer& operator=(const ChunkServer&) = delete;
+
+		bool start(const std::string& socketPath);
+		void stop();
+
+		bool isRunning() const { return running; }
+		ServerStats getStats() const;
+
+	private:
+		struct Connection {
+			std::thread thread;
+			std::atomic<bool> finished{ false };
+		};
+
+		void acceptLoop();
+		void serve(SocketHandle socket, Connection& connection);
+		int chunkResolution(int lod) const;
+
+		TerrainGenerator& terrainGen;
+		std::string socketPath;
+		SocketHandle listener;
+		std::atomic<bool> running;
+		std::thread acceptThread;
+
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<Connection>> connections;
+		ServerStats stats;
+	};
+
+	//Chunk of the response as received by the client
+	struct ReceivedChunk {
+		ChunkHeader header{};
+		std::vector<float> heights;
+		std::vector<int> biomes;
+		std::vector<float> treeX, treeY, treeHeight;
+	};
+
+	struct Response {
+		uint32_t requestId = 0;
+		uint32_t status = STATUS_OK;
+		uint32_t fields = 0;
+		std::vector<ReceivedChunk> chunks;
+	};
+
+	//Blocking client of the chunk server, requests can be pipelined by sending several before receiving the responses
+	class ChunkClient
+	{
+	public:
+		ChunkClient();
+		~ChunkClient();
+		ChunkClient(const ChunkClient&) = delete;
+		ChunkClient& operator=(const ChunkClient&) = delete;
+
+		bool connect(const std::string& socketPath);
+		void close();
+
+		bool sendRequest(uint32_t requestId, uint32_t fields, std::span<const RequestedChunk> chunks);
+		bool sendRaw(std::span<const uint8_t> bytes);
+		bool receiveResponse(Response& response);
+
+		bool isConnected() const { return socket != invalidSocket; }
+
+	private:
+		bool receiveAll(void* destination, size_t size);
+
+		SocketHandle socket;
+	};
+}
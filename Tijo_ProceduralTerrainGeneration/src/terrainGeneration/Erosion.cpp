@@ -1,50 +1,74 @@
 #include "Erosion.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
 #include <math.h>
-#include <random>
-#include <queue>
 #include <iostream>
 
+#include "JobSystem.h"
+
 namespace erosion {
-	//Primitive listNode to use and test erosion
-	//TODO: Implement a more efficient data structure
-	struct ListNode
+	//Fixed point of the summed changes of the FIXED_POINT erosion, 2^32 steps per unit of height
+	static const double FIXED_POINT_SCALE = 4294967296.0;
+
+	//Writes the changes straight into the map
+	struct DirectWriter
 	{
-		Droplet* d;
-		ListNode* next;
+		float* map;
+		float blur;
 
-		ListNode(vec2 position, float velocity, float water, float capacity) : d(new Droplet(position, velocity, water, capacity)), next(nullptr) {}
+		void deposit(size_t index, float amount) { map[index] += amount; }
 
-		~ListNode() {
-			delete d;
+		void erode(size_t index, float amount)
+		{
+			float newMapValue = map[index] - amount;
+			map[index] *= blur;
+			map[index] += (1 - blur) * newMapValue;
 		}
+	};
 
-		ListNode* deleteNode(ListNode* prev) {
-			ListNode* next = this->next;
-			if (prev != nullptr) {
-				prev->next = next;
-			}
-			delete this;
-			return next;
-		}
+	//Sums the changes into the fixed point deltas of the map, safe to use from many threads at once
+	struct FixedPointWriter
+	{
+		int64_t* deltas;
+		float blur;
 
-		void deleteAll() {
-			ListNode* current = this;
-			while (current != nullptr) {
-				ListNode* nextNode = current->next;
-				delete current;
-				current = nextNode;
-			}
+		void deposit(size_t index, float amount) { add(index, amount); }
+		void erode(size_t index, float amount) { add(index, -(1 - blur) * amount); }
+		void add(size_t index, float amount)
+		{
+			std::atomic_ref<int64_t>(deltas[index]).fetch_add(std::llround(static_cast<double>(amount) * FIXED_POINT_SCALE), std::memory_order_relaxed);
 		}
 	};
 
-	Erosion::Erosion(int width, int height) : width(width), height(height), map(nullptr)
+	static uint64_t mix(uint64_t value)
+	{
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ull;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	Erosion::Erosion(int width, int height) : map(nullptr), ownsMap(true), width(width), height(height), stride(width)
 	{
 	}
 
 	Erosion::~Erosion()
 	{
-		delete[] map;
+		releaseMap();
+	}
+
+	void Erosion::releaseMap()
+	{
+		if (ownsMap)
+			delete[] map;
+		map = nullptr;
+		ownsMap = true;
 	}
 
 	//--------------------------------------------------------------------------------------
@@ -65,23 +89,94 @@ namespace erosion {
 		this->dropletCount = dropletCount;
 	}
 	
-	//Resizes the map to the new dimensions
+	//Resizes the map to the new dimensions, the map has to be set again afterwards
 	//@param width - new width of the map
 	//@param height - new height of the map
 	void Erosion::Resize(int width, int height)
 	{
 		this->width = width;
 		this->height = height;
+		this->stride = width;
+		dirty.resize(width, height);
 	}
 
-	//Set the heightsMap to be eroded
+	//Set the heightsMap to be eroded, the map is copied into the erosion
 	//@param _map - pointer to the map to be eroded
-	void Erosion::SetMap(float* _map)
+	void Erosion::SetMap(const float* _map)
+	{
+		releaseMap();
+		stride = width;
+		this->map = new float[static_cast<size_t>(width) * height];
+		dirty.resize(width, height);
+
+		std::copy(_map, _map + (static_cast<size_t>(width) * height), this->map);
+	}
+
+	//Erode the map owned by the caller in place, the map is not copied and has to outlive the erosion
+	//The view can be a rectangle of a larger row-major map: data points to its first sample and stride is the width
+	//of the larger map, e.g. the generator height map, a mapped file or a chunk of the chunk-major layout.
+	//Resizes the erosion to the size of the view.
+	//@param data - first sample of the view
+	//@param width, height - size of the view in samples
+	//@param stride - samples between the starts of the rows, 0 for the rows next to each other
+	//@return bool - false if the view is empty or its rows overlap
+	bool Erosion::SetMapView(float* data, int width, int height, int stride)
+	{
+		if (!data || width <= 0 || height <= 0 || (stride != 0 && stride < width)) {
+			std::cout << "[ERROR] Invalid erosion map view " << width << " x " << height << " with stride " << stride << std::endl;
+			return false;
+		}
+
+		releaseMap();
+		map = data;
+		ownsMap = false;
+		this->width = width;
+		this->height = height;
+		this->stride = stride != 0 ? stride : width;
+		dirty.resize(width, height);
+		return true;
+	}
+
+	//Limits the positions the droplets are spawned at to the rectangle of the map, droplets still move and erode
+	//anywhere on the map, e.g. the chunk in the middle of the window with the halo of its neighbours
+	//Rectangle is clipped to the map, the width of 0 spawns the droplets over the whole map again
+	//@param x, y - first sample of the rectangle
+	//@param width, height - size of the rectangle in samples
+	//@return bool - false if the rectangle is negative
+	bool Erosion::SetSpawnArea(int x, int y, int width, int height)
+	{
+		if (x < 0 || y < 0 || width < 0 || height < 0) {
+			std::cout << "[ERROR] Invalid erosion spawn area " << width << " x " << height << " at " << x << ", " << y << std::endl;
+			return false;
+		}
+
+		spawnX = x;
+		spawnY = y;
+		spawnWidth = width;
+		spawnHeight = height;
+		return true;
+	}
+
+	//Set the heightsMap to be eroded from the mapped height file, resizes the erosion to the size of the file
+	//Samples are converted straight into the map of the erosion, the file is not copied
+	//@param file - opened RAW or PGM file
+	//@param heightScale - height of the sample normalized to 1
+	//@param heightOffset - height of the sample 0
+	bool Erosion::LoadMap(const heightfile::MappedHeightFile& file, float heightScale, float heightOffset)
 	{
-		delete[] map;
-		this->map = new float[width * height];
+		if (!file.isOpen()) {
+			std::cout << "[ERROR] Height file not opened" << std::endl;
+			return false;
+		}
+
+		releaseMap();
+		width = file.getWidth();
+		height = file.getHeight();
+		stride = width;
+		map = new float[static_cast<size_t>(width) * height];
+		dirty.resize(width, height);
 
-		std::copy(_map, _map + (width * height), this->map);
+		return file.readRegion(0, 0, width, height, map, width, heightScale, heightOffset);
 	}
 
 	//Get the reference to the configuration of the erosion
@@ -106,116 +201,295 @@ namespace erosion {
 	}
 
 	//Main simulation function
+	//Every step moves all of the droplets first, then erodes and deposits the sediment droplet by droplet,
+	//so the droplets of one step see the map as it was before the step
+	//Droplets and their random directions are derived from the seed (see SetSeed), the same seed erodes the map the same way
 	//@param Track - optional pointer to the array of vertices to store the path of the droplet (pass std::nullopt to disable)
 	void Erosion::Erode(std::optional<float*> Track)
 	{
-		ListNode* dropletsHead = nullptr;
-		ListNode* dropletPrev = nullptr;
-		ListNode* dropletCurrent = nullptr;
+		ErosionSession session(*this);
+		session.start(Track);
+		session.advance({});
+		std::cout << "[LOG] Droplets out of the map: " << session.getFellOff() << std::endl;
+	}
 
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-				
-		vec2 gradient;
-		vec2 oldPosition;
+	//Parallel simulation on the threads of the job system, see ParallelMode
+	//Droplets are the same as in Erode, the result depends only on the seed and never on the number of threads.
+	//It differs from the result of Erode, which erodes the droplets of the whole map in one order.
+	//@param mode - how the concurrent changes of the map are kept apart
+	//@param tileSize - size of the checkerboard tiles in samples, at least getMinTileSize(), 0 picks the size
+	//@return bool - false if the map is not set or the tile size is too small
+	bool Erosion::ErodeParallel(ParallelMode mode, int tileSize)
+	{
+		if (!map || width < 2 || height < 2) {
+			std::cout << "[ERROR] Parallel erosion needs the map of at least 2 x 2 samples" << std::endl;
+			return false;
+		}
+		if (mode == ParallelMode::CHECKERBOARD && tileSize != 0 && tileSize < getMinTileSize()) {
+			std::cout << "[ERROR] Erosion tiles of " << tileSize << " samples are smaller than the reach of the droplet, at least " << getMinTileSize() << " needed" << std::endl;
+			return false;
+		}
 
-		int fellOff = 0;
-		int step = 0;
+		prepareBrush();
+		if (mode == ParallelMode::CHECKERBOARD)
+			erodeCheckerboard(tileSize > 0 ? tileSize : std::max(64, getMinTileSize()));
+		else
+			erodeFixedPoint();
+		return true;
+	}
 
-		//Placeholder node
-		dropletsHead = new ListNode({ 0.0f, 0.0f }, 0.0f, 0.0f, 0.0f);
-		dropletCurrent = dropletsHead;
+	//Builds the brush of the erosion radius unless it is already built, must not be called while droplets are eroded
+	void Erosion::prepareBrush()
+	{
+		if (brush.radius != config.erosionRadius || brush.offsets.empty())
+			brush.build(config.erosionRadius);
+	}
 
-		//Creatint a new droplets on a random cell on the map
-		//Initialize the droplet with initial values cofigured by the user
+	//Creates the droplets on random cells of the map with initial values configured by the user
+	//Droplets start inside of the last cell, the gradient reads the samples to the right and below
+	void Erosion::spawnDroplets(std::optional<float*> Track, int& step)
+	{
+		droplets.clear();
+		droplets.reserve(dropletCount);
+		//Spawn area clipped to the positions on the map, see SetSpawnArea
+		float minX = static_cast<float>(std::min(spawnX, width - 1)), minY = static_cast<float>(std::min(spawnY, height - 1));
+		float maxX = static_cast<float>(spawnWidth > 0 ? std::min(spawnX + spawnWidth, width - 1) : width - 1);
+		float maxY = static_cast<float>(spawnWidth > 0 ? std::min(spawnY + spawnHeight, height - 1) : height - 1);
 		for (int i = 0; i < dropletCount; i++) {
-			dropletCurrent->next = new ListNode({ dist(gen) * width, dist(gen) * height }, config.initialVelocity, config.initialWater, config.initialCapacity);
-			dropletCurrent = dropletCurrent->next;
+			DropletRandom random(seed, i, DropletRandom::SPAWN_STEP);
+			float x = minX + random.next() * (maxX - minX);
+			droplets.add(i, { x, minY + random.next() * (maxY - minY) }, config.initialVelocity, config.initialWater, config.initialCapacity);
 
 			//If tracking enabled, save the droplets initial positions
-			if(Track.has_value() && Track.value())
-				trackDroplets(Track.value(), dropletCurrent->d->getPosition(), step++);
+			if (Track.has_value() && Track.value())
+				trackDroplets(Track.value(), { droplets.positionX.back(), droplets.positionY.back() }, step++);
 		}
+	}
 
-		dropletCurrent = dropletsHead->next;
-		dropletPrev = dropletsHead;
-
-		for (int i = 0; i < config.dropletLifetime; i++) {
-			if (!dropletsHead->next) {
-				break;
+	//Removes the droplets which fell off the map
+	//@return int - number of the removed droplets
+	int Erosion::removeFallenDroplets()
+	{
+		int fellOff = 0;
+		for (size_t d = 0; d < droplets.size();) {
+			if (isOnMap({ droplets.positionX[d], droplets.positionY[d] }))
+				d++;
+			else {
+				droplets.remove(d);
+				fellOff++;
 			}
+		}
+		return fellOff;
+	}
 
-			dropletCurrent = dropletsHead->next;
-			dropletPrev = dropletsHead;
+	//Every step the droplets are sorted into the tiles by their position, then the tiles are eroded in four phases by the parity
+	//of their coordinates. Droplet step reaches at most erosionRadius + 2 samples out of its tile, tiles of one phase are
+	//a whole tile apart, so with tiles of at least getMinTileSize() the tiles of one phase never touch the same sample.
+	void Erosion::erodeCheckerboard(int tileSize)
+	{
+		int step = 0;
+		spawnDroplets(std::nullopt, step);
 
-			while (dropletCurrent) {
-				if (log) {
-					std::cout << "------------------------------------\n";
-				}
+		int tilesX = (width + tileSize - 1) / tileSize;
+		int tilesY = (height + tileSize - 1) / tileSize;
+		std::vector<int> phaseTiles[4];
+		for (int tileY = 0; tileY < tilesY; tileY++)
+			for (int tileX = 0; tileX < tilesX; tileX++)
+				phaseTiles[(tileY % 2) * 2 + tileX % 2].push_back(tileY * tilesX + tileX);
 
-				//Calculate the gradient of current cell and adjust the direction of the droplet and its position
-				gradient = getGradient(dropletCurrent->d->getPosition());
-				oldPosition = dropletCurrent->d->getPosition();
-				dropletCurrent->d->adjustDirection(gradient, config.inertia);
-				
-				//If tracking enabled, save the droplets path
-				if (Track.has_value() && Track.value())
-					trackDroplets(Track.value(), dropletCurrent->d->getPosition(), step++);
-
-				//Check if the droplet is still on the map
-				if (isOnMap(dropletCurrent->d->getPosition())) {
-					//Calculate the difference in elevation between the old and new position of the droplet
-					float deltaElevation = getElevationDifference(oldPosition, dropletCurrent->d->getPosition());
-					
-					if (log) {
-						std::cout << "[LOG] Elevation difference: " << deltaElevation << std::endl;
-					}
+		//Droplets of the tile i are tileDroplets[tileOffsets[i], tileOffsets[i + 1]), in the order of the pool
+		std::vector<uint32_t> tileOffsets(static_cast<size_t>(tilesX) * tilesY + 1);
+		std::vector<uint32_t> tileDroplets, dropletTiles, cursors;
 
-					//If the droplet is moving uphill, it will drop some sediment on the old cell 
-					//in order to fill the gap whit the droplet passed, otherwise it will erode the terrain
-					//based on the calculated values or drop surplus sediment if it surpasses the capacity of the droplet
-					if (deltaElevation >= 0.0f) {
-						if(log){
-							std::cout << "[LOG] Droplet is moving uphill\n";
-						}
-						distributeSediment(oldPosition, dropletCurrent->d->dropSediment(deltaElevation));
+		jobs::JobSystem& jobSystem = jobs::JobSystem::get();
+		int fellOff = 0;
+		for (int i = 0; i < config.dropletLifetime && droplets.size() > 0; i++) {
+			std::fill(tileOffsets.begin(), tileOffsets.end(), 0);
+			dropletTiles.resize(droplets.size());
+			for (size_t d = 0; d < droplets.size(); d++) {
+				dropletTiles[d] = static_cast<uint32_t>(static_cast<int>(droplets.positionY[d]) / tileSize * tilesX + static_cast<int>(droplets.positionX[d]) / tileSize);
+				tileOffsets[dropletTiles[d] + 1]++;
+			}
+			for (size_t t = 1; t < tileOffsets.size(); t++)
+				tileOffsets[t] += tileOffsets[t - 1];
+			cursors.assign(tileOffsets.begin(), tileOffsets.end() - 1);
+			tileDroplets.resize(droplets.size());
+			for (size_t d = 0; d < droplets.size(); d++)
+				tileDroplets[cursors[dropletTiles[d]]++] = static_cast<uint32_t>(d);
+
+			for (std::vector<int>& tiles : phaseTiles) {
+				jobSystem.parallel_for(0, static_cast<int>(tiles.size()), 1, [&](int t) {
+					DirectWriter writer{ map, config.blur };
+					for (uint32_t k = tileOffsets[tiles[t]]; k < tileOffsets[tiles[t] + 1]; k++) {
+						size_t d = tileDroplets[k];
+						moveDroplet(d, i);
+						if (isOnMap({ droplets.positionX[d], droplets.positionY[d] }))
+							updateDroplet(d, writer);
 					}
-					else {
-						if (log){
-								std::cout << "[LOG] Droplet is moving downhill\n";
-						}
-						//Calculate new capacity of the current droplet, if its carried sediment surpasses the new capacity
-						//function will return positive number which means that we need to drop some sediment on the old position
-						//based on the deposition rate. If the function returns negative number, it means we can erode points in the range
-						//of erosion radius and gather possible to collect sediment ammount and add it to the droplet.
-						float sedimentToCollect = dropletCurrent->d->adjustCapacity(config.minSlope, config.erosionRate, config.depositionRate, deltaElevation);
-						
-						if (sedimentToCollect > 0.0f) {
-							distributeSediment(oldPosition, sedimentToCollect);
-						}
-						else {
-							sedimentToCollect = -sedimentToCollect;
-							dropletCurrent->d->adjustSediment(erodeRadius(oldPosition, dropletCurrent->d->getPosition(), sedimentToCollect));
-						}
+				});
+			}
+			fellOff += removeFallenDroplets();
+			erodeThermal(i, config);
+		}
+		std::cout << "[LOG] Droplets out of the map: " << fellOff << std::endl;
+	}
+
+	//Every step all of the droplets are moved and eroded at once against the map of the previous step, their changes
+	//are summed in fixed point and applied to the map after the step. Integer sums dont depend on the order of the additions.
+	void Erosion::erodeFixedPoint()
+	{
+		int step = 0;
+		spawnDroplets(std::nullopt, step);
+
+		std::vector<int64_t> deltas(index(0, height - 1) + width, 0);
+		FixedPointWriter writer{ deltas.data(), config.blur };
 
+		jobs::JobSystem& jobSystem = jobs::JobSystem::get();
+		int fellOff = 0;
+		for (int i = 0; i < config.dropletLifetime && droplets.size() > 0; i++) {
+			jobSystem.parallel_for(0, static_cast<int>(droplets.size()), 1024, [&](int d) {
+				moveDroplet(d, i);
+				if (isOnMap({ droplets.positionX[d], droplets.positionY[d] }))
+					updateDroplet(d, writer);
+			});
+			jobSystem.parallel_for(0, height, 16, [&](int y) {
+				for (size_t cell = index(0, y); cell < index(width, y); cell++) {
+					if (deltas[cell] != 0) {
+						map[cell] += static_cast<float>(deltas[cell] / FIXED_POINT_SCALE);
+						deltas[cell] = 0;
 					}
-					dropletCurrent->d->adjustVelocity(deltaElevation, config.gravity);
-					dropletCurrent->d->evaporate(config.evaporationRate);
-					dropletPrev = dropletCurrent;
-					dropletCurrent = dropletCurrent->next;
-				}
-				else {
-					//If the droplet fell off the map, delete it from the list
-					dropletCurrent = dropletCurrent->deleteNode(dropletPrev);
-					fellOff++;
 				}
-			}
+			});
+			fellOff += removeFallenDroplets();
+			erodeThermal(i, config);
 		}
 		std::cout << "[LOG] Droplets out of the map: " << fellOff << std::endl;
+	}
+
+	//Runs the pass of the thermal erosion after every thermalInterval steps of the droplets, see ThermalErosion.h
+	//@param lifetimeStep - step of the simulation just finished
+	//@param settings - configuration with the thermal erosion settings, the one of the erosion or the one of the session
+	void Erosion::erodeThermal(int lifetimeStep, const ErosionConfig& settings)
+	{
+		if (!isThermalStep(lifetimeStep, settings))
+			return;
+		thermal.SetConfig(settings.talusSlope, settings.thermalRate);
+		thermal.Erode(map, width, height, stride);
+		//Material slides wherever the slope is too steep
+		dirty.markAll();
+	}
 
-		if (dropletsHead)
-			dropletsHead->deleteAll();
+	//@return bool - true if the pass of the thermal erosion follows the step of the simulation
+	bool Erosion::isThermalStep(int lifetimeStep, const ErosionConfig& settings)
+	{
+		return settings.thermalInterval > 0 && (lifetimeStep + 1) % settings.thermalInterval == 0;
+	}
+
+	//Moves the droplet one cell along its direction adjusted by the gradient at its position and samples
+	//the heights before and after the move, the map is not changed
+	//@param index - index of the droplet in the pool
+	//@param lifetimeStep - step of the simulation, keys the random direction of the droplet on the flat terrain
+	void Erosion::moveDroplet(size_t index, int lifetimeStep)
+	{
+		vec2 position = { droplets.positionX[index], droplets.positionY[index] };
+		HeightAndGradient sample = sampleHeightAndGradient(position);
+		droplets.oldX[index] = position.x;
+		droplets.oldY[index] = position.y;
+		droplets.oldHeight[index] = sample.height;
+
+		//Same blending as in Droplet::adjustDirection
+		float inertia = config.inertia;
+		float dx = droplets.directionX[index] * inertia - sample.gradient.x * (1 - inertia);
+		float dy = droplets.directionY[index] * inertia - sample.gradient.y * (1 - inertia);
+		if (dx == 0 && dy == 0) {
+			DropletRandom random(seed, droplets.id[index], lifetimeStep);
+			dx = random.next(-1.0f, 1.0f);
+			dy = random.next(-1.0f, 1.0f);
+		}
+
+		float length = sqrtf((dx * dx) + (dy * dy));
+		if (length > 0) {
+			droplets.directionX[index] = dx / length;
+			droplets.directionY[index] = dy / length;
+		}
+		position.x += droplets.directionX[index];
+		position.y += droplets.directionY[index];
+		droplets.positionX[index] = position.x;
+		droplets.positionY[index] = position.y;
+
+		//Droplets off the map keep the old height, they are removed before their update
+		droplets.newHeight[index] = isOnMap(position) ? getInterpolatedGridHeight(position) : sample.height;
+	}
+
+	//Erodes or deposits the sediment of the moved droplet and updates its velocity and water
+	//Same physics as the Droplet class, applied to the droplet of the pool
+	//@param index - index of the droplet in the pool, the droplet has to be on the map
+	//@param writer - applies the changes of the map
+	template<typename Writer>
+	void Erosion::updateDroplet(size_t index, Writer& writer)
+	{
+		vec2 oldPosition = { droplets.oldX[index], droplets.oldY[index] };
+		float deltaElevation = droplets.newHeight[index] - droplets.oldHeight[index];
+		float& sediment = droplets.sediment[index];
+		float& velocity = droplets.velocity[index];
+		float& water = droplets.water[index];
+
+		if (log) {
+			std::cout << "[LOG] Elevation difference: " << deltaElevation << std::endl;
+		}
+
+		//If the droplet is moving uphill, it will drop some sediment on the old cell
+		//in order to fill the gap whit the droplet passed, otherwise it will erode the terrain
+		//based on the calculated values or drop surplus sediment if it surpasses the capacity of the droplet
+		if (deltaElevation >= 0.0f) {
+			float dropAmount = std::min(deltaElevation, sediment);
+			sediment -= dropAmount;
+			distributeSediment(oldPosition, dropAmount, writer);
+		}
+		else {
+			float capacity = std::max(-deltaElevation, config.minSlope) * velocity * water;
+			droplets.capacity[index] = capacity;
+
+			if (sediment > capacity) {
+				float surplus = (sediment - capacity) * config.depositionRate;
+				sediment -= surplus;
+				distributeSediment(oldPosition, surplus, writer);
+			}
+			else {
+				float sedimentToGather = std::min((capacity - sediment) * config.erosionRate, -deltaElevation);
+				sediment += erodeRadius(oldPosition, { droplets.positionX[index], droplets.positionY[index] }, sedimentToGather, writer);
+			}
+		}
+
+		velocity = sqrtf((velocity * velocity) + (deltaElevation * config.gravity));
+		water *= (1 - config.evaporationRate);
+	}
+
+	//Erodes the paged map larger than the memory tile by tile with the configuration and the droplet count of this erosion
+	//Every tile is eroded together with the halo around it, droplets are spread over the window by its share of the map,
+	//only the tile part is written back. Droplets dont cross the window, so the halo should be at least as long as
+	//the distance the droplet travels, otherwise the seams between the tiles are visible.
+	//@param heights - paged map with 1 channel
+	//@param halo - number of the samples of the neighbouring tiles eroded with the tile
+	//@return bool - false if the map is not a height map or the tiles couldnt be processed
+	bool Erosion::ErodePaged(paging::PagedMap& heights, int halo)
+	{
+		if (!heights.isOpen() || heights.getChannels() != 1) {
+			std::cout << "[ERROR] Paged erosion needs the opened height map with 1 channel" << std::endl;
+			return false;
+		}
+
+		double mapArea = static_cast<double>(heights.getWidth()) * heights.getHeight();
+		return heights.forEachTile(halo, [this, mapArea](paging::TileWindow& window) {
+			Erosion tileErosion(window.width, window.height);
+			tileErosion.SetConfig(config);
+			//Every tile has its own droplets
+			tileErosion.SetSeed(seed ^ static_cast<int>(mix((static_cast<uint64_t>(window.tileY) << 32) | static_cast<uint32_t>(window.tileX))));
+			tileErosion.SetDropletCount(static_cast<int>(std::llround(dropletCount * (static_cast<double>(window.width) * window.height / mapArea))));
+			tileErosion.SetMapView(window.samples.data(), window.width, window.height);
+			tileErosion.Erode(std::nullopt);
+			return true;
+		});
 	}
 
 	vec2 Erosion::getGradient(vec2 pos)
@@ -233,10 +507,10 @@ namespace erosion {
 		//It is assumed that erode function checks if the drop fell outside the map
 		//Formula used: g(pos) = ( (P(x+1, y) - P(x, y)) * (1 - v) + (P(x+1, y+1) - P(x, y+1)) * v )
 		//						 ( (P(x, y+1) - P(x, y)) * (1 - u) + (P(x+1, y+1) - P(x+1, y)) * u )
-		gradient.x = (map[y * width + x + 1] - map[y * width + x]) * (1 - v) +
-					 ((map[(y + 1) * width + x + 1] - map[(y + 1) * width + x]) * v);
-		gradient.y = (map[(y + 1) * width + x] - map[y * width + x]) * (1 - u) +
-					 ((map[(y + 1) * width + x + 1] - map[y * width + x + 1]) * u);
+		gradient.x = (map[index(x + 1, y)] - map[index(x, y)]) * (1 - v) +
+					 ((map[index(x + 1, y + 1)] - map[index(x, y + 1)]) * v);
+		gradient.y = (map[index(x, y + 1)] - map[index(x, y)]) * (1 - u) +
+					 ((map[index(x + 1, y + 1)] - map[index(x + 1, y)]) * u);
 
 		if (log) {
 			std::cout << "[LOG] Gradient: " << gradient.x << " " << gradient.y << std::endl;
@@ -244,6 +518,29 @@ namespace erosion {
 		return gradient;
 	}
 
+	//Bilinear height and the gradient of the cell at the position, same values as getInterpolatedGridHeight and getGradient
+	//Four corners of the cell are read once for both of them
+	//@param pos - position on the map, it is assumed that it is on the map
+	HeightAndGradient Erosion::sampleHeightAndGradient(vec2 pos) const
+	{
+		int x = static_cast<int>(pos.x);
+		int y = static_cast<int>(pos.y);
+		float v = pos.x - x;
+		float u = pos.y - y;
+
+		const float* cell = map + index(x, y);
+		float northWest = cell[0];
+		float northEast = cell[1];
+		float southWest = cell[stride];
+		float southEast = cell[stride + 1];
+
+		HeightAndGradient sample;
+		sample.height = (northWest * (1 - v) * (1 - u)) + (northEast * v * (1 - u)) + (southWest * (1 - v) * u) + (southEast * v * u);
+		sample.gradient.x = (northEast - northWest) * (1 - v) + ((southEast - southWest) * v);
+		sample.gradient.y = (southWest - northWest) * (1 - u) + ((southEast - northEast) * u);
+		return sample;
+	}
+
 	float Erosion::getInterpolatedGridHeight(vec2 pos) {
 		//Get the integer part of the position ( x and y coordinates)
 		int x = static_cast<int>(pos.x);
@@ -256,10 +553,10 @@ namespace erosion {
 		//Interpolate the height of the grid using bilinear interpolation
 		//Formula used: H(pos) = P(x, y) * (1 - v) * (1 - u) + P(x+1, y) * v * (1 - u) + P(x, y+1) * (1 - v) * u + P(x+1, y+1) * v * u
 		//It is assumed that the erode function checks if the drop fell outside the map
-		float diff ((map[y * width + x] * (1 - v) * (1 - u)) + //P(x, y) * (1 - v) * (1 - u) northWest point of the cell
-					(map[y * width + x + 1] * v * (1 - u))   + //P(x+1, y) * v * (1 - u) northEast point of the cell
-					(map[(y + 1) * width + x] * (1 - v) * u) + //P(x, y+1) * (1 - v) * u southWest point of the cell
-					(map[(y + 1) * width + x + 1] * v * u));   //P(x+1, y+1) * v * u southEast point of the cell
+		float diff ((map[index(x, y)] * (1 - v) * (1 - u)) +    //P(x, y) * (1 - v) * (1 - u) northWest point of the cell
+					(map[index(x + 1, y)] * v * (1 - u))   +    //P(x+1, y) * v * (1 - u) northEast point of the cell
+					(map[index(x, y + 1)] * (1 - v) * u) +      //P(x, y+1) * (1 - v) * u southWest point of the cell
+					(map[index(x + 1, y + 1)] * v * u));        //P(x+1, y+1) * v * u southEast point of the cell
 		return diff;
 	}
 
@@ -282,6 +579,18 @@ namespace erosion {
 	}
 
 	void Erosion::distributeSediment(vec2 pos, float sedimentDropped) {
+		DirectWriter writer{ map, config.blur };
+		distributeSediment(pos, sedimentDropped, writer);
+	}
+
+	float Erosion::erodeRadius(vec2 oldPos, vec2 newPos, float ammountEroded) {
+		prepareBrush();
+		DirectWriter writer{ map, config.blur };
+		return erodeRadius(oldPos, newPos, ammountEroded, writer);
+	}
+
+	template<typename Writer>
+	void Erosion::distributeSediment(vec2 pos, float sedimentDropped, Writer& writer) {
 		int x = static_cast<int>(pos.x);
 		int y = static_cast<int>(pos.y);
 
@@ -292,72 +601,69 @@ namespace erosion {
 		//Distribute the sediment dropped by the droplet to the four corners of the cell
 		//Its not distributed in the radius of erosion in order to fill a small 1-cell gap
 		//There is no need to blur the map via radius
-		map[y * width + x] += (1 - v) * (1 - u) * sedimentDropped; //P(x, y) * (1 - v) * (1 - u) northWest point of the cell
-		map[y * width + x + 1] += v * (1 - u) * sedimentDropped;   //P(x+1, y) * v * (1 - u) northEast point of the cell
-		map[(y + 1) * width + x] += (1 - v) * u * sedimentDropped; //P(x, y+1) * (1 - v) * u southWest point of the cell
-		map[(y + 1) * width + x + 1] += v * u * sedimentDropped;   //P(x+1, y+1) * v * u southEast point of the cell
+		writer.deposit(index(x, y), (1 - v) * (1 - u) * sedimentDropped);    //P(x, y) * (1 - v) * (1 - u) northWest point of the cell
+		writer.deposit(index(x + 1, y), v * (1 - u) * sedimentDropped);      //P(x+1, y) * v * (1 - u) northEast point of the cell
+		writer.deposit(index(x, y + 1), (1 - v) * u * sedimentDropped);      //P(x, y+1) * (1 - v) * u southWest point of the cell
+		writer.deposit(index(x + 1, y + 1), v * u * sedimentDropped);        //P(x+1, y+1) * v * u southEast point of the cell
+		dirty.mark(x, y, x + 1, y + 1);
 	}
 
-	float Erosion::erodeRadius(vec2 oldPos, vec2 newPos, float ammountEroded) {
+	template<typename Writer>
+	float Erosion::erodeRadius(vec2 oldPos, vec2 newPos, float ammountEroded, Writer& writer) {
 		//Erode the terrain in a circular radius around the droplet
-		//Its done due to the fact that no thermal erosion or sediment sliding is simulated in this project
-		//In order to perform mentioned above action we need to calculate weights of each point within the radius
-		
-		float deltax;
-		float deltay;
-		float weightSum = 0.0f;
-		float weight;
-		std::queue<vec2i_f> weights;
-
-		for (int y = static_cast<int>(oldPos.y) - config.erosionRadius; y < static_cast<int>(oldPos.y) + config.erosionRadius; y++) {
-			for (int x = static_cast<int>(oldPos.x) - config.erosionRadius; x < static_cast<int>(oldPos.x) + config.erosionRadius; x++) {
-				if (x >= 0 && y >= 0 && x < width && y < height) {
-					//Calculate the distance from the droplet to the current point on the map
-					deltax = x - oldPos.x;
-					deltay = y - oldPos.y;
-					float distance = sqrtf(deltax * deltax + deltay * deltay);
-
-					//Check if the distance is within the erosion radius and if the point is higher than new position
-					if (distance < config.erosionRadius && map[y * width + x] > map[static_cast<int>(newPos.y) * width + static_cast<int>(newPos.x)]) {
-						weight = 1.0f - (distance / config.erosionRadius);
-						weightSum += weight;
-						weights.push({ y * width + x, weight });
-					}
+		//Its done due to the fact that the sediment doesnt slide on its own, the thermal erosion (see ErosionConfig::thermalInterval)
+		//slides the steep slopes down instead and lets the radius be smaller
+		//Weights of the points within the radius are taken from the brush, only the points higher than the new position
+		//are eroded and the weights are normalized over them. The brush has to be prepared (see prepareBrush).
+		int x = static_cast<int>(oldPos.x);
+		int y = static_cast<int>(oldPos.y);
+		int bucket = brush.bucket(oldPos);
+		uint32_t begin = brush.offsets[bucket], end = brush.offsets[bucket + 1];
+		float newHeight = map[index(static_cast<int>(newPos.x), static_cast<int>(newPos.y))];
+
+		//Brush clipped by the edge of the map skips the cells outside of it, otherwise every cell is on the map
+		dirty.mark(x - brush.radius, y - brush.radius, x + brush.radius - 1, y + brush.radius - 1);
+		bool inside = x - brush.radius >= 0 && y - brush.radius >= 0 && x + brush.radius <= width && y + brush.radius <= height;
+		auto forEachCell = [&](auto&& func) {
+			if (inside) {
+				for (uint32_t i = begin; i < end; i++)
+					func(i, index(x + brush.cellX[i], y + brush.cellY[i]));
+			}
+			else {
+				for (uint32_t i = begin; i < end; i++) {
+					int cellX = x + brush.cellX[i], cellY = y + brush.cellY[i];
+					if (cellX >= 0 && cellY >= 0 && cellX < width && cellY < height)
+						func(i, index(cellX, cellY));
 				}
 			}
-		}
-
-		if (log) {
-			std::cout << "---------------Eroding-Radius---------------\n"
-						 "Number of points in the radius: " << weights.size() << std::endl;
-		}
+		};
 
-		float totalErosion = 0.0f;
-		float possibleErosion;
-		float newMapValue;
+		//Points are not changed before their own visit, so both of the passes select the same points
+		float weightSum = 0.0f;
+		forEachCell([&](uint32_t i, size_t cell) {
+			if (map[cell] > newHeight)
+				weightSum += brush.weights[i];
+		});
+		if (weightSum <= 0.0f)
+			return 0.0f;
 
 		//Erode the points in the radius of the droplet
 		//Based on blur parameter, value of the new point is interpolated between the old value and the eroded value
 		//Blur value 0.0 means that the new value is the eroded value, 
 		//blur value 1.0 means that the new value is the old value
-		while (!weights.empty())
-		{
-			possibleErosion = ammountEroded * (weights.front().value / weightSum);
-			possibleErosion = map[weights.front().index] >= possibleErosion ? possibleErosion : map[weights.front().index];
-			newMapValue = map[weights.front().index] - possibleErosion;
-			map[weights.front().index] *= config.blur;
-			map[weights.front().index] += (1-config.blur) * newMapValue;
-			totalErosion += (1-config.blur) * possibleErosion;
-			weights.pop();
+		float totalErosion = 0.0f;
+		forEachCell([&](uint32_t i, size_t cell) {
+			if (map[cell] <= newHeight)
+				return;
+			float possibleErosion = ammountEroded * (brush.weights[i] / weightSum);
+			possibleErosion = map[cell] >= possibleErosion ? possibleErosion : map[cell];
+			writer.erode(cell, possibleErosion);
+			totalErosion += (1 - config.blur) * possibleErosion;
 
 			if (log) {
 				std::cout << "[LOG] Eroded: " << possibleErosion << std::endl;
 			}
-		}
-
-		if (log) {
-			std::cout << "--------------------------------------------\n";
-		}
+		});
 		return totalErosion;
 	}
 
@@ -367,11 +673,356 @@ namespace erosion {
 		return pos.x >= 0.0f && pos.y >= 0.0f && pos.x < width - 1.0f && pos.y < height - 1.0f;
 	}
 
+	//--------------------------------------------------------------------------------------
+	//Erosion session functions
+	//--------------------------------------------------------------------------------------
+
+	//Spawns the droplets of the erosion, any previous session of the erosion is abandoned
+	//@param Track - optional pointer to the array of vertices to store the path of the droplet, see Erosion::Erode
+	//@return bool - false if the map of the erosion is not set
+	bool ErosionSession::start(std::optional<float*> Track)
+	{
+		if (!erosion.map) {
+			std::cout << "[ERROR] Erosion session needs the map to be set" << std::endl;
+			state = SessionState::IDLE;
+			return false;
+		}
+
+		this->Track = Track;
+		config = erosion.config;
+		dropletCount = erosion.dropletCount;
+		lifetimeStep = 0;
+		eroding = false;
+		next = 0;
+		thermalPending = false;
+		trackStep = 0;
+		fellOff = 0;
+		completedSteps = 0;
+		//Every step moves and erodes every droplet
+		totalSteps = 2 * static_cast<uint64_t>(std::max(dropletCount, 0)) * std::max(config.dropletLifetime, 0);
+
+		erosion.prepareBrush();
+		erosion.spawnDroplets(Track, trackStep);
+		state = SessionState::RUNNING;
+		return true;
+	}
+
+	//Continues the erosion until the budget is used up or the droplets are gone
+	//Time is checked every few droplets, so the call can take a little longer than the budget
+	//Pass of the thermal erosion runs in the call of its own, see ErosionBudget
+	//@param budget - limits of the call, the default budget erodes the map to the end
+	//@return bool - true while the session has work left, also when paused; false once finished, cancelled or not started
+	bool ErosionSession::advance(ErosionBudget budget)
+	{
+		if (state != SessionState::RUNNING)
+			return state == SessionState::PAUSED;
+
+		const int TIME_CHECK_INTERVAL = 32;
+		auto startTime = std::chrono::steady_clock::now();
+		DirectWriter writer{ erosion.map, erosion.config.blur };
+		DropletPool& droplets = erosion.droplets;
+
+		bool limited = budget.droplets > 0 || budget.milliseconds > 0.0;
+		for (int processed = 0;; processed++) {
+			if (thermalPending) {
+				if (limited && processed > 0)
+					return true;
+				erosion.erodeThermal(lifetimeStep - 1, config);
+				thermalPending = false;
+				if (limited && lifetimeStep < config.dropletLifetime && droplets.size() > 0)
+					return true;
+			}
+			if (lifetimeStep >= config.dropletLifetime || droplets.size() == 0) {
+				completedSteps = totalSteps;
+				state = SessionState::FINISHED;
+				return false;
+			}
+			if (budget.droplets > 0 && processed >= budget.droplets)
+				return true;
+			if (budget.milliseconds > 0.0 && processed > 0 && processed % TIME_CHECK_INTERVAL == 0) {
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+				if (elapsed.count() >= budget.milliseconds)
+					return true;
+			}
+
+			if (!eroding) {
+				erosion.moveDroplet(next, lifetimeStep);
+
+				//If tracking enabled, save the droplets path
+				if (Track.has_value() && Track.value()) {
+					float* vertices = Track.value();
+					vertices[trackStep * 3] = droplets.positionX[next] / erosion.width;
+					vertices[trackStep * 3 + 1] = droplets.newHeight[next];
+					vertices[trackStep * 3 + 2] = droplets.positionY[next] / erosion.height;
+					trackStep++;
+				}
+
+				completedSteps++;
+				if (++next == droplets.size()) {
+					next = 0;
+					eroding = true;
+				}
+				continue;
+			}
+
+			//Droplets which fell off the map are replaced by the last droplet, which is updated in their place
+			if (erosion.isOnMap({ droplets.positionX[next], droplets.positionY[next] })) {
+				erosion.updateDroplet(next, writer);
+				next++;
+				completedSteps++;
+			}
+			else {
+				droplets.remove(next);
+				fellOff++;
+				completedSteps += 1 + 2 * static_cast<uint64_t>(config.dropletLifetime - lifetimeStep - 1);
+			}
+
+			if (next >= droplets.size()) {
+				thermalPending = Erosion::isThermalStep(lifetimeStep, config);
+				next = 0;
+				eroding = false;
+				lifetimeStep++;
+			}
+		}
+	}
+
+	void ErosionSession::pause()
+	{
+		if (state == SessionState::RUNNING)
+			state = SessionState::PAUSED;
+	}
+
+	void ErosionSession::resume()
+	{
+		if (state == SessionState::PAUSED)
+			state = SessionState::RUNNING;
+	}
+
+	//Stops the session for good, the droplets left are dropped and the map keeps the erosion done so far
+	void ErosionSession::cancel()
+	{
+		if (!isActive())
+			return;
+		erosion.droplets.clear();
+		state = SessionState::CANCELLED;
+	}
+
+	//@return float - share of the droplets moved and eroded so far, droplets which fell off the map count all of their remaining steps
+	float ErosionSession::getProgress() const
+	{
+		if (state == SessionState::FINISHED)
+			return 1.0f;
+		return totalSteps > 0 ? static_cast<float>(static_cast<double>(completedSteps) / totalSteps) : 0.0f;
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Erosion brush functions
+	//--------------------------------------------------------------------------------------
+
+	//Computes the cells and the weights of every bucket of the radius
+	//Cells are the same as the loop over [-radius, radius) around the droplet would visit, weight of the cell
+	//is 1 - distance / radius for the cells closer than the radius
+	//@param radius - erosion radius in cells
+	void ErosionBrush::build(int radius)
+	{
+		this->radius = radius;
+		offsets.assign(1, 0);
+		cellX.clear();
+		cellY.clear();
+		weights.clear();
+
+		for (int bucketY = 0; bucketY < SUBCELLS; bucketY++) {
+			for (int bucketX = 0; bucketX < SUBCELLS; bucketX++) {
+				float offsetX = (bucketX + 0.5f) / SUBCELLS;
+				float offsetY = (bucketY + 0.5f) / SUBCELLS;
+				for (int y = -radius; y < radius; y++) {
+					for (int x = -radius; x < radius; x++) {
+						float distance = sqrtf((x - offsetX) * (x - offsetX) + (y - offsetY) * (y - offsetY));
+						if (distance < radius) {
+							cellX.push_back(x);
+							cellY.push_back(y);
+							weights.push_back(1.0f - distance / radius);
+						}
+					}
+				}
+				offsets.push_back(static_cast<uint32_t>(weights.size()));
+			}
+		}
+	}
+
+	//@return int - bucket of the offset of the position inside of its cell
+	int ErosionBrush::bucket(vec2 pos) const
+	{
+		int bucketX = std::min(static_cast<int>((pos.x - static_cast<int>(pos.x)) * SUBCELLS), SUBCELLS - 1);
+		int bucketY = std::min(static_cast<int>((pos.y - static_cast<int>(pos.y)) * SUBCELLS), SUBCELLS - 1);
+		return bucketY * SUBCELLS + bucketX;
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Dirty region functions
+	//--------------------------------------------------------------------------------------
+
+	//Sets the size of the map, no tile is dirty afterwards
+	void DirtyRegion::resize(int width, int height)
+	{
+		this->width = std::max(width, 0);
+		this->height = std::max(height, 0);
+		tilesX = (this->width + TILE_SIZE - 1) / TILE_SIZE;
+		tilesY = (this->height + TILE_SIZE - 1) / TILE_SIZE;
+		tiles.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+	}
+
+	void DirtyRegion::clear()
+	{
+		std::fill(tiles.begin(), tiles.end(), 0);
+	}
+
+	//Marks the tiles of the samples [x0, x1] x [y0, y1], the rectangle is clipped to the map
+	//Tiles are set with relaxed atomic stores, so the droplets of the parallel erosion can mark them at once
+	void DirtyRegion::mark(int x0, int y0, int x1, int y1)
+	{
+		x0 = std::max(x0, 0);
+		y0 = std::max(y0, 0);
+		x1 = std::min(x1, width - 1);
+		y1 = std::min(y1, height - 1);
+		if (x0 > x1 || y0 > y1)
+			return;
+
+		for (int tileY = y0 / TILE_SIZE; tileY <= y1 / TILE_SIZE; tileY++) {
+			for (int tileX = x0 / TILE_SIZE; tileX <= x1 / TILE_SIZE; tileX++) {
+				std::atomic_ref<uint8_t> tile(tiles[static_cast<size_t>(tileY) * tilesX + tileX]);
+				if (!tile.load(std::memory_order_relaxed))
+					tile.store(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void DirtyRegion::markAll()
+	{
+		std::fill(tiles.begin(), tiles.end(), 1);
+	}
+
+	bool DirtyRegion::isDirty() const
+	{
+		return std::find(tiles.begin(), tiles.end(), 1) != tiles.end();
+	}
+
+	//Dirty tiles merged into the rectangles: runs of the dirty tiles in the row of the tiles, joined with the run
+	//of the same columns in the row above
+	//@param border - samples added around every rectangle, clipped to the map, e.g. 1 for the normals of the mesh
+	//@return std::vector<DirtyRect> - rectangles in the samples, empty if nothing changed
+	std::vector<DirtyRect> DirtyRegion::getRects(int border) const
+	{
+		//Rectangles in the tiles first, the open ones end in the previous row of the tiles
+		std::vector<DirtyRect> rects;
+		std::vector<size_t> open, current;
+		for (int tileY = 0; tileY < tilesY; tileY++) {
+			current.clear();
+			for (int tileX = 0; tileX < tilesX;) {
+				if (!isTileDirty(tileX, tileY)) {
+					tileX++;
+					continue;
+				}
+				int runStart = tileX;
+				while (tileX < tilesX && isTileDirty(tileX, tileY))
+					tileX++;
+
+				auto above = std::find_if(open.begin(), open.end(), [&](size_t r) { return rects[r].x == runStart && rects[r].width == tileX - runStart; });
+				if (above != open.end()) {
+					rects[*above].height++;
+					current.push_back(*above);
+				}
+				else {
+					current.push_back(rects.size());
+					rects.push_back({ runStart, tileY, tileX - runStart, 1 });
+				}
+			}
+			open.swap(current);
+		}
+
+		for (DirtyRect& rect : rects) {
+			int x0 = std::max(rect.x * TILE_SIZE - border, 0), y0 = std::max(rect.y * TILE_SIZE - border, 0);
+			int x1 = std::min((rect.x + rect.width) * TILE_SIZE + border, width), y1 = std::min((rect.y + rect.height) * TILE_SIZE + border, height);
+			rect = { x0, y0, x1 - x0, y1 - y0 };
+		}
+		return rects;
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Droplet pool functions
+	//--------------------------------------------------------------------------------------
+
+	std::array<std::vector<float>*, 12> DropletPool::attributes()
+	{
+		return { &positionX, &positionY, &directionX, &directionY, &velocity, &water, &sediment, &capacity, &oldX, &oldY, &oldHeight, &newHeight };
+	}
+
+	void DropletPool::clear()
+	{
+		for (std::vector<float>* attribute : attributes())
+			attribute->clear();
+		id.clear();
+	}
+
+	void DropletPool::reserve(size_t count)
+	{
+		for (std::vector<float>* attribute : attributes())
+			attribute->reserve(count);
+		id.reserve(count);
+	}
+
+	//Adds the droplet standing still without any sediment, same as the new Droplet
+	void DropletPool::add(uint32_t id, vec2 position, float velocity, float water, float capacity)
+	{
+		this->id.push_back(id);
+		positionX.push_back(position.x);
+		positionY.push_back(position.y);
+		directionX.push_back(0.0f);
+		directionY.push_back(0.0f);
+		this->velocity.push_back(velocity);
+		this->water.push_back(water);
+		sediment.push_back(0.0f);
+		this->capacity.push_back(capacity);
+		oldX.push_back(position.x);
+		oldY.push_back(position.y);
+		oldHeight.push_back(0.0f);
+		newHeight.push_back(0.0f);
+	}
+
+	//Removes the droplet by moving the last droplet in its place, order of the droplets is not kept
+	//@param index - index of the removed droplet
+	void DropletPool::remove(size_t index)
+	{
+		for (std::vector<float>* attribute : attributes()) {
+			(*attribute)[index] = attribute->back();
+			attribute->pop_back();
+		}
+		id[index] = id.back();
+		id.pop_back();
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Droplet random functions
+	//--------------------------------------------------------------------------------------
+
+	DropletRandom::DropletRandom(uint32_t seed, uint32_t droplet, uint32_t step)
+		: key(mix(mix(static_cast<uint64_t>(seed)) ^ ((static_cast<uint64_t>(droplet) << 32) | step)))
+	{
+	}
+
+	//@return float - next number in [0, 1)
+	float DropletRandom::next()
+	{
+		//24 bits fill the mantissa of the float exactly
+		uint64_t value = mix(key + ++counter * 0x9E3779B97F4A7C15ull);
+		return static_cast<float>(value >> 40) * (1.0f / 16777216.0f);
+	}
+
 	//--------------------------------------------------------------------------------------
 	//Droplet class functions
 	//--------------------------------------------------------------------------------------
 
-	Droplet::Droplet(vec2 position, float velocity, float water, float capacity) : position(position), velocity(velocity), water(water), capacity(capacity), direction({ 0, 0 }), sediment(0.0f)
+	Droplet::Droplet(vec2 position, float velocity, float water, float capacity) : position(position), direction({ 0, 0 }), velocity(velocity), water(water), sediment(0.0f), capacity(capacity)
 	{
 	}
 
@@ -393,12 +1044,8 @@ namespace erosion {
 		//If the direction is zero which means the droplet wouldnt move, move it in a random direction
 		if (dx == 0 && dy == 0)
 		{
-			std::random_device rd;
-			std::mt19937 gen(rd());
-			std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
-
-			dx = dist(gen);
-			dy = dist(gen);
+			dx = random.next(-1.0f, 1.0f);
+			dy = random.next(-1.0f, 1.0f);
 		}
 
 		//Normalize the direction to get a unit vector
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <vector>
+
+#include "HeightFile.h"
+#include "PagedMap.h"
+#include "ThermalErosion.h"
 
 
 //Implementation of the algorith described here: http://www.firespark.de/resources/downloads/implementation%20of%20a%20methode%20for%20hydraulic%20erosion.pdf
 //Its a particle based hydraulic erosion algorithm that simulates the erosion of terrain by water droplets
-//The algorithm is implemented in the Erosion class using the Droplet class to simulate the droplets
+//The algorithm is implemented in the Erosion class, droplets of the simulation are kept in the DropletPool,
+//the Droplet class is a single droplet with the same physics used for testing the steps separately
 
 namespace erosion {
 	//Temporary variable for enabling or disabling logging for debugging purposes
@@ -24,6 +32,9 @@ namespace erosion {
 	//@param initialWater: The initial amount of water in the droplet
 	//@param initialVelocity: The initial velocity of the droplet
 	//@param initialCapacity: The initial capacity of the droplet
+	//@param talusSlope: The steepest slope (height difference per sample) the material stays on in the thermal erosion
+	//@param thermalRate: The share of the excess of the slope moved by one pass of the thermal erosion
+	//@param thermalInterval: The number of the steps between the passes of the thermal erosion (0 disables it)
 	struct ErosionConfig {
 		//Erosion parameters
 		float erosionRate = 0.2f;
@@ -42,6 +53,11 @@ namespace erosion {
 		float initialWater = 1.0f;
 		float initialVelocity = 1.0f;
 		float initialCapacity = 1.0f;
+
+		//Thermal erosion parameters
+		float talusSlope = 0.02f;
+		float thermalRate = 0.5f;
+		int thermalInterval = 0;
 	};
 
 	struct vec2 {
@@ -51,12 +67,116 @@ namespace erosion {
 		vec2(float x, float y) : x(x), y(y) {}
 	};
 
-	struct vec2i_f
+	//Precomputed cells eroded around the droplet and their weights
+	//Weights depend only on the erosion radius and the offset of the droplet inside of its cell, the offset is split
+	//into SUBCELLS x SUBCELLS buckets and the weights of every bucket are computed for the droplet in its centre.
+	//Cells of the bucket b are [offsets[b], offsets[b + 1]) of the arrays, relative to the cell of the droplet.
+	struct ErosionBrush
+	{
+		static const int SUBCELLS = 8;
+
+		int radius = 0;
+		std::vector<uint32_t> offsets;
+		std::vector<int> cellX, cellY;
+		std::vector<float> weights;
+
+		void build(int radius);
+		int bucket(vec2 pos) const;
+	};
+
+	//Counter-based random numbers of the droplet, every number is a hash of the seed, the droplet, the step and the index
+	//of the number in the step. Nothing is shared between the droplets, so the numbers dont depend on the order or
+	//the thread the droplets are simulated in, and creating the generator costs nothing.
+	class DropletRandom
+	{
+	public:
+		//Step of the numbers used to spawn the droplet
+		static const uint32_t SPAWN_STEP = 0xFFFFFFFFu;
+
+		DropletRandom(uint32_t seed, uint32_t droplet, uint32_t step);
+
+		float next();
+		float next(float min, float max) { return min + (max - min) * next(); }
+
+	private:
+		uint64_t key;
+		uint64_t counter = 0;
+	};
+
+	//Bilinear height and gradient of the map at the position, read from the same four cells
+	struct HeightAndGradient
+	{
+		float height;
+		vec2 gradient;
+	};
+
+	//Droplets of the simulation as a structure of arrays
+	//Every attribute is contiguous so one step of the simulation runs over all of the droplets array by array,
+	//droplets leaving the map are removed by moving the last droplet in their place. Pool keeps its memory
+	//between the simulations, no droplet is allocated separately.
+	struct DropletPool
+	{
+		std::vector<float> positionX, positionY;
+		std::vector<float> directionX, directionY;
+		std::vector<float> velocity;
+		std::vector<float> water;
+		std::vector<float> sediment;
+		std::vector<float> capacity;
+
+		//State of the current step: position before the move and the heights before and after it
+		std::vector<float> oldX, oldY;
+		std::vector<float> oldHeight, newHeight;
+
+		//Index of the droplet when it was spawned, keys its random numbers
+		std::vector<uint32_t> id;
+
+		size_t size() const { return positionX.size(); }
+		void clear();
+		void reserve(size_t count);
+		void add(uint32_t id, vec2 position, float velocity, float water, float capacity);
+		void remove(size_t index);
+
+	private:
+		std::array<std::vector<float>*, 12> attributes();
+	};
+
+	//Rectangle of the samples of the map
+	struct DirtyRect {
+		int x, y, width, height;
+	};
+
+	//Samples of the map changed by the erosion, kept as the bitmap of TILE_SIZE x TILE_SIZE tiles
+	//Every change marks the tiles of the samples it touched, so the mesh, the normals and the GPU buffer can be
+	//updated only where the map changed (see utilities::UpdateErosionMeshDirty). Tiles can be marked from many threads at once.
+	class DirtyRegion
 	{
-		int index;
-		float value;
+	public:
+		static const int TILE_SIZE = 32;
+
+		void resize(int width, int height);
+		void clear();
+		void mark(int x0, int y0, int x1, int y1);
+		void markAll();
+
+		bool isDirty() const;
+		bool isTileDirty(int tileX, int tileY) const { return tiles[static_cast<size_t>(tileY) * tilesX + tileX] != 0; }
+		int getTilesX() const { return tilesX; }
+		int getTilesY() const { return tilesY; }
+		std::vector<DirtyRect> getRects(int border = 0) const;
+
+	private:
+		int width = 0, height = 0;
+		int tilesX = 0, tilesY = 0;
+		std::vector<uint8_t> tiles;
 	};
 
+	//Modes of the parallel erosion, both give the same result for the seed with any number of threads
+	//CHECKERBOARD - map is split into tiles wider than the reach of the droplet step, tiles are eroded in four phases
+	//				 so that no two tiles eroded at once are neighbours, droplets of one tile are simulated in order
+	//FIXED_POINT - all of the droplets are stepped at once against the map of the previous step, their changes are summed
+	//				in fixed point with atomic additions and applied at the end of the step
+	enum class ParallelMode { CHECKERBOARD, FIXED_POINT };
+
 	class Erosion
 	{
 	public:
@@ -65,9 +185,12 @@ namespace erosion {
 
 		//Simulation functions
 		void Erode(std::optional<float*> Track);
+		bool ErodeParallel(ParallelMode mode = ParallelMode::CHECKERBOARD, int tileSize = 0);
+		bool ErodePaged(paging::PagedMap& heights, int halo);
 		vec2 getGradient(vec2 pos);
 		float getElevationDifference(vec2 posOld, vec2 posNew);
 		float getInterpolatedGridHeight(vec2 pos);
+		HeightAndGradient sampleHeightAndGradient(vec2 pos) const;
 		void distributeSediment(vec2 pos, float sedimentDropped);
 		float erodeRadius(vec2 oldPos, vec2 newPos, float ammountEroded);
 		bool isOnMap(vec2 pos);
@@ -76,23 +199,121 @@ namespace erosion {
 		//Configuration functions
 		void SetConfig(ErosionConfig config);
 		void Resize(int width, int height);
-		void SetMap(float* map);
+		void SetMap(const float* map);
+		bool SetMapView(float* data, int width, int height, int stride = 0);
+		bool SetSpawnArea(int x, int y, int width, int height);
+		bool LoadMap(const heightfile::MappedHeightFile& file, float heightScale, float heightOffset = 0.0f);
 		void SetDropletCount(int dropletCount);
+		void SetSeed(int seed) { this->seed = seed; }
 
 		//Getters
 		ErosionConfig& getConfigRef();
 		int& getDropletCountRef() { return dropletCount; }
+		int& getSeedRef() { return seed; }
 		int getWidth() { return width; }
 		int getHeight() { return height; }
+		int getStride() { return stride; }
 		float* getMap() { return map; }
+		bool isMapView() { return map && !ownsMap; }
+		const DirtyRegion& getDirtyRegion() const { return dirty; }
+		void ClearDirtyRegion() { dirty.clear(); }
+
+		int getMinTileSize() const { return 2 * (config.erosionRadius + 2); }
 
 	private:
+		friend class ErosionSession;
+
+		size_t index(int x, int y) const { return static_cast<size_t>(y) * stride + x; }
+		void releaseMap();
+		void prepareBrush();
+		void spawnDroplets(std::optional<float*> Track, int& step);
+		int removeFallenDroplets();
+		void erodeCheckerboard(int tileSize);
+		void erodeFixedPoint();
+		void erodeThermal(int lifetimeStep, const ErosionConfig& settings);
+		static bool isThermalStep(int lifetimeStep, const ErosionConfig& settings);
+
+		//Droplet step, Writer applies the changes of the map (see Erosion.cpp)
+		void moveDroplet(size_t index, int lifetimeStep);
+		template<typename Writer>
+		void updateDroplet(size_t index, Writer& writer);
+		template<typename Writer>
+		void distributeSediment(vec2 pos, float sedimentDropped, Writer& writer);
+		template<typename Writer>
+		float erodeRadius(vec2 oldPos, vec2 newPos, float ammountEroded, Writer& writer);
+
 		float* map;
+		bool ownsMap;
 
 		int width, height;
+		int stride;
 		int dropletCount = 1;
+		int seed = 0;
+		//Rectangle the droplets are spawned in, width of 0 for the whole map
+		int spawnX = 0, spawnY = 0, spawnWidth = 0, spawnHeight = 0;
+
+		ErosionConfig config;
+		DropletPool droplets;
+		ErosionBrush brush;
+		ThermalErosion thermal;
+		//Tiles changed since the map was set or since ClearDirtyRegion
+		DirtyRegion dirty;
+	};
+
+	//Limits of one ErosionSession::advance call, the call stops at the first limit reached
+	//@param droplets: number of the droplets processed, every step moves all of the droplets and then erodes them,
+	//				   so one droplet counts twice per step, 0 for no limit
+	//@param milliseconds: time of the call, 0 for no limit
+	//Pass of the thermal erosion (see ErosionConfig::thermalInterval) changes the whole map at once, with any limit set
+	//it is a slice of its own: the call reaching it stops before it and the next call runs only the pass
+	struct ErosionBudget {
+		int droplets = 0;
+		double milliseconds = 0.0;
+	};
 
+	enum class SessionState { IDLE, RUNNING, PAUSED, FINISHED, CANCELLED };
+
+	//Serial erosion (see Erosion::Erode) split into slices, every advance call continues where the previous one stopped
+	//The map of the erosion is eroded in place, between the calls it shows the erosion done so far, e.g. in the viewer
+	//eroding a few milliseconds per frame. Finished session leaves the same map as Erode with the same seed, no matter
+	//how the work was sliced. Cancelled session leaves the map partly eroded.
+	//Droplet count, droplet lifetime and the thermal erosion settings are taken when the session starts, changing them
+	//later doesnt affect it. The rest of the configuration and the map must not change until the session is finished or cancelled.
+	class ErosionSession
+	{
+	public:
+		ErosionSession(Erosion& erosion) : erosion(erosion) {}
+
+		bool start(std::optional<float*> Track = std::nullopt);
+		bool advance(ErosionBudget budget);
+		void pause();
+		void resume();
+		void cancel();
+
+		SessionState getState() const { return state; }
+		bool isActive() const { return state == SessionState::RUNNING || state == SessionState::PAUSED; }
+		float getProgress() const;
+		int getFellOff() const { return fellOff; }
+		float* getMap() { return erosion.getMap(); }
+
+	private:
+		Erosion& erosion;
+		SessionState state = SessionState::IDLE;
+		std::optional<float*> Track;
+		//Configuration and droplet count of the erosion when the session started
 		ErosionConfig config;
+		int dropletCount = 0;
+
+		//Position in the simulation: step of the droplets, pass of the step and the next droplet of the pass
+		int lifetimeStep = 0;
+		bool eroding = false;
+		size_t next = 0;
+		//Thermal pass of the step just finished is the next slice
+		bool thermalPending = false;
+
+		int trackStep = 0;
+		int fellOff = 0;
+		uint64_t completedSteps = 0, totalSteps = 0;	//Droplets processed, see ErosionBudget
 	};
 
 	class Droplet
@@ -122,6 +343,7 @@ namespace erosion {
 		float sedimentToGather(float erosionRate, float elevationDifference);
 		float dropSediment(float elevationDifference);
 		float dropSurplusSediment(float depositionRate);
+		void setRandom(DropletRandom random) { this->random = random; }
 
 
 	private:
@@ -131,5 +353,6 @@ namespace erosion {
 		float water;
 		float sediment;
 		float capacity;
+		DropletRandom random{ 0, 0, 0 };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include "GenerationConfig.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <variant>
+
+namespace config
+{
+	using NoiseField = std::variant<float noise::NoiseConfigParameters::*, int noise::NoiseConfigParameters::*, bool noise::NoiseConfigParameters::*,
+		noise::Options noise::NoiseConfigParameters::*, noise::IslandType noise::NoiseConfigParameters::*>;
+	using ErosionField = std::variant<float erosion::ErosionConfig::*, int erosion::ErosionConfig::*>;
+	using PipeErosionField = std::variant<float erosion::PipeErosionConfig::*, int erosion::PipeErosionConfig::*>;
+
+	//Seed of the noise is not listed, it is derived from the world seed
+	static const std::pair<const char*, NoiseField> noiseFields[] = {
+		{ "xoffset", &noise::NoiseConfigParameters::xoffset },
+		{ "yoffset", &noise::NoiseConfigParameters::yoffset },
+		{ "scale", &noise::NoiseConfigParameters::scale },
+		{ "octaves", &noise::NoiseConfigParameters::octaves },
+		{ "constrast", &noise::NoiseConfigParameters::constrast },
+		{ "redistribution", &noise::NoiseConfigParameters::redistribution },
+		{ "lacunarity", &noise::NoiseConfigParameters::lacunarity },
+		{ "persistance", &noise::NoiseConfigParameters::persistance },
+		{ "option", &noise::NoiseConfigParameters::option },
+		{ "revertGain", &noise::NoiseConfigParameters::revertGain },
+		{ "ridge", &noise::NoiseConfigParameters::ridge },
+		{ "ridgeGain", &noise::NoiseConfigParameters::ridgeGain },
+		{ "ridgeOffset", &noise::NoiseConfigParameters::ridgeOffset },
+		{ "island", &noise::NoiseConfigParameters::island },
+		{ "mixPower", &noise::NoiseConfigParameters::mixPower },
+		{ "islandType", &noise::NoiseConfigParameters::islandType },
+		{ "symmetrical", &noise::NoiseConfigParameters::symmetrical }
+	};
+
+	static const std::pair<const char*, ErosionField> erosionFields[] = {
+		{ "erosionRate", &erosion::ErosionConfig::erosionRate },
+		{ "depositionRate", &erosion::ErosionConfig::depositionRate },
+		{ "evaporationRate", &erosion::ErosionConfig::evaporationRate },
+		{ "gravity", &erosion::ErosionConfig::gravity },
+		{ "inertia", &erosion::ErosionConfig::inertia },
+		{ "minSlope", &erosion::ErosionConfig::minSlope },
+		{ "erosionRadius", &erosion::ErosionConfig::erosionRadius },
+		{ "blur", &erosion::ErosionConfig::blur },
+		{ "dropletLifetime", &erosion::ErosionConfig::dropletLifetime },
+		{ "initialWater", &erosion::ErosionConfig::initialWater },
+		{ "initialVelocity", &erosion::ErosionConfig::initialVelocity },
+		{ "initialCapacity", &erosion::ErosionConfig::initialCapacity },
+		{ "talusSlope", &erosion::ErosionConfig::talusSlope },
+		{ "thermalRate", &erosion::ErosionConfig::thermalRate },
+		{ "thermalInterval", &erosion::ErosionConfig::thermalInterval }
+	};
+
+	static const std::pair<const char*, PipeErosionField> pipeErosionFields[] = {
+		{ "timeStep", &erosion::PipeErosionConfig::timeStep },
+		{ "rainRate", &erosion::PipeErosionConfig::rainRate },
+		{ "pipeArea", &erosion::PipeErosionConfig::pipeArea },
+		{ "cellSize", &erosion::PipeErosionConfig::cellSize },
+		{ "sedimentCapacity", &erosion::PipeErosionConfig::sedimentCapacity },
+		{ "iterations", &erosion::PipeErosionConfig::iterations }
+	};
+
+	//Names of the enums in the order of their values
+	static const std::vector<std::string> optionNames = { "refit_all", "flatten_negatives", "revert_negatives", "nothing" };
+	static const std::vector<std::string> islandTypeNames = { "cone", "diagonal", "euclidean_squared", "square_bump", "hyperboloid", "squircle", "trig" };
+	static const std::vector<std::string> layoutNames = { "row_major", "chunk_major" };
+	static const std::vector<std::string> erosionEngineNames = { "droplets", "pipe" };
+
+	//Sections of the noises in the file, the first three have the splines
+	static const char* const noiseSections[] = { "continentalness", "mountainous", "pv", "temperature", "humidity" };
+
+	static noise::NoiseConfigParameters GenerationConfig::* const noiseMembers[] = {
+		&GenerationConfig::continentalness, &GenerationConfig::mountainous, &GenerationConfig::PV, &GenerationConfig::temperature, &GenerationConfig::humidity
+	};
+
+	//--------------------------------------------------------------------------------------
+	//Parsing and formatting of the values
+	//--------------------------------------------------------------------------------------
+
+	static bool parseValue(const std::string& text, float& value)
+	{
+		auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	}
+
+	static bool parseValue(const std::string& text, int& value)
+	{
+		auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+		return result.ec == std::errc() && result.ptr == text.data() + text.size();
+	}
+
+	static bool parseValue(const std::string& text, bool& value)
+	{
+		if (text != "true" && text != "false" && text != "1" && text != "0")
+			return false;
+		value = text == "true" || text == "1";
+		return true;
+	}
+
+	template<typename Enum>
+	static bool parseEnum(const std::string& text, const std::vector<std::string>& names, Enum& value)
+	{
+		auto it = std::find(names.begin(), names.end(), text);
+		if (it == names.end())
+			return false;
+		value = static_cast<Enum>(it - names.begin());
+		return true;
+	}
+
+	static bool parseValue(const std::string& text, noise::Options& value) { return parseEnum(text, optionNames, value); }
+	static bool parseValue(const std::string& text, noise::IslandType& value) { return parseEnum(text, islandTypeNames, value); }
+	static bool parseValue(const std::string& text, layout::MapLayout& value) { return parseEnum(text, layoutNames, value); }
+	static bool parseValue(const std::string& text, erosion::ErosionEngine& value) { return parseEnum(text, erosionEngineNames, value); }
+
+	static bool parseValue(const std::string& text, std::vector<double>& values)
+	{
+		std::vector<double> parsed;
+		const char* current = text.data();
+		const char* end = text.data() + text.size();
+		while (current < end) {
+			while (current < end && (*current == ' ' || *current == '\t'))
+				current++;
+			double value;
+			auto result = std::from_chars(current, end, value);
+			if (result.ec != std::errc())
+				return false;
+			parsed.push_back(value);
+			current = result.ptr;
+			while (current < end && (*current == ' ' || *current == '\t'))
+				current++;
+			if (current < end && *current++ != ',')
+				return false;
+		}
+		if (parsed.empty())
+			return false;
+		values = std::move(parsed);
+		return true;
+	}
+
+	//Floats are written in the shortest form that reads back to the same value
+	static std::string formatValue(float value)
+	{
+		char buffer[32];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		return std::string(buffer, result.ptr);
+	}
+
+	static std::string formatValue(int value) { return std::to_string(value); }
+	static std::string formatValue(bool value) { return value ? "true" : "false"; }
+	static std::string formatValue(noise::Options value) { return optionNames[static_cast<size_t>(value)]; }
+	static std::string formatValue(noise::IslandType value) { return islandTypeNames[static_cast<size_t>(value)]; }
+	static std::string formatValue(layout::MapLayout value) { return layoutNames[static_cast<size_t>(value)]; }
+	static std::string formatValue(erosion::ErosionEngine value) { return erosionEngineNames[static_cast<size_t>(value)]; }
+
+	static std::string formatValue(const std::vector<double>& values)
+	{
+		std::string text;
+		for (size_t i = 0; i < values.size(); i++) {
+			char buffer[32];
+			auto result = std::to_chars(buffer, buffer + sizeof(buffer), values[i]);
+			text += i > 0 ? ", " : "";
+			text.append(buffer, result.ptr);
+		}
+		return text;
+	}
+
+	//Sets the field of the table by its name, false if there is no such field or the value is not valid
+	template<typename Struct, typename Field, size_t N>
+	static bool setField(Struct& object, const std::pair<const char*, Field>(&fields)[N], const std::string& key, const std::string& value)
+	{
+		for (auto& [name, member] : fields) {
+			if (key == name)
+				return std::visit([&object, &value](auto pointer) { return parseValue(value, object.*pointer); }, member);
+		}
+		return false;
+	}
+
+	template<typename Struct, typename Field, size_t N>
+	static void writeFields(std::ofstream& file, const Struct& object, const std::pair<const char*, Field>(&fields)[N])
+	{
+		for (auto& [name, member] : fields)
+			file << name << " = " << std::visit([&object](auto pointer) { return formatValue(object.*pointer); }, member) << "\n";
+	}
+
+	static std::string trim(const std::string& text)
+	{
+		size_t first = text.find_first_not_of(" \t\r");
+		if (first == std::string::npos)
+			return "";
+		return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Defaults
+	//--------------------------------------------------------------------------------------
+
+	//Config of the world generated by the application
+	GenerationConfig defaultConfig()
+	{
+		GenerationConfig config;
+
+		//Defaults of the generator, options and ridges of the noises are set by its constructor
+		TerrainGenerator defaults;
+		config.continentalness = defaults.getContinentalnessNoiseConfig();
+		config.mountainous = defaults.getMountainousNoiseConfig();
+		config.PV = defaults.getPVNoiseConfig();
+		config.temperature = defaults.getTemperatureNoiseConfig();
+		config.humidity = defaults.getHumidityNoiseConfig();
+
+		config.continentalness.constrast = 1.5f;
+		config.continentalness.octaves = 7;
+		config.continentalness.scale = 0.05f;
+
+		config.mountainous.constrast = 1.5f;
+		config.mountainous.scale = 0.05f;
+
+		config.PV.constrast = 1.5f;
+		config.PV.ridgeGain = 3.0f;
+		config.PV.scale = 0.05f;
+
+		config.splines = { {-1.0, -0.7, -0.2, 0.03, 0.3, 1.0}, {0.0, 40.0 ,64.0, 66.0, 68.0, 70.0},	//Continentalness {X,Y}
+							{-1.0, -0.78, -0.37, -0.2, 0.05, 0.45, 0.55, 1.0}, {0.0, 5.0, 10.0, 20.0, 30.0, 80.0, 100.0, 170.0},	//Mountainousness {X,Y}
+							{-1.0, -0.85, -0.6, 0.2, 0.7, 1.0}, {1.0, 0.7, 0.4, 0.2, 0.05, 0} }; //PV {X,Y}
+		return config;
+	}
+
+	//Biomes of the application, the number of the trees scales with the area of the chunk
+	std::vector<biome::Biome> defaultBiomes(int chunkResolution)
+	{
+		float area = static_cast<float>(chunkResolution) * chunkResolution;
+		return {
+			biome::Biome(0, "Grassplains",	{1, 2}, {1, 4}, {3, 5}, {0, 3}, 3, static_cast<int>(area * 0.2f)),
+			biome::Biome(1, "Desert",		{2, 4}, {0, 1}, {3, 5}, {0, 4}, 2, static_cast<int>(area * 0.01f)),
+			biome::Biome(2, "Snow",			{0, 1}, {0, 4}, {3, 5}, {0, 4}, 7, static_cast<int>(area * 0.03f)),
+			biome::Biome(3, "Sand",			{0, 4}, {0, 4}, {2, 3}, {0, 7}, 8, static_cast<int>(area * 0.01f)),
+			biome::Biome(4, "Mountain",		{0, 4}, {0, 4}, {4, 5}, {4, 7}, 0, static_cast<int>(area * 0.02f)),
+			biome::Biome(5, "Ocean",		{0, 4}, {0, 4}, {0, 2}, {0, 7}, 5, static_cast<int>(area * 0.0f))
+		};
+	}
+
+	std::vector<std::vector<RangedLevel>> defaultRanges()
+	{
+		return {
+			{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+			{{-1.0f, -0.5f, 0},{-0.5f, 0.0f, 1},{0.0f, 0.5f, 2},{0.5f, 1.1f, 3}},
+			{{-1.0f, -0.7f, 0},{-0.7f, -0.2f, 1},{ -0.2f, 0.03f, 2},{0.03f, 0.3f, 3},{0.3f, 1.1f, 4}},
+			{{-1.0f, -0.78f, 0},{-0.78f, -0.37f, 1},{-0.37f, -0.2f, 2},{-0.2f, 0.05f, 3},{0.05f, 0.45f, 4},{0.45f, 0.55f, 5},{0.55f, 1.1f, 6}}
+		};
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Files
+	//--------------------------------------------------------------------------------------
+
+	//Reads the config file over the given config, see the description of the format in the header
+	//Config is left untouched if the file is not valid
+	//
+	//@param path - path of the config file
+	//@param config - config to be overwritten by the values of the file, usually defaultConfig()
+	//@return bool - false if the file couldnt be opened or contains an unknown key or an invalid value
+	bool loadConfig(const std::string& path, GenerationConfig& config)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			std::cout << "[ERROR] Config file " << path << " couldnt be opened" << std::endl;
+			return false;
+		}
+
+		GenerationConfig loaded = config;
+		loaded.splines.resize(6);
+		std::string section, line;
+		for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+			line = trim(line);
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			if (line.front() == '[' && line.back() == ']') {
+				section = trim(line.substr(1, line.size() - 2));
+				continue;
+			}
+
+			size_t separator = line.find('=');
+			std::string key = separator == std::string::npos ? "" : trim(line.substr(0, separator));
+			std::string value = separator == std::string::npos ? "" : trim(line.substr(separator + 1));
+
+			bool valid = false;
+			if (section == "world") {
+				if (key == "seed")
+					valid = parseValue(value, loaded.seed);
+				else if (key == "width")
+					valid = parseValue(value, loaded.width) && loaded.width > 0;
+				else if (key == "height")
+					valid = parseValue(value, loaded.height) && loaded.height > 0;
+				else if (key == "chunkResolution")
+					valid = parseValue(value, loaded.chunkResolution) && loaded.chunkResolution > 0;
+				else if (key == "seeLevel")
+					valid = parseValue(value, loaded.seeLevel) && loaded.seeLevel >= 0.0f;
+				else if (key == "vegetationMinDistance")
+					valid = parseValue(value, loaded.vegetationMinDistance) && loaded.vegetationMinDistance >= 1.0f;
+				else if (key == "layout")
+					valid = parseValue(value, loaded.mapLayout);
+			}
+			else if (section == "erosion") {
+				if (key == "droplets")
+					valid = parseValue(value, loaded.dropletCount) && loaded.dropletCount >= 0;
+				else if (key == "engine")
+					valid = parseValue(value, loaded.erosionEngine);
+				else if (key == "chunked")
+					valid = parseValue(value, loaded.chunkedErosion);
+				else if (key == "halo")
+					valid = parseValue(value, loaded.erosionHalo) && loaded.erosionHalo >= 0;
+				else
+					valid = setField(loaded.erosion, erosionFields, key, value);
+			}
+			else if (section == "pipeErosion") {
+				valid = setField(loaded.pipeErosion, pipeErosionFields, key, value) && loaded.pipeErosion.iterations >= 0 &&
+					loaded.pipeErosion.cellSize > 0.0f;
+			}
+			else {
+				auto it = std::find_if(std::begin(noiseSections), std::end(noiseSections), [&section](const char* name) { return section == name; });
+				int noiseSection = static_cast<int>(it - std::begin(noiseSections));
+				if (it != std::end(noiseSections)) {
+					if (noiseSection < 3 && (key == "splineX" || key == "splineY"))
+						valid = parseValue(value, loaded.splines[noiseSection * 2 + (key == "splineY" ? 1 : 0)]);
+					else
+						valid = setField(loaded.*noiseMembers[noiseSection], noiseFields, key, value);
+				}
+			}
+
+			if (!valid) {
+				std::cout << "[ERROR] " << path << ":" << lineNumber << " unknown key or invalid value '" << line << "' in section [" << section << "]" << std::endl;
+				return false;
+			}
+		}
+
+		for (int spline = 0; spline < 3; spline++) {
+			if (loaded.splines[spline * 2].size() != loaded.splines[spline * 2 + 1].size() || loaded.splines[spline * 2].size() < 3) {
+				std::cout << "[ERROR] Spline of [" << noiseSections[spline] << "] in " << path << " needs the same number of at least 3 x and y points" << std::endl;
+				return false;
+			}
+		}
+
+		config = std::move(loaded);
+		return true;
+	}
+
+	//Writes every value of the config, the file can be read back by loadConfig
+	bool saveConfig(const std::string& path, const GenerationConfig& config)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			std::cout << "[ERROR] Config file " << path << " couldnt be opened" << std::endl;
+			return false;
+		}
+
+		file << "# Tijo_ProceduralTerrainGeneration generation config\n";
+		file << "[world]\n";
+		file << "seed = " << formatValue(config.seed) << "\n";
+		file << "width = " << formatValue(config.width) << "\n";
+		file << "height = " << formatValue(config.height) << "\n";
+		file << "chunkResolution = " << formatValue(config.chunkResolution) << "\n";
+		file << "seeLevel = " << formatValue(config.seeLevel) << "\n";
+		file << "vegetationMinDistance = " << formatValue(config.vegetationMinDistance) << "\n";
+		file << "layout = " << formatValue(config.mapLayout) << "\n";
+
+		for (int section = 0; section < 5; section++) {
+			file << "\n[" << noiseSections[section] << "]\n";
+			writeFields(file, config.*noiseMembers[section], noiseFields);
+			if (section < 3 && config.splines.size() > static_cast<size_t>(section * 2 + 1)) {
+				file << "splineX = " << formatValue(config.splines[section * 2]) << "\n";
+				file << "splineY = " << formatValue(config.splines[section * 2 + 1]) << "\n";
+			}
+		}
+
+		file << "\n[erosion]\n";
+		file << "droplets = " << formatValue(config.dropletCount) << "\n";
+		file << "engine = " << formatValue(config.erosionEngine) << "\n";
+		file << "chunked = " << formatValue(config.chunkedErosion) << "\n";
+		file << "halo = " << formatValue(config.erosionHalo) << "\n";
+		writeFields(file, config.erosion, erosionFields);
+
+		file << "\n[pipeErosion]\n";
+		writeFields(file, config.pipeErosion, pipeErosionFields);
+
+		if (!file.good()) {
+			std::cout << "[ERROR] Config couldnt be written to " << path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	//Sets the generator up with the config, allocates its maps and sets the default biomes
+	//Generator is ready for performTerrainGeneration afterwards, erosion is part of the generator only when it is chunked
+	//
+	//@param config - config of the world
+	//@param terrainGen - generator to be set up
+	//@return bool - false if any of the values is not accepted by the generator
+	bool applyConfig(const GenerationConfig& config, TerrainGenerator& terrainGen)
+	{
+		if (config.width <= 0 || config.height <= 0 || config.vegetationMinDistance > config.chunkResolution || !terrainGen.setSize(config.width, config.height) ||
+			!terrainGen.setChunkResolution(config.chunkResolution) || !terrainGen.setSeeLevel(config.seeLevel) ||
+			!terrainGen.setVegetationMinDistance(config.vegetationMinDistance) || !terrainGen.setMapLayout(config.mapLayout)) {
+			std::cout << "[ERROR] Size, resolution, see level or vegetation distance of the config not valid" << std::endl;
+			return false;
+		}
+
+		terrainGen.setSeed(config.seed);
+		terrainGen.setContinentalnessNoiseConfig(config.continentalness);
+		terrainGen.setMountainousNoiseConfig(config.mountainous);
+		terrainGen.setPVNoiseConfig(config.PV);
+		terrainGen.getTemperatureNoiseConfig() = config.temperature;
+		terrainGen.getHumidityNoiseConfig() = config.humidity;
+
+		std::vector<biome::Biome> biomes = defaultBiomes(config.chunkResolution);
+		std::vector<std::vector<RangedLevel>> ranges = defaultRanges();
+		if (!terrainGen.initializeMap() || !terrainGen.setSplines(config.splines) || !terrainGen.setBiomes(biomes) || !terrainGen.setRanges(ranges)) {
+			std::cout << "[ERROR] Generator couldnt be set up with the config" << std::endl;
+			return false;
+		}
+
+		bool chunked = config.chunkedErosion && config.erosionEngine == erosion::ErosionEngine::DROPLETS;
+		if (!terrainGen.setErosion(config.erosion, chunked ? dropletsPerChunk(config) : 0, config.erosionHalo)) {
+			std::cout << "[ERROR] Chunked erosion of the config not valid" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	//Droplets of the chunked erosion spawned in every chunk, the droplets of the config are given for the whole world
+	//
+	//@param config - config of the whole world, not of its shard
+	//@return int - droplets per chunk, at least 1 if the config has any droplets
+	int dropletsPerChunk(const GenerationConfig& config)
+	{
+		if (config.dropletCount <= 0 || config.width <= 0 || config.height <= 0)
+			return 0;
+		return std::max(static_cast<int>(std::llround(static_cast<double>(config.dropletCount) / (static_cast<double>(config.width) * config.height))), 1);
+	}
+}
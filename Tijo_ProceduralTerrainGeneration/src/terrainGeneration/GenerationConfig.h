@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Erosion.h"
+#include "PipeErosion.h"
+#include "TerrainGenerator.h"
+
+//Whole configuration of the generation of the world kept in one place, so the world can be generated without
+//the application (batch generation, servers) and the same config can be shared between the runs
+//
+//Text file of the config is made of sections with "key = value" lines, lines starting with # are comments:
+//
+//	[world]				seed, width, height (in chunks), chunkResolution, seeLevel, vegetationMinDistance, layout (row_major, chunk_major)
+//	[continentalness]	fields of NoiseConfigParameters by name (xoffset, scale, octaves, constrast, ...) and splineX, splineY
+//	[mountainous]		as continentalness
+//	[pv]				as continentalness
+//	[temperature]		fields of NoiseConfigParameters
+//	[humidity]			fields of NoiseConfigParameters
+//	[erosion]			fields of ErosionConfig by name, droplets (0 disables the erosion), engine (droplets, pipe),
+//						chunked (true erodes the chunks in the generation, see TerrainGenerator::erodeChunk) and halo
+//	[pipeErosion]		fields of PipeErosionConfig by name, used by the pipe engine (iterations 0 disables the erosion)
+//
+//Keys that are not in the file keep their default values. Seeds of the noises are always derived from the world seed.
+//Option and islandType are written by name (revert_negatives, cone, ...), lists of the spline points are comma separated.
+//Biomes and their ranges are not part of the file, the default biomes of the application are used.
+
+namespace config
+{
+	struct GenerationConfig {
+		int seed = 742;
+		int width = 20, height = 20;
+		int chunkResolution = 20;
+		float seeLevel = 64.0f;
+		float vegetationMinDistance = 2.0f;
+		layout::MapLayout mapLayout = layout::MapLayout::CHUNK_MAJOR;
+
+		noise::NoiseConfigParameters continentalness, mountainous, PV, temperature, humidity;
+		//x and y points of the continentalness, mountainous and PV splines, in the order of TerrainGenerator::setSplines
+		std::vector<std::vector<double>> splines;
+
+		erosion::ErosionConfig erosion;
+		int dropletCount = 0;
+		erosion::ErosionEngine erosionEngine = erosion::ErosionEngine::DROPLETS;
+		erosion::PipeErosionConfig pipeErosion;
+		//Droplets erode the chunks with the halo of their neighbours during the generation instead of the whole map after it
+		bool chunkedErosion = false;
+		int erosionHalo = 0;
+	};
+
+	GenerationConfig defaultConfig();
+	std::vector<biome::Biome> defaultBiomes(int chunkResolution);
+	std::vector<std::vector<RangedLevel>> defaultRanges();
+
+	bool loadConfig(const std::string& path, GenerationConfig& config);
+	bool saveConfig(const std::string& path, const GenerationConfig& config);
+	bool applyConfig(const GenerationConfig& config, TerrainGenerator& terrainGen);
+	int dropletsPerChunk(const GenerationConfig& config);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//64 bit hash of the generation inputs, used to tell apart the configs and to key the cached results
+//Values are fed one by one (FNV-1a over their bytes) and the result goes through the final avalanche, so swapped
+//or shifted fields give different hashes. Sizes of the containers are hashed too, so [a, b] + [c] differs from [a] + [b, c].
+
+namespace hashing
+{
+	class Hasher
+	{
+	public:
+		Hasher& add(const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; i++) {
+				state ^= bytes[i];
+				state *= 0x100000001B3ull;
+			}
+			return *this;
+		}
+
+		template<typename T>
+			requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+		Hasher& add(T value)
+		{
+			if constexpr (std::is_floating_point_v<T>) {
+				//-0.0 and 0.0 generate the same terrain
+				if (value == T(0))
+					value = T(0);
+			}
+			if constexpr (std::is_same_v<T, size_t> && sizeof(size_t) != sizeof(uint64_t))
+				return add(static_cast<uint64_t>(value));
+			else
+				return add(&value, sizeof(T));
+		}
+
+		Hasher& add(const std::string& value)
+		{
+			add(static_cast<uint64_t>(value.size()));
+			return add(value.data(), value.size());
+		}
+
+		template<typename T>
+		Hasher& add(const std::vector<T>& values)
+		{
+			add(static_cast<uint64_t>(values.size()));
+			for (const auto& it : values)
+				add(it);
+			return *this;
+		}
+
+		uint64_t get() const
+		{
+			uint64_t h = state;
+			h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+			h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+			return h ^ (h >> 31);
+		}
+
+	private:
+		uint64_t state = 0xCBF29CE484222325ull;
+	};
+}
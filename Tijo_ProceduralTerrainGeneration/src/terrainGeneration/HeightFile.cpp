@@ -0,0 +1,336 @@
+#include "HeightFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "JobSystem.h"
+
+namespace heightfile
+{
+	static size_t sampleBytes(SampleFormat format)
+	{
+		switch (format) {
+		case SampleFormat::UINT8: return 1;
+		case SampleFormat::UINT16: return 2;
+		default: return 4;
+		}
+	}
+
+	MappedHeightFile::MappedHeightFile() : data(nullptr), samples(nullptr), mappedSize(0), width(0), height(0),
+		format(SampleFormat::UINT16), bigEndian(false), maxValue(65535.0f)
+	{
+	}
+
+	MappedHeightFile::~MappedHeightFile()
+	{
+		close();
+	}
+
+	//Maps the RAW file of the samples without any header, rows one after another
+	//
+	//@param path - path of the file
+	//@param width, height - size of the map in samples
+	//@param format - format of the single sample
+	//@param bigEndian - byte order of the samples wider than one byte
+	//@return bool - false if the file couldnt be mapped or it is smaller than the map
+	bool MappedHeightFile::openRaw(const std::string& path, int width, int height, SampleFormat format, bool bigEndian)
+	{
+		close();
+		if (width <= 0 || height <= 0) {
+			std::cout << "[ERROR] width and height must be greater than 0" << std::endl;
+			return false;
+		}
+		if (!map(path))
+			return false;
+
+		uint64_t expected = static_cast<uint64_t>(width) * height * sampleBytes(format);
+		if (mappedSize < expected) {
+			std::cout << "[ERROR] " << path << " has " << mappedSize << " bytes, " << expected << " expected" << std::endl;
+			close();
+			return false;
+		}
+
+		this->width = width;
+		this->height = height;
+		this->format = format;
+		this->bigEndian = bigEndian;
+		maxValue = format == SampleFormat::UINT8 ? 255.0f : 65535.0f;
+		samples = data;
+		return true;
+	}
+
+	//Maps the binary PGM (P5) file, size and maxval are read from its header
+	//
+	//@param path - path of the file
+	//@return bool - false if the file couldnt be mapped or it is not a valid PGM
+	bool MappedHeightFile::openPgm(const std::string& path)
+	{
+		close();
+		if (!map(path))
+			return false;
+
+		//Header is P5, width, height and maxval separated by whitespace, comments run from # to the end of the line
+		uint64_t position = 2;
+		auto readNumber = [this, &position](int& value) {
+			while (position < mappedSize && (std::isspace(data[position]) || data[position] == '#')) {
+				if (data[position] == '#')
+					while (position < mappedSize && data[position] != '\n')
+						position++;
+				else
+					position++;
+			}
+			if (position >= mappedSize || !std::isdigit(data[position]))
+				return false;
+			int64_t number = 0;
+			while (position < mappedSize && std::isdigit(data[position]) && number <= INT32_MAX)
+				number = number * 10 + (data[position++] - '0');
+			value = static_cast<int>(std::min<int64_t>(number, INT32_MAX));
+			return true;
+		};
+
+		int pgmWidth = 0, pgmHeight = 0, pgmMaxValue = 0;
+		bool valid = mappedSize > 2 && data[0] == 'P' && data[1] == '5' && readNumber(pgmWidth) && readNumber(pgmHeight) &&
+			readNumber(pgmMaxValue) && position < mappedSize && std::isspace(data[position]);
+		valid = valid && pgmWidth > 0 && pgmHeight > 0 && pgmMaxValue > 0 && pgmMaxValue <= 65535;
+
+		//Single whitespace separates maxval from the samples
+		SampleFormat pgmFormat = pgmMaxValue < 256 ? SampleFormat::UINT8 : SampleFormat::UINT16;
+		position++;
+		if (!valid || mappedSize - position < static_cast<uint64_t>(pgmWidth) * pgmHeight * sampleBytes(pgmFormat)) {
+			std::cout << "[ERROR] " << path << " is not a valid binary PGM file" << std::endl;
+			close();
+			return false;
+		}
+
+		width = pgmWidth;
+		height = pgmHeight;
+		format = pgmFormat;
+		bigEndian = true;
+		maxValue = static_cast<float>(pgmMaxValue);
+		samples = data + position;
+		return true;
+	}
+
+	void MappedHeightFile::close()
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+#else
+		if (data)
+			munmap(const_cast<uint8_t*>(data), mappedSize);
+#endif
+		data = nullptr;
+		samples = nullptr;
+		mappedSize = 0;
+		width = 0;
+		height = 0;
+	}
+
+	//Converts the rectangle of the samples into the heights, every row is converted by its own job
+	//
+	//@param x, y - top left sample of the region
+	//@param regionWidth, regionHeight - size of the region, it has to lie inside of the file
+	//@param destination - output heights, row after row
+	//@param destinationStride - number of floats between the starts of the rows in the destination
+	//@param heightScale - height of the sample normalized to 1
+	//@param heightOffset - height of the sample 0
+	//@return bool - false if the file is not open or the region is out of it
+	bool MappedHeightFile::readRegion(int x, int y, int regionWidth, int regionHeight, float* destination, size_t destinationStride,
+		float heightScale, float heightOffset) const
+	{
+		if (!isOpen() || !destination || x < 0 || y < 0 || regionWidth <= 0 || regionHeight <= 0 ||
+			x + regionWidth > width || y + regionHeight > height || destinationStride < static_cast<size_t>(regionWidth)) {
+			std::cout << "[ERROR] Region couldnt be read from the height file" << std::endl;
+			return false;
+		}
+
+		size_t bytes = sampleBytes(format);
+		float scale = format == SampleFormat::FLOAT32 ? heightScale : heightScale / maxValue;
+		jobs::JobSystem::get().parallel_for(0, regionHeight, 16, [&](int row) {
+			const uint8_t* source = samples + (static_cast<size_t>(y + row) * width + x) * bytes;
+			float* output = destination + row * destinationStride;
+
+			switch (format) {
+			case SampleFormat::UINT8:
+				for (int i = 0; i < regionWidth; i++)
+					output[i] = source[i] * scale + heightOffset;
+				break;
+			case SampleFormat::UINT16:
+				for (int i = 0; i < regionWidth; i++) {
+					const uint8_t* sample = source + i * 2;
+					uint16_t value = bigEndian ? static_cast<uint16_t>(sample[0] << 8 | sample[1]) : static_cast<uint16_t>(sample[1] << 8 | sample[0]);
+					output[i] = value * scale + heightOffset;
+				}
+				break;
+			case SampleFormat::FLOAT32:
+				for (int i = 0; i < regionWidth; i++) {
+					uint8_t sample[4];
+					std::memcpy(sample, source + i * 4, 4);
+					if (bigEndian)
+						std::reverse(sample, sample + 4);
+					float value;
+					std::memcpy(&value, sample, 4);
+					output[i] = value * scale + heightOffset;
+				}
+				break;
+			}
+		});
+		return true;
+	}
+
+	//Sample normalized the same way as by readRegion with the scale 1 and the offset 0
+	float MappedHeightFile::getSample(int x, int y) const
+	{
+		if (!isOpen() || x < 0 || y < 0 || x >= width || y >= height)
+			return 0.0f;
+
+		size_t bytes = sampleBytes(format);
+		const uint8_t* sample = samples + (static_cast<size_t>(y) * width + x) * bytes;
+		if (format == SampleFormat::UINT8)
+			return sample[0] / maxValue;
+		if (format == SampleFormat::UINT16)
+			return (bigEndian ? sample[0] << 8 | sample[1] : sample[1] << 8 | sample[0]) / maxValue;
+
+		uint8_t bytesOfValue[4];
+		std::memcpy(bytesOfValue, sample, 4);
+		if (bigEndian)
+			std::reverse(bytesOfValue, bytesOfValue + 4);
+		float value;
+		std::memcpy(&value, bytesOfValue, 4);
+		return value;
+	}
+
+	//Maps the whole file read-only, the file itself is closed straight away, the mapping keeps it accessible
+	bool MappedHeightFile::map(const std::string& path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size;
+		if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping) {
+				data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+				CloseHandle(mapping);
+			}
+			mappedSize = static_cast<uint64_t>(size.QuadPart);
+		}
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		struct stat status;
+		if (file != -1 && fstat(file, &status) == 0 && status.st_size > 0) {
+			void* address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+			if (address != MAP_FAILED)
+				data = static_cast<const uint8_t*>(address);
+			mappedSize = static_cast<uint64_t>(status.st_size);
+		}
+		if (file != -1)
+			::close(file);
+#endif
+		if (!data) {
+			std::cout << "[ERROR] Height file " << path << " couldnt be mapped" << std::endl;
+			mappedSize = 0;
+			return false;
+		}
+		return true;
+	}
+
+	//Lowest and highest height of the map, used as the range of the exported samples
+	HeightRange findHeightRange(const float* heightMap, const layout::MapIndexer& indexer)
+	{
+		HeightRange range;
+		if (!heightMap || indexer.size() == 0)
+			return range;
+
+		range.minHeight = range.maxHeight = heightMap[indexer.index(0, 0)];
+		for (int y = 0; y < indexer.height * indexer.chunkHeight; y++) {
+			for (int chunkX = 0; chunkX < indexer.width; chunkX++) {
+				//Row of the chunk is contiguous in every layout
+				const float* row = heightMap + indexer.index(chunkX * indexer.chunkWidth, y);
+				auto [rowMin, rowMax] = std::minmax_element(row, row + indexer.chunkWidth);
+				range.minHeight = std::min(range.minHeight, *rowMin);
+				range.maxHeight = std::max(range.maxHeight, *rowMax);
+			}
+		}
+		return range;
+	}
+
+	//Writes the height map as the grid of 16 bit tiles, tiles on the right and bottom border may be smaller
+	//Heights are mapped linearly from the range to [0, 65535] and clamped, every tile is written by its own job
+	//
+	//@param pathPrefix - path of the tiles without the suffix, e.g. "res/tiles/terrain"
+	//@param heightMap - height map to be exported
+	//@param indexer - layout of the height map
+	//@param tileSize - size of the tile in samples
+	//@param type - RAW (little-endian) or PGM (big-endian with the header)
+	//@param range - heights mapped to 0 and 65535, see findHeightRange
+	//@return bool - false if any of the tiles couldnt be written
+	bool exportTiles(const std::string& pathPrefix, const float* heightMap, const layout::MapIndexer& indexer, int tileSize, FileType type, HeightRange range)
+	{
+		int mapWidth = indexer.width * indexer.chunkWidth;
+		int mapHeight = indexer.height * indexer.chunkHeight;
+		if (!heightMap || mapWidth <= 0 || mapHeight <= 0 || tileSize <= 0) {
+			std::cout << "[ERROR] HeightMap couldnt be exported" << std::endl;
+			return false;
+		}
+
+		int tilesX = (mapWidth + tileSize - 1) / tileSize;
+		int tilesY = (mapHeight + tileSize - 1) / tileSize;
+		float scale = range.maxHeight > range.minHeight ? 65535.0f / (range.maxHeight - range.minHeight) : 0.0f;
+		std::atomic<bool> failed{ false };
+
+		jobs::JobSystem::get().parallel_for2D(tilesX, tilesY, 1, 1, [&](int tileX, int tileY) {
+			int x0 = tileX * tileSize, y0 = tileY * tileSize;
+			int tileWidth = std::min(tileSize, mapWidth - x0);
+			int tileHeight = std::min(tileSize, mapHeight - y0);
+
+			std::string header;
+			if (type == FileType::PGM)
+				header = "P5\n" + std::to_string(tileWidth) + " " + std::to_string(tileHeight) + "\n65535\n";
+
+			std::vector<uint8_t> bytes(header.size() + static_cast<size_t>(tileWidth) * tileHeight * 2);
+			std::memcpy(bytes.data(), header.data(), header.size());
+			uint8_t* output = bytes.data() + header.size();
+			for (int y = y0; y < y0 + tileHeight; y++) {
+				for (int x = x0; x < x0 + tileWidth; x++, output += 2) {
+					float value = std::round((heightMap[indexer.index(x, y)] - range.minHeight) * scale);
+					uint16_t sample = static_cast<uint16_t>(std::clamp(value, 0.0f, 65535.0f));
+					output[type == FileType::PGM ? 0 : 1] = static_cast<uint8_t>(sample >> 8);
+					output[type == FileType::PGM ? 1 : 0] = static_cast<uint8_t>(sample & 0xFF);
+				}
+			}
+
+			std::string path = pathPrefix + "_x" + std::to_string(tileX) + "_y" + std::to_string(tileY) + (type == FileType::PGM ? ".pgm" : ".raw");
+			std::ofstream file(path, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			if (!file.good())
+				failed = true;
+		});
+
+		if (failed) {
+			std::cout << "[ERROR] Tiles of the height map couldnt be written to " << pathPrefix << std::endl;
+			return false;
+		}
+		std::cout << "[LOG] HeightMap exported as " << tilesX * tilesY << " tiles" << std::endl;
+		return true;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MapLayout.h"
+
+//Exchange of the height maps with other tools as RAW and PGM files
+//
+//Import maps the file read-only and converts the samples straight into the destination array (the map of the erosion,
+//the meshing utilities or any region of it), rows in parallel, so the file is never read or copied as a whole and
+//only the pages of the requested region are touched. Integer samples are normalized to [0, 1] by their maximal value
+//(65535, 255 or maxval of the PGM) and then scaled, float samples are only scaled.
+//
+//RAW files have no header, the size and the format have to be known. PGM (P5) samples are always big-endian,
+//RAW samples are little-endian unless told otherwise.
+//
+//Export writes the height map in 16 bit tiles, every tile is its own file named <prefix>_x<tileX>_y<tileY>.<raw|pgm>.
+
+namespace heightfile
+{
+	enum class SampleFormat {
+		UINT8,
+		UINT16,
+		FLOAT32
+	};
+
+	enum class FileType {
+		RAW,
+		PGM
+	};
+
+	struct HeightRange {
+		float minHeight = 0.0f;
+		float maxHeight = 1.0f;
+	};
+
+	class MappedHeightFile
+	{
+	public:
+		MappedHeightFile();
+		~MappedHeightFile();
+		MappedHeightFile(const MappedHeightFile&) = delete;
+		MappedHeightFile& operator=(const MappedHeightFile&) = delete;
+
+		bool openRaw(const std::string& path, int width, int height, SampleFormat format, bool bigEndian = false);
+		bool openPgm(const std::string& path);
+		void close();
+
+		bool readRegion(int x, int y, int regionWidth, int regionHeight, float* destination, size_t destinationStride,
+			float heightScale = 1.0f, float heightOffset = 0.0f) const;
+		float getSample(int x, int y) const;
+
+		bool isOpen() const { return data != nullptr; }
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		SampleFormat getFormat() const { return format; }
+
+	private:
+		bool map(const std::string& path);
+
+		const uint8_t* data;		//Start of the mapping
+		const uint8_t* samples;		//First sample, behind the header of the PGM
+		uint64_t mappedSize;
+		int width, height;
+		SampleFormat format;
+		bool bigEndian;
+		float maxValue;				//Value of the integer sample that is normalized to 1
+	};
+
+	HeightRange findHeightRange(const float* heightMap, const layout::MapIndexer& indexer);
+	bool exportTiles(const std::string& pathPrefix, const float* heightMap, const layout::MapIndexer& indexer, int tileSize, FileType type, HeightRange range);
+}
@@ -0,0 +1,246 @@
+#include "JobSystem.h"
+
+#include <iostream>
+
+namespace jobs {
+	//Index of the queue owned by the current thread, -1 for threads not created by the job system
+	static thread_local int workerIndex = -1;
+
+	JobSystem& JobSystem::get()
+	{
+		static JobSystem instance;
+		return instance;
+	}
+
+	JobSystem::JobSystem() : threadCount(0), queuedTasks(0), stopping(false)
+	{
+		setThreadCount(0);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		stopWorkers();
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Configuration functions
+	//--------------------------------------------------------------------------------------
+
+	//Sets the number of threads executing the tasks, the calling thread counts as one of them
+	//since it executes tasks while waiting for them, hence threadCount - 1 workers are created
+	//Workers are restarted and the change is logged only if the number of threads differs from the current one,
+	//so tests and benchmarks can call it freely
+	//@param threadCount - number of threads, 0 means std::thread::hardware_concurrency()
+	void JobSystem::setThreadCount(unsigned int threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		if (threadCount == this->threadCount)
+			return;
+
+		unsigned int previousCount = this->threadCount;
+		stopWorkers();
+		this->threadCount = threadCount;
+		startWorkers();
+
+		if (previousCount == 0)
+			std::cout << "[LOG] Job system running on " << threadCount << " threads" << std::endl;
+		else
+			std::cout << "[LOG] Job system changed from " << previousCount << " to " << threadCount << " threads" << std::endl;
+	}
+
+	void JobSystem::startWorkers()
+	{
+		stopping = false;
+		queues.clear();
+		for (unsigned int i = 0; i < threadCount; i++)
+			queues.push_back(std::make_unique<WorkerQueue>());
+
+		//Queue 0 is shared by all the threads from outside of the job system
+		for (unsigned int i = 1; i < threadCount; i++)
+			workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	void JobSystem::stopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			stopping = true;
+		}
+		sleepCondition.notify_all();
+
+		for (auto& it : workers)
+			it.join();
+		workers.clear();
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Task functions
+	//--------------------------------------------------------------------------------------
+
+	//Pushes the task on the back of the current thread's deque
+	//@param group - group the task belongs to, used to wait for it
+	//@param task - function to be executed
+	void JobSystem::submit(TaskGroup& group, std::function<void()> task)
+	{
+		group.pending.fetch_add(1);
+
+		WorkerQueue& queue = *queues[currentQueue()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ std::move(task), &group });
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			queuedTasks.fetch_add(1);
+		}
+		sleepCondition.notify_one();
+	}
+
+	//Waits until every task of the group is finished, meanwhile executes any pending tasks
+	//Rethrows the first exception thrown by a task of the group
+	//@param group - group to wait for
+	void JobSystem::wait(TaskGroup& group)
+	{
+		unsigned int self = currentQueue();
+		Task task;
+
+		while (group.pending.load() > 0) {
+			if (fetchTask(self, task))
+				runTask(task);
+			else
+				std::this_thread::yield();
+		}
+
+		std::exception_ptr exception;
+		{
+			std::lock_guard<std::mutex> lock(group.exceptionMutex);
+			std::swap(exception, group.exception);
+		}
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+
+	void JobSystem::workerLoop(unsigned int index)
+	{
+		workerIndex = static_cast<int>(index);
+		Task task;
+
+		while (true) {
+			if (fetchTask(index, task)) {
+				runTask(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleepCondition.wait(lock, [this]() { return stopping || queuedTasks.load() > 0; });
+			if (stopping && queuedTasks.load() == 0)
+				break;
+		}
+		workerIndex = -1;
+	}
+
+	//Takes the newest task from own deque, if its empty tries to steal the oldest task of another thread
+	//@param self - index of the queue owned by the calling thread
+	//@param task - output task
+	//@return true if some task was found
+	bool JobSystem::fetchTask(unsigned int self, Task& task)
+	{
+		{
+			WorkerQueue& own = *queues[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				queuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+
+		for (unsigned int i = 1; i < queues.size(); i++) {
+			WorkerQueue& victim = *queues[(self + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				queuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Exception of the task is stored in its group, otherwise the group would never be finished
+	void JobSystem::runTask(Task& task)
+	{
+		try {
+			task.func();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(task.group->exceptionMutex);
+			if (!task.group->exception)
+				task.group->exception = std::current_exception();
+		}
+		task.func = nullptr;
+		task.group->pending.fetch_sub(1);
+	}
+
+	unsigned int JobSystem::currentQueue() const
+	{
+		return workerIndex >= 0 && static_cast<unsigned int>(workerIndex) < queues.size() ? workerIndex : 0;
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Task graph functions
+	//--------------------------------------------------------------------------------------
+
+	int TaskGraph::addNode(std::function<void()> task)
+	{
+		nodes.emplace_back();
+		nodes.back().task = std::move(task);
+		return static_cast<int>(nodes.size()) - 1;
+	}
+
+	//@param before - id of the node that has to finish first
+	//@param after - id of the node waiting for it
+	void TaskGraph::addDependency(int before, int after)
+	{
+		if (before < 0 || after < 0 || before >= static_cast<int>(nodes.size()) || after >= static_cast<int>(nodes.size()) || before == after) {
+			std::cout << "[ERROR] Invalid task graph dependency" << std::endl;
+			return;
+		}
+
+		nodes[before].successors.push_back(after);
+		nodes[after].dependencies++;
+	}
+
+	void TaskGraph::run()
+	{
+		JobSystem& system = JobSystem::get();
+		TaskGroup group;
+
+		for (auto& it : nodes)
+			it.remaining.store(it.dependencies);
+
+		for (int i = 0; i < static_cast<int>(nodes.size()); i++) {
+			if (nodes[i].dependencies == 0)
+				schedule(system, group, i);
+		}
+		system.wait(group);
+	}
+
+	//Submits the node, after it is finished its successors with no more unfinished dependencies are submitted too
+	//Successors are submitted before the node's own task counts as finished, so the group never drops to zero too early
+	void TaskGraph::schedule(JobSystem& system, TaskGroup& group, int node)
+	{
+		system.submit(group, [this, &system, &group, node]() {
+			nodes[node].task();
+			for (int successor : nodes[node].successors) {
+				if (nodes[successor].remaining.fetch_sub(1) == 1)
+					schedule(system, group, successor);
+			}
+		});
+	}
+}
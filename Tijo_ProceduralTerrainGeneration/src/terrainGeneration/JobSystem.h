@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Process-wide work-stealing job system shared by all generation stages
+//Every thread owns a deque of tasks, it takes work from the back of its own deque and when it runs out
+//of work it steals from the front of the other deques. Thread waiting for a group of tasks does not block,
+//it helps executing pending tasks instead, thanks to that nested parallel_for calls can not deadlock.
+//
+//Determinism: parallel_for splits the range into tiles based only on the grain size, never on the thread count,
+//so as long as every invocation of the body writes only its own cells, the result is identical for any thread count.
+
+namespace jobs {
+	//Counter of the unfinished tasks submitted as one group
+	//First exception thrown by a task of the group is kept and rethrown by JobSystem::wait
+	struct TaskGroup {
+		std::atomic<int> pending{ 0 };
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+	};
+
+	class JobSystem
+	{
+	public:
+		//Returns the process-wide instance, on the first call it is started with hardware_concurrency threads
+		static JobSystem& get();
+
+		//Changes number of threads executing the tasks (including the calling thread)
+		//Must not be called while any task is in flight
+		//@param threadCount - number of threads, 0 means std::thread::hardware_concurrency()
+		void setThreadCount(unsigned int threadCount);
+		unsigned int getThreadCount() const { return threadCount; }
+
+		//Task submission
+		//Task that throws still counts as finished, wait rethrows the first exception of the group
+		//after all of its tasks are done
+		void submit(TaskGroup& group, std::function<void()> task);
+		void wait(TaskGroup& group);
+
+		//Calls func(i) for every i in [begin, end), range is divided into tiles of grain elements
+		template<typename Func>
+		void parallel_for(int begin, int end, int grain, Func&& func);
+
+		//Calls func(x, y) for every cell of the width x height range, range is divided into grainX x grainY tiles
+		//Tiles are executed in parallel, cells inside of one tile are visited row by row
+		template<typename Func>
+		void parallel_for2D(int width, int height, int grainX, int grainY, Func&& func);
+
+	private:
+		struct Task {
+			std::function<void()> func;
+			TaskGroup* group;
+		};
+
+		struct WorkerQueue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		JobSystem();
+		~JobSystem();
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		void startWorkers();
+		void stopWorkers();
+		void workerLoop(unsigned int index);
+		bool fetchTask(unsigned int self, Task& task);
+		void runTask(Task& task);
+		unsigned int currentQueue() const;
+
+		unsigned int threadCount;
+		std::vector<std::thread> workers;
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+		std::atomic<int> queuedTasks;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		bool stopping;
+	};
+
+	//Graph of tasks with dependencies between them, every node is handed to the job system as soon
+	//as all of the nodes it depends on are finished, so independent parts of the graph overlap
+	//Graph can be run many times, but must not be modified while it is running
+	class TaskGraph
+	{
+	public:
+		//Adds the node to the graph
+		//@param task - function executed by the node
+		//@return int - id of the node used to declare dependencies
+		int addNode(std::function<void()> task);
+
+		//Declares that node after can not start before node before is finished
+		void addDependency(int before, int after);
+
+		//Executes the whole graph and returns when every node is finished
+		//Calling thread executes the tasks meanwhile
+		//If a node throws, its successors are skipped and the exception is rethrown once the rest is finished
+		void run();
+
+		size_t size() const { return nodes.size(); }
+
+	private:
+		struct Node {
+			std::function<void()> task;
+			std::vector<int> successors;
+			int dependencies = 0;
+			std::atomic<int> remaining{ 0 };
+		};
+
+		void schedule(JobSystem& system, TaskGroup& group, int node);
+
+		//Deque keeps the addresses of the nodes stable, atomics can not be moved
+		std::deque<Node> nodes;
+	};
+
+	template<typename Func>
+	void JobSystem::parallel_for(int begin, int end, int grain, Func&& func)
+	{
+		if (end <= begin)
+			return;
+		if (grain <= 0)
+			grain = 1;
+
+		//Nothing to share, run the body inline without the overhead of the tasks
+		if (threadCount <= 1 || end - begin <= grain) {
+			for (int i = begin; i < end; i++)
+				func(i);
+			return;
+		}
+
+		TaskGroup group;
+		for (int tileBegin = begin; tileBegin < end; tileBegin += grain) {
+			int tileEnd = std::min(tileBegin + grain, end);
+			submit(group, [&func, tileBegin, tileEnd]() {
+				for (int i = tileBegin; i < tileEnd; i++)
+					func(i);
+			});
+		}
+		wait(group);
+	}
+
+	template<typename Func>
+	void JobSystem::parallel_for2D(int width, int height, int grainX, int grainY, Func&& func)
+	{
+		if (width <= 0 || height <= 0)
+			return;
+		if (grainX <= 0)
+			grainX = 1;
+		if (grainY <= 0)
+			grainY = 1;
+
+		if (threadCount <= 1 || (width <= grainX && height <= grainY)) {
+			for (int y = 0; y < height; y++)
+				for (int x = 0; x < width; x++)
+					func(x, y);
+			return;
+		}
+
+		TaskGroup group;
+		for (int tileY = 0; tileY < height; tileY += grainY) {
+			for (int tileX = 0; tileX < width; tileX += grainX) {
+				int x1 = std::min(tileX + grainX, width);
+				int y1 = std::min(tileY + grainY, height);
+				submit(group, [&func, tileX, tileY, x1, y1]() {
+					for (int y = tileY; y < y1; y++)
+						for (int x = tileX; x < x1; x++)
+							func(x, y);
+				});
+			}
+		}
+		wait(group);
+	}
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+
+//Memory layouts of the maps of the samples (heights, biomes, noises)
+//Every field of the map is kept in its own array, the layout only decides the order of the samples inside of it.
+//Row-major maps are indexed as y * width * chunkWidth + x, so one chunk is spread over chunkHeight distant rows.
+//Chunk-major maps store every chunk as one contiguous block, rows of the chunk one after another, and every block
+//starts at MAP_ALIGNMENT bytes, so a chunk can be processed sequentially or handed off as a single block.
+//In both layouts one row of the chunk is contiguous, so chunk loops can take the index of the row start once.
+
+namespace layout
+{
+	enum class MapLayout {
+		ROW_MAJOR,
+		CHUNK_MAJOR
+	};
+
+	constexpr size_t MAP_ALIGNMENT = 64;
+
+	//Translates global coordinates of the sample into its position in the array of the given layout
+	//Samples are assumed to be 4 bytes wide (float, int), blocks of the chunks are padded to MAP_ALIGNMENT with that size
+	struct MapIndexer {
+		MapLayout layout;
+		int width, height;				//Size of the map in chunks
+		int chunkWidth, chunkHeight;	//Size of the chunk in samples
+		size_t chunkStride;				//Number of samples between the starts of the neighbouring chunk blocks
+
+		MapIndexer() : layout(MapLayout::ROW_MAJOR), width(0), height(0), chunkWidth(1), chunkHeight(1), chunkStride(1) {}
+		MapIndexer(MapLayout layout, int width, int height, int chunkWidth, int chunkHeight)
+			: layout(layout), width(width), height(height), chunkWidth(chunkWidth), chunkHeight(chunkHeight)
+		{
+			const size_t padding = MAP_ALIGNMENT / sizeof(float);
+			chunkStride = (static_cast<size_t>(chunkWidth) * chunkHeight + padding - 1) / padding * padding;
+		}
+
+		//Number of samples that have to be allocated for the whole map
+		size_t size() const {
+			if (layout == MapLayout::ROW_MAJOR)
+				return static_cast<size_t>(width) * chunkWidth * height * chunkHeight;
+			return static_cast<size_t>(width) * height * chunkStride;
+		}
+
+		size_t index(int x, int y) const {
+			if (layout == MapLayout::ROW_MAJOR)
+				return static_cast<size_t>(y) * width * chunkWidth + x;
+
+			int chunkX = x / chunkWidth;
+			int chunkY = y / chunkHeight;
+			return chunkOffset(chunkX, chunkY) + static_cast<size_t>(y - chunkY * chunkHeight) * chunkWidth + (x - chunkX * chunkWidth);
+		}
+
+		//Index of the first sample of the chunk
+		size_t chunkOffset(int chunkX, int chunkY) const {
+			if (layout == MapLayout::ROW_MAJOR)
+				return index(chunkX * chunkWidth, chunkY * chunkHeight);
+			return static_cast<size_t>(chunkY * width + chunkX) * chunkStride;
+		}
+	};
+
+	//Allocation of the map arrays aligned to MAP_ALIGNMENT, arrays have to be released with releaseMap
+	//Samples are zeroed, so the map not generated yet reads as the flat terrain
+	template<typename T>
+	T* allocateMap(size_t count)
+	{
+		T* map = static_cast<T*>(::operator new[](count * sizeof(T), std::align_val_t(MAP_ALIGNMENT)));
+		std::fill_n(map, count, T());
+		return map;
+	}
+
+	template<typename T>
+	void releaseMap(T* map)
+	{
+		if (map)
+			::operator delete[](map, std::align_val_t(MAP_ALIGNMENT));
+	}
+
+	//Copies the map between two layouts, both indexers have to describe the map of the same size
+	//Rows of the chunks are contiguous in every layout, so they are copied as whole runs
+	//
+	//@param source - map to be copied
+	//@param sourceIndexer - layout of the source
+	//@param destination - output map, allocated for destinationIndexer.size() samples
+	//@param destinationIndexer - layout of the destination
+	//@return bool - false if the sizes of the maps differ
+	template<typename T>
+	bool convertLayout(const T* source, const MapIndexer& sourceIndexer, T* destination, const MapIndexer& destinationIndexer)
+	{
+		if (!source || !destination || sourceIndexer.width != destinationIndexer.width || sourceIndexer.height != destinationIndexer.height ||
+			sourceIndexer.chunkWidth != destinationIndexer.chunkWidth || sourceIndexer.chunkHeight != destinationIndexer.chunkHeight)
+			return false;
+
+		for (int y = 0; y < sourceIndexer.height * sourceIndexer.chunkHeight; y++) {
+			for (int chunkX = 0; chunkX < sourceIndexer.width; chunkX++) {
+				int x = chunkX * sourceIndexer.chunkWidth;
+				const T* row = source + sourceIndexer.index(x, y);
+				std::copy(row, row + sourceIndexer.chunkWidth, destination + destinationIndexer.index(x, y));
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,456 @@
+#include "MeshExport.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "JobSystem.h"
+
+namespace exporter
+{
+	//Vertex as stored in the glb and ply files, 32 bytes without padding
+	struct GridVertex {
+		float position[3];
+		float normal[3];
+		float texCoord[2];
+	};
+
+	//Height map read band by band, with the access to the samples clamped to its borders
+	//Band holds its rows and one row above and below, so the normals of its vertices can be computed
+	struct HeightGrid {
+		//Copies rowCount full rows from the row y0 into rows, row after row
+		using RowReader = std::function<bool(int y0, int rowCount, float* rows)>;
+
+		RowReader readRows;
+		int width, height;
+		int rowsPerBand;
+		std::vector<float> band;
+		int bandY0 = 0;
+
+		HeightGrid(RowReader readRows, int width, int height, int rowsPerBand) : readRows(std::move(readRows)),
+			width(width), height(height), rowsPerBand(std::max(rowsPerBand, 1)) {}
+
+		bool valid() const { return readRows && width > 1 && height > 1; }
+
+		//Loads the rows [y0, y1) with the rows around them
+		bool loadBand(int y0, int y1) {
+			bandY0 = std::max(y0 - 1, 0);
+			int rowCount = std::min(y1 + 1, height) - bandY0;
+			band.resize(static_cast<size_t>(rowCount) * width);
+			return readRows(bandY0, rowCount, band.data());
+		}
+
+		float at(int x, int y) const {
+			return band[static_cast<size_t>(std::clamp(y, 0, height - 1) - bandY0) * width + std::clamp(x, 0, width - 1)];
+		}
+
+		uint64_t vertexCount() const { return static_cast<uint64_t>(width) * height; }
+		uint64_t triangleCount() const { return static_cast<uint64_t>(width - 1) * (height - 1) * 2; }
+		//Rows of the band, bounds the memory used by the export
+		int bandHeight() const { return rowsPerBand; }
+	};
+
+	//Grid over the height map in memory, band is one row of the chunks
+	static HeightGrid makeGrid(const float* heightMap, const layout::MapIndexer& indexer)
+	{
+		int width = indexer.width * indexer.chunkWidth;
+		HeightGrid::RowReader reader;
+		if (heightMap) {
+			reader = [heightMap, indexer, width](int y0, int rowCount, float* rows) {
+				jobs::JobSystem::get().parallel_for(y0, y0 + rowCount, 1, [heightMap, &indexer, width, y0, rows](int y) {
+					//Row of the chunk is contiguous in every layout
+					for (int chunkX = 0; chunkX < indexer.width; chunkX++)
+						std::copy_n(heightMap + indexer.index(chunkX * indexer.chunkWidth, y), indexer.chunkWidth,
+							rows + static_cast<size_t>(y - y0) * width + chunkX * indexer.chunkWidth);
+				});
+				return true;
+			};
+		}
+		return HeightGrid(std::move(reader), width, indexer.height * indexer.chunkHeight, indexer.chunkHeight);
+	}
+
+	//Grid over the paged map, band is one row of the tiles, so every tile is read from the file once
+	static HeightGrid makeGrid(paging::PagedMap& heights)
+	{
+		HeightGrid::RowReader reader;
+		if (heights.isOpen() && heights.getChannels() == 1) {
+			reader = [&heights](int y0, int rowCount, float* rows) {
+				return heights.readWindow(0, y0, heights.getWidth(), rowCount, rows);
+			};
+		}
+		return HeightGrid(std::move(reader), heights.getWidth(), heights.getHeight(), heights.getTileSize());
+	}
+
+	static GridVertex makeVertex(const HeightGrid& grid, int x, int y, float scalingFactor)
+	{
+		GridVertex vertex;
+		vertex.position[0] = x * scalingFactor;
+		vertex.position[1] = grid.at(x, y) * scalingFactor;
+		vertex.position[2] = y * scalingFactor;
+
+		//Both the distance of the samples and the heights are scaled by scalingFactor, so the slope doesnt change
+		int left = std::max(x - 1, 0), right = std::min(x + 1, grid.width - 1);
+		int top = std::max(y - 1, 0), bottom = std::min(y + 1, grid.height - 1);
+		float dx = (grid.at(right, y) - grid.at(left, y)) / (right - left);
+		float dz = (grid.at(x, bottom) - grid.at(x, top)) / (bottom - top);
+		float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+		vertex.normal[0] = -dx / length;
+		vertex.normal[1] = 1.0f / length;
+		vertex.normal[2] = -dz / length;
+
+		vertex.texCoord[0] = x / static_cast<float>(grid.width - 1);
+		vertex.texCoord[1] = y / static_cast<float>(grid.height - 1);
+		return vertex;
+	}
+
+	//Vertices of the rows [y0, y1) of the grid
+	static void buildVertices(const HeightGrid& grid, int y0, int y1, float scalingFactor, std::vector<GridVertex>& vertices)
+	{
+		vertices.resize(static_cast<size_t>(y1 - y0) * grid.width);
+		jobs::JobSystem::get().parallel_for(y0, y1, 1, [&grid, &vertices, y0, scalingFactor](int y) {
+			GridVertex* row = vertices.data() + static_cast<size_t>(y - y0) * grid.width;
+			for (int x = 0; x < grid.width; x++)
+				row[x] = makeVertex(grid, x, y, scalingFactor);
+		});
+	}
+
+	//Triangles of the cells in the rows [y0, y1), indexed into the vertices of the whole grid
+	//{a, c, b} and {a, d, c} are counter-clockwise when looked at from above, so their normals point up
+	static void buildTriangles(const HeightGrid& grid, int y0, int y1, std::vector<uint32_t>& indices)
+	{
+		indices.resize(static_cast<size_t>(y1 - y0) * (grid.width - 1) * 6);
+		jobs::JobSystem::get().parallel_for(y0, y1, 1, [&grid, &indices, y0](int y) {
+			uint32_t* out = indices.data() + static_cast<size_t>(y - y0) * (grid.width - 1) * 6;
+			for (int x = 0; x < grid.width - 1; x++, out += 6) {
+				uint32_t a = static_cast<uint32_t>(y) * grid.width + x;
+				uint32_t b = a + 1, c = a + grid.width + 1, d = a + grid.width;
+				out[0] = a; out[1] = c; out[2] = b;
+				out[3] = a; out[4] = d; out[5] = c;
+			}
+		});
+	}
+
+	template<typename T>
+	static bool writeArray(std::ofstream& file, const std::vector<T>& data)
+	{
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+		return file.good();
+	}
+
+	static bool writeVertexBands(std::ofstream& file, HeightGrid& grid, float scalingFactor)
+	{
+		std::vector<GridVertex> vertices;
+		for (int y0 = 0; y0 < grid.height; y0 += grid.bandHeight()) {
+			int y1 = std::min(y0 + grid.bandHeight(), grid.height);
+			if (!grid.loadBand(y0, y1))
+				return false;
+			buildVertices(grid, y0, y1, scalingFactor, vertices);
+			if (!writeArray(file, vertices))
+				return false;
+		}
+		return true;
+	}
+
+	static void appendFloat(std::string& text, float value)
+	{
+		char buffer[32];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		text.append(buffer, result.ptr);
+	}
+
+	static void appendIndex(std::string& text, uint64_t value)
+	{
+		char buffer[24];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		text.append(buffer, result.ptr);
+	}
+
+	static bool heightRange(HeightGrid& grid, float& minHeight, float& maxHeight)
+	{
+		for (int y0 = 0; y0 < grid.height; y0 += grid.bandHeight()) {
+			int y1 = std::min(y0 + grid.bandHeight(), grid.height);
+			if (!grid.loadBand(y0, y1))
+				return false;
+			if (y0 == 0)
+				minHeight = maxHeight = grid.at(0, 0);
+			const float* rows = grid.band.data() + static_cast<size_t>(y0 - grid.bandY0) * grid.width;
+			auto [bandMin, bandMax] = std::minmax_element(rows, rows + static_cast<size_t>(y1 - y0) * grid.width);
+			minHeight = std::min(minHeight, *bandMin);
+			maxHeight = std::max(maxHeight, *bandMax);
+		}
+		return true;
+	}
+
+	//Writes the terrain as the binary glTF 2.0 file with one mesh of one primitive
+	//
+	//@param path - path of the output file
+	//@param grid - height map read band by band
+	//@param scalingFactor - scale of the positions, applied to the heights and to the distance of the samples
+	//@return bool - false if the map is empty, doesnt fit into the glb limits or the file couldnt be written
+	static bool writeGlb(const std::string& path, HeightGrid& grid, float scalingFactor)
+	{
+		if (!grid.valid()) {
+			std::cout << "[ERROR] HeightMap not initialized" << std::endl;
+			return false;
+		}
+
+		uint64_t vertexCount = grid.vertexCount();
+		uint64_t indexCount = grid.triangleCount() * 3;
+		uint64_t vertexBytes = vertexCount * sizeof(GridVertex);
+		uint64_t indexBytes = indexCount * sizeof(uint32_t);
+
+		float minHeight = 0.0f, maxHeight = 0.0f;
+		if (!heightRange(grid, minHeight, maxHeight)) {
+			std::cout << "[ERROR] HeightMap couldnt be read" << std::endl;
+			return false;
+		}
+		float extent[2][3] = {
+			{ 0.0f, std::min(minHeight, maxHeight) * scalingFactor, 0.0f },
+			{ (grid.width - 1) * scalingFactor, std::max(minHeight, maxHeight) * scalingFactor, (grid.height - 1) * scalingFactor }
+		};
+		if (scalingFactor < 0.0f) {
+			std::swap(extent[0][0], extent[1][0]);
+			std::swap(extent[0][1], extent[1][1]);
+			std::swap(extent[0][2], extent[1][2]);
+		}
+
+		std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"Tijo_ProceduralTerrainGeneration\"},"
+			"\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0,\"name\":\"terrain\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3,\"mode\":4}]}],";
+		json += "\"buffers\":[{\"byteLength\":" + std::to_string(vertexBytes + indexBytes) + "}],";
+		json += "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(vertexBytes) +
+			",\"byteStride\":" + std::to_string(sizeof(GridVertex)) + ",\"target\":34962},";
+		json += "{\"buffer\":0,\"byteOffset\":" + std::to_string(vertexBytes) + ",\"byteLength\":" + std::to_string(indexBytes) + ",\"target\":34963}],";
+		json += "\"accessors\":[{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC3\",\"min\":[";
+		for (int i = 0; i < 3; i++) {
+			appendFloat(json, extent[0][i]);
+			json += i < 2 ? "," : "],\"max\":[";
+		}
+		for (int i = 0; i < 3; i++) {
+			appendFloat(json, extent[1][i]);
+			json += i < 2 ? "," : "]},";
+		}
+		json += "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC3\"},";
+		json += "{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":" + std::to_string(vertexCount) + ",\"type\":\"VEC2\"},";
+		json += "{\"bufferView\":1,\"componentType\":5125,\"count\":" + std::to_string(indexCount) + ",\"type\":\"SCALAR\"}]}";
+		//Chunks of the glb are aligned to 4 bytes, json is padded with spaces
+		json.append((4 - json.size() % 4) % 4, ' ');
+
+		uint64_t totalBytes = 12 + 8 + json.size() + 8 + vertexBytes + indexBytes;
+		if (vertexCount > UINT32_MAX || totalBytes > UINT32_MAX) {
+			std::cout << "[ERROR] Terrain is too large for the glb file, export it as ply" << std::endl;
+			return false;
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "[ERROR] File " << path << " couldnt be opened" << std::endl;
+			return false;
+		}
+
+		uint32_t header[3] = { 0x46546C67u, 2, static_cast<uint32_t>(totalBytes) };
+		uint32_t jsonChunk[2] = { static_cast<uint32_t>(json.size()), 0x4E4F534Au };
+		uint32_t binaryChunk[2] = { static_cast<uint32_t>(vertexBytes + indexBytes), 0x004E4942u };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk));
+		file.write(json.data(), json.size());
+		file.write(reinterpret_cast<const char*>(binaryChunk), sizeof(binaryChunk));
+
+		bool written = writeVertexBands(file, grid, scalingFactor);
+		std::vector<uint32_t> indices;
+		for (int y0 = 0; y0 < grid.height - 1 && written; y0 += grid.bandHeight()) {
+			buildTriangles(grid, y0, std::min(y0 + grid.bandHeight(), grid.height - 1), indices);
+			written = writeArray(file, indices);
+		}
+
+		if (!written) {
+			std::cout << "[ERROR] Terrain couldnt be written to " << path << std::endl;
+			return false;
+		}
+		std::cout << "[LOG] Terrain exported to " << path << std::endl;
+		return true;
+	}
+
+	//Writes the terrain as the binary little-endian PLY file, vertices with normals and texture coordinates
+	//
+	//@param path - path of the output file
+	//@param grid - height map read band by band
+	//@param scalingFactor - scale of the positions, applied to the heights and to the distance of the samples
+	//@return bool - false if the map is empty or the file couldnt be written
+	static bool writePly(const std::string& path, HeightGrid& grid, float scalingFactor)
+	{
+		if (!grid.valid()) {
+			std::cout << "[ERROR] HeightMap not initialized" << std::endl;
+			return false;
+		}
+		if (grid.vertexCount() > UINT32_MAX) {
+			std::cout << "[ERROR] Terrain has too many vertices for 32 bit indices" << std::endl;
+			return false;
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "[ERROR] File " << path << " couldnt be opened" << std::endl;
+			return false;
+		}
+
+		std::string header = "ply\nformat binary_little_endian 1.0\ncomment Tijo_ProceduralTerrainGeneration\n";
+		header += "element vertex " + std::to_string(grid.vertexCount()) + "\n";
+		header += "property float x\nproperty float y\nproperty float z\n";
+		header += "property float nx\nproperty float ny\nproperty float nz\n";
+		header += "property float s\nproperty float t\n";
+		header += "element face " + std::to_string(grid.triangleCount()) + "\n";
+		header += "property list uchar uint vertex_indices\nend_header\n";
+		file.write(header.data(), header.size());
+
+		bool written = writeVertexBands(file, grid, scalingFactor);
+
+		//Face is the count followed by three indices, 13 bytes without any padding
+		std::vector<uint32_t> indices;
+		std::vector<uint8_t> faces;
+		for (int y0 = 0; y0 < grid.height - 1 && written; y0 += grid.bandHeight()) {
+			buildTriangles(grid, y0, std::min(y0 + grid.bandHeight(), grid.height - 1), indices);
+			faces.resize(indices.size() / 3 * 13);
+			jobs::JobSystem::get().parallel_for(0, static_cast<int>(indices.size() / 3), 4096, [&indices, &faces](int i) {
+				faces[i * 13] = 3;
+				std::memcpy(faces.data() + i * 13 + 1, indices.data() + i * 3, 3 * sizeof(uint32_t));
+			});
+			written = writeArray(file, faces);
+		}
+
+		if (!written) {
+			std::cout << "[ERROR] Terrain couldnt be written to " << path << std::endl;
+			return false;
+		}
+		std::cout << "[LOG] Terrain exported to " << path << std::endl;
+		return true;
+	}
+
+	//Writes the terrain as the text OBJ file, position, texture coordinates and normal of the vertex share the index
+	//Text of every row is formatted by its own job, rows of the band are written in order
+	//
+	//@param path - path of the output file
+	//@param grid - height map read band by band
+	//@param scalingFactor - scale of the positions, applied to the heights and to the distance of the samples
+	//@return bool - false if the map is empty or the file couldnt be written
+	static bool writeObj(const std::string& path, HeightGrid& grid, float scalingFactor)
+	{
+		if (!grid.valid()) {
+			std::cout << "[ERROR] HeightMap not initialized" << std::endl;
+			return false;
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "[ERROR] File " << path << " couldnt be opened" << std::endl;
+			return false;
+		}
+		file << "# Tijo_ProceduralTerrainGeneration\n";
+
+		std::vector<std::string> rows(grid.bandHeight());
+		bool written = file.good();
+		for (int y0 = 0; y0 < grid.height && written; y0 += grid.bandHeight()) {
+			int y1 = std::min(y0 + grid.bandHeight(), grid.height);
+			if (!grid.loadBand(y0, y1)) {
+				written = false;
+				break;
+			}
+
+			jobs::JobSystem::get().parallel_for(y0, y1, 1, [&grid, &rows, y0, scalingFactor](int y) {
+				std::string& text = rows[y - y0];
+				text.clear();
+				for (int x = 0; x < grid.width; x++) {
+					GridVertex vertex = makeVertex(grid, x, y, scalingFactor);
+					text += "v ";
+					appendFloat(text, vertex.position[0]); text += ' ';
+					appendFloat(text, vertex.position[1]); text += ' ';
+					appendFloat(text, vertex.position[2]);
+					text += "\nvt ";
+					appendFloat(text, vertex.texCoord[0]); text += ' ';
+					appendFloat(text, vertex.texCoord[1]);
+					text += "\nvn ";
+					appendFloat(text, vertex.normal[0]); text += ' ';
+					appendFloat(text, vertex.normal[1]); text += ' ';
+					appendFloat(text, vertex.normal[2]);
+					text += '\n';
+				}
+			});
+			for (int y = y0; y < y1; y++)
+				file.write(rows[y - y0].data(), rows[y - y0].size());
+
+			//Cells whose both rows of vertices are written already, indices of OBJ start at 1
+			int cellY0 = std::max(y0 - 1, 0), cellY1 = y1 - 1;
+			jobs::JobSystem::get().parallel_for(cellY0, cellY1, 1, [&grid, &rows, cellY0](int y) {
+				std::string& text = rows[y - cellY0];
+				text.clear();
+				for (int x = 0; x < grid.width - 1; x++) {
+					uint64_t a = static_cast<uint64_t>(y) * grid.width + x + 1;
+					uint64_t triangles[2][3] = { { a, a + grid.width + 1, a + 1 }, { a, a + grid.width, a + grid.width + 1 } };
+					for (auto& triangle : triangles) {
+						text += 'f';
+						for (uint64_t index : triangle) {
+							text += ' ';
+							appendIndex(text, index); text += '/';
+							appendIndex(text, index); text += '/';
+							appendIndex(text, index);
+						}
+						text += '\n';
+					}
+				}
+			});
+			for (int y = cellY0; y < cellY1; y++)
+				file.write(rows[y - cellY0].data(), rows[y - cellY0].size());
+			written = file.good();
+		}
+
+		if (!written) {
+			std::cout << "[ERROR] Terrain couldnt be written to " << path << std::endl;
+			return false;
+		}
+		std::cout << "[LOG] Terrain exported to " << path << std::endl;
+		return true;
+	}
+
+	bool exportGlb(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heightMap, indexer);
+		return writeGlb(path, grid, scalingFactor);
+	}
+
+	bool exportPly(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heightMap, indexer);
+		return writePly(path, grid, scalingFactor);
+	}
+
+	bool exportObj(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heightMap, indexer);
+		return writeObj(path, grid, scalingFactor);
+	}
+
+	//Paged maps are read one row of the tiles at a time, so only the band of the terrain is ever in memory
+	bool exportGlb(const std::string& path, paging::PagedMap& heights, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heights);
+		return writeGlb(path, grid, scalingFactor);
+	}
+
+	bool exportPly(const std::string& path, paging::PagedMap& heights, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heights);
+		return writePly(path, grid, scalingFactor);
+	}
+
+	bool exportObj(const std::string& path, paging::PagedMap& heights, float scalingFactor)
+	{
+		HeightGrid grid = makeGrid(heights);
+		return writeObj(path, grid, scalingFactor);
+	}
+}
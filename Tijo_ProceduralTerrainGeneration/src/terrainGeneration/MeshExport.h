@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "MapLayout.h"
+#include "PagedMap.h"
+
+//Export of the terrain mesh built straight from the height map
+//
+//Mesh is the regular grid of the map, one vertex per sample (position, normal, texture coordinates over the whole map)
+//and two triangles per cell, counter-clockwise when looked at from above. Normals are central differences of the heights.
+//
+//Files are written band by band, one band is one row of chunks: vertices (or indices) of the band are built in parallel
+//by the job system into the buffer and written with a single call, so the memory used doesnt depend on the size
+//of the map and no mesh has to be built beforehand. Paged maps larger than the memory are exported the same way,
+//band is one row of the tiles.
+//
+//glb	- binary glTF 2.0, interleaved vertex buffer and 32 bit indices, limited to 4 GB by the format
+//ply	- binary little-endian PLY, no size limit
+//obj	- text OBJ, numbers formatted with std::to_chars in parallel, faces indexed from 1
+
+namespace exporter
+{
+	bool exportGlb(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor = 1.0f);
+	bool exportPly(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor = 1.0f);
+	bool exportObj(const std::string& path, const float* heightMap, const layout::MapIndexer& indexer, float scalingFactor = 1.0f);
+
+	bool exportGlb(const std::string& path, paging::PagedMap& heights, float scalingFactor = 1.0f);
+	bool exportPly(const std::string& path, paging::PagedMap& heights, float scalingFactor = 1.0f);
+	bool exportObj(const std::string& path, paging::PagedMap& heights, float scalingFactor = 1.0f);
+}
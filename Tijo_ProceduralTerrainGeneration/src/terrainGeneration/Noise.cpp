@@ -4,30 +4,35 @@
 #include <iostream>
 
 #include <algorithm>
+#include <numbers>
 #include <random>
 
 #include "SimplexNoise.h"
+#include "JobSystem.h"
 
 #define PI 3.14159265
 
 namespace noise
 {
 	SimplexNoiseClass::SimplexNoiseClass()
-		: config(NoiseConfigParameters()), width(1), height(1),
-		heightMap(nullptr), chunkWidth(1), chunkHeight(1)
+		: config(NoiseConfigParameters()), permutationSeed(0), heightMap(nullptr), width(1), height(1),
+		chunkWidth(1), chunkHeight(1), originX(0), originY(0), worldWidth(0), worldHeight(0),
+		mapLayout(layout::MapLayout::ROW_MAJOR), indexer()
 	{
+		SimplexNoise::shuffle(permutationSeed, permutation);
 	}
 	SimplexNoiseClass::~SimplexNoiseClass()
 	{
-		delete[] heightMap;
+		layout::releaseMap(heightMap);
 	}
 
-	//Initializes the height map based on the width and height of the map
+	//Initializes the height map based on the width and height of the map, samples are ordered by the layout of the noise
 	void SimplexNoiseClass::initMap()
 	{
 		if (width > 0 && height > 0) {
-			delete[] heightMap;
-			heightMap = new float[width * chunkWidth * height * chunkHeight];
+			layout::releaseMap(heightMap);
+			indexer = layout::MapIndexer(mapLayout, width, height, chunkWidth, chunkHeight);
+			heightMap = layout::allocateMap<float>(indexer.size());
 		}
 		else {
 			std::cout << "[ERROR] Map size must be greater than 0" << std::endl;
@@ -35,13 +40,14 @@ namespace noise
 	}
 
 	//Sets the seed of the noise, if the seed is different than the current seed
-	//Seeding in this case is performed by shuffling permutation table of the simplex noise
+	//Seeding in this case is performed by shuffling the permutation table owned by this noise
 	//
 	//@param seed - seed of the noise
 	void SimplexNoiseClass::setSeed(int seed) {
-		if (seed != this->config.seed) {
-			this->config.seed = seed;
-			SimplexNoise::reseed(seed);
+		this->config.seed = seed;
+		if (seed != permutationSeed) {
+			permutationSeed = seed;
+			SimplexNoise::shuffle(seed, permutation);
 		}
 	}
 
@@ -93,12 +99,44 @@ namespace noise
 	void SimplexNoiseClass::setConfig(NoiseConfigParameters config)
 	{
 		this->config = config;
-		if (config.seed != this->config.seed)
-			setSeed(config.seed);
+		setSeed(config.seed);
+	}
+
+	//Sets the order of the samples in the map, already generated map is converted to the new layout
+	//
+	//@param mapLayout - row-major or chunk-major layout
+	void SimplexNoiseClass::setLayout(layout::MapLayout mapLayout)
+	{
+		if (mapLayout == this->mapLayout)
+			return;
+
+		this->mapLayout = mapLayout;
+		if (heightMap) {
+			layout::MapIndexer converted(mapLayout, indexer.width, indexer.height, indexer.chunkWidth, indexer.chunkHeight);
+			float* map = layout::allocateMap<float>(converted.size());
+			layout::convertLayout(heightMap, indexer, map, converted);
+			layout::releaseMap(heightMap);
+			heightMap = map;
+			indexer = converted;
+		}
+	}
+
+	//Places the map into the larger world, e.g. when the world is generated as the shards by separate processes
+	//Chunks of the map are sampled at their world coordinates and the island is shaped by the size of the world
+	//
+	//@param originX, originY - world coordinates of the first chunk of the map
+	//@param worldWidth, worldHeight - size of the world in chunks, 0 means the world is the map itself
+	void SimplexNoiseClass::setWorldRegion(int originX, int originY, unsigned int worldWidth, unsigned int worldHeight)
+	{
+		this->originX = originX;
+		this->originY = originY;
+		this->worldWidth = worldWidth;
+		this->worldHeight = worldHeight;
 	}
 
 	//Function generating simplex noise based on the configuration parameters and also
 	//Divided into chunks which can be generated by its own configuration
+	//Chunks are independent of each other so they are generated in parallel by the job system
 	//
 	//@return float* - 2D height map of the noise
 	bool SimplexNoiseClass::generateFractalNoiseByChunks() {
@@ -106,81 +144,103 @@ namespace noise
 			std::cout << "[ERROR] Height map not initialized" << std::endl;
 			return false;
 		}
+		//Seed could have been changed through the config reference
+		setSeed(config.seed);
+
+		jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this](int chunkX, int chunkY) {
+			generateFractalNoiseChunk(chunkX, chunkY);
+		});
+
+		std::cout << "[LOG] Noise successfully generated" << std::endl;
+		return true;
+	}
+
+	//Function generating simplex noise of the single chunk of the map
+	//
+	//@param chunkX - x coordinate of the chunk
+	//@param chunkY - y coordinate of the chunk
+	//@return bool - false if the map is not initialized or the chunk is outside of the map
+	bool SimplexNoiseClass::generateFractalNoiseChunk(int chunkX, int chunkY) {
+		if (heightMap == nullptr || chunkX < 0 || chunkY < 0 || chunkX >= static_cast<int>(width) || chunkY >= static_cast<int>(height))
+			return false;
 
 		float amplitude;
 		float frequency;
 		float elevation;
 		float divider;
 		glm::vec2 vec = glm::vec2(0.0f, 0.0f);
+		//World coordinates of the chunk, the result depends only on them and never on the part of the world the map covers
+		int worldChunkX = originX + chunkX;
+		int worldChunkY = originY + chunkY;
+		float islandWidth = static_cast<float>((worldWidth > 0 ? worldWidth : width) * chunkWidth);
+		float islandHeight = static_cast<float>((worldHeight > 0 ? worldHeight : height) * chunkHeight);
 
-		//Generating noise chunk by chunk, [y,x] are the width and height sizes of each singular chunk
+		//[y,x] are the width and height sizes of each singular chunk
 		//[ChunkT, ChunkX] are the chunks counts on the x and y axis, adjusted by the scaling factor
 		//To apply correct offset to each chunk
-		for (int chunkY = 0; chunkY < height; chunkY++) {
-			for (int chunkX = 0; chunkX < width; chunkX++){
-				for (int y = 0; y < chunkHeight; y++) {
-					for (int x = 0; x < chunkWidth; x++) {
-						divider = 0.0f;
-						amplitude = 1.0f;
-						frequency = 1.0f;
-						elevation = 0.0f;
+		for (unsigned int y = 0; y < chunkHeight; y++) {
+			float* row = heightMap + indexer.index(chunkX * chunkWidth, chunkY * chunkHeight + y);
+			for (unsigned int x = 0; x < chunkWidth; x++) {
+				divider = 0.0f;
+				amplitude = 1.0f;
+				frequency = 1.0f;
+				elevation = 0.0f;
+
+				for (int i = 0; i < config.octaves; i++)
+				{
+					vec.x = frequency * ((worldChunkX * config.scale) + (x / float(chunkWidth) * config.scale));
+					vec.y = frequency * ((worldChunkY * config.scale) + (y / float(chunkHeight) * config.scale));
 
-						for (int i = 0; i < config.octaves; i++)
-						{
-							vec.x = frequency * ((chunkX * config.scale) + (x / float(chunkWidth) * config.scale));
-							vec.y = frequency * ((chunkY * config.scale) + (y / float(chunkHeight) * config.scale));
-
-							elevation += SimplexNoise::noise(vec.x, vec.y) * amplitude;
-							
-							divider += amplitude;
-							amplitude *= config.persistance;
-							frequency *= config.lacunarity;
-						}
-
-						elevation *= config.constrast;
-						elevation /= divider;
-
-						//Clipping values to be in range -1.0f and 1.0f
-						if (elevation < -1.0f) {
-							elevation = -1.0f;
-						}
-						else if (elevation > 1.0f) {
-							elevation = 1.0f;
-						}
-
-						//Dealing with negatives
-						if (config.option == Options::REFIT_ALL) {
-							elevation = (elevation + 1.0f) / 2.0f;
-						}
-						else if (elevation < 0.0f && config.option != Options::NOTHING)
-						{
-							if (config.option == Options::FLATTEN_NEGATIVES)
-							{
-								elevation = 0.0f;
-							}
-							else if (config.option == Options::REVERT_NEGATIVES)
-							{
-								elevation = -(elevation * config.revertGain);
-							}
-						}
-						//Make ridge noise
-						if (config.ridge)
-							elevation = ridge(elevation, config.ridgeOffset, config.ridgeGain);
-
-						//Make island
-						if (config.island) {
-							elevation = std::fabsf(makeIsland(elevation, x, y));
-						}
-
-						//Redistribute the noise
-						elevation = std::pow(elevation, config.redistribution);
-
-						heightMap[((chunkY * chunkHeight + y) * width * chunkWidth) + chunkX * chunkWidth + x] = elevation;
+					elevation += SimplexNoise::noise(vec.x, vec.y, permutation) * amplitude;
+					
+					divider += amplitude;
+					amplitude *= config.persistance;
+					frequency *= config.lacunarity;
+				}
+
+				elevation *= config.constrast;
+				elevation /= divider;
+
+				//Clipping values to be in range -1.0f and 1.0f
+				if (elevation < -1.0f) {
+					elevation = -1.0f;
+				}
+				else if (elevation > 1.0f) {
+					elevation = 1.0f;
+				}
+
+				//Dealing with negatives
+				if (config.option == Options::REFIT_ALL) {
+					elevation = (elevation + 1.0f) / 2.0f;
+				}
+				else if (elevation < 0.0f && config.option != Options::NOTHING)
+				{
+					if (config.option == Options::FLATTEN_NEGATIVES)
+					{
+						elevation = 0.0f;
+					}
+					else if (config.option == Options::REVERT_NEGATIVES)
+					{
+						elevation = -(elevation * config.revertGain);
 					}
 				}
+				//Make ridge noise
+				if (config.ridge)
+					elevation = ridge(elevation, config.ridgeOffset, config.ridgeGain);
+
+				//Make island, centered in the middle of the world
+				if (config.island) {
+					float nx = (worldChunkX * chunkWidth + x) * 2 / islandWidth - 1;
+					float ny = (worldChunkY * chunkHeight + y) * 2 / islandHeight - 1;
+					elevation = std::fabs(makeIsland(elevation, nx, ny));
+				}
+
+				//Redistribute the noise
+				elevation = std::pow(elevation, config.redistribution);
+
+				row[x] = elevation;
 			}
 		}
-		std::cout << "[LOG] Noise successfully generated" << std::endl;
 		return true;
 	}
 
@@ -192,15 +252,17 @@ namespace noise
 	{
 		if (heightMap == nullptr)
 			return false;
+		setSeed(config.seed);
 
-		float amplitude;
-		float frequency;
-		float elevation;
-		float divider;
-		glm::vec2 vec = glm::vec2(0.0f, 0.0f);
-
-		for (int y = 0; y < height; y++)
+		//Rows are independent of each other so they are generated in parallel by the job system
+		jobs::JobSystem::get().parallel_for(0, height, 8, [this](int y)
 		{
+			float amplitude;
+			float frequency;
+			float elevation;
+			float divider;
+			glm::vec2 vec = glm::vec2(0.0f, 0.0f);
+
 			for (int x = 0; x < width; x++)
 			{
 				divider = 0.0f;
@@ -211,20 +273,21 @@ namespace noise
 				for (int i = 0; i < config.octaves; i++)
 				{
 					if (this->config.symmetrical) {
-						float TAU = 2 * std::_Pi_val;
+						float TAU = 2 * std::numbers::pi_v<float>;
 						float anglex = TAU * (x / (float)width);
 						float angley = TAU * (y / (float)height);
 
-						elevation += SimplexNoise::noise(std::cosf(anglex) / TAU * config.scale * frequency + config.xoffset, 
-														 std::sinf(anglex) / TAU * config.scale * frequency + config.xoffset,
-														 std::cosf(angley) / TAU * config.scale * frequency + config.yoffset,
-														 std::sinf(angley) / TAU * config.scale * frequency + config.yoffset)  * amplitude;
+						elevation += SimplexNoise::noise(std::cos(anglex) / TAU * config.scale * frequency + config.xoffset, 
+														 std::sin(anglex) / TAU * config.scale * frequency + config.xoffset,
+														 std::cos(angley) / TAU * config.scale * frequency + config.yoffset,
+														 std::sin(angley) / TAU * config.scale * frequency + config.yoffset,
+														 permutation)  * amplitude;
 					}
 					else {
 						vec.x = (x / (float)width  * config.scale + config.xoffset) * frequency;
 						vec.y = (y / (float)height * config.scale + config.yoffset) * frequency;
 
-						elevation += SimplexNoise::noise(vec.x, vec.y) * amplitude;
+						elevation += SimplexNoise::noise(vec.x, vec.y, permutation) * amplitude;
 						//elevation += perlin(vec) * amplitude;
 					}
 					divider += amplitude;
@@ -264,15 +327,15 @@ namespace noise
 				
 				//Make island
 				if (config.island) {
-					elevation = std::fabsf(makeIsland(elevation, x, y));
+					elevation = std::fabs(makeIsland(elevation, x * 2 / (float)width - 1, y * 2 / (float)height - 1));
 				}
 
 				//Redistribute the noise
 				elevation = std::pow(elevation, config.redistribution);
 
-				heightMap[y * width + x] = elevation;
+				heightMap[indexer.index(x, y)] = elevation;
 			}
-		}
+		});
 		std::cout << "[LOG] Noise successfully generated" << std::endl;
 		return true;
 	}
@@ -294,30 +357,29 @@ namespace noise
 		if (!this->heightMap)
 			return false;
 
-		for (int y = 0; y < height * chunkHeight; y++)
+		jobs::JobSystem::get().parallel_for(0, height * chunkHeight, 64, [this](int y)
 		{
 			for (int x = 0; x < width * chunkWidth; x++)
 			{
-				heightMap[y * width * chunkWidth + x] = ridge(heightMap[y * width * chunkWidth + x], config.ridgeOffset, config.ridgeGain);
+				heightMap[indexer.index(x, y)] = ridge(heightMap[indexer.index(x, y)], config.ridgeOffset, config.ridgeGain);
 			}
-		}
+		});
+		return true;
 	}
 
 	//Function generating island noise based on the configuration parameters
 	//
 	//@param e - elevation value
-	//@param x - x coordinate
-	//@param y - y coordinate
-	float SimplexNoiseClass::makeIsland(float e, int x, int y) {
-		float nx = x * 2 / (float)width  -1;
-		float ny = y * 2 / (float)height -1;
+	//@param nx - x coordinate in the map scaled to [-1, 1]
+	//@param ny - y coordinate in the map scaled to [-1, 1]
+	float SimplexNoiseClass::makeIsland(float e, float nx, float ny) {
 		float distance = 0;
 		if (config.islandType == IslandType::CONE)
 			distance = sqrt((nx * nx) + (ny * ny));
 		else if (config.islandType == IslandType::DIAGONAL)
 			distance = std::max(fabs(nx), fabs(ny));
 		else if (config.islandType == IslandType::EUCLIDEAN_SQUARED){
-			distance = std::min(1.0f, ((nx * nx) + (ny * ny)) / std::sqrtf(2.0f));
+			distance = std::min(1.0f, ((nx * nx) + (ny * ny)) / std::sqrt(2.0f));
 		}
 		else if (config.islandType == IslandType::SQUARE_BUMP) {
 			distance = 1 - ((1-(nx * nx))*(1-(ny * ny)));
@@ -326,10 +388,10 @@ namespace noise
 			distance = sqrt((nx * nx) + (ny * ny) + (0.5 * 0.5));
 		}
 		else if (config.islandType == IslandType::SQUIRCLE) {
-			distance = sqrt(std::powf(nx,4) + std::powf(ny,4));
+			distance = sqrt(std::pow(nx, 4.0f) + std::pow(ny, 4.0f));
 		}
 		else if (config.islandType == IslandType::TRIG) {
-			distance = 1 - (cos(nx * (std::_Pi_val / 2)) * cos(ny * (std::_Pi_val / 2)));
+			distance = 1 - (cos(nx * (std::numbers::pi_v<float> / 2)) * cos(ny * (std::numbers::pi_v<float> / 2)));
 		}
 		return std::lerp(e, 1 - distance, config.mixPower);
 	}
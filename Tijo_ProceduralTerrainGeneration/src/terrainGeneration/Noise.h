@@ -2,6 +2,9 @@
 
 #include "glm/glm.hpp"
 
+#include "Hash.h"
+#include "MapLayout.h"
+
 #include <cstdint>
 #include <vector>
 
@@ -63,9 +66,16 @@ namespace noise
 			ridge(ridge), ridgeGain(ridgeGain), ridgeOffset(ridgeOffset), island(island), islandType(islandType), mixPower(mixPower), 
 			symmetrical(symmetrical){}
 
-		float getCheckSum() const {
-			return xoffset + yoffset + scale + octaves + constrast + redistribution + lacunarity +
-				persistance + ridgeGain + ridgeOffset + revertGain + mixPower + seed;
+		//Hash of every field of the config
+		//@param withSeed - false when the seed is derived from the world seed and hashed separately
+		uint64_t getHash(bool withSeed = true) const {
+			hashing::Hasher hasher;
+			hasher.add(xoffset).add(yoffset).add(scale).add(octaves).add(constrast).add(redistribution).add(lacunarity)
+				.add(persistance).add(option).add(revertGain).add(ridge).add(ridgeGain).add(ridgeOffset)
+				.add(island).add(mixPower).add(islandType).add(symmetrical);
+			if (withSeed)
+				hasher.add(seed);
+			return hasher.get();
 		}
 	};
 
@@ -77,7 +87,8 @@ namespace noise
 
 		bool generateFractalNoise();
 		bool generateFractalNoiseByChunks();
-		float makeIsland(float e, int x, int y);
+		bool generateFractalNoiseChunk(int chunkX, int chunkY);
+		float makeIsland(float e, float nx, float ny);
 		bool makeMapRidged();
 
 		void initMap();
@@ -86,20 +97,34 @@ namespace noise
 		void setMapSize(unsigned int width, unsigned int height);
 		void setChunkSize(unsigned int chunkWidth, unsigned int chunkHeight);
 		void setConfig(NoiseConfigParameters config);
+		void setLayout(layout::MapLayout mapLayout);
+		void setWorldRegion(int originX, int originY, unsigned int worldWidth, unsigned int worldHeight);
 
 		float* getMap() const { return heightMap; }
-		float getVal(int x, int y) const { return heightMap[y * width * chunkWidth + x]; }
+		float getVal(int x, int y) const { return heightMap[indexer.index(x, y)]; }
+		const layout::MapIndexer& getIndexer() const { return indexer; }
 		unsigned int getWidth()  const { return width; }
 		unsigned int getHeight() const { return height; }
 		unsigned int getChunkWidth() const { return chunkWidth; }
 		unsigned int getChunkHeight() const { return chunkHeight; }
 		NoiseConfigParameters& getConfigRef() { return config; }
+		const NoiseConfigParameters& getConfig() const { return config; }
 
 	private:
 		NoiseConfigParameters config;
+		//Permutation table of this noise, separate for every instance so noises with different seeds
+		//can be generated at the same time
+		uint8_t permutation[256];
+		int permutationSeed;
 		float* heightMap;
 		unsigned int width, height;
 		unsigned int chunkWidth, chunkHeight;
+		//Position of the map in the world in chunks and the size of the world, chunks are sampled at their world coordinates
+		//so a map covering only a part of the world matches the same part of the map of the whole world
+		int originX, originY;
+		unsigned int worldWidth, worldHeight;
+		layout::MapLayout mapLayout;
+		layout::MapIndexer indexer;
 
 		float ridge(float h, float offset, float gain);
 	};
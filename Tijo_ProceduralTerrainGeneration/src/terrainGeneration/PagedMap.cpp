@@ -0,0 +1,450 @@
+#include "PagedMap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "JobSystem.h"
+
+static_assert(sizeof(paging::PagedMapHeader) == 32, "Paged map header must not change its size");
+
+namespace paging
+{
+	PagedMap::PagedMap() : file(invalidFile), cacheBudget(0), ioFailed(false)
+	{
+	}
+
+	PagedMap::~PagedMap()
+	{
+		close();
+	}
+
+	//Creates the new file of the map filled with zeros, truncates the existing one
+	//
+	//@param path - path of the file
+	//@param width, height - size of the map in samples
+	//@param tileSize - size of the tile in samples
+	//@param channels - number of floats per sample, e.g. 1 for heights, 3 for normals
+	//@param cacheBudget - maximal size of the tiles kept in memory in bytes
+	//@return bool - false if the parameters are not valid or the file couldnt be created
+	bool PagedMap::create(const std::string& path, int width, int height, int tileSize, int channels, size_t cacheBudget)
+	{
+		close();
+		if (width <= 0 || height <= 0 || tileSize <= 0 || channels <= 0) {
+			std::cout << "[ERROR] Paged map must have positive size, tile size and channels" << std::endl;
+			return false;
+		}
+
+		header = PagedMapHeader();
+		header.width = width;
+		header.height = height;
+		header.tileSize = tileSize;
+		header.channels = channels;
+		uint64_t fileSize = sizeof(PagedMapHeader) + static_cast<uint64_t>(getTilesX()) * getTilesY() * tileBytes();
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		file = reinterpret_cast<intptr_t>(handle);
+		LARGE_INTEGER size;
+		size.QuadPart = static_cast<LONGLONG>(fileSize);
+		bool sized = file != invalidFile && SetFilePointerEx(handle, size, nullptr, FILE_BEGIN) && SetEndOfFile(handle);
+#else
+		file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		bool sized = file != invalidFile && ftruncate(static_cast<int>(file), static_cast<off_t>(fileSize)) == 0;
+#endif
+		if (!sized || !writeAt(0, &header, sizeof(PagedMapHeader))) {
+			std::cout << "[ERROR] Paged map " << path << " couldnt be created" << std::endl;
+			close();
+			return false;
+		}
+
+		this->cacheBudget = cacheBudget;
+		return true;
+	}
+
+	//Opens the map created before
+	//
+	//@param path - path of the file
+	//@param cacheBudget - maximal size of the tiles kept in memory in bytes
+	//@return bool - false if the file doesnt exist or it is not a valid paged map
+	bool PagedMap::open(const std::string& path, size_t cacheBudget)
+	{
+		close();
+
+		uint64_t fileSize = 0;
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		file = reinterpret_cast<intptr_t>(handle);
+		LARGE_INTEGER size;
+		if (file != invalidFile && GetFileSizeEx(handle, &size))
+			fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+		file = ::open(path.c_str(), O_RDWR);
+		struct stat status;
+		if (file != invalidFile && fstat(static_cast<int>(file), &status) == 0)
+			fileSize = static_cast<uint64_t>(status.st_size);
+#endif
+		if (file == invalidFile)
+			return false;
+
+		PagedMapHeader expected;
+		if (fileSize < sizeof(PagedMapHeader) || !readAt(0, &header, sizeof(PagedMapHeader)) ||
+			std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0 || header.version != PAGED_MAP_VERSION ||
+			header.width <= 0 || header.height <= 0 || header.tileSize <= 0 || header.channels <= 0 ||
+			fileSize < sizeof(PagedMapHeader) + static_cast<uint64_t>(getTilesX()) * getTilesY() * tileBytes()) {
+			std::cout << "[ERROR] " << path << " is not a valid paged map" << std::endl;
+			close();
+			return false;
+		}
+
+		this->cacheBudget = cacheBudget;
+		return true;
+	}
+
+	//Writes every modified tile back to the file, tiles stay in the cache
+	//Must not be called while any window is being written
+	bool PagedMap::flush()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& [id, tile] : tiles) {
+			if (tile->dirty) {
+				if (!writeTile(id, *tile))
+					return false;
+				tile->dirty = false;
+			}
+		}
+		return !ioFailed;
+	}
+
+	void PagedMap::close()
+	{
+		if (file != invalidFile) {
+			flush();
+#ifdef _WIN32
+			CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+			::close(static_cast<int>(file));
+#endif
+		}
+		file = invalidFile;
+		header = PagedMapHeader();
+		tiles.clear();
+		lookup.clear();
+		ioFailed = false;
+	}
+
+	//Copies the rectangle of the samples out of the map, tiles are loaded as needed
+	//
+	//@param x, y - top left sample of the rectangle
+	//@param windowWidth, windowHeight - size of the rectangle, it has to lie inside of the map
+	//@param destination - windowWidth * windowHeight * channels floats, row after row
+	//@return bool - false if the rectangle is out of the map or the tiles couldnt be read
+	bool PagedMap::readWindow(int x, int y, int windowWidth, int windowHeight, float* destination)
+	{
+		return copyWindow(x, y, windowWidth, windowHeight, destination, false);
+	}
+
+	//Copies the rectangle of the samples into the map, tiles are marked as modified
+	//Windows written at the same time must not overlap
+	bool PagedMap::writeWindow(int x, int y, int windowWidth, int windowHeight, const float* source)
+	{
+		return copyWindow(x, y, windowWidth, windowHeight, const_cast<float*>(source), true);
+	}
+
+	//Runs the function on every tile with the halo around it, see the description of the class
+	//
+	//@param halo - number of the samples of the neighbouring tiles around the tile, at most the tile size
+	//@param func - processes the window, returns false on failure
+	//@param writeBack - writes the tile part of the window back to the map after the function
+	//@return bool - false if any of the windows failed or the tiles couldnt be read or written
+	bool PagedMap::forEachTile(int halo, const std::function<bool(TileWindow& window)>& func, bool writeBack)
+	{
+		if (!isOpen() || halo < 0 || halo > header.tileSize) {
+			std::cout << "[ERROR] Halo must be between 0 and the tile size" << std::endl;
+			return false;
+		}
+
+		TileCacheStats before = getStats();
+		auto start = std::chrono::high_resolution_clock::now();
+		std::atomic<bool> failed{ false };
+
+		for (int phase = 0; phase < 4; phase++) {
+			int phaseX = phase % 2, phaseY = phase / 2;
+			int countX = (getTilesX() - phaseX + 1) / 2, countY = (getTilesY() - phaseY + 1) / 2;
+
+			jobs::JobSystem::get().parallel_for2D(countX, countY, 1, 1, [&](int i, int j) {
+				TileWindow window;
+				window.tileX = i * 2 + phaseX;
+				window.tileY = j * 2 + phaseY;
+				window.channels = header.channels;
+
+				int tileX0 = window.tileX * header.tileSize, tileY0 = window.tileY * header.tileSize;
+				int tileX1 = std::min(tileX0 + header.tileSize, header.width), tileY1 = std::min(tileY0 + header.tileSize, header.height);
+				window.x = std::max(tileX0 - halo, 0);
+				window.y = std::max(tileY0 - halo, 0);
+				window.width = std::min(tileX1 + halo, header.width) - window.x;
+				window.height = std::min(tileY1 + halo, header.height) - window.y;
+				window.interiorX = tileX0 - window.x;
+				window.interiorY = tileY0 - window.y;
+				window.interiorWidth = tileX1 - tileX0;
+				window.interiorHeight = tileY1 - tileY0;
+				window.samples.resize(static_cast<size_t>(window.width) * window.height * header.channels);
+
+				if (!readWindow(window.x, window.y, window.width, window.height, window.samples.data()) || !func(window)) {
+					failed = true;
+					return;
+				}
+				if (!writeBack)
+					return;
+
+				//Rows of the tile are taken out of the window, the halo is dropped
+				std::vector<float> interior(static_cast<size_t>(window.interiorWidth) * window.interiorHeight * header.channels);
+				size_t rowSize = static_cast<size_t>(window.interiorWidth) * header.channels;
+				for (int row = 0; row < window.interiorHeight; row++)
+					std::copy_n(window.at(window.interiorX, window.interiorY + row), rowSize, interior.begin() + row * rowSize);
+				if (!writeWindow(tileX0, tileY0, window.interiorWidth, window.interiorHeight, interior.data()))
+					failed = true;
+			});
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		TileCacheStats after = getStats();
+		TileCacheStats pass;
+		pass.hits = after.hits - before.hits;
+		pass.misses = after.misses - before.misses;
+		double megabytes = static_cast<double>(header.width) * header.height * header.channels * sizeof(float) / (1024.0 * 1024.0);
+		std::cout << "[LOG] Processed " << getTilesX() * getTilesY() << " tiles in " << seconds << " s, " << megabytes / std::max(seconds, 1e-9)
+			<< " MB/s, tile cache hit rate " << pass.getHitRate() * 100.0 << "%" << std::endl;
+
+		bool evictionFailed;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			evictionFailed = ioFailed;
+		}
+		if (failed || evictionFailed) {
+			std::cout << "[ERROR] Tiles of the paged map couldnt be processed" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	//Changes the maximal size of the tiles in memory, tiles over the new budget are evicted straight away
+	void PagedMap::setCacheBudget(size_t cacheBudget)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->cacheBudget = cacheBudget;
+		evict(cacheBudget);
+	}
+
+	TileCacheStats PagedMap::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	void PagedMap::resetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats = TileCacheStats();
+	}
+
+	//Returns the tile from the cache or loads it from the file, lock has to be held
+	//Tile is pinned by the returned pointer, so it is not evicted before it is released
+	std::shared_ptr<PagedMap::Tile> PagedMap::acquireTile(int tileX, int tileY)
+	{
+		int id = tileY * getTilesX() + tileX;
+		auto it = lookup.find(id);
+		if (it != lookup.end()) {
+			stats.hits++;
+			tiles.splice(tiles.begin(), tiles, it->second);
+			return it->second->second;
+		}
+
+		stats.misses++;
+		auto tile = std::make_shared<Tile>();
+		tile->samples.resize(tileBytes() / sizeof(float));
+		if (!readAt(sizeof(PagedMapHeader) + static_cast<uint64_t>(id) * tileBytes(), tile->samples.data(), tileBytes())) {
+			std::cout << "[ERROR] Tile " << tileX << ", " << tileY << " couldnt be read" << std::endl;
+			ioFailed = true;
+			return nullptr;
+		}
+		stats.bytesRead += tileBytes();
+
+		tiles.emplace_front(id, tile);
+		lookup.emplace(id, tiles.begin());
+		evict(cacheBudget);
+		return tile;
+	}
+
+	//Copies between the rectangle of the map and the array, rows of every touched tile are copied outside of the lock
+	bool PagedMap::copyWindow(int x, int y, int windowWidth, int windowHeight, float* samples, bool write)
+	{
+		if (!isOpen() || !samples || x < 0 || y < 0 || windowWidth <= 0 || windowHeight <= 0 ||
+			x + windowWidth > header.width || y + windowHeight > header.height) {
+			std::cout << "[ERROR] Window out of the paged map" << std::endl;
+			return false;
+		}
+
+		int tileSize = header.tileSize, channels = header.channels;
+		for (int tileY = y / tileSize; tileY <= (y + windowHeight - 1) / tileSize; tileY++) {
+			for (int tileX = x / tileSize; tileX <= (x + windowWidth - 1) / tileSize; tileX++) {
+				std::shared_ptr<Tile> tile;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					tile = acquireTile(tileX, tileY);
+					if (tile && write)
+						tile->dirty = true;
+				}
+				if (!tile)
+					return false;
+
+				int x0 = std::max(x, tileX * tileSize), x1 = std::min(x + windowWidth, (tileX + 1) * tileSize);
+				int y0 = std::max(y, tileY * tileSize), y1 = std::min(y + windowHeight, (tileY + 1) * tileSize);
+				size_t rowSize = static_cast<size_t>(x1 - x0) * channels;
+				for (int row = y0; row < y1; row++) {
+					float* tileRow = tile->samples.data() + (static_cast<size_t>(row - tileY * tileSize) * tileSize + (x0 - tileX * tileSize)) * channels;
+					float* windowRow = samples + (static_cast<size_t>(row - y) * windowWidth + (x0 - x)) * channels;
+					if (write)
+						std::copy_n(windowRow, rowSize, tileRow);
+					else
+						std::copy_n(tileRow, rowSize, windowRow);
+				}
+			}
+		}
+		return true;
+	}
+
+	//Evicts the least recently used tiles that are not in use until the cache fits into the budget, lock has to be held
+	bool PagedMap::evict(size_t budget)
+	{
+		auto it = tiles.end();
+		while (tiles.size() * tileBytes() > budget && it != tiles.begin()) {
+			--it;
+			if (it->second.use_count() > 1)
+				continue;
+			if (it->second->dirty && !writeTile(it->first, *it->second)) {
+				ioFailed = true;
+				return false;
+			}
+			stats.evictions++;
+			lookup.erase(it->first);
+			it = tiles.erase(it);
+		}
+		return true;
+	}
+
+	bool PagedMap::writeTile(int id, const Tile& tile)
+	{
+		if (!writeAt(sizeof(PagedMapHeader) + static_cast<uint64_t>(id) * tileBytes(), tile.samples.data(), tileBytes())) {
+			std::cout << "[ERROR] Tile " << id << " couldnt be written" << std::endl;
+			return false;
+		}
+		stats.bytesWritten += tileBytes();
+		return true;
+	}
+
+	bool PagedMap::writeAt(uint64_t offset, const void* source, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(source);
+		size_t written = 0;
+#ifdef _WIN32
+		HANDLE handle = reinterpret_cast<HANDLE>(file);
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(offset);
+		if (!SetFilePointerEx(handle, position, nullptr, FILE_BEGIN))
+			return false;
+		while (written < size) {
+			DWORD chunk = 0;
+			if (!WriteFile(handle, bytes + written, static_cast<DWORD>(std::min<size_t>(size - written, 1u << 30)), &chunk, nullptr) || chunk == 0)
+				return false;
+			written += chunk;
+		}
+#else
+		while (written < size) {
+			ssize_t chunk = pwrite(static_cast<int>(file), bytes + written, size - written, static_cast<off_t>(offset + written));
+			if (chunk <= 0)
+				return false;
+			written += static_cast<size_t>(chunk);
+		}
+#endif
+		return true;
+	}
+
+	bool PagedMap::readAt(uint64_t offset, void* destination, size_t size)
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(destination);
+		size_t read = 0;
+#ifdef _WIN32
+		HANDLE handle = reinterpret_cast<HANDLE>(file);
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(offset);
+		if (!SetFilePointerEx(handle, position, nullptr, FILE_BEGIN))
+			return false;
+		while (read < size) {
+			DWORD chunk = 0;
+			if (!ReadFile(handle, bytes + read, static_cast<DWORD>(std::min<size_t>(size - read, 1u << 30)), &chunk, nullptr) || chunk == 0)
+				return false;
+			read += chunk;
+		}
+#else
+		while (read < size) {
+			ssize_t chunk = pread(static_cast<int>(file), bytes + read, size - read, static_cast<off_t>(offset + read));
+			if (chunk <= 0)
+				return false;
+			read += static_cast<size_t>(chunk);
+		}
+#endif
+		return true;
+	}
+
+	size_t PagedMap::tileBytes() const
+	{
+		return static_cast<size_t>(header.tileSize) * header.tileSize * header.channels * sizeof(float);
+	}
+
+	//Computes the normals of the height map into the map of the same size with 3 channels
+	//Normals are central differences of the heights clamped at the borders of the map, the same as of the exported meshes
+	//
+	//@param heights - map with 1 channel
+	//@param normals - output map with 3 channels
+	//@return bool - false if the sizes of the maps dont match or the tiles couldnt be processed
+	bool computeNormals(PagedMap& heights, PagedMap& normals)
+	{
+		if (heights.getChannels() != 1 || normals.getChannels() != 3 || heights.getWidth() != normals.getWidth() || heights.getHeight() != normals.getHeight()) {
+			std::cout << "[ERROR] Normals need the height map and the normal map of the same size" << std::endl;
+			return false;
+		}
+
+		return heights.forEachTile(1, [&normals](TileWindow& window) {
+			std::vector<float> output(static_cast<size_t>(window.interiorWidth) * window.interiorHeight * 3);
+			float* normal = output.data();
+			for (int y = window.interiorY; y < window.interiorY + window.interiorHeight; y++) {
+				for (int x = window.interiorX; x < window.interiorX + window.interiorWidth; x++, normal += 3) {
+					//Window is clipped to the map, so clamping to it is the same as clamping to the map
+					int left = std::max(x - 1, 0), right = std::min(x + 1, window.width - 1);
+					int top = std::max(y - 1, 0), bottom = std::min(y + 1, window.height - 1);
+					float dx = right > left ? (*window.at(right, y) - *window.at(left, y)) / (right - left) : 0.0f;
+					float dz = bottom > top ? (*window.at(x, bottom) - *window.at(x, top)) / (bottom - top) : 0.0f;
+					float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+					normal[0] = -dx / length;
+					normal[1] = 1.0f / length;
+					normal[2] = -dz / length;
+				}
+			}
+			return normals.writeWindow(window.x + window.interiorX, window.y + window.interiorY, window.interiorWidth, window.interiorHeight, output.data());
+		}, false);
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Map of the samples larger than the memory, kept in a file and paged in by square tiles
+//
+//File layout (little-endian):
+//	PagedMapHeader
+//	tiles row by row, every tile tileSize * tileSize * channels floats (tiles on the border are padded to the full size)
+//
+//Tiles are loaded on demand into the LRU cache limited by the byte budget, modified tiles are written back when
+//they are evicted or on flush. Tiles in use (held by a window being copied) are never evicted.
+//
+//Processing goes tile by tile through forEachTile: the tile together with the halo of the neighbouring samples
+//is copied into a contiguous window, so any algorithm working on the float* of the whole map (erosion, normals,
+//meshing) can run on it, and the tile part of the window is written back. Tiles are processed in four phases
+//(even/odd x and y), tiles of one phase are at least one tile apart, so with the halo not larger than the tile
+//they can run in parallel without reading the samples written in the same phase.
+//
+//Every pass logs the hit rate of the tile cache and the throughput in MB/s of the processed samples.
+
+namespace paging
+{
+	constexpr uint32_t PAGED_MAP_VERSION = 1;
+
+	struct PagedMapHeader {
+		char magic[4] = { 'T', 'P', 'P', 'M' };
+		uint32_t version = PAGED_MAP_VERSION;
+		int32_t width = 0, height = 0;		//Size of the map in samples
+		int32_t tileSize = 0;
+		int32_t channels = 0;				//Floats per sample
+		uint32_t reserved[2] = {};
+	};
+
+	struct TileCacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t bytesRead = 0;
+		uint64_t bytesWritten = 0;
+
+		double getHitRate() const { return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0; }
+	};
+
+	//Samples of the tile with the halo around it, clipped to the map
+	struct TileWindow {
+		int tileX, tileY;
+		int x, y, width, height;							//Window in the map coordinates
+		int interiorX, interiorY, interiorWidth, interiorHeight;	//Tile in the window coordinates
+		int channels;
+		std::vector<float> samples;							//Rows of the window, channels of the sample next to each other
+
+		float* at(int windowX, int windowY) { return samples.data() + (static_cast<size_t>(windowY) * width + windowX) * channels; }
+	};
+
+	class PagedMap
+	{
+	public:
+		PagedMap();
+		~PagedMap();
+		PagedMap(const PagedMap&) = delete;
+		PagedMap& operator=(const PagedMap&) = delete;
+
+		bool create(const std::string& path, int width, int height, int tileSize, int channels, size_t cacheBudget);
+		bool open(const std::string& path, size_t cacheBudget);
+		bool flush();
+		void close();
+
+		bool readWindow(int x, int y, int windowWidth, int windowHeight, float* destination);
+		bool writeWindow(int x, int y, int windowWidth, int windowHeight, const float* source);
+		bool forEachTile(int halo, const std::function<bool(TileWindow& window)>& func, bool writeBack = true);
+
+		void setCacheBudget(size_t cacheBudget);
+		TileCacheStats getStats() const;
+		void resetStats();
+
+		bool isOpen() const { return file != invalidFile; }
+		int getWidth() const { return header.width; }
+		int getHeight() const { return header.height; }
+		int getTileSize() const { return header.tileSize; }
+		int getChannels() const { return header.channels; }
+		int getTilesX() const { return (header.width + header.tileSize - 1) / header.tileSize; }
+		int getTilesY() const { return (header.height + header.tileSize - 1) / header.tileSize; }
+
+	private:
+		struct Tile {
+			std::vector<float> samples;
+			bool dirty = false;
+		};
+		using Entry = std::pair<int, std::shared_ptr<Tile>>;
+
+		std::shared_ptr<Tile> acquireTile(int tileX, int tileY);
+		bool copyWindow(int x, int y, int windowWidth, int windowHeight, float* samples, bool write);
+		bool evict(size_t budget);
+		bool writeTile(int id, const Tile& tile);
+		bool writeAt(uint64_t offset, const void* source, size_t size);
+		bool readAt(uint64_t offset, void* destination, size_t size);
+		size_t tileBytes() const;
+
+		static constexpr intptr_t invalidFile = -1;
+
+		intptr_t file;
+		PagedMapHeader header;
+
+		//Guards the cache, the statistics and the file, tiles are read and written under it
+		mutable std::mutex mutex;
+		//Most recently used tile is at the front
+		std::list<Entry> tiles;
+		std::unordered_map<int, std::list<Entry>::iterator> lookup;
+		size_t cacheBudget;
+		bool ioFailed;
+		TileCacheStats stats;
+	};
+
+	bool computeNormals(PagedMap& heights, PagedMap& normals);
+}
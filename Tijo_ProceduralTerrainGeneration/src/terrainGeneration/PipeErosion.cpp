@@ -0,0 +1,199 @@
+#include "PipeErosion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "JobSystem.h"
+
+namespace erosion
+{
+	//Rows of one task of the job system, rows are short enough for the tasks to be worth splitting
+	static const int ROWS_PER_TASK = 16;
+
+	//Water shallower than this doesnt move the sediment, the velocity would divide by almost zero
+	static const float MIN_DEPTH = 1e-6f;
+
+	PipeErosion::PipeErosion(int width, int height) : width(width), height(height)
+	{
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Configuration functions
+	//--------------------------------------------------------------------------------------
+
+	//Sets the parameters of the simulation
+	//Erosion rate dissolves the terrain, deposition rate drops the sediment, evaporation rate is the share of the water
+	//evaporated every iteration, gravity accelerates the flux and min slope keeps the capacity of the flat cells
+	//above zero, the same as for the droplets. Thermal erosion runs every thermalInterval iterations.
+	//Parameters of the droplets (inertia, radius, lifetime...) are not used.
+	//@param config - rates shared with the droplet erosion
+	//@param pipeConfig - parameters of the virtual pipe model
+	void PipeErosion::SetConfig(const ErosionConfig& config, const PipeErosionConfig& pipeConfig)
+	{
+		dissolvingRate = config.erosionRate;
+		depositionRate = config.depositionRate;
+		evaporationRate = config.evaporationRate;
+		gravity = config.gravity;
+		minSlope = config.minSlope;
+		thermalInterval = config.thermalInterval;
+		thermal.SetConfig(config.talusSlope, config.thermalRate);
+		this->pipeConfig = pipeConfig;
+	}
+
+	//Copies the map to be eroded and starts the simulation from dry terrain
+	//@param map - row-major map of width x height samples
+	void PipeErosion::SetMap(const float* map)
+	{
+		size_t count = static_cast<size_t>(width) * height;
+		terrain.assign(map, map + count);
+		terrainNext.assign(count, 0.0f);
+		for (std::vector<float>* field : { &water, &fluxLeft, &fluxRight, &fluxTop, &fluxBottom, &velocityX, &velocityY, &sediment, &sedimentNext })
+			field->assign(count, 0.0f);
+	}
+
+	//--------------------------------------------------------------------------------------
+	//Simulation functions
+	//--------------------------------------------------------------------------------------
+
+	//Runs the configured number of the iterations on the threads of the job system
+	//@return bool - false if the map is not set or is smaller than 2 x 2 samples
+	bool PipeErosion::Erode()
+	{
+		if (width < 2 || height < 2 || terrain.size() != static_cast<size_t>(width) * height) {
+			std::cout << "[ERROR] Pipe erosion needs the map of at least 2 x 2 samples" << std::endl;
+			return false;
+		}
+
+		for (int i = 0; i < pipeConfig.iterations; i++) {
+			Iterate();
+			if (thermalInterval > 0 && (i + 1) % thermalInterval == 0)
+				thermal.Erode(terrain.data(), width, height, width);
+		}
+		return true;
+	}
+
+	//One iteration of the simulation, three passes over the rows, see PipeErosion.h
+	void PipeErosion::Iterate()
+	{
+		jobs::JobSystem& jobSystem = jobs::JobSystem::get();
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this](int y) { updateFlux(y); });
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this](int y) { updateWaterAndTerrain(y); });
+		terrain.swap(terrainNext);
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this](int y) { transportSediment(y); });
+		sediment.swap(sedimentNext);
+	}
+
+	//Accelerates the outflow of the cells by the differences of the water surfaces, the outflow is scaled down
+	//when it would take more water than the cell has after the rain. Rain is the same everywhere, so it doesnt
+	//change the differences. Neighbours out of the map are the cell itself, so nothing flows out of the map.
+	//@param y - row of the cells
+	void PipeErosion::updateFlux(int y)
+	{
+		const float timeStep = pipeConfig.timeStep;
+		const float acceleration = timeStep * pipeConfig.pipeArea * gravity / pipeConfig.cellSize;
+		const float cellArea = pipeConfig.cellSize * pipeConfig.cellSize;
+		const int up = std::max(y - 1, 0), down = std::min(y + 1, height - 1);
+
+		for (int x = 0; x < width; x++) {
+			size_t i = index(x, y);
+			size_t left = index(std::max(x - 1, 0), y), right = index(std::min(x + 1, width - 1), y);
+			size_t top = index(x, up), bottom = index(x, down);
+
+			float surface = terrain[i] + water[i];
+			float outLeft = std::max(0.0f, fluxLeft[i] + acceleration * (surface - terrain[left] - water[left]));
+			float outRight = std::max(0.0f, fluxRight[i] + acceleration * (surface - terrain[right] - water[right]));
+			float outTop = std::max(0.0f, fluxTop[i] + acceleration * (surface - terrain[top] - water[top]));
+			float outBottom = std::max(0.0f, fluxBottom[i] + acceleration * (surface - terrain[bottom] - water[bottom]));
+
+			float outflow = (outLeft + outRight + outTop + outBottom) * timeStep;
+			float available = (water[i] + pipeConfig.rainRate) * cellArea;
+			float scale = outflow > available ? available / outflow : 1.0f;
+
+			fluxLeft[i] = outLeft * scale;
+			fluxRight[i] = outRight * scale;
+			fluxTop[i] = outTop * scale;
+			fluxBottom[i] = outBottom * scale;
+		}
+	}
+
+	//Moves the water by the flux, computes the velocity from the water passing through the cell and dissolves
+	//the terrain into the water or deposits the sediment by the capacity of the water
+	//Terrain of the neighbours is read for the slope, so the eroded terrain is written to the other buffer.
+	//@param y - row of the cells
+	void PipeErosion::updateWaterAndTerrain(int y)
+	{
+		const float timeStep = pipeConfig.timeStep;
+		const float cellSize = pipeConfig.cellSize;
+		const float cellArea = cellSize * cellSize;
+		const int up = std::max(y - 1, 0), down = std::min(y + 1, height - 1);
+		const bool hasTop = y > 0, hasBottom = y < height - 1;
+
+		for (int x = 0; x < width; x++) {
+			size_t i = index(x, y);
+			const bool hasLeft = x > 0, hasRight = x < width - 1;
+			float fromLeft = hasLeft ? fluxRight[i - 1] : 0.0f;
+			float fromRight = hasRight ? fluxLeft[i + 1] : 0.0f;
+			float fromTop = hasTop ? fluxBottom[index(x, up)] : 0.0f;
+			float fromBottom = hasBottom ? fluxTop[index(x, down)] : 0.0f;
+
+			float inflow = fromLeft + fromRight + fromTop + fromBottom;
+			float outflow = fluxLeft[i] + fluxRight[i] + fluxTop[i] + fluxBottom[i];
+			float before = water[i] + pipeConfig.rainRate;
+			float after = std::max(before + timeStep * (inflow - outflow) / cellArea, 0.0f);
+			water[i] = after;
+
+			//Velocity is the average water passing through the cell divided by the cross section of the water
+			float depth = (before + after) * 0.5f;
+			float passX = (fromLeft - fluxLeft[i] + fluxRight[i] - fromRight) * 0.5f;
+			float passY = (fromTop - fluxTop[i] + fluxBottom[i] - fromBottom) * 0.5f;
+			float u = depth > MIN_DEPTH ? passX / (depth * cellSize) : 0.0f;
+			float v = depth > MIN_DEPTH ? passY / (depth * cellSize) : 0.0f;
+			velocityX[i] = u;
+			velocityY[i] = v;
+
+			//Sine of the tilt of the terrain from its central differences, one-sided on the border
+			int left = std::max(x - 1, 0), right = std::min(x + 1, width - 1);
+			float slopeX = (terrain[index(right, y)] - terrain[index(left, y)]) / ((right - left) * cellSize);
+			float slopeY = (terrain[index(x, down)] - terrain[index(x, up)]) / ((down - up) * cellSize);
+			float slopeSquared = slopeX * slopeX + slopeY * slopeY;
+			float tilt = std::sqrt(slopeSquared / (1.0f + slopeSquared));
+
+			float capacity = pipeConfig.sedimentCapacity * std::max(tilt, minSlope) * std::sqrt(u * u + v * v);
+			float carried = sediment[i];
+			if (capacity > carried) {
+				float dissolved = dissolvingRate * (capacity - carried);
+				terrainNext[i] = terrain[i] - dissolved;
+				sediment[i] = carried + dissolved;
+			}
+			else {
+				float deposited = depositionRate * (carried - capacity);
+				terrainNext[i] = terrain[i] + deposited;
+				sediment[i] = carried - deposited;
+			}
+		}
+	}
+
+	//Carries the sediment along the velocity, every cell takes the sediment of the point the water came from,
+	//bilinearly interpolated, then the water evaporates
+	//@param y - row of the cells
+	void PipeErosion::transportSediment(int y)
+	{
+		const float step = pipeConfig.timeStep / pipeConfig.cellSize;
+
+		for (int x = 0; x < width; x++) {
+			size_t i = index(x, y);
+			float sourceX = std::clamp(x - velocityX[i] * step, 0.0f, static_cast<float>(width - 1));
+			float sourceY = std::clamp(y - velocityY[i] * step, 0.0f, static_cast<float>(height - 1));
+
+			int x0 = static_cast<int>(sourceX), y0 = static_cast<int>(sourceY);
+			int x1 = std::min(x0 + 1, width - 1), y1 = std::min(y0 + 1, height - 1);
+			float u = sourceX - x0, v = sourceY - y0;
+			float topRow = sediment[index(x0, y0)] * (1 - u) + sediment[index(x1, y0)] * u;
+			float bottomRow = sediment[index(x0, y1)] * (1 - u) + sediment[index(x1, y1)] * u;
+			sedimentNext[i] = topRow * (1 - v) + bottomRow * v;
+
+			water[i] *= 1 - evaporationRate;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+
+#include "Erosion.h"
+
+//Grid based hydraulic erosion with the virtual pipe model of the shallow water, described here: https://hal.inria.fr/inria-00402079/document
+//Every cell keeps its water, the outflow flux to its four neighbours through the virtual pipes, the velocity of the water
+//and the suspended sediment. One iteration of the simulation:
+//	1. rain is added to every cell and the flux is accelerated by the difference of the water surfaces of the neighbours
+//	2. water moves by the flux, the velocity follows from the water passing through the cell, the water dissolves
+//	   the terrain or deposits the sediment by the difference of its sediment to its capacity
+//	3. sediment is carried along the velocity (semi-Lagrangian), the water evaporates
+//Every pass writes only the fields of its own cell and reads the fields of the neighbours written by the previous pass,
+//terrain and sediment are double buffered. Passes run over the rows in parallel on the job system and the result
+//doesnt depend on the number of threads.
+
+namespace erosion
+{
+	//Erosion engines which can be selected for the run
+	//DROPLETS - particle erosion of the Erosion class
+	//PIPE - grid erosion of the PipeErosion class
+	enum class ErosionEngine { DROPLETS, PIPE };
+
+	//Parameters of the virtual pipe model, rates shared with the droplets are taken from ErosionConfig
+	//(see PipeErosion::SetConfig)
+	//@param timeStep: Time of one iteration for the flow of the water and the transport of the sediment
+	//@param rainRate: Water added to every cell in every iteration
+	//@param pipeArea: Cross section of the virtual pipe between two cells
+	//@param cellSize: Distance between the neighbouring cells in the units of the heights
+	//@param sedimentCapacity: Sediment carried by the water per unit of the slope and of the velocity
+	//@param iterations: Number of the iterations of the simulation (0 disables the erosion)
+	struct PipeErosionConfig {
+		float timeStep = 0.1f;
+		float rainRate = 0.01f;
+		float pipeArea = 1.0f;
+		float cellSize = 1.0f;
+		float sedimentCapacity = 1.0f;
+		int iterations = 0;
+	};
+
+	class PipeErosion
+	{
+	public:
+		PipeErosion(int width, int height);
+
+		//Simulation functions
+		bool Erode();
+		void Iterate();
+
+		//Configuration functions
+		void SetConfig(const ErosionConfig& config, const PipeErosionConfig& pipeConfig);
+		void SetMap(const float* map);
+
+		//Getters
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		float* getMap() { return terrain.data(); }
+		const float* getWater() const { return water.data(); }
+		const float* getSediment() const { return sediment.data(); }
+		PipeErosionConfig& getPipeConfigRef() { return pipeConfig; }
+
+	private:
+		void updateFlux(int y);
+		void updateWaterAndTerrain(int y);
+		void transportSediment(int y);
+
+		size_t index(int x, int y) const { return static_cast<size_t>(y) * width + x; }
+
+		int width, height;
+
+		//Rates of the erosion, taken from ErosionConfig
+		float dissolvingRate = 0.2f;
+		float depositionRate = 0.5f;
+		float evaporationRate = 0.01f;
+		float gravity = 1.0f;
+		float minSlope = 0.0f;
+		int thermalInterval = 0;
+		PipeErosionConfig pipeConfig;
+		ThermalErosion thermal;
+
+		//Fields of the cells, row-major
+		std::vector<float> terrain, terrainNext;
+		std::vector<float> water;
+		std::vector<float> fluxLeft, fluxRight, fluxTop, fluxBottom;
+		std::vector<float> velocityX, velocityY;
+		std::vector<float> sediment, sedimentNext;
+	};
+}
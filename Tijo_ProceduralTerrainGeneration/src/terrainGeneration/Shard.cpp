@@ -0,0 +1,226 @@
+#include "Shard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+#include "TerrainGenerator.h"
+#include "WorldStore.h"
+
+namespace shard
+{
+	//Splits the world into the grid of shards of nearly the same size, shards are ordered row by row
+	//
+	//@param worldWidth, worldHeight - size of the world in chunks
+	//@param shardsX, shardsY - number of the shards along the axes, at most the size of the world
+	//@return std::vector<ShardRegion> - shards, empty if the world cant be split this way
+	std::vector<ShardRegion> planShards(int worldWidth, int worldHeight, int shardsX, int shardsY)
+	{
+		std::vector<ShardRegion> shards;
+		if (shardsX <= 0 || shardsY <= 0 || shardsX > worldWidth || shardsY > worldHeight)
+			return shards;
+
+		for (int j = 0; j < shardsY; j++) {
+			for (int i = 0; i < shardsX; i++) {
+				ShardRegion& shard = shards.emplace_back();
+				shard.originX = static_cast<int>(static_cast<long long>(i) * worldWidth / shardsX);
+				shard.originY = static_cast<int>(static_cast<long long>(j) * worldHeight / shardsY);
+				shard.width = static_cast<int>(static_cast<long long>(i + 1) * worldWidth / shardsX) - shard.originX;
+				shard.height = static_cast<int>(static_cast<long long>(j + 1) * worldHeight / shardsY) - shard.originY;
+			}
+		}
+		return shards;
+	}
+
+	//@return std::string - path of the shard file of the world, e.g. world.world.1_0.shard
+	std::string shardPath(const std::string& worldPath, int shardX, int shardY)
+	{
+		return worldPath + "." + std::to_string(shardX) + "_" + std::to_string(shardY) + ".shard";
+	}
+
+	//Generates the shard of the world and writes it to the shard file
+	//
+	//@param config - config of the whole world
+	//@param shardsX, shardsY - grid of the shards, see planShards
+	//@param shardX, shardY - coordinates of the generated shard in the grid
+	//@param margin - chunks generated around the shard, at least 1 so the trees on the border are the same as in the world
+	//@param path - shard file, usually shardPath(worldPath, shardX, shardY)
+	//@return bool - false if the shard is not in the grid or couldnt be generated or written
+	bool generateShard(const config::GenerationConfig& config, int shardsX, int shardsY, int shardX, int shardY, int margin, const std::string& path)
+	{
+		std::vector<ShardRegion> shards = planShards(config.width, config.height, shardsX, shardsY);
+		if (shards.empty() || shardX < 0 || shardY < 0 || shardX >= shardsX || shardY >= shardsY || margin < 1) {
+			std::cout << "[ERROR] Invalid shard " << shardX << ", " << shardY << " of " << shardsX << " x " << shardsY << " with margin " << margin << std::endl;
+			return false;
+		}
+
+		const ShardRegion& shard = shards[shardY * shardsX + shardX];
+		int x0 = std::max(shard.originX - margin, 0), y0 = std::max(shard.originY - margin, 0);
+		int x1 = std::min(shard.originX + shard.width + margin, config.width), y1 = std::min(shard.originY + shard.height + margin, config.height);
+
+		//Eroded chunk depends on the chunks around it, they are generated too, but not written
+		bool chunkedErosion = config.chunkedErosion && config.erosionEngine == erosion::ErosionEngine::DROPLETS && config.dropletCount > 0;
+		int reach = chunkedErosion ? TerrainGenerator::EROSION_REACH : 0;
+		int generatedX = std::max(x0 - reach, 0), generatedY = std::max(y0 - reach, 0);
+
+		//Chunks are written straight from the maps, so they have to be contiguous
+		config::GenerationConfig shardConfig = config;
+		shardConfig.width = std::min(x1 + reach, config.width) - generatedX;
+		shardConfig.height = std::min(y1 + reach, config.height) - generatedY;
+		shardConfig.mapLayout = layout::MapLayout::CHUNK_MAJOR;
+
+		//Droplets per chunk are taken from the whole world
+		TerrainGenerator terrainGen;
+		if (!config::applyConfig(shardConfig, terrainGen) || !terrainGen.setShard(generatedX, generatedY, config.width, config.height) ||
+			(chunkedErosion && !terrainGen.setErosion(config.erosion, config::dropletsPerChunk(config), config.erosionHalo)) ||
+			!terrainGen.performTerrainGeneration()) {
+			std::cout << "[ERROR] Shard " << shardX << ", " << shardY << " couldnt be generated" << std::endl;
+			return false;
+		}
+
+		world::WorldStore store;
+		if (!store.create(path, terrainGen.getWorldHeader()))
+			return false;
+
+		for (int worldY = y0; worldY < y1; worldY++) {
+			for (int worldX = x0; worldX < x1; worldX++) {
+				int x = worldX - generatedX, y = worldY - generatedY;
+				bool owned = worldX >= shard.originX && worldX < shard.originX + shard.width && worldY >= shard.originY && worldY < shard.originY + shard.height;
+				//Trees of the margin chunks miss the candidates beyond the margin, only their heights and biomes are kept
+				bool written = owned ? terrainGen.storeChunk(store, x, y) :
+					store.writeChunk(worldX, worldY, terrainGen.getHeightChunk(x, y), terrainGen.getBiomeChunk(x, y), {});
+				if (!written) {
+					std::cout << "[ERROR] Shard file couldnt be written: " << path << std::endl;
+					return false;
+				}
+			}
+		}
+
+		std::cout << "[LOG] Shard " << shardX << ", " << shardY << " (" << shard.width << " x " << shard.height << " chunks at " << shard.originX << ", "
+			<< shard.originY << ") written to: " << path << std::endl;
+		return true;
+	}
+
+	static bool sameChunk(const world::ChunkView& first, const world::ChunkView& second)
+	{
+		return first.heights.size() == second.heights.size() && first.biomes.size() == second.biomes.size() &&
+			std::memcmp(first.heights.data(), second.heights.data(), first.heights.size_bytes()) == 0 &&
+			std::memcmp(first.biomes.data(), second.biomes.data(), first.biomes.size_bytes()) == 0;
+	}
+
+	//Merges the shard files of the world into the world file and verifies the seams between the shards
+	//
+	//@param worldPath - merged world file, shards are read from shardPath(worldPath, x, y)
+	//@param shardsX, shardsY - grid of the shards the world was generated in
+	//@param report - counts of the merged chunks and of the problems found on the seams
+	//@return bool - false if any shard is missing or doesnt belong to the world, or any seam is not exact
+	bool mergeShards(const std::string& worldPath, int shardsX, int shardsY, MergeReport& report)
+	{
+		report = MergeReport();
+		std::vector<std::unique_ptr<world::WorldStore>> stores;
+		for (int j = 0; j < shardsY; j++) {
+			for (int i = 0; i < shardsX; i++) {
+				auto store = std::make_unique<world::WorldStore>();
+				if (!store->open(shardPath(worldPath, i, j)))
+					return false;
+				if (!stores.empty() && store->getHeader() != stores.front()->getHeader()) {
+					std::cout << "[ERROR] Shard " << i << ", " << j << " was generated with a different config" << std::endl;
+					return false;
+				}
+				stores.push_back(std::move(store));
+			}
+		}
+		if (stores.empty())
+			return false;
+
+		const world::WorldHeader& header = stores.front()->getHeader();
+		std::vector<ShardRegion> shards = planShards(header.width, header.height, shardsX, shardsY);
+		if (shards.empty())
+			return false;
+		report.shardCount = static_cast<int>(shards.size());
+
+		world::WorldStore merged;
+		if (!merged.create(worldPath, header))
+			return false;
+
+		//Owner of every chunk of the world, index of its shard
+		std::vector<int> owners(static_cast<size_t>(header.width) * header.height);
+		std::vector<std::pair<int, int>> trees;
+		for (size_t s = 0; s < shards.size(); s++) {
+			const ShardRegion& shard = shards[s];
+			for (int y = shard.originY; y < shard.originY + shard.height; y++) {
+				for (int x = shard.originX; x < shard.originX + shard.width; x++) {
+					world::ChunkView view = stores[s]->readChunk(x, y);
+					if (!view.valid()) {
+						std::cout << "[ERROR] Chunk " << x << ", " << y << " missing in the shard " << s % shardsX << ", " << s / shardsX << std::endl;
+						return false;
+					}
+					trees.resize(view.treeCount());
+					for (size_t t = 0; t < trees.size(); t++)
+						trees[t] = { view.trees[t * 2], view.trees[t * 2 + 1] };
+					if (!merged.writeChunk(x, y, view.heights, view.biomes, trees))
+						return false;
+					owners[static_cast<size_t>(y) * header.width + x] = static_cast<int>(s);
+					report.chunkCount++;
+				}
+			}
+		}
+		if (!merged.remap())
+			return false;
+
+		//Margin chunks of every shard, ring by ring around the shard until the ring has no stored chunk
+		for (size_t s = 0; s < shards.size(); s++) {
+			const ShardRegion& shard = shards[s];
+			for (int ring = 1;; ring++) {
+				int x0 = shard.originX - ring, y0 = shard.originY - ring;
+				int x1 = shard.originX + shard.width + ring - 1, y1 = shard.originY + shard.height + ring - 1;
+				bool found = false;
+				for (int y = std::max(y0, 0); y <= std::min(y1, header.height - 1); y++) {
+					for (int x = std::max(x0, 0); x <= std::min(x1, header.width - 1); x++) {
+						if ((x != x0 && x != x1 && y != y0 && y != y1) || !stores[s]->hasChunk(x, y))
+							continue;
+						found = true;
+						report.seamChunks++;
+						if (!sameChunk(stores[s]->readChunk(x, y), merged.readChunk(x, y))) {
+							report.mismatchedChunks++;
+							std::cout << "[ERROR] Seam mismatch: chunk " << x << ", " << y << " of the shard " << s % shardsX << ", " << s / shardsX
+								<< " differs from its owner" << std::endl;
+						}
+					}
+				}
+				if (!found)
+					break;
+			}
+		}
+
+		//Trees of the neighbouring chunks of different shards keep the minimal distance
+		float minDistanceSquared = header.vegetationMinDistance * header.vegetationMinDistance;
+		for (int y = 0; y < header.height; y++) {
+			for (int x = 0; x < header.width; x++) {
+				int owner = owners[static_cast<size_t>(y) * header.width + x];
+				world::ChunkView view = merged.readChunk(x, y);
+				//Only the neighbours after the chunk, so every pair of chunks is checked once
+				for (auto [i, j] : { std::pair{ 1, 0 }, std::pair{ -1, 1 }, std::pair{ 0, 1 }, std::pair{ 1, 1 } }) {
+					int nx = x + i, ny = y + j;
+					if (nx < 0 || ny >= header.height || nx >= header.width || owners[static_cast<size_t>(ny) * header.width + nx] == owner)
+						continue;
+					world::ChunkView neighbour = merged.readChunk(nx, ny);
+					for (size_t a = 0; a < view.treeCount(); a++) {
+						for (size_t b = 0; b < neighbour.treeCount(); b++) {
+							float dx = static_cast<float>(view.trees[a * 2] - neighbour.trees[b * 2]);
+							float dy = static_cast<float>(view.trees[a * 2 + 1] - neighbour.trees[b * 2 + 1]);
+							if (dx * dx + dy * dy < minDistanceSquared)
+								report.treeConflicts++;
+						}
+					}
+				}
+			}
+		}
+
+		std::cout << "[LOG] Merged " << report.chunkCount << " chunks of " << report.shardCount << " shards, " << report.seamChunks << " seam chunks checked, "
+			<< report.mismatchedChunks << " mismatched, " << report.treeConflicts << " tree conflicts" << std::endl;
+		return report.mismatchedChunks == 0 && report.treeConflicts == 0;
+	}
+}
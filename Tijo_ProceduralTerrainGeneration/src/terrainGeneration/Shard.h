@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "GenerationConfig.h"
+
+//Generation of the world split into the rectangular shards, generated independently by separate processes or hosts
+//
+//Every stage of the generation depends only on the seed and the world coordinates (see TerrainGenerator::setShard),
+//so the shard is identical to the same part of the world generated at once. Shard is generated together with
+//the margin of the neighbouring chunks, which vegetation near the border of the shard needs. Shard file is
+//the world file (see WorldStore.h) with the header of the whole world, containing the chunks of the shard and
+//the chunks of its margin, the margin chunks without the trees. With the chunked erosion the chunks up to
+//TerrainGenerator::EROSION_REACH chunks beyond the margin are generated as well, but not written.
+//
+//Merge copies the chunks of every shard into one world file and verifies the seams: every margin chunk has to be
+//bit-identical to the chunk of the shard owning it and no two trees of different shards can be closer than
+//the minimal distance of the vegetation.
+
+namespace shard
+{
+	//Chunks owned by the shard, in the world coordinates
+	struct ShardRegion {
+		int originX = 0, originY = 0;
+		int width = 0, height = 0;
+	};
+
+	struct MergeReport {
+		int shardCount = 0;
+		int chunkCount = 0;
+		int seamChunks = 0;			//Margin chunks compared with the chunks of their owners
+		int mismatchedChunks = 0;	//Margin chunks different from the chunks of their owners
+		int treeConflicts = 0;		//Pairs of trees of different shards closer than the minimal distance
+	};
+
+	std::vector<ShardRegion> planShards(int worldWidth, int worldHeight, int shardsX, int shardsY);
+	std::string shardPath(const std::string& worldPath, int shardX, int shardY);
+
+	bool generateShard(const config::GenerationConfig& config, int shardsX, int shardsY, int shardX, int shardY, int margin, const std::string& path);
+	bool mergeShards(const std::string& worldPath, int shardsX, int shardsY, MergeReport& report);
+}
@@ -1,14 +1,19 @@
 #include "TerrainGenerator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
 #include <math.h>
 
-#include "PoissonGenerator.h"
+#include "JobSystem.h"
 
-TerrainGenerator::TerrainGenerator() : width(0), height(0), seed(0), chunkResolution(0),
-heightMap(nullptr), biomeMap(nullptr), biomeMapPerChunk(nullptr),
-continentalnessNoise(), mountainousNoise(), PVNoise(), continentalnessSpline(), mountainousSpline(), PVSpline(),
-seeLevel(64.0f), biomeGen()
+TerrainGenerator::TerrainGenerator() : heightMap(nullptr), biomeMap(nullptr), biomeMapPerChunk(nullptr), seed(0), width(0), height(0),
+chunkResolution(0), originX(0), originY(0), worldWidth(0), worldHeight(0), mapLayout(layout::MapLayout::ROW_MAJOR), indexer(),
+seeLevel(64.0f), vegetationMinDistance(2.0f), continentalnessNoise(), mountainousNoise(), PVNoise(), continentalnessSpline(), mountainousSpline(), PVSpline(),
+biomeGen(), erosionConfig(), erosionDroplets(0), erosionHalo(0), chunkCache(&cache::ChunkCache::get())
 {
 	mountainousNoise.getConfigRef().option = noise::Options::NOTHING;
 	continentalnessNoise.getConfigRef().option = noise::Options::NOTHING;
@@ -18,10 +23,8 @@ seeLevel(64.0f), biomeGen()
 
 TerrainGenerator::~TerrainGenerator()
 {
-	if(heightMap)
-		delete[] heightMap;
-	if (biomeMap)
-		delete[] biomeMap;
+	layout::releaseMap(heightMap);
+	layout::releaseMap(biomeMap);
 	if(biomeMapPerChunk)
 		delete[] biomeMapPerChunk;
 }
@@ -31,10 +34,11 @@ bool TerrainGenerator::initializeMap()
 	if (width <= 0 || height <= 0 || chunkResolution <= 0)
 		return false;
 
-	if (heightMap)
-		delete[] heightMap;
+	layout::releaseMap(heightMap);
 
-	heightMap = new float[width * chunkResolution * height * chunkResolution];
+	indexer = layout::MapIndexer(mapLayout, width, height, chunkResolution, chunkResolution);
+	heightMap = layout::allocateMap<float>(indexer.size());
+	vegetationChunks.assign(width * height, std::vector<std::pair<int, int>>());
 
 	return true;
 }
@@ -44,10 +48,10 @@ bool TerrainGenerator::initializeBiomeMap()
 	if (width <= 0 || height <= 0 || chunkResolution <= 0)
 		return false;
 
-	if (biomeMap)
-		delete[] biomeMap;
+	layout::releaseMap(biomeMap);
 
-	biomeMap = new int[width * chunkResolution * height * chunkResolution];
+	indexer = layout::MapIndexer(mapLayout, width, height, chunkResolution, chunkResolution);
+	biomeMap = layout::allocateMap<int>(indexer.size());
 
 	return true;
 }
@@ -56,7 +60,7 @@ bool TerrainGenerator::deinitalizeBiomeMap()
 {
 	if (biomeMap)
 	{
-		delete[] biomeMap;
+		layout::releaseMap(biomeMap);
 		biomeMap = nullptr;
 	}
 	if (biomeMapPerChunk)
@@ -135,6 +139,7 @@ bool TerrainGenerator::setSplines(std::vector<std::vector<double>> splines)
 	continentalnessSpline.set_points(splines[0], splines[1]);
 	mountainousSpline.set_points(splines[2], splines[3]);
 	PVSpline.set_points(splines[4], splines[5]);
+	splinePoints = splines;
 
 	return true;
 }
@@ -149,6 +154,127 @@ bool TerrainGenerator::setBiomes(std::vector<biome::Biome>& biomes)
 	return true;
 }
 
+//Sets the function building the mesh of a single chunk, it is invoked from the job system threads
+//during performTerrainGeneration, possibly for many chunks at the same time
+//
+//@param callback - function taking the coordinates of the chunk, empty function disables meshing
+void TerrainGenerator::setChunkMeshCallback(std::function<void(int chunkX, int chunkY)> callback)
+{
+	chunkMeshCallback = std::move(callback);
+}
+
+//Enables the cache of the finished generations, performTerrainGeneration loads the world generated with the identical
+//config before from the directory instead of generating it and stores every new world there
+//
+//@param directory - directory of the cache, created when needed, empty string disables the cache
+void TerrainGenerator::setCacheDirectory(const std::string& directory)
+{
+	cacheDirectory = directory;
+}
+
+//Sets the in-memory cache of the generated chunks, performTerrainGeneration takes the chunks generated with
+//the identical config from it instead of generating them again and stores the newly generated ones there
+//
+//@param chunkCache - cache shared with the other generators, nullptr disables the cache
+void TerrainGenerator::setChunkCache(cache::ChunkCache* chunkCache)
+{
+	this->chunkCache = chunkCache;
+}
+
+//Generates only the shard of the larger world, the size of the shard is set by setSize
+//Noises, biomes and vegetation are evaluated at the world coordinates, so shards generated by separate processes
+//match each other at their borders exactly. Chunks are stored in the world files and the chunk cache under their world
+//coordinates, the cache directory is not used since it keeps only whole worlds.
+//Vegetation of the chunk depends on its neighbouring chunks, so the shard should be generated with one chunk of margin,
+//the eroded chunk depends on the chunks up to EROSION_REACH chunks away.
+//
+//@param originX, originY - world coordinates of the first chunk of the shard
+//@param worldWidth, worldHeight - size of the world in chunks, 0 generates the whole world again
+//@return bool - false if the shard doesnt fit into the world
+bool TerrainGenerator::setShard(int originX, int originY, int worldWidth, int worldHeight)
+{
+	if (worldWidth == 0 && worldHeight == 0) {
+		originX = originY = 0;
+	}
+	else if (originX < 0 || originY < 0 || worldWidth <= 0 || worldHeight <= 0 || originX + width > worldWidth || originY + height > worldHeight) {
+		std::cout << "[ERROR] Shard doesnt fit into the world" << std::endl;
+		return false;
+	}
+
+	this->originX = originX;
+	this->originY = originY;
+	this->worldWidth = worldWidth;
+	this->worldHeight = worldHeight;
+	return true;
+}
+
+//Enables the erosion stage of performTerrainGeneration (see erodeChunk), heights of the chunks are eroded before
+//their biomes are evaluated. Droplets are given per chunk, so the chunk is eroded the same in the shard and in the whole world.
+//
+//@param config - parameters of the droplets
+//@param dropletsPerChunk - droplets spawned in every chunk, 0 disables the stage
+//@param halo - samples of the neighbouring chunks around the chunk the droplets can reach, at most half of the chunk,
+//				0 takes half of the chunk
+//@return bool - false if the droplets are negative or the halo is wider than half of the chunk
+bool TerrainGenerator::setErosion(const erosion::ErosionConfig& config, int dropletsPerChunk, int halo)
+{
+	if (dropletsPerChunk < 0 || halo < 0 || (chunkResolution > 0 && halo > chunkResolution / 2)) {
+		std::cout << "[ERROR] Erosion needs at least 0 droplets and the halo of at most half of the chunk" << std::endl;
+		return false;
+	}
+
+	erosionConfig = config;
+	erosionDroplets = dropletsPerChunk;
+	erosionHalo = halo;
+	return true;
+}
+
+//Halo of the eroded chunks, limited to half of the chunk since the chunk resolution can change after setErosion
+int TerrainGenerator::getErosionHalo() const
+{
+	return erosionHalo > 0 ? std::min(erosionHalo, chunkResolution / 2) : chunkResolution / 2;
+}
+
+//Hash of every input of the generation: sizes, seed, see level, vegetation distance, noise configs, splines,
+//ranges, biomes and the erosion stage. Layout of the maps doesnt change the result, so it is not part of it.
+//Shard has the hash of the whole world, since its chunks are the same as the chunks of the world.
+//Seeds of the noises are derived from the world seed when the generation starts, so they are left out
+//
+//@return uint64_t - hash identifying the generated world
+uint64_t TerrainGenerator::getConfigHash() const
+{
+	hashing::Hasher hasher;
+	hasher.add(getWorldWidth()).add(getWorldHeight()).add(chunkResolution).add(seed).add(seeLevel).add(vegetationMinDistance);
+	hasher.add(continentalnessNoise.getConfig().getHash(false)).add(mountainousNoise.getConfig().getHash(false)).add(PVNoise.getConfig().getHash(false));
+	hasher.add(splinePoints);
+	hasher.add(biomeGen.getConfigHash());
+	if (isErosionEnabled()) {
+		const erosion::ErosionConfig& c = erosionConfig;
+		hasher.add(erosionDroplets).add(getErosionHalo());
+		hasher.add(c.erosionRate).add(c.depositionRate).add(c.evaporationRate).add(c.gravity).add(c.inertia).add(c.minSlope).add(c.erosionRadius).add(c.blur);
+		hasher.add(c.dropletLifetime).add(c.initialWater).add(c.initialVelocity).add(c.initialCapacity).add(c.talusSlope).add(c.thermalRate).add(c.thermalInterval);
+	}
+	return hasher.get();
+}
+
+//Sets the minimal distance between two trees, it is kept also between trees of neighbouring chunks
+//Distance can not exceed the chunk resolution, vegetation of the chunk would depend on the chunks behind its direct
+//neighbours, which neither the task graph nor the shard margin waits for. It is checked by performTerrainGeneration,
+//so the distance can be set before the chunk resolution.
+//
+//@param minDistance - distance in cells of the map, has to be at least 1
+bool TerrainGenerator::setVegetationMinDistance(float minDistance)
+{
+	if (minDistance < 1.0f) {
+		std::cout << "[ERROR] Vegetation min distance has to be at least 1" << std::endl;
+		return false;
+	}
+
+	vegetationMinDistance = minDistance;
+
+	return true;
+}
+
 bool TerrainGenerator::setRanges(std::vector<std::vector<RangedLevel>>& ranges)
 {
 	if (ranges.size() != 4)
@@ -159,21 +285,93 @@ bool TerrainGenerator::setRanges(std::vector<std::vector<RangedLevel>>& ranges)
 	return true;
 }
 
+//Raw maps are stored in the layout of the generator, with CHUNK_MAJOR layout they are not row by row,
+//cells have to be addressed through getMapIndexer, or copied row by row with copyHeightMap
 float* TerrainGenerator::getHeightMap()
 {
 	return heightMap;
 }
 
+//Stored in the layout of the generator, see getHeightMap
 int* TerrainGenerator::getBiomeMap()
 {
 	return biomeMap;
 }
 
+//Changes the order in which the height, biome and noise maps are stored, already generated maps are converted
+//Chunk-major layout keeps every chunk in one contiguous aligned block, so the chunk can be processed or handed off as a whole
+//
+//@param mapLayout - new layout of the maps
+//@return bool - false if the maps couldnt be converted
+bool TerrainGenerator::setMapLayout(layout::MapLayout mapLayout)
+{
+	if (this->mapLayout == mapLayout)
+		return true;
+
+	layout::MapIndexer converted(mapLayout, indexer.width, indexer.height, indexer.chunkWidth, indexer.chunkHeight);
+	if (heightMap) {
+		float* map = layout::allocateMap<float>(converted.size());
+		if (!layout::convertLayout(heightMap, indexer, map, converted)) {
+			layout::releaseMap(map);
+			std::cout << "[ERROR] HeightMap couldnt be converted" << std::endl;
+			return false;
+		}
+		layout::releaseMap(heightMap);
+		heightMap = map;
+	}
+	if (biomeMap) {
+		int* map = layout::allocateMap<int>(converted.size());
+		if (!layout::convertLayout(biomeMap, indexer, map, converted)) {
+			layout::releaseMap(map);
+			std::cout << "[ERROR] BiomeMap couldnt be converted" << std::endl;
+			return false;
+		}
+		layout::releaseMap(biomeMap);
+		biomeMap = map;
+	}
+
+	this->mapLayout = mapLayout;
+	indexer = converted;
+
+	continentalnessNoise.setLayout(mapLayout);
+	mountainousNoise.setLayout(mapLayout);
+	PVNoise.setLayout(mapLayout);
+
+	return true;
+}
+
+//@return std::span<const float> - heights of the chunk, row after row, empty if the map is not chunk-major
+std::span<const float> TerrainGenerator::getHeightChunk(int chunkX, int chunkY) const
+{
+	if (!heightMap || mapLayout != layout::MapLayout::CHUNK_MAJOR || chunkX < 0 || chunkY < 0 || chunkX >= indexer.width || chunkY >= indexer.height)
+		return {};
+	return std::span<const float>(heightMap + indexer.chunkOffset(chunkX, chunkY), static_cast<size_t>(chunkResolution) * chunkResolution);
+}
+
+//@return std::span<const int> - biomes of the chunk, row after row, empty if the map is not chunk-major
+std::span<const int> TerrainGenerator::getBiomeChunk(int chunkX, int chunkY) const
+{
+	if (!biomeMap || mapLayout != layout::MapLayout::CHUNK_MAJOR || chunkX < 0 || chunkY < 0 || chunkX >= indexer.width || chunkY >= indexer.height)
+		return {};
+	return std::span<const int>(biomeMap + indexer.chunkOffset(chunkX, chunkY), static_cast<size_t>(chunkResolution) * chunkResolution);
+}
+
+//Copies the height map in the row-major order, whatever the layout of the map is
+//
+//@param destination - array of getWidth() * getHeight() floats
+//@return bool - false if the height map is not initialized
+bool TerrainGenerator::copyHeightMap(float* destination) const
+{
+	if (!heightMap || !destination)
+		return false;
+	return layout::convertLayout(heightMap, indexer, destination, layout::MapIndexer(layout::MapLayout::ROW_MAJOR, indexer.width, indexer.height, indexer.chunkWidth, indexer.chunkHeight));
+}
+
 float TerrainGenerator::getHeightAt(int x, int y)
 {
 	if (!heightMap)
 		return -1.0f;
-	return heightMap[y * width * chunkResolution + x];
+	return heightMap[indexer.index(x, y)];
 }
 
 biome::Biome& TerrainGenerator::getBiome(int id)
@@ -185,7 +383,7 @@ int TerrainGenerator::getBiomeAt(int x, int y)
 {
 	if (!biomeMap)
 		return -1;	
-	return biomeMap[y * width * chunkResolution + x];
+	return biomeMap[indexer.index(x, y)];
 }
 
 noise::NoiseConfigParameters& TerrainGenerator::getContinentalnessNoiseConfig()
@@ -214,33 +412,74 @@ noise::NoiseConfigParameters& TerrainGenerator::getHumidityNoiseConfig()
 }
 
 bool TerrainGenerator::generateHeightMap()
+{
+	if (!prepareHeightMapNoise())
+		return false;
+
+	std::cout << "[LOG] Evaluating heightMap..." << std::endl;
+
+	//Every chunk of the height map is evaluated independently by the job system
+	jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this](int chunkX, int chunkY) {
+		generateHeightMapChunk(chunkX, chunkY);
+	});
+
+	std::cout << "[LOG] HeightMap succesfully evaluated " << std::endl;
+	return true;
+}
+
+//Seeds the noises the height map is built from and allocates their maps
+//
+//@return bool - false if the height map is not initialized
+bool TerrainGenerator::prepareHeightMapNoise()
 {
 	if (!heightMap || width <= 0 || height <= 0 || chunkResolution <= 0) {
 		std::cout << "[ERROR] HeightMap not initialized" << std::endl;
 		return false;
 	}
 
+	if (isShard() && (originX + width > worldWidth || originY + height > worldHeight)) {
+		std::cout << "[ERROR] Shard doesnt fit into the world" << std::endl;
+		return false;
+	}
+
+	for (noise::SimplexNoiseClass* noise : { &continentalnessNoise, &mountainousNoise, &PVNoise })
+		noise->setWorldRegion(originX, originY, worldWidth, worldHeight);
+	biomeGen.setWorldRegion(originX, originY, worldWidth, worldHeight);
+
 	continentalnessNoise.setSeed(seed);
 	continentalnessNoise.initMap();
-	continentalnessNoise.generateFractalNoiseByChunks();
 
 	mountainousNoise.setSeed(seed/2);
 	mountainousNoise.initMap();
-	mountainousNoise.generateFractalNoiseByChunks();
 
 	PVNoise.setSeed(seed/3);
 	PVNoise.initMap();
-	PVNoise.generateFractalNoiseByChunks();
 
-	std::cout << "[LOG] Evaluating heightMap..." << std::endl;
+	return true;
+}
+
+//Generates the noises of the single chunk and evaluates its heights
+//Only cells of the given chunk are written so chunks can be processed at the same time
+//
+//@param chunkX - x coordinate of the chunk
+//@param chunkY - y coordinate of the chunk
+//@return bool - false if the noises were not prepared or the chunk is outside of the map
+bool TerrainGenerator::generateHeightMapChunk(int chunkX, int chunkY)
+{
+	if (!continentalnessNoise.generateFractalNoiseChunk(chunkX, chunkY) ||
+		!mountainousNoise.generateFractalNoiseChunk(chunkX, chunkY) ||
+		!PVNoise.generateFractalNoiseChunk(chunkX, chunkY))
+		return false;
 
 	float continentalness = 0.0f;
 	float mountainous = 0.0f;
 	float PV = 0.0f;
 	float elevation = 0.0f;
 
-	for (int y = 0; y < height * chunkResolution; y++) {
-		for (int x = 0; x < width * chunkResolution; x++) {
+	for (int y = chunkY * chunkResolution; y < (chunkY + 1) * chunkResolution; y++) {
+		//Row of the chunk is contiguous in every layout
+		float* row = heightMap + indexer.index(chunkX * chunkResolution, y) - chunkX * chunkResolution;
+		for (int x = chunkX * chunkResolution; x < (chunkX + 1) * chunkResolution; x++) {
 			continentalness = continentalnessNoise.getVal(x, y);
 			mountainous = mountainousSpline(mountainousNoise.getVal(x, y));
 			PV = PVSpline(PVNoise.getVal(x, y));
@@ -260,11 +499,9 @@ bool TerrainGenerator::generateHeightMap()
 
 			elevation = continentalnessSpline(continentalness) + mountainous - (PV * 20.0f);
 
-			heightMap[y * width * chunkResolution + x] = elevation;
+			row[x] = elevation;
 		}
 	}
-
-	std::cout << "[LOG] HeightMap succesfully evaluated " << std::endl;
 	return true;
 }
 
@@ -274,65 +511,553 @@ bool TerrainGenerator::generateBiomes()
 		return false;
 	}
 
-	if (!biomeGen.biomify(heightMap ,biomeMap, width, height, chunkResolution, seed, continentalnessNoise, mountainousNoise)) {
+	if (!biomeGen.biomify(heightMap ,biomeMap, width, height, chunkResolution, seed, continentalnessNoise, mountainousNoise, mapLayout)) {
 		return false;
 	}
 
 	return true;
 }
 
+bool TerrainGenerator::generateBiomeMapChunk(int chunkX, int chunkY)
+{
+	return biomeGen.biomifyChunk(heightMap, biomeMap, indexer, chunkX, chunkY, continentalnessNoise, mountainousNoise);
+}
+
+//Runs the whole generation as a graph of per chunk tasks instead of a sequence of stages over the whole map
+//Chunk goes height -> biome -> chunk biome -> vegetation, as soon as its own dependencies are done,
+//so the stages of different chunks overlap. Mesh callback of the chunk runs once heights of the chunk
+//and of its right, bottom and bottom-right neighbours are ready (normals on its border need them) and its biomes are known.
+//Vegetation of the chunk waits for the biomes of its neighbours since minimal distance is kept across the borders.
+//Chunks found in the chunk cache are copied into the maps by their height task, newly generated chunks are added to it.
+//With the erosion stage (see setErosion) the chunk is eroded once the heights of its neighbours are ready and the neighbours
+//of the earlier phases are eroded (see erodeChunk), its heights are final once all of its neighbours are eroded.
+//Chunk cache keeps the chunks independent of their neighbours, so it is not used with the erosion.
 bool TerrainGenerator::performTerrainGeneration()
 {
-	if (!generateHeightMap())
+	if (vegetationMinDistance > chunkResolution) {
+		std::cout << "[ERROR] Vegetation min distance larger than the chunk resolution" << std::endl;
+		return false;
+	}
+
+	if (loadFromCache())
+		return true;
+
+	if (!prepareHeightMapNoise())
 	{
 		std::cout << "[ERROR] HeightMap couldnt be generated" << std::endl;
 		return false;
 	}
-
-	if (!generateBiomes())
+	if (!initializeBiomeMap() || !biomeGen.prepareNoise(width, height, chunkResolution, seed, mapLayout))
 	{
 		std::cout << "[ERROR] Biomes couldnt be generated" << std::endl;
 		return false;
 	}
-	if (!generateBiomeMapPerChunk())
-	{
-		std::cout << "[ERROR] BiomeMapPerChunk couldnt be generated" << std::endl;
+
+	if (biomeMapPerChunk)
+		delete[] biomeMapPerChunk;
+	biomeMapPerChunk = new int[width * height];
+
+	vegetationChunks.assign(width * height, std::vector<std::pair<int, int>>());
+
+	std::vector<int> heightNodes(width * height);
+	std::vector<int> biomeNodes(width * height);
+	std::vector<int> chunkBiomeNodes(width * height);
+	std::vector<int> vegetationNodes(width * height);
+	std::atomic<bool> failed{ false };
+	jobs::TaskGraph graph;
+
+	//Chunks found in the chunk cache skip the noise, biome and vegetation evaluation
+	bool useChunkCache = chunkCache && !isErosionEnabled();
+	uint64_t configHash = useChunkCache ? getConfigHash() : 0;
+	std::vector<std::shared_ptr<const cache::CachedChunk>> cachedChunks(width * height);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int id = y * width + x;
+
+			heightNodes[id] = graph.addNode([this, x, y, id, configHash, useChunkCache, &cachedChunks, &failed]() {
+				if (useChunkCache)
+					cachedChunks[id] = chunkCache->find({ configHash, originX + x, originY + y });
+				if (cachedChunks[id])
+					writeChunkCells(x, y, cachedChunks[id]->heights, cachedChunks[id]->biomes);
+				else if (!generateHeightMapChunk(x, y))
+					failed = true;
+			});
+			biomeNodes[id] = graph.addNode([this, x, y, id, &cachedChunks, &failed]() {
+				if (!cachedChunks[id] && !generateBiomeMapChunk(x, y))
+					failed = true;
+			});
+			chunkBiomeNodes[id] = graph.addNode([this, x, y]() {
+				generateChunkBiome(x, y);
+			});
+			vegetationNodes[id] = graph.addNode([this, x, y, id, configHash, useChunkCache, &cachedChunks]() {
+				if (cachedChunks[id]) {
+					vegetationChunks[id] = cachedChunks[id]->trees;
+					return;
+				}
+				vegetationGenerationChunk(x, y);
+				if (useChunkCache)
+					cacheChunk(configHash, x, y);
+			});
+
+			graph.addDependency(biomeNodes[id], chunkBiomeNodes[id]);
+		}
+	}
+
+	//Node after which the heights of the chunk are final
+	std::vector<int> settledNodes = heightNodes;
+	if (isErosionEnabled()) {
+		std::vector<int> erosionNodes(width * height);
+		for (int id = 0; id < width * height; id++) {
+			erosionNodes[id] = graph.addNode([this, id, &failed]() {
+				if (!erodeChunk(id % width, id / width))
+					failed = true;
+			});
+			settledNodes[id] = graph.addNode([]() {});
+		}
+
+		//Windows of the neighbouring chunks overlap, the chunks of the earlier phase are eroded first
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				int id = y * width + x;
+				for (int j = std::max(y - 1, 0); j <= std::min(y + 1, height - 1); j++) {
+					for (int i = std::max(x - 1, 0); i <= std::min(x + 1, width - 1); i++) {
+						int neighbour = j * width + i;
+						graph.addDependency(heightNodes[neighbour], erosionNodes[id]);
+						graph.addDependency(erosionNodes[neighbour], settledNodes[id]);
+						if (erosionPhase(i, j) < erosionPhase(x, y))
+							graph.addDependency(erosionNodes[neighbour], erosionNodes[id]);
+					}
+				}
+			}
+		}
+	}
+	for (int id = 0; id < width * height; id++)
+		graph.addDependency(settledNodes[id], biomeNodes[id]);
+
+	//Trees near the border are checked against the candidates of the neighbouring chunks,
+	//which need their heights and biomes
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			for (int j = std::max(y - 1, 0); j <= std::min(y + 1, height - 1); j++)
+				for (int i = std::max(x - 1, 0); i <= std::min(x + 1, width - 1); i++)
+					graph.addDependency(chunkBiomeNodes[j * width + i], vegetationNodes[y * width + x]);
+
+	if (chunkMeshCallback) {
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				int meshNode = graph.addNode([this, x, y]() {
+					chunkMeshCallback(x, y);
+				});
+
+				graph.addDependency(biomeNodes[y * width + x], meshNode);
+				for (int j = y; j <= std::min(y + 1, height - 1); j++)
+					for (int i = x; i <= std::min(x + 1, width - 1); i++)
+						graph.addDependency(settledNodes[j * width + i], meshNode);
+			}
+		}
+	}
+
+	std::cout << "[LOG] Running terrain generation graph of " << graph.size() << " tasks..." << std::endl;
+	graph.run();
+
+	if (useChunkCache) {
+		int cachedCount = static_cast<int>(std::count_if(cachedChunks.begin(), cachedChunks.end(), [](const auto& it) { return it != nullptr; }));
+		std::cout << "[LOG] " << cachedCount << " of " << width * height << " chunks taken from the chunk cache" << std::endl;
+	}
+
+	if (failed) {
+		std::cout << "[ERROR] Terrain couldnt be generated" << std::endl;
 		return false;
 	}
-	if (!vegetationGeneration())
-	{
-		std::cout << "[ERROR] Vegetation couldnt be generated" << std::endl;
+
+	buildVegetation();
+
+	std::cout << "[LOG] Terrain succesfully generated" << std::endl;
+	saveToCache();
+	return true;
+}
+
+std::string TerrainGenerator::getCachePath() const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.world", static_cast<unsigned long long>(getConfigHash()));
+	return (std::filesystem::path(cacheDirectory) / name).string();
+}
+
+//Loads the world of the current config from the cache directory and runs the mesh callback for every chunk
+//
+//@return bool - false if the cache is disabled or the world is not cached
+bool TerrainGenerator::loadFromCache()
+{
+	if (cacheDirectory.empty() || isShard())
 		return false;
+
+	world::WorldStore store;
+	if (!store.open(getCachePath()) || !loadWorld(store))
+		return false;
+
+	if (chunkMeshCallback) {
+		jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this](int x, int y) {
+			chunkMeshCallback(x, y);
+		});
 	}
 
+	std::cout << "[LOG] Terrain loaded from the cache " << getCachePath() << std::endl;
+	return true;
+}
+
+//Stores the generated world in the cache directory under the hash of its config
+bool TerrainGenerator::saveToCache()
+{
+	if (cacheDirectory.empty() || isShard())
+		return false;
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+
+	world::WorldStore store;
+	if (!store.create(getCachePath(), getWorldHeader()) || !saveWorld(store)) {
+		std::cout << "[ERROR] Terrain couldnt be stored in the cache" << std::endl;
+		return false;
+	}
 	return true;
 }
 
+//Copies the cells of the chunk out of the maps into the row by row arrays
+//
+//@param chunkX, chunkY - coordinates of the chunk
+//@param heights, biomes - outputs of chunkResolution * chunkResolution elements
+void TerrainGenerator::readChunkCells(int chunkX, int chunkY, std::span<float> heights, std::span<int> biomes) const
+{
+	for (int j = 0; j < chunkResolution; j++) {
+		size_t row = indexer.index(chunkX * chunkResolution, chunkY * chunkResolution + j);
+		std::copy(heightMap + row, heightMap + row + chunkResolution, heights.begin() + j * chunkResolution);
+		std::copy(biomeMap + row, biomeMap + row + chunkResolution, biomes.begin() + j * chunkResolution);
+	}
+}
+
+//Copies the row by row arrays into the cells of the chunk, only cells of the chunk are written
+void TerrainGenerator::writeChunkCells(int chunkX, int chunkY, std::span<const float> heights, std::span<const int> biomes)
+{
+	for (int j = 0; j < chunkResolution; j++) {
+		size_t row = indexer.index(chunkX * chunkResolution, chunkY * chunkResolution + j);
+		std::copy_n(heights.begin() + j * chunkResolution, chunkResolution, heightMap + row);
+		std::copy_n(biomes.begin() + j * chunkResolution, chunkResolution, biomeMap + row);
+	}
+}
+
+//Stores the generated chunk in the chunk cache, heights, biomes and vegetation of the chunk have to be final
+//
+//@param configHash - config hash of the generator, computed once for the whole generation
+//@param chunkX, chunkY - coordinates of the chunk
+//@return bool - false if the cache is disabled or the chunk doesnt fit into it
+bool TerrainGenerator::cacheChunk(uint64_t configHash, int chunkX, int chunkY)
+{
+	if (!chunkCache)
+		return false;
+
+	//Trees of the chunk on the border of the shard miss the candidates of the chunks beyond it, unless it is the border of the world
+	if ((chunkX == 0 && originX > 0) || (chunkY == 0 && originY > 0) ||
+		(chunkX == width - 1 && originX + width < getWorldWidth()) || (chunkY == height - 1 && originY + height < getWorldHeight()))
+		return false;
+
+	auto chunk = std::make_shared<cache::CachedChunk>();
+	chunk->heights.resize(chunkResolution * chunkResolution);
+	chunk->biomes.resize(chunkResolution * chunkResolution);
+	readChunkCells(chunkX, chunkY, chunk->heights, chunk->biomes);
+	chunk->trees = vegetationChunks[chunkY * width + chunkX];
+	return chunkCache->insert({ configHash, originX + chunkX, originY + chunkY }, std::move(chunk));
+}
+
 bool TerrainGenerator::vegetationGeneration()
 {
 	if (!biomeMap || !biomeMapPerChunk) {
 		std::cout << "[ERROR] BiomeMap or BiomeMapPerChunk not initialized" << std::endl;
 		return false;
 	}
+	if (vegetationMinDistance > chunkResolution) {
+		std::cout << "[ERROR] Vegetation min distance larger than the chunk resolution" << std::endl;
+		return false;
+	}
 
-	treeCount = 0;
-	PoissonGenerator::DefaultPRNG PRNG;
-	vegetationPoints.resize(width * height);
+	vegetationChunks.assign(width * height, std::vector<std::pair<int, int>>());
 
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			const auto Points = PoissonGenerator::generatePoissonPoints(getBiome(biomeMapPerChunk[y * width + x]).getVegetationLevel(), PRNG);
+	//Every chunk derives its random values from the seed and cell coordinates only, so the order does not matter
+	jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this](int x, int y) {
+		vegetationGenerationChunk(x, y);
+	});
 
-			for (int i = 0; i < Points.size(); i++)
-			{
-				if (getHeightAt(Points[i].x * chunkResolution + (x * chunkResolution), Points[i].y * chunkResolution + (y * chunkResolution)) < seeLevel)
-					continue;	
-				vegetationPoints[y * width + x].push_back(std::make_pair(Points[i].x * chunkResolution + (x * chunkResolution), Points[i].y * chunkResolution + (y * chunkResolution)));
-				treeCount++;
-			}
+	return buildVegetation();
+}
+
+//Flattens the trees generated per chunk into the vegetation map and indexes them
+//Called after vegetation of every chunk is generated, cells of the index have the size of the chunk
+bool TerrainGenerator::buildVegetation()
+{
+	return vegetation.build(vegetationChunks, heightMap, indexer, chunkResolution);
+}
+
+//Removes the trees, e.g. the ones returned by the query of the vegetation map
+//
+//@param indices - indices of the trees in the vegetation map
+bool TerrainGenerator::removeVegetation(std::vector<uint32_t> indices)
+{
+	return vegetation.remove(std::move(indices));
+}
+
+//Header of the world file describing the current generation config
+//Splines, biomes and ranges are covered only by the config hash
+world::WorldHeader TerrainGenerator::getWorldHeader()
+{
+	world::WorldHeader header;
+	header.width = getWorldWidth();
+	header.height = getWorldHeight();
+	header.chunkResolution = chunkResolution;
+	header.seed = seed;
+	header.seeLevel = seeLevel;
+	header.vegetationMinDistance = vegetationMinDistance;
+	header.continentalness = world::NoiseRecord::fromConfig(continentalnessNoise.getConfigRef());
+	header.mountainous = world::NoiseRecord::fromConfig(mountainousNoise.getConfigRef());
+	header.PV = world::NoiseRecord::fromConfig(PVNoise.getConfigRef());
+
+	//Seeds of the noises are derived from the world seed when the generation starts
+	header.continentalness.seed = seed;
+	header.mountainous.seed = seed / 2;
+	header.PV.seed = seed / 3;
+	header.configHash = getConfigHash();
+	return header;
+}
+
+//Writes heights, biomes and vegetation of the generated chunk to the world file
+//
+//@param store - world file created with the header of this generator
+//@param chunkX, chunkY - coordinates of the chunk
+//@return bool - false if the chunk is not generated or couldnt be written
+bool TerrainGenerator::storeChunk(world::WorldStore& store, int chunkX, int chunkY)
+{
+	if (!heightMap || !biomeMap || vegetationChunks.size() != static_cast<size_t>(width) * height || chunkX < 0 || chunkY < 0 || chunkX >= width || chunkY >= height)
+		return false;
+
+	//World file keeps the trees in the world coordinates
+	std::vector<std::pair<int, int>> shardTrees;
+	std::span<const std::pair<int, int>> trees = vegetationChunks[chunkY * width + chunkX];
+	if (isShard()) {
+		shardTrees.assign(trees.begin(), trees.end());
+		for (auto& [x, y] : shardTrees) {
+			x += originX * chunkResolution;
+			y += originY * chunkResolution;
 		}
+		trees = shardTrees;
+	}
+
+	if (mapLayout == layout::MapLayout::CHUNK_MAJOR)
+		return store.writeChunk(originX + chunkX, originY + chunkY, getHeightChunk(chunkX, chunkY), getBiomeChunk(chunkX, chunkY), trees);
+
+	std::vector<float> heights(chunkResolution * chunkResolution);
+	std::vector<int> biomes(chunkResolution * chunkResolution);
+	readChunkCells(chunkX, chunkY, heights, biomes);
+	return store.writeChunk(originX + chunkX, originY + chunkY, heights, biomes, trees);
+}
+
+//Reads the chunk from the world file into the maps instead of generating it
+//Maps have to be initialized, chunks write only their own cells so they can be loaded at the same time
+//
+//@param store - world file with the header of this generator
+//@param chunkX, chunkY - coordinates of the chunk
+//@return bool - false if the chunk is not stored
+bool TerrainGenerator::loadChunk(const world::WorldStore& store, int chunkX, int chunkY)
+{
+	if (!heightMap || !biomeMap || !biomeMapPerChunk || vegetationChunks.size() != static_cast<size_t>(width) * height)
+		return false;
+
+	world::ChunkView view = store.readChunk(originX + chunkX, originY + chunkY);
+	if (!view.valid() || view.heights.size() != chunkResolution * chunkResolution)
+		return false;
+
+	writeChunkCells(chunkX, chunkY, view.heights, view.biomes);
+
+	std::vector<std::pair<int, int>>& trees = vegetationChunks[chunkY * width + chunkX];
+	trees.resize(view.treeCount());
+	for (size_t i = 0; i < trees.size(); i++)
+		trees[i] = { view.trees[i * 2] - originX * chunkResolution, view.trees[i * 2 + 1] - originY * chunkResolution };
+
+	return generateChunkBiome(chunkX, chunkY);
+}
+
+//Writes every chunk of the generated world to the world file
+//
+//@param store - world file created with the header of this generator
+//@return bool - false if any of the chunks couldnt be written
+bool TerrainGenerator::saveWorld(world::WorldStore& store)
+{
+	if (!store.isOpen() || store.getHeader() != getWorldHeader()) {
+		std::cout << "[ERROR] World file doesnt match the generator config" << std::endl;
+		return false;
 	}
 
+	for (int y = 0; y < height; y++)
+		for (int x = 0; x < width; x++)
+			if (!storeChunk(store, x, y))
+				return false;
+	//File is mapped once for the whole batch of the chunks
+	return store.remap();
+}
+
+//Loads the whole world from the world file, replaces the whole generation
+//Chunks are read straight from the mapping, so only the pages of the file that are touched are loaded
+//
+//@param store - world file with every chunk stored
+//@return bool - false if the file was generated with a different config or any chunk is missing
+bool TerrainGenerator::loadWorld(const world::WorldStore& store)
+{
+	if (!store.isOpen() || store.getHeader() != getWorldHeader()) {
+		std::cout << "[ERROR] World file doesnt match the generator config" << std::endl;
+		return false;
+	}
+	if (!isShard() && store.getStoredChunkCount() != static_cast<size_t>(width) * height) {
+		std::cout << "[ERROR] World file is not complete" << std::endl;
+		return false;
+	}
+	if (!initializeMap() || !initializeBiomeMap())
+		return false;
+
+	if (biomeMapPerChunk)
+		delete[] biomeMapPerChunk;
+	biomeMapPerChunk = new int[width * height];
+
+	std::cout << "[LOG] Loading world..." << std::endl;
+
+	std::atomic<bool> failed{ false };
+	jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this, &store, &failed](int x, int y) {
+		if (!loadChunk(store, x, y))
+			failed = true;
+	});
+	if (failed) {
+		std::cout << "[ERROR] World couldnt be loaded" << std::endl;
+		return false;
+	}
+
+	std::cout << "[LOG] World succesfully loaded" << std::endl;
+	return buildVegetation();
+}
+
+//Mixes the world seed, coordinates of the cell and the id of the stream into well distributed 32 bit value
+//Used instead of a sequential generator so every cell has its own independent random values
+static uint32_t hashCell(int seed, int x, int y, uint32_t stream)
+{
+	uint32_t h = static_cast<uint32_t>(seed) * 0x9E3779B1u;
+	h ^= static_cast<uint32_t>(x) * 0x85EBCA77u;
+	h = (h << 13 | h >> 19) * 5u + 0xE6546B64u;
+	h ^= static_cast<uint32_t>(y) * 0xC2B2AE3Du;
+	h = (h << 13 | h >> 19) * 5u + 0xE6546B64u;
+	h ^= stream * 0x27D4EB2Fu;
+
+	h ^= h >> 16;
+	h *= 0x85EBCA6Bu;
+	h ^= h >> 13;
+	h *= 0xC2B2AE35u;
+	h ^= h >> 16;
+	return h;
+}
+
+//Evaluates the candidate tree of the cell of the global vegetation grid, the grid has cells of spacing x spacing map cells
+//Candidate is placed at random position inside of the cell, it is rejected straight away if its under the see level or
+//if it doesnt pass the density of the biome of its chunk. Result depends only on the seed and the cell, never on the order of calls.
+//Grid covers the whole world, so candidates of the shard are the same as the candidates of the whole world.
+//
+//@param cellX, cellY - coordinates of the cell in the vegetation grid
+//@param spacing - size of the cell, not lower than the minimal distance
+//@return VegetationCandidate - candidate in the world coordinates, valid set to false if there is no tree in the cell
+TerrainGenerator::VegetationCandidate TerrainGenerator::vegetationCandidate(int cellX, int cellY, int spacing)
+{
+	VegetationCandidate candidate = { 0, 0, 0, false };
+	int worldSamplesX = getWorldWidth() * chunkResolution;
+	int worldSamplesY = getWorldHeight() * chunkResolution;
+
+	if (cellX < 0 || cellY < 0)
+		return candidate;
+
+	candidate.x = cellX * spacing + hashCell(seed, cellX, cellY, 0) % spacing;
+	candidate.y = cellY * spacing + hashCell(seed, cellX, cellY, 1) % spacing;
+	if (candidate.x >= worldSamplesX || candidate.y >= worldSamplesY)
+		return candidate;
+
+	//Candidates outside of the generated shard are not known, only the chunks on the margin of the shard reach them
+	int x = candidate.x - originX * chunkResolution;
+	int y = candidate.y - originY * chunkResolution;
+	if (x < 0 || y < 0 || x >= width * chunkResolution || y >= height * chunkResolution)
+		return candidate;
+
+	if (heightMap[indexer.index(x, y)] < seeLevel)
+		return candidate;
+
+	//Vegetation level is the expected number of trees in the chunk, so it is scaled to the area of the cell
+	int chunk = (y / chunkResolution) * width + x / chunkResolution;
+	float density = getBiome(biomeMapPerChunk[chunk]).getVegetationLevel() * spacing * spacing / static_cast<float>(chunkResolution * chunkResolution);
+	if ((hashCell(seed, cellX, cellY, 2) >> 8) * (1.0f / 16777216.0f) >= density)
+		return candidate;
+
+	candidate.priority = hashCell(seed, cellX, cellY, 3);
+	candidate.valid = true;
+	return candidate;
+}
+
+//Places the vegetation of the single chunk
+//Candidate is kept only if no candidate of higher priority is closer than the minimal distance, neighbouring
+//candidates are evaluated the same way no matter which chunk they belong to, so the distance is kept across the borders
+//Requires heights and chunk biomes of the chunk and of its neighbours
+//
+//@param chunkX - x coordinate of the chunk
+//@param chunkY - y coordinate of the chunk
+bool TerrainGenerator::vegetationGenerationChunk(int chunkX, int chunkY)
+{
+	if (!heightMap || !biomeMapPerChunk || vegetationChunks.size() != static_cast<size_t>(width) * height || chunkX < 0 || chunkY < 0 || chunkX >= width || chunkY >= height)
+		return false;
+
+	auto& points = vegetationChunks[chunkY * width + chunkX];
+	points.clear();
+
+	int spacing = static_cast<int>(std::ceil(vegetationMinDistance));
+	float minDistanceSquared = vegetationMinDistance * vegetationMinDistance;
+
+	//Bounds of the chunk in the world coordinates
+	int x0 = (originX + chunkX) * chunkResolution, y0 = (originY + chunkY) * chunkResolution;
+	int x1 = x0 + chunkResolution, y1 = y0 + chunkResolution;
+
+	for (int cellY = y0 / spacing; cellY <= (y1 - 1) / spacing; cellY++) {
+		for (int cellX = x0 / spacing; cellX <= (x1 - 1) / spacing; cellX++) {
+			VegetationCandidate candidate = vegetationCandidate(cellX, cellY, spacing);
+			if (!candidate.valid || candidate.x < x0 || candidate.x >= x1 || candidate.y < y0 || candidate.y >= y1)
+				continue;
+
+			//Cells are not smaller than the minimal distance, so only the direct neighbours can be too close
+			bool accepted = true;
+			for (int j = -1; j <= 1 && accepted; j++) {
+				for (int i = -1; i <= 1; i++) {
+					if (i == 0 && j == 0)
+						continue;
+
+					VegetationCandidate neighbour = vegetationCandidate(cellX + i, cellY + j, spacing);
+					if (!neighbour.valid)
+						continue;
+
+					float dx = static_cast<float>(neighbour.x - candidate.x);
+					float dy = static_cast<float>(neighbour.y - candidate.y);
+					bool higherPriority = neighbour.priority > candidate.priority ||
+						(neighbour.priority == candidate.priority && (j > 0 || (j == 0 && i > 0)));
+
+					if (dx * dx + dy * dy < minDistanceSquared && higherPriority) {
+						accepted = false;
+						break;
+					}
+				}
+			}
+
+			if (accepted)
+				points.push_back(std::make_pair(candidate.x - originX * chunkResolution, candidate.y - originY * chunkResolution));
+		}
+	}
 	return true;
 }
 
@@ -343,19 +1068,130 @@ bool TerrainGenerator::generateBiomeMapPerChunk()
 		return false;
 	}
 
+	if (biomeMapPerChunk)
+		delete[] biomeMapPerChunk;
 	biomeMapPerChunk = new int[width * height];
-	int biomeSum = 0;
 
-	for (int y = 0; y < height; y++) {
-		for (int x = 0; x < width; x++) {
-			int biomeSum = 0;
-			for (int j = 0; j < chunkResolution; j++) {
-				for (int i = 0; i < chunkResolution; i++) {
-					biomeSum += biomeMap[(y * chunkResolution + j) * width * chunkResolution + (x * chunkResolution + i)];
-				}
-			}
-			biomeMapPerChunk[y * width + x] = biomeSum / (chunkResolution * chunkResolution);
+	jobs::JobSystem::get().parallel_for2D(width, height, 1, 1, [this](int x, int y) {
+		generateChunkBiome(x, y);
+	});
+	return true;
+}
+
+//Evaluates the biome of the whole chunk as the average of its cells
+//
+//@param chunkX - x coordinate of the chunk
+//@param chunkY - y coordinate of the chunk
+bool TerrainGenerator::generateChunkBiome(int chunkX, int chunkY)
+{
+	if (!biomeMap || !biomeMapPerChunk)
+		return false;
+
+	int biomeSum = 0;
+	for (int j = 0; j < chunkResolution; j++) {
+		const int* row = biomeMap + indexer.index(chunkX * chunkResolution, chunkY * chunkResolution + j);
+		for (int i = 0; i < chunkResolution; i++) {
+			biomeSum += row[i];
 		}
 	}
+	biomeMapPerChunk[chunkY * width + chunkX] = biomeSum / (chunkResolution * chunkResolution);
 	return true;
-}
\ No newline at end of file
+}
+
+//Erodes the heights of every chunk, the same as the erosion stage of performTerrainGeneration
+//Chunks of one phase are eroded in parallel, their windows never overlap, so the result doesnt depend on the number of threads
+//
+//@return bool - false if the height map is not generated or the erosion is disabled
+bool TerrainGenerator::erodeHeightMap()
+{
+	if (!heightMap || !isErosionEnabled()) {
+		std::cout << "[ERROR] HeightMap not initialized or the erosion not enabled" << std::endl;
+		return false;
+	}
+
+	std::vector<std::pair<int, int>> phaseChunks;
+	for (int phase = 0; phase < 4; phase++) {
+		phaseChunks.clear();
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++)
+				if (erosionPhase(x, y) == phase)
+					phaseChunks.emplace_back(x, y);
+
+		std::atomic<bool> failed{ false };
+		jobs::JobSystem::get().parallel_for(0, static_cast<int>(phaseChunks.size()), 1, [this, &phaseChunks, &failed](int i) {
+			if (!erodeChunk(phaseChunks[i].first, phaseChunks[i].second))
+				failed = true;
+		});
+		if (failed)
+			return false;
+	}
+	return true;
+}
+
+//Erodes the chunk together with the halo of the samples of its neighbours around it
+//Droplets are spawned only inside of the chunk, but they move and erode across its border until they leave the halo,
+//changes of the halo are written back too. Chunks are eroded in four phases by the parity of their world coordinates,
+//neighbours are always of a different phase and the windows of the chunks of one phase never overlap (the halo is
+//at most half of the chunk), so the chunk of the later phase continues on the heights left by its neighbours of
+//the earlier phases. Droplets are seeded by the world coordinates of the chunk, so the result depends only on
+//the heights, never on the order or the thread of the chunks, and the chunk borders have no seams.
+//Eroded chunk depends on the heights of the chunks up to EROSION_REACH chunks away from it.
+//
+//@param chunkX, chunkY - coordinates of the chunk, its neighbours have to have their heights
+//@return bool - false if the chunk is outside of the map
+bool TerrainGenerator::erodeChunk(int chunkX, int chunkY)
+{
+	if (!heightMap || chunkX < 0 || chunkY < 0 || chunkX >= width || chunkY >= height)
+		return false;
+
+	int halo = getErosionHalo();
+	int x0 = std::max(chunkX * chunkResolution - halo, 0), y0 = std::max(chunkY * chunkResolution - halo, 0);
+	int x1 = std::min((chunkX + 1) * chunkResolution + halo, getWidth()), y1 = std::min((chunkY + 1) * chunkResolution + halo, getHeight());
+	std::vector<float> window(static_cast<size_t>(x1 - x0) * (y1 - y0));
+	copyHeightWindow(x0, y0, x1 - x0, y1 - y0, window.data(), false);
+
+	erosion::Erosion erosion(x1 - x0, y1 - y0);
+	if (!erosion.SetMapView(window.data(), x1 - x0, y1 - y0) ||
+		!erosion.SetSpawnArea(chunkX * chunkResolution - x0, chunkY * chunkResolution - y0, chunkResolution, chunkResolution))
+		return false;
+	erosion.SetConfig(erosionConfig);
+	erosion.SetDropletCount(erosionDroplets);
+	erosion.SetSeed(static_cast<int>(hashCell(seed, originX + chunkX, originY + chunkY, 4)));
+
+	//Session is run at once instead of Erode, which would log every chunk
+	erosion::ErosionSession session(erosion);
+	if (!session.start())
+		return false;
+	session.advance({});
+
+	copyHeightWindow(x0, y0, x1 - x0, y1 - y0, window.data(), true);
+	return true;
+}
+
+//Copies the rectangle of the height map into the row by row window or back, rows of the chunks are contiguous in every layout
+//
+//@param x, y - first cell of the rectangle
+//@param windowWidth, windowHeight - size of the rectangle
+//@param window - windowWidth * windowHeight samples
+//@param writeBack - true copies the window into the height map
+void TerrainGenerator::copyHeightWindow(int x, int y, int windowWidth, int windowHeight, float* window, bool writeBack)
+{
+	for (int j = 0; j < windowHeight; j++) {
+		for (int i = 0; i < windowWidth;) {
+			int run = std::min(windowWidth - i, chunkResolution - (x + i) % chunkResolution);
+			float* cells = heightMap + indexer.index(x + i, y + j);
+			float* samples = window + static_cast<size_t>(j) * windowWidth + i;
+			if (writeBack)
+				std::copy_n(samples, run, cells);
+			else
+				std::copy_n(cells, run, samples);
+			i += run;
+		}
+	}
+}
+
+//Phase of the chunk in the erosion stage, from the parity of its world coordinates, so the shards keep the phases of the world
+int TerrainGenerator::erosionPhase(int chunkX, int chunkY) const
+{
+	return ((originX + chunkX) & 1) + 2 * ((originY + chunkY) & 1);
+}
@@ -1,16 +1,28 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
 #include <vector>
 #include <utility>
 
+#include "MapLayout.h"
 #include "Noise.h"
 #include "BiomeGenerator.h"
+#include "ChunkCache.h"
+#include "Erosion.h"
+#include "Vegetation.h"
+#include "WorldStore.h"
 
 #include "Splines/spline.h"
 
 class TerrainGenerator
 {
 public:
+	//Chunks around the chunk whose heights change its eroded heights, see erodeChunk
+	static const int EROSION_REACH = 5;
+
 	TerrainGenerator();
 	~TerrainGenerator();
 
@@ -28,38 +40,101 @@ public:
 	bool setSplines(std::vector<std::vector<double>> splines);
 	bool setBiomes(std::vector<biome::Biome>& biomes);
 	bool setRanges(std::vector<std::vector<RangedLevel>>& ranges);
+	bool setVegetationMinDistance(float minDistance);
+	void setChunkMeshCallback(std::function<void(int chunkX, int chunkY)> callback);
+	void setCacheDirectory(const std::string& directory);
+	void setChunkCache(cache::ChunkCache* chunkCache);
+	bool setMapLayout(layout::MapLayout mapLayout);
+	bool setShard(int originX, int originY, int worldWidth, int worldHeight);
+	bool setErosion(const erosion::ErosionConfig& config, int dropletsPerChunk, int halo = 0);
 
+	//Maps in the layout of getMapLayout, not row-major when it is CHUNK_MAJOR, index them with getMapIndexer
 	float* getHeightMap();
 	int* getBiomeMap();
+	layout::MapLayout getMapLayout() const { return mapLayout; };
+	const layout::MapIndexer& getMapIndexer() const { return indexer; };
+	std::span<const float> getHeightChunk(int chunkX, int chunkY) const;
+	std::span<const int> getBiomeChunk(int chunkX, int chunkY) const;
+	bool copyHeightMap(float* destination) const;
 	int getWidth(){ return width * chunkResolution; };
 	int getHeight(){ return height * chunkResolution; };
+	int getShardOriginX() const { return originX; };
+	int getShardOriginY() const { return originY; };
+	int getWorldWidth() const { return worldWidth > 0 ? worldWidth : width; };
+	int getWorldHeight() const { return worldHeight > 0 ? worldHeight : height; };
+	bool isShard() const { return worldWidth > 0; };
 	float getHeightAt(int x, int y);
 	biome::Biome& getBiome(int id);
 	int getBiomeAt(int x, int y);
-	int getTreeCount() { return treeCount; };
+	int getTreeCount() const { return static_cast<int>(vegetation.size()); };
 	noise::NoiseConfigParameters& getContinentalnessNoiseConfig();
 	noise::NoiseConfigParameters& getMountainousNoiseConfig();
 	noise::NoiseConfigParameters& getPVNoiseConfig();
 	noise::NoiseConfigParameters& getTemperatureNoiseConfig();
 	noise::NoiseConfigParameters& getHumidityNoiseConfig();
-	std::vector<std::vector<std::pair<int, int>>> getVegetationPoints() { return vegetationPoints; };
+	const vegetation::VegetationMap& getVegetation() const { return vegetation; };
+	cache::ChunkCache* getChunkCache() const { return chunkCache; };
+	uint64_t getConfigHash() const;
+	bool isErosionEnabled() const { return erosionDroplets > 0; };
+	int getErosionHalo() const;
 
 	bool generateHeightMap();
 	bool generateBiomes();
 	bool performTerrainGeneration();
 	bool vegetationGeneration();
 	bool generateBiomeMapPerChunk();
+	bool generateHeightMapChunk(int chunkX, int chunkY);
+	bool erodeHeightMap();
+	bool erodeChunk(int chunkX, int chunkY);
+	bool generateBiomeMapChunk(int chunkX, int chunkY);
+	bool generateChunkBiome(int chunkX, int chunkY);
+	bool vegetationGenerationChunk(int chunkX, int chunkY);
+	bool buildVegetation();
+	bool removeVegetation(std::vector<uint32_t> indices);
+
+	world::WorldHeader getWorldHeader();
+	bool storeChunk(world::WorldStore& store, int chunkX, int chunkY);
+	bool loadChunk(const world::WorldStore& store, int chunkX, int chunkY);
+	bool saveWorld(world::WorldStore& store);
+	bool loadWorld(const world::WorldStore& store);
 
 private:
+	//Candidate position of the tree in the cell of the global vegetation grid
+	struct VegetationCandidate {
+		int x, y;
+		uint32_t priority;
+		bool valid;
+	};
+
+	bool prepareHeightMapNoise();
+	std::string getCachePath() const;
+	bool loadFromCache();
+	bool saveToCache();
+	void readChunkCells(int chunkX, int chunkY, std::span<float> heights, std::span<int> biomes) const;
+	void writeChunkCells(int chunkX, int chunkY, std::span<const float> heights, std::span<const int> biomes);
+	void copyHeightWindow(int x, int y, int windowWidth, int windowHeight, float* window, bool writeBack);
+	int erosionPhase(int chunkX, int chunkY) const;
+	bool cacheChunk(uint64_t configHash, int chunkX, int chunkY);
+	VegetationCandidate vegetationCandidate(int cellX, int cellY, int spacing);
+
+	//Height and biome maps are stored in the mapLayout, indexer translates the coordinates of the cells into them
 	float* heightMap;
 	int* biomeMap;
 	int* biomeMapPerChunk;
 	int seed, width, height;
 	int chunkResolution;
+	//Position of the generated chunks in the world and the size of the world in chunks, when only the shard of the world is generated
+	//Every stage works with the world coordinates, so the shard is identical to the same part of the whole world
+	int originX, originY;
+	int worldWidth, worldHeight;
+	layout::MapLayout mapLayout;
+	layout::MapIndexer indexer;
 	float seeLevel;
-	int treeCount;
+	float vegetationMinDistance;
 
-	std::vector<std::vector<std::pair<int,int>>> vegetationPoints;
+	//Trees of every chunk as generated, flattened into vegetation by buildVegetation
+	std::vector<std::vector<std::pair<int,int>>> vegetationChunks;
+	vegetation::VegetationMap vegetation;
 
 	noise::SimplexNoiseClass continentalnessNoise;
 	noise::SimplexNoiseClass mountainousNoise;
@@ -68,6 +143,21 @@ private:
 	tk::spline continentalnessSpline;
 	tk::spline mountainousSpline;
 	tk::spline PVSpline;
+	//Points the splines were built from, kept for the config hash
+	std::vector<std::vector<double>> splinePoints;
 
 	BiomeGenerator biomeGen;
+
+	//Erosion stage of the generation, chunks are eroded with the halo of their neighbours, 0 droplets disables it
+	erosion::ErosionConfig erosionConfig;
+	int erosionDroplets;
+	int erosionHalo;
+
+	//Called by performTerrainGeneration as soon as the chunk and its right, bottom and bottom-right neighbours have heights
+	std::function<void(int chunkX, int chunkY)> chunkMeshCallback;
+
+	//Directory of the world files of the finished generations named by the config hash, empty disables the cache
+	std::string cacheDirectory;
+	//Cache of the generated chunks in memory, shared process-wide by default, nullptr disables it
+	cache::ChunkCache* chunkCache;
 };
\ No newline at end of file
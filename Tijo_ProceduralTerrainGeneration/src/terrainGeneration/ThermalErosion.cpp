@@ -0,0 +1,113 @@
+#include "ThermalErosion.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "JobSystem.h"
+
+namespace erosion
+{
+	//Rows of one band of the job system
+	static const int ROWS_PER_TASK = 16;
+
+	static const float DIAGONAL = 1.41421356f;
+
+	//Sets the slope the material stays on and the share of the excess moved by one pass
+	//@param talusSlope - height difference per sample of distance, steeper slopes slide
+	//@param rate - share of the half of the largest excess moved by one pass, in [0, 1]
+	void ThermalErosion::SetConfig(float talusSlope, float rate)
+	{
+		this->talusSlope = talusSlope;
+		this->rate = std::clamp(rate, 0.0f, 1.0f);
+	}
+
+	//Runs one pass of the thermal erosion on the map in place
+	//@param map - first sample of the map
+	//@param width, height - size of the map in samples
+	//@param stride - samples between the starts of the rows
+	void ThermalErosion::Erode(float* map, int width, int height, int stride)
+	{
+		if (!map || width < 2 || height < 2)
+			return;
+
+		this->width = width;
+		this->height = height;
+		this->stride = stride;
+		size_t count = static_cast<size_t>(width) * height;
+		outflow.resize(count);
+		share.resize(count);
+		next.resize(count);
+
+		jobs::JobSystem& jobSystem = jobs::JobSystem::get();
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this, map](int y) { computeOutflow(map, y); });
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this, map](int y) { gatherInflow(map, y); });
+		jobSystem.parallel_for(0, height, ROWS_PER_TASK, [this, map](int y) {
+			std::copy_n(next.data() + static_cast<size_t>(y) * this->width, this->width, map + static_cast<size_t>(y) * this->stride);
+		});
+	}
+
+	//Neighbours out of the map are the cell itself, which never has any excess, so the border needs no branches either.
+	//Rows are clamped once per row, columns only for the first and the last cell of the row.
+	void ThermalErosion::computeOutflow(const float* map, int y)
+	{
+		const float* row = map + static_cast<size_t>(y) * stride;
+		const float* up = map + static_cast<size_t>(std::max(y - 1, 0)) * stride;
+		const float* down = map + static_cast<size_t>(std::min(y + 1, height - 1)) * stride;
+		float* rowOutflow = outflow.data() + static_cast<size_t>(y) * width;
+		float* rowShare = share.data() + static_cast<size_t>(y) * width;
+		const float straight = talusSlope, diagonal = talusSlope * DIAGONAL;
+		const float halfRate = rate * 0.5f;
+
+		auto cell = [&](int x, int left, int right) {
+			float h = row[x];
+			float left0 = std::max(h - row[left] - straight, 0.0f), right0 = std::max(h - row[right] - straight, 0.0f);
+			float up0 = std::max(h - up[x] - straight, 0.0f), down0 = std::max(h - down[x] - straight, 0.0f);
+			float upLeft = std::max(h - up[left] - diagonal, 0.0f), upRight = std::max(h - up[right] - diagonal, 0.0f);
+			float downLeft = std::max(h - down[left] - diagonal, 0.0f), downRight = std::max(h - down[right] - diagonal, 0.0f);
+			float total = left0 + right0 + up0 + down0 + upLeft + upRight + downLeft + downRight;
+			float largest = std::max(left0, right0);
+			largest = std::max(largest, std::max(up0, down0));
+			largest = std::max(largest, std::max(upLeft, upRight));
+			largest = std::max(largest, std::max(downLeft, downRight));
+			float moved = halfRate * largest;
+			rowOutflow[x] = moved;
+			//Moved is 0 whenever total is, the maximum only keeps the division defined
+			rowShare[x] = moved / std::max(total, 1e-30f);
+		};
+
+		cell(0, 0, std::min(1, width - 1));
+		for (int x = 1; x < width - 1; x++)
+			cell(x, x - 1, x + 1);
+		cell(width - 1, width - 2, width - 1);
+	}
+
+	//Cell gets share * excess from every neighbour higher than itself by more than the talus slope
+	void ThermalErosion::gatherInflow(const float* map, int y)
+	{
+		int upY = std::max(y - 1, 0), downY = std::min(y + 1, height - 1);
+		const float* row = map + static_cast<size_t>(y) * stride;
+		const float* up = map + static_cast<size_t>(upY) * stride;
+		const float* down = map + static_cast<size_t>(downY) * stride;
+		const float* rowShare = share.data() + static_cast<size_t>(y) * width;
+		const float* upShare = share.data() + static_cast<size_t>(upY) * width;
+		const float* downShare = share.data() + static_cast<size_t>(downY) * width;
+		const float* rowOutflow = outflow.data() + static_cast<size_t>(y) * width;
+		float* rowNext = next.data() + static_cast<size_t>(y) * width;
+		const float straight = talusSlope, diagonal = talusSlope * DIAGONAL;
+
+		auto cell = [&](int x, int left, int right) {
+			float h = row[x];
+			float inflow =
+				rowShare[left] * std::max(row[left] - h - straight, 0.0f) + rowShare[right] * std::max(row[right] - h - straight, 0.0f) +
+				upShare[x] * std::max(up[x] - h - straight, 0.0f) + downShare[x] * std::max(down[x] - h - straight, 0.0f) +
+				upShare[left] * std::max(up[left] - h - diagonal, 0.0f) + upShare[right] * std::max(up[right] - h - diagonal, 0.0f) +
+				downShare[left] * std::max(down[left] - h - diagonal, 0.0f) + downShare[right] * std::max(down[right] - h - diagonal, 0.0f);
+			rowNext[x] = h - rowOutflow[x] + inflow;
+		};
+
+		cell(0, 0, std::min(1, width - 1));
+		for (int x = 1; x < width - 1; x++)
+			cell(x, x - 1, x + 1);
+		cell(width - 1, width - 2, width - 1);
+	}
+}
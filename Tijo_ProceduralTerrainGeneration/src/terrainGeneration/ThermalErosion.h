@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+//Thermal erosion, material of the cells steeper than the talus slope slides down to their lower neighbours
+//
+//Every cell compares itself with its 8 neighbours, the excess of the slope over the talus slope (height difference
+//above talusSlope * distance) is the driving force. The cell loses rate * half of its largest excess, split between
+//its lower neighbours by their excess, so the material is conserved and the slope never flips in one pass.
+//The pass is made of two stencils over the rows: the first one computes the outflow of every cell, the second one
+//gathers the inflow of every cell from the outflows of its neighbours. Both read the map of the previous pass and write
+//only their own cells, so the rows are split into bands over the threads of the job system and the result doesnt
+//depend on the number of threads. Rows are processed without branches in their interior, so the compiler can vectorize them.
+//
+//Droplet and pipe erosion run the pass every few steps (see ErosionConfig::thermalInterval), the slid material does
+//what the blur of the erosion radius does otherwise, so the smaller radius can be used.
+
+namespace erosion
+{
+	class ThermalErosion
+	{
+	public:
+		void SetConfig(float talusSlope, float rate);
+		void Erode(float* map, int width, int height, int stride);
+
+	private:
+		void computeOutflow(const float* map, int y);
+		void gatherInflow(const float* map, int y);
+
+		float talusSlope = 0.02f;
+		float rate = 0.5f;
+
+		int width = 0, height = 0, stride = 0;
+		//Height lost by the cell and the share of its excess going to every lower neighbour, row-major without the stride
+		std::vector<float> outflow, share;
+		std::vector<float> next;
+	};
+}
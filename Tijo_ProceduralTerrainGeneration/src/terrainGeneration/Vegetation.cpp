@@ -0,0 +1,169 @@
+#include "Vegetation.h"
+
+#include <iostream>
+
+namespace vegetation
+{
+	VegetationMap::VegetationMap() : chunksX(0), chunksY(0), chunkRes(0), cellSize(0), gridWidth(0), gridHeight(0)
+	{
+	}
+
+	//Flattens the vegetation generated per chunk into the arrays and builds the spatial index
+	//
+	//@param chunks - positions of the trees of every chunk, row by row
+	//@param heightMap - height map of the whole world, used to place the trees on the ground
+	//@param indexer - layout and size of the height map, size of the map in chunks and the chunk resolution are taken from it
+	//@param cellSize - size of the cell of the spatial index
+	//@return bool - false if the sizes dont match
+	bool VegetationMap::build(const std::vector<std::vector<std::pair<int, int>>>& chunks, const float* heightMap, const layout::MapIndexer& indexer, int cellSize)
+	{
+		if (!heightMap || indexer.width <= 0 || indexer.height <= 0 || indexer.chunkWidth <= 0 || cellSize <= 0 || chunks.size() != static_cast<size_t>(indexer.width) * indexer.height) {
+			std::cout << "[ERROR] Vegetation couldnt be built" << std::endl;
+			return false;
+		}
+
+		this->chunksX = indexer.width;
+		this->chunksY = indexer.height;
+		this->chunkRes = indexer.chunkWidth;
+		this->cellSize = cellSize;
+
+		chunkOffsets.assign(chunks.size() + 1, 0);
+		for (size_t i = 0; i < chunks.size(); i++)
+			chunkOffsets[i + 1] = chunkOffsets[i] + static_cast<uint32_t>(chunks[i].size());
+
+		xs.resize(chunkOffsets.back());
+		ys.resize(chunkOffsets.back());
+		heights.resize(chunkOffsets.back());
+
+		for (size_t i = 0; i < chunks.size(); i++) {
+			uint32_t index = chunkOffsets[i];
+			for (auto& it : chunks[i]) {
+				xs[index] = static_cast<float>(it.first);
+				ys[index] = static_cast<float>(it.second);
+				heights[index] = heightMap[indexer.index(it.first, it.second)];
+				index++;
+			}
+		}
+
+		buildGrid();
+		return true;
+	}
+
+	//Removes the instances, order of the remaining ones is kept
+	//
+	//@param indices - indices of the instances to be removed, e.g. result of a query
+	//@return bool - true if anything was removed
+	bool VegetationMap::remove(std::vector<uint32_t> indices)
+	{
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+		while (!indices.empty() && indices.back() >= xs.size())
+			indices.pop_back();
+
+		if (indices.empty())
+			return false;
+
+		size_t next = 0;
+		uint32_t write = 0;
+		uint32_t chunkBegin = 0;
+		for (size_t chunk = 0; chunk + 1 < chunkOffsets.size(); chunk++) {
+			uint32_t chunkEnd = chunkOffsets[chunk + 1];
+			for (uint32_t read = chunkBegin; read < chunkEnd; read++) {
+				if (next < indices.size() && indices[next] == read) {
+					next++;
+					continue;
+				}
+				xs[write] = xs[read];
+				ys[write] = ys[read];
+				heights[write] = heights[read];
+				write++;
+			}
+			chunkBegin = chunkEnd;
+			chunkOffsets[chunk + 1] = write;
+		}
+
+		xs.resize(write);
+		ys.resize(write);
+		heights.resize(write);
+
+		buildGrid();
+		return true;
+	}
+
+	void VegetationMap::clear()
+	{
+		xs.clear();
+		ys.clear();
+		heights.clear();
+		chunkOffsets.assign(chunksX * chunksY + 1, 0);
+		buildGrid();
+	}
+
+	//@param x, y - center of the circle
+	//@param radius - radius of the circle
+	//@return std::vector<uint32_t> - indices of the instances inside of the circle
+	std::vector<uint32_t> VegetationMap::queryRadius(float x, float y, float radius) const
+	{
+		std::vector<uint32_t> result;
+		float radiusSquared = radius * radius;
+
+		forEachInRect(x - radius, y - radius, x + radius, y + radius, [&](uint32_t index) {
+			float dx = xs[index] - x;
+			float dy = ys[index] - y;
+			if (dx * dx + dy * dy <= radiusSquared)
+				result.push_back(index);
+		});
+		return result;
+	}
+
+	//@param minX, minY, maxX, maxY - bounds of the rectangle, inclusive
+	//@return std::vector<uint32_t> - indices of the instances inside of the rectangle
+	std::vector<uint32_t> VegetationMap::queryRect(float minX, float minY, float maxX, float maxY) const
+	{
+		std::vector<uint32_t> result;
+		forEachInRect(minX, minY, maxX, maxY, [&](uint32_t index) {
+			result.push_back(index);
+		});
+		return result;
+	}
+
+	std::span<const float> VegetationMap::chunkSpan(const std::vector<float>& data, int chunkX, int chunkY) const
+	{
+		if (chunkX < 0 || chunkY < 0 || chunkX >= chunksX || chunkY >= chunksY || chunkOffsets.size() != static_cast<size_t>(chunksX) * chunksY + 1)
+			return {};
+
+		int chunk = chunkY * chunksX + chunkX;
+		return std::span<const float>(data.data() + chunkOffsets[chunk], chunkOffsets[chunk + 1] - chunkOffsets[chunk]);
+	}
+
+	//Counting sort of the instances into the cells of the grid
+	void VegetationMap::buildGrid()
+	{
+		if (cellSize <= 0) {
+			gridWidth = gridHeight = 0;
+			cellOffsets.clear();
+			cellItems.clear();
+			return;
+		}
+
+		gridWidth = (chunksX * chunkRes + cellSize - 1) / cellSize;
+		gridHeight = (chunksY * chunkRes + cellSize - 1) / cellSize;
+		cellOffsets.assign(gridWidth * gridHeight + 1, 0);
+		cellItems.resize(xs.size());
+
+		auto cellOf = [this](uint32_t index) {
+			int cellX = std::clamp(static_cast<int>(xs[index]) / cellSize, 0, gridWidth - 1);
+			int cellY = std::clamp(static_cast<int>(ys[index]) / cellSize, 0, gridHeight - 1);
+			return cellY * gridWidth + cellX;
+		};
+
+		for (uint32_t i = 0; i < xs.size(); i++)
+			cellOffsets[cellOf(i) + 1]++;
+		for (int i = 0; i < gridWidth * gridHeight; i++)
+			cellOffsets[i + 1] += cellOffsets[i];
+
+		std::vector<uint32_t> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (uint32_t i = 0; i < xs.size(); i++)
+			cellItems[cursor[cellOf(i)]++] = i;
+	}
+}
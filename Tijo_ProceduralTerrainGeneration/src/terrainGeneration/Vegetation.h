@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "MapLayout.h"
+
+namespace vegetation
+{
+	//Flat storage of the vegetation instances of the whole map
+	//Instances are kept as a structure of arrays ordered by chunk, so instances of a single chunk are contiguous
+	//and the arrays can be handed straight to the GPU upload. Uniform grid over the map indexes the instances
+	//for the radius and rectangle queries. All of the coordinates are in the cells of the map.
+	class VegetationMap
+	{
+	public:
+		VegetationMap();
+
+		bool build(const std::vector<std::vector<std::pair<int, int>>>& chunks, const float* heightMap, const layout::MapIndexer& indexer, int cellSize);
+		bool remove(std::vector<uint32_t> indices);
+		void clear();
+
+		std::vector<uint32_t> queryRadius(float x, float y, float radius) const;
+		std::vector<uint32_t> queryRect(float minX, float minY, float maxX, float maxY) const;
+		template<typename Func>
+		void forEachInRect(float minX, float minY, float maxX, float maxY, Func&& func) const;
+
+		size_t size() const { return xs.size(); }
+		std::span<const float> getX() const { return xs; }
+		std::span<const float> getY() const { return ys; }
+		std::span<const float> getHeight() const { return heights; }
+		std::span<const float> getX(int chunkX, int chunkY) const { return chunkSpan(xs, chunkX, chunkY); }
+		std::span<const float> getY(int chunkX, int chunkY) const { return chunkSpan(ys, chunkX, chunkY); }
+		std::span<const float> getHeight(int chunkX, int chunkY) const { return chunkSpan(heights, chunkX, chunkY); }
+		size_t getChunkSize(int chunkX, int chunkY) const { return chunkSpan(xs, chunkX, chunkY).size(); }
+
+	private:
+		std::span<const float> chunkSpan(const std::vector<float>& data, int chunkX, int chunkY) const;
+		void buildGrid();
+
+		//Instances, ordered by chunk
+		std::vector<float> xs;
+		std::vector<float> ys;
+		std::vector<float> heights;
+		//Instances of the chunk i are in [chunkOffsets[i], chunkOffsets[i + 1])
+		std::vector<uint32_t> chunkOffsets;
+		int chunksX, chunksY, chunkRes;
+
+		//Uniform grid, indices of the instances of cell i are in cellItems[cellOffsets[i], cellOffsets[i + 1])
+		std::vector<uint32_t> cellOffsets;
+		std::vector<uint32_t> cellItems;
+		int cellSize, gridWidth, gridHeight;
+	};
+
+	//Calls func(index) for every instance inside of the rectangle, without allocating
+	template<typename Func>
+	void VegetationMap::forEachInRect(float minX, float minY, float maxX, float maxY, Func&& func) const
+	{
+		if (xs.empty() || cellSize <= 0)
+			return;
+
+		int cellX0 = std::max(static_cast<int>(std::floor(minX / cellSize)), 0);
+		int cellY0 = std::max(static_cast<int>(std::floor(minY / cellSize)), 0);
+		int cellX1 = std::min(static_cast<int>(std::floor(maxX / cellSize)), gridWidth - 1);
+		int cellY1 = std::min(static_cast<int>(std::floor(maxY / cellSize)), gridHeight - 1);
+
+		for (int cellY = cellY0; cellY <= cellY1; cellY++) {
+			for (int cellX = cellX0; cellX <= cellX1; cellX++) {
+				int cell = cellY * gridWidth + cellX;
+				for (uint32_t i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++) {
+					uint32_t index = cellItems[i];
+					if (xs[index] >= minX && xs[index] <= maxX && ys[index] >= minY && ys[index] <= maxY)
+						func(index);
+				}
+			}
+		}
+	}
+}
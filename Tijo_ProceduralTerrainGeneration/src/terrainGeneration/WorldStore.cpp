@@ -0,0 +1,349 @@
+#include "WorldStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(int) == 4 && sizeof(float) == 4, "World file stores 4 byte samples");
+static_assert(sizeof(world::WorldHeader) % 8 == 0 && sizeof(world::ChunkEntry) == 16, "World file structures must not change their size");
+
+namespace world
+{
+	NoiseRecord NoiseRecord::fromConfig(const noise::NoiseConfigParameters& config)
+	{
+		NoiseRecord record;
+		record.xoffset = config.xoffset;
+		record.yoffset = config.yoffset;
+		record.scale = config.scale;
+		record.constrast = config.constrast;
+		record.redistribution = config.redistribution;
+		record.lacunarity = config.lacunarity;
+		record.persistance = config.persistance;
+		record.revertGain = config.revertGain;
+		record.ridgeGain = config.ridgeGain;
+		record.ridgeOffset = config.ridgeOffset;
+		record.mixPower = config.mixPower;
+		record.seed = config.seed;
+		record.octaves = config.octaves;
+		record.option = static_cast<int32_t>(config.option);
+		record.ridge = config.ridge;
+		record.island = config.island;
+		record.islandType = static_cast<int32_t>(config.islandType);
+		record.symmetrical = config.symmetrical;
+		return record;
+	}
+
+	WorldStore::WorldStore() : file(invalidFile), mapping(nullptr), data(nullptr), mappedSize(0), fileSize(0)
+	{
+	}
+
+	WorldStore::~WorldStore()
+	{
+		close();
+	}
+
+	//Creates the new world file, existing file is overwritten
+	//
+	//@param path - path of the file
+	//@param header - config of the world, size of the index is taken from it
+	//@return bool - false if the file couldnt be created
+	bool WorldStore::create(const std::string& path, const WorldHeader& header)
+	{
+		close();
+
+		if (header.width <= 0 || header.height <= 0 || header.chunkResolution <= 0) {
+			std::cout << "[ERROR] World size must be greater than 0" << std::endl;
+			return false;
+		}
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		file = reinterpret_cast<intptr_t>(handle);
+#else
+		file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+#endif
+		if (file == invalidFile) {
+			std::cout << "[ERROR] World file " << path << " couldnt be created" << std::endl;
+			return false;
+		}
+
+		this->header = header;
+		index.assign(static_cast<size_t>(header.width) * header.height, ChunkEntry{ 0, 0, 0 });
+		fileSize = 0;
+
+		if (!writeAt(0, &this->header, sizeof(WorldHeader)) || !writeAt(sizeof(WorldHeader), index.data(), index.size() * sizeof(ChunkEntry))) {
+			std::cout << "[ERROR] World file " << path << " couldnt be written" << std::endl;
+			close();
+			return false;
+		}
+		return map();
+	}
+
+	//Opens the existing world file, header and index are read, chunks stay on the disk until they are read
+	//
+	//@param path - path of the file
+	//@return bool - false if the file doesnt exist or it is not a valid world file
+	bool WorldStore::open(const std::string& path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		file = reinterpret_cast<intptr_t>(handle);
+		LARGE_INTEGER size;
+		if (file != invalidFile && GetFileSizeEx(handle, &size))
+			fileSize = static_cast<uint64_t>(size.QuadPart);
+#else
+		file = ::open(path.c_str(), O_RDWR);
+		struct stat status;
+		if (file != invalidFile && fstat(static_cast<int>(file), &status) == 0)
+			fileSize = static_cast<uint64_t>(status.st_size);
+#endif
+		if (file == invalidFile)
+			return false;
+
+		WorldHeader expected;
+		if (fileSize < sizeof(WorldHeader) || !readAt(0, &header, sizeof(WorldHeader)) ||
+			std::memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0 || header.version != WORLD_VERSION ||
+			header.width <= 0 || header.height <= 0 || header.chunkResolution <= 0) {
+			std::cout << "[ERROR] " << path << " is not a valid world file" << std::endl;
+			close();
+			return false;
+		}
+
+		index.resize(static_cast<size_t>(header.width) * header.height);
+		if (fileSize < sizeof(WorldHeader) + index.size() * sizeof(ChunkEntry) || !readAt(sizeof(WorldHeader), index.data(), index.size() * sizeof(ChunkEntry))) {
+			std::cout << "[ERROR] Index of the world " << path << " is truncated" << std::endl;
+			close();
+			return false;
+		}
+
+		//Blocks past the end of the file were not finished when the file was written, they are dropped
+		for (auto& entry : index)
+			if (entry.offset != 0 && entry.offset + chunkBytes() + entry.treeCount * 2 * sizeof(int) > fileSize)
+				entry = ChunkEntry{ 0, 0, 0 };
+
+		return map();
+	}
+
+	void WorldStore::close()
+	{
+		unmap();
+		if (file != invalidFile) {
+#ifdef _WIN32
+			CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+			::close(static_cast<int>(file));
+#endif
+		}
+		file = invalidFile;
+		fileSize = 0;
+		index.clear();
+		header = WorldHeader();
+	}
+
+	//Appends the block of the chunk and points the index at it
+	//Block is written to the file only, mapping and the views returned by readChunk are left untouched
+	//
+	//@param chunkX, chunkY - coordinates of the chunk
+	//@param heights, biomes - samples of the chunk, row after row
+	//@param trees - positions of the trees of the chunk
+	//@return bool - false if the sizes dont match the header or the file couldnt be written
+	bool WorldStore::writeChunk(int chunkX, int chunkY, std::span<const float> heights, std::span<const int> biomes, std::span<const std::pair<int, int>> trees)
+	{
+		size_t samples = static_cast<size_t>(header.chunkResolution) * header.chunkResolution;
+		if (!isOpen() || chunkX < 0 || chunkY < 0 || chunkX >= header.width || chunkY >= header.height || heights.size() != samples || biomes.size() != samples) {
+			std::cout << "[ERROR] Chunk " << chunkX << ", " << chunkY << " couldnt be stored" << std::endl;
+			return false;
+		}
+
+		//Whole block is built in memory and written by a single call
+		std::vector<uint8_t> block(chunkBytes() + trees.size() * 2 * sizeof(int));
+		std::memcpy(block.data(), heights.data(), samples * sizeof(float));
+		std::memcpy(block.data() + samples * sizeof(float), biomes.data(), samples * sizeof(int));
+		int* treeData = reinterpret_cast<int*>(block.data() + chunkBytes());
+		for (size_t i = 0; i < trees.size(); i++) {
+			treeData[i * 2] = trees[i].first;
+			treeData[i * 2 + 1] = trees[i].second;
+		}
+
+		uint64_t offset = (fileSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+		ChunkEntry entry = { offset, static_cast<uint32_t>(trees.size()), 0 };
+		size_t entryOffset = sizeof(WorldHeader) + (static_cast<size_t>(chunkY) * header.width + chunkX) * sizeof(ChunkEntry);
+
+		//Block goes first, so the index never points at the data not written yet
+		if (!writeAt(offset, block.data(), block.size()) || !writeAt(entryOffset, &entry, sizeof(ChunkEntry))) {
+			std::cout << "[ERROR] Chunk " << chunkX << ", " << chunkY << " couldnt be written" << std::endl;
+			return false;
+		}
+		index[static_cast<size_t>(chunkY) * header.width + chunkX] = entry;
+
+		return true;
+	}
+
+	//Block written after the file was mapped makes the read map the file again, which invalidates the views returned before
+	//
+	//@param chunkX, chunkY - coordinates of the chunk
+	//@return ChunkView - spans into the mapping, invalid view if the chunk is not stored
+	ChunkView WorldStore::readChunk(int chunkX, int chunkY) const
+	{
+		if (!hasChunk(chunkX, chunkY))
+			return {};
+
+		const ChunkEntry& entry = index[static_cast<size_t>(chunkY) * header.width + chunkX];
+		uint64_t blockEnd = entry.offset + chunkBytes() + entry.treeCount * 2 * sizeof(int);
+
+		std::lock_guard<std::mutex> lock(mapMutex);
+		if (blockEnd > mappedSize && (blockEnd > fileSize || !map()))
+			return {};
+
+		size_t samples = static_cast<size_t>(header.chunkResolution) * header.chunkResolution;
+		const uint8_t* block = data + entry.offset;
+
+		ChunkView view;
+		view.heights = std::span<const float>(reinterpret_cast<const float*>(block), samples);
+		view.biomes = std::span<const int>(reinterpret_cast<const int*>(block + samples * sizeof(float)), samples);
+		view.trees = std::span<const int>(reinterpret_cast<const int*>(block + chunkBytes()), entry.treeCount * 2);
+		return view;
+	}
+
+	bool WorldStore::hasChunk(int chunkX, int chunkY) const
+	{
+		if (chunkX < 0 || chunkY < 0 || chunkX >= header.width || chunkY >= header.height || index.empty())
+			return false;
+		return index[static_cast<size_t>(chunkY) * header.width + chunkX].offset != 0;
+	}
+
+	//Maps the file again if it grew since it was mapped, called after a batch of writes so the following reads
+	//dont have to, views returned by readChunk before are invalidated if the file is mapped again
+	//@return bool - false if the file couldnt be mapped
+	bool WorldStore::remap()
+	{
+		std::lock_guard<std::mutex> lock(mapMutex);
+		if (!isOpen())
+			return false;
+		return mappedSize == fileSize || map();
+	}
+
+	size_t WorldStore::getStoredChunkCount() const
+	{
+		size_t count = 0;
+		for (auto& entry : index)
+			if (entry.offset != 0)
+				count++;
+		return count;
+	}
+
+	bool WorldStore::writeAt(uint64_t offset, const void* source, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(source);
+		size_t written = 0;
+#ifdef _WIN32
+		HANDLE handle = reinterpret_cast<HANDLE>(file);
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(offset);
+		if (!SetFilePointerEx(handle, position, nullptr, FILE_BEGIN))
+			return false;
+		while (written < size) {
+			DWORD chunk = 0;
+			if (!WriteFile(handle, bytes + written, static_cast<DWORD>(std::min<size_t>(size - written, 1u << 30)), &chunk, nullptr) || chunk == 0)
+				return false;
+			written += chunk;
+		}
+#else
+		while (written < size) {
+			ssize_t chunk = pwrite(static_cast<int>(file), bytes + written, size - written, static_cast<off_t>(offset + written));
+			if (chunk <= 0)
+				return false;
+			written += static_cast<size_t>(chunk);
+		}
+#endif
+		fileSize = std::max<uint64_t>(fileSize, offset + size);
+		return true;
+	}
+
+	bool WorldStore::readAt(uint64_t offset, void* destination, size_t size) const
+	{
+		uint8_t* bytes = static_cast<uint8_t*>(destination);
+		size_t read = 0;
+#ifdef _WIN32
+		HANDLE handle = reinterpret_cast<HANDLE>(file);
+		LARGE_INTEGER position;
+		position.QuadPart = static_cast<LONGLONG>(offset);
+		if (!SetFilePointerEx(handle, position, nullptr, FILE_BEGIN))
+			return false;
+		while (read < size) {
+			DWORD chunk = 0;
+			if (!ReadFile(handle, bytes + read, static_cast<DWORD>(std::min<size_t>(size - read, 1u << 30)), &chunk, nullptr) || chunk == 0)
+				return false;
+			read += chunk;
+		}
+#else
+		while (read < size) {
+			ssize_t chunk = pread(static_cast<int>(file), bytes + read, size - read, static_cast<off_t>(offset + read));
+			if (chunk <= 0)
+				return false;
+			read += static_cast<size_t>(chunk);
+		}
+#endif
+		return true;
+	}
+
+	//Maps the whole file for reading
+	bool WorldStore::map() const
+	{
+		unmap();
+		if (file == invalidFile || fileSize == 0)
+			return false;
+
+#ifdef _WIN32
+		mapping = CreateFileMappingA(reinterpret_cast<HANDLE>(file), nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+			data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		void* address = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, static_cast<int>(file), 0);
+		if (address != MAP_FAILED)
+			data = static_cast<const uint8_t*>(address);
+#endif
+		if (!data) {
+			std::cout << "[ERROR] World file couldnt be mapped" << std::endl;
+			unmap();
+			return false;
+		}
+		mappedSize = fileSize;
+		return true;
+	}
+
+	void WorldStore::unmap() const
+	{
+#ifdef _WIN32
+		if (data)
+			UnmapViewOfFile(data);
+		if (mapping)
+			CloseHandle(mapping);
+#else
+		if (data)
+			munmap(const_cast<uint8_t*>(data), mappedSize);
+#endif
+		mapping = nullptr;
+		data = nullptr;
+		mappedSize = 0;
+	}
+
+	//Size of the fixed part of the block, heights and biomes
+	size_t WorldStore::chunkBytes() const
+	{
+		return static_cast<size_t>(header.chunkResolution) * header.chunkResolution * (sizeof(float) + sizeof(int));
+	}
+}
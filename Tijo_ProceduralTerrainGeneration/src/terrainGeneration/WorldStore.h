@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Noise.h"
+
+//On-disk store of the generated world, opened through the memory mapping
+//
+//File layout (little-endian, all of the sizes in bytes):
+//	WorldHeader							- generation config the world was created with
+//	ChunkEntry[width * height]			- index of the chunks, row by row, offset 0 means the chunk is not stored
+//	chunk blocks						- appended in the order of writing, every block starts at BLOCK_ALIGNMENT
+//
+//Block of the chunk:
+//	float heights[chunkRes * chunkRes]	- rows of the chunk one after another
+//	int biomes[chunkRes * chunkRes]
+//	int trees[treeCount * 2]			- x, y pairs in the map coordinates
+//
+//Chunk is read straight from the mapping without touching the rest of the file. Writes only append new blocks
+//and rewrite the entry of the index, so rewriting the chunk leaves its old block unused in the file.
+//Writes go to the file, not to the mapping, the file is mapped again only when a read needs a block past the end
+//of the mapping, or by remap after a batch of writes. Reads may run concurrently, but not together with writes.
+
+namespace world
+{
+	constexpr uint32_t WORLD_VERSION = 2;
+	constexpr size_t BLOCK_ALIGNMENT = 64;
+
+	//Noise configuration as stored in the file, fields of fixed size without padding
+	struct NoiseRecord {
+		float xoffset, yoffset, scale, constrast, redistribution, lacunarity, persistance, revertGain, ridgeGain, ridgeOffset, mixPower;
+		int32_t seed, octaves, option, ridge, island, islandType, symmetrical;
+
+		static NoiseRecord fromConfig(const noise::NoiseConfigParameters& config);
+		bool operator==(const NoiseRecord&) const = default;
+	};
+
+	struct WorldHeader {
+		char magic[4] = { 'T', 'P', 'T', 'W' };
+		uint32_t version = WORLD_VERSION;
+		int32_t width = 0, height = 0;		//Size of the world in chunks
+		int32_t chunkResolution = 0;
+		int32_t seed = 0;
+		float seeLevel = 0.0f;
+		float vegetationMinDistance = 0.0f;
+		NoiseRecord continentalness{}, mountainous{}, PV{};
+		uint64_t configHash = 0;			//Hash of the whole generation config, see TerrainGenerator::getConfigHash
+
+		bool operator==(const WorldHeader&) const = default;
+	};
+
+	struct ChunkEntry {
+		uint64_t offset;
+		uint32_t treeCount;
+		uint32_t reserved;
+	};
+
+	//Data of the single chunk, points into the mapping and stays valid until the next remap of the store,
+	//i.e. until remap, close or a read of a chunk written after the file was mapped
+	struct ChunkView {
+		std::span<const float> heights;
+		std::span<const int> biomes;
+		std::span<const int> trees;
+
+		bool valid() const { return !heights.empty(); }
+		size_t treeCount() const { return trees.size() / 2; }
+	};
+
+	class WorldStore
+	{
+	public:
+		WorldStore();
+		~WorldStore();
+		WorldStore(const WorldStore&) = delete;
+		WorldStore& operator=(const WorldStore&) = delete;
+
+		bool create(const std::string& path, const WorldHeader& header);
+		bool open(const std::string& path);
+		void close();
+
+		bool writeChunk(int chunkX, int chunkY, std::span<const float> heights, std::span<const int> biomes, std::span<const std::pair<int, int>> trees);
+		ChunkView readChunk(int chunkX, int chunkY) const;
+		bool hasChunk(int chunkX, int chunkY) const;
+		bool remap();
+
+		bool isOpen() const { return file != invalidFile; }
+		const WorldHeader& getHeader() const { return header; }
+		size_t getStoredChunkCount() const;
+		uint64_t getFileSize() const { return fileSize; }
+
+	private:
+		bool writeAt(uint64_t offset, const void* source, size_t size);
+		bool readAt(uint64_t offset, void* destination, size_t size) const;
+		bool map() const;
+		void unmap() const;
+		size_t chunkBytes() const;
+
+		static constexpr intptr_t invalidFile = -1;
+
+		intptr_t file;
+		//Mapping is refreshed by the reads, so it is mutable and guarded by mapMutex
+		mutable std::mutex mapMutex;
+		mutable void* mapping;		//Handle of the file mapping object, used only on windows
+		mutable const uint8_t* data;
+		mutable uint64_t mappedSize;
+		uint64_t fileSize;
+
+		WorldHeader header;
+		std::vector<ChunkEntry> index;
+	};
+}
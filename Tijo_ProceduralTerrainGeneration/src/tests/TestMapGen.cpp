@@ -1,6 +1,7 @@
 #include "TestMapGen.h"
 
 #include "utilities.h"
+#include "MeshExport.h"
 
 #include "imgui.h"
 #include "glm.hpp"
@@ -9,7 +10,7 @@
 test::TestMapGen::TestMapGen() : m_Width(20), m_Height(20), m_ChunkResX(20), m_ChunkResY(20), m_ChunkScale(0.05f), realHeight(255.0f),
 m_Stride(8), m_MeshVertices(nullptr), m_MeshIndices(nullptr), deltaTime(0.0f), lastFrame(0.0f), seeLevel(64.0f),
 m_Player(800, 600, glm::vec3(0.0f, 0.0f, 0.0f), 0.0001f, 10.0f, false, m_Height* m_ChunkResY), isTerrainDisplayed(true),
-m_LightSource(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f), noise(), terrainGen(), m_treesPositions(nullptr)//, obj(nullptr)
+m_LightSource(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f), noise(), terrainGen()//, obj(nullptr)
 {
 	//vertices times 4 cause we are using 4 unique vertices for each quad
 	//indices times 6 cause we are using 6 indices for forming each quad
@@ -44,7 +45,7 @@ m_LightSource(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f), noise(), terrainGen(), m_trees
 	m_LightSource.SetPosition(glm::vec3(2.0f * realHeight, 2.0f * realHeight, 2.0f * realHeight));
 	//m_Player.SetPosition(glm::vec3(0.5f * m_Width / m_ChunkScale, 1.0f / m_ChunkScale, 0.5f * m_Height / m_ChunkScale));
 
-	//utilities::saveToObj("res/models/", "terrain", m_MeshVertices, m_MeshIndices, m_Stride, (m_Width * m_ChunkResX - 1) * (m_Height * m_ChunkResY - 1) * 6, (m_Width * m_ChunkResX - 1) * (m_Height * m_ChunkResY - 1) * m_Stride * 4, true);
+	//exporter::exportGlb("res/models/terrain.glb", terrainGen.getHeightMap(), terrainGen.getMapIndexer(), m_ChunkScale);
 }
 
 test::TestMapGen::~TestMapGen()
@@ -53,8 +54,6 @@ test::TestMapGen::~TestMapGen()
 		delete[] m_MeshVertices;
 	if (m_MeshIndices)
 		delete[] m_MeshIndices;
-	if (m_treesPositions)
-		delete[] m_treesPositions;
 }
 
 void test::TestMapGen::OnUpdate(float deltaTime)
@@ -97,6 +96,7 @@ void test::TestMapGen::OnRender(GLFWwindow& window, Renderer& renderer)
 	m_TreeShader->SetLightUniforms(m_LightSource.GetPosition(), glm::vec3(0.2f, 0.2f, 0.2f), glm::vec3(0.5f, 0.5f, 0.5f), glm::vec3(1.0f, 1.0f, 1.0f));
 	m_TreeShader->SetViewPos((*m_Player.GetCameraRef()).GetPosition());
 	m_TreeShader->SetMVP(model, *(m_Player.GetCameraRef()->GetViewMatrix()), *(m_Player.GetCameraRef()->GetProjectionMatrix()));
+	m_TreeShader->SetUniform1f("offsetScale", 0.2f);
 
 
 	glBindVertexArray(treeVAO);
@@ -128,6 +128,8 @@ void test::TestMapGen::conditionalTerrainGeneration()
 	terrainGen.setSize(m_Width, m_Height);
 	terrainGen.setChunkResolution(m_ChunkResX);
 	terrainGen.setSeed(742);
+	//Chunks are generated and meshed one by one, so every chunk is kept in one block
+	terrainGen.setMapLayout(layout::MapLayout::CHUNK_MAJOR);
 
 	terrainGen.getContinentalnessNoiseConfig().constrast = 1.5f;
 	terrainGen.getContinentalnessNoiseConfig().octaves = 7;
@@ -164,19 +166,20 @@ void test::TestMapGen::conditionalTerrainGeneration()
 	terrainGen.setBiomes(biomes);
 	terrainGen.setRanges(ranges);
 
+	//Mesh of the chunk is built by the generation graph as soon as the heights around it are ready
+	utilities::createIndicesTiledField(m_MeshIndices, m_Width * m_ChunkResX, m_Height * m_ChunkResY);
+	terrainGen.setChunkMeshCallback([this](int chunkX, int chunkY) {
+		utilities::createTiledChunkMesh(terrainGen, m_MeshVertices, chunkX, chunkY, m_ChunkResX, 0.2f, 3, m_Stride, 3, 6);
+	});
 
+	//World generated with the same config before is read from the cache instead of generated again
+	terrainGen.setCacheDirectory("res/cache");
 	if (!terrainGen.performTerrainGeneration()) {
 		std::cout << "[ERROR] Map couldnt be generated" << std::endl;
 		return;
 	}
 
 	seeLevel *= 0.2f;
-	utilities::createTiledVertices(m_MeshVertices, m_Width * m_ChunkResX, m_Height * m_ChunkResY, terrainGen.getHeightMap(), 0.2f, m_Stride, 0);
-	utilities::createIndicesTiledField(m_MeshIndices, m_Width * m_ChunkResX, m_Height * m_ChunkResY);
-	utilities::InitializeNormals(m_MeshVertices, m_Stride, 3, (m_Height * m_ChunkResY - 1) * (m_Width * m_ChunkResX - 1) * 4);
-	utilities::CalculateNormals(m_MeshVertices, m_MeshIndices, m_Stride, 3, (m_Width * m_ChunkResX - 1) * (m_Height * m_ChunkResY - 1) * 6);
-	utilities::NormalizeVector3f(m_MeshVertices, m_Stride, 3, (m_Height * m_ChunkResY - 1) * (m_Width * m_ChunkResX - 1) * 4);
-	utilities::AssignTexturesByBiomes(terrainGen, m_MeshVertices, m_Width * m_ChunkResX, m_Height * m_ChunkResY, 3, m_Stride, 6);
 }
 
 void test::TestMapGen::setTreeVertices()
@@ -230,18 +233,8 @@ void test::TestMapGen::setTreeVertices()
 	};
 	treeIndicesCount = sizeof(treeIndices) / sizeof(treeIndices[0]);
 
-	m_treesPositions = new float[3 * terrainGen.getTreeCount()];
-	std::cout << terrainGen.getTreeCount() << std::endl;
-
-	int index = 0;
-
-	for (auto& it : terrainGen.getVegetationPoints()) {
-		for (auto& it2 : it) {
-			m_treesPositions[index++] = it2.first * scaleFactor;
-			m_treesPositions[index++] = terrainGen.getHeightAt(it2.first, it2.second) * scaleFactor;
-			m_treesPositions[index++] = it2.second * scaleFactor;
-		}
-	}
+	const vegetation::VegetationMap& trees = terrainGen.getVegetation();
+	std::cout << trees.size() << std::endl;
 
 	glGenVertexArrays(1, &treeVAO);
 	glGenBuffers(1, &treeVBO);
@@ -263,14 +256,21 @@ void test::TestMapGen::setTreeVertices()
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(6 * sizeof(float)));
 	glEnableVertexAttribArray(2);
 	
+	//Arrays of the vegetation map are uploaded one after another as they are, without packing them into positions
+	//Shader scales them to the size of the terrain mesh
 	glGenBuffers(1, &instanceVBO);
 	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * terrainGen.getTreeCount(), m_treesPositions, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * trees.size(), nullptr, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * trees.size(), trees.getX().data());
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * trees.size(), sizeof(float) * trees.size(), trees.getHeight().data());
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * 2 * trees.size(), sizeof(float) * trees.size(), trees.getY().data());
 
 	glBindVertexArray(treeVAO);
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-	glVertexAttribDivisor(3, 1);
+	for (int i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(sizeof(float) * i * trees.size()));
+		glVertexAttribDivisor(3 + i, 1);
+	}
 
 	glBindVertexArray(0);
 }
@@ -67,7 +67,6 @@ namespace test {
 		//Settings
 		float* m_MeshVertices;
 		unsigned int* m_MeshIndices;
-		float* m_treesPositions;
 		int treeIndicesCount;
 
 		unsigned int treeVAO, treeVBO, instanceVBO, EBO;
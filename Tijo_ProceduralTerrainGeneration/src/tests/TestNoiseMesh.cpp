@@ -1,11 +1,14 @@
 #include "TestNoiseMesh.h"
 
+#include <algorithm>
+
 #include "Renderer.h"
 #include "Noise.h"
 #include "Camera.h"
 #include "utilities.h"
 
 #include "imgui.h"
+#include "imgui_internal.h"
 #include "glm.hpp"
 #include "gtc/matrix_transform.hpp"
 
@@ -13,8 +16,8 @@ namespace test
 {
 	TestNoiseMesh::TestNoiseMesh() :height(300), width(300), stride(8), seed(0), meshColor(MONO),
 		erosionWindow(false), testSymmetrical(false), trackDraw(false), erosionDraw(false),
-		meshVertices(nullptr), traceVertices(nullptr), erosionVertices(nullptr), meshIndices(nullptr), 
-		noise(), lightSource(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f), erosion(width, height), camera(800, 600), 
+		meshVertices(nullptr), traceVertices(nullptr), erosionVertices(nullptr), meshIndices(nullptr), traceVertexCount(0),
+		noise(), lightSource(glm::vec3(0.0f, 0.0f, 0.0f), 1.0f), erosion(width, height), erosionSession(erosion), erosionSliceTime(4.0f), camera(800, 600), 
 		player(800, 600, glm::vec3(0.0f, 0.0f, 0.0f), 0.0001f, 20.0f, false, height),
 		deltaTime(0.0f), lastFrame(0.0f), m_Scaling_Factor(10.0f)
 	{
@@ -61,8 +64,13 @@ namespace test
 		delete[] erosionVertices;
 	}
 
+	//Erosion runs for a slice of every frame, so the terrain erodes live without freezing the window
 	void TestNoiseMesh::OnUpdate(float deltaTime)
 	{
+		if (erosionSession.getState() == erosion::SessionState::RUNNING) {
+			erosionSession.advance({ 0, erosionSliceTime });
+			UpdateErosionMesh();
+		}
 	}
 
 	//-------------------------------------------------------------------------------------
@@ -228,12 +236,8 @@ namespace test
 	//Function checking if the noise settings have changed
 	//If so it generates new terrain mesh and repaints it
 	void TestNoiseMesh::CheckChange() {
-		if (prevCheck.prevOpt != noise.getConfigRef().option ||
-			prevCheck.prevCheckSum != noise.getConfigRef().getCheckSum() ||
-			prevCheck.prevRidge != noise.getConfigRef().ridge ||
-			prevCheck.prevIsland != noise.getConfigRef().island ||
-			prevCheck.prevIslandType != noise.getConfigRef().islandType ||
-			prevCheck.symmetrical != noise.getConfigRef().symmetrical ||
+		//Seed of the config is updated only after the change is detected, so it is compared separately
+		if (prevCheck.prevHash != noise.getConfigRef().getHash(false) ||
 			prevCheck.seed != seed)
 		{
 			noise.setSeed(seed);
@@ -250,12 +254,7 @@ namespace test
 
 	//Function updating previous noise settings just for CheckChange() function to work
 	void TestNoiseMesh::UpdatePrevCheckers() {
-		prevCheck.prevCheckSum = noise.getConfigRef().getCheckSum();
-		prevCheck.prevOpt = noise.getConfigRef().option;
-		prevCheck.prevRidge = noise.getConfigRef().ridge;
-		prevCheck.prevIsland = noise.getConfigRef().island;
-		prevCheck.prevIslandType = noise.getConfigRef().islandType;
-		prevCheck.symmetrical = noise.getConfigRef().symmetrical;
+		prevCheck.prevHash = noise.getConfigRef().getHash(false);
 		prevCheck.seed = seed;
 	}
 
@@ -290,12 +289,14 @@ namespace test
 		{
 			delete[] traceVertices;
 			traceVertices = nullptr;
+			traceVertexCount = 0;
 		}
 		if (erosionVertices)
 		{
 			delete[] erosionVertices;
 			erosionVertices = nullptr;
 		}
+		erosionSession.cancel();
 		trackDraw = false;
 		erosionDraw = false;
 		erosionWindow = false;
@@ -312,8 +313,15 @@ namespace test
 
 		ImGui::SetNextWindowSizeConstraints(minSize, maxSize);
 		ImGui::Begin("Erosion Settings");
-		
+
+		//Settings are locked while the session runs, ImGui 1.60 has no BeginDisabled so the items are disabled by their flag
+		bool locked = erosionSession.isActive();
+		if (locked) {
+			ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+			ImGui::PushStyleVar(ImGuiStyleVar_Alpha, ImGui::GetStyle().Alpha * 0.5f);
+		}
 		ImGui::InputInt("Droplet count", &erosion.getDropletCountRef());
+		ImGui::InputInt("Erosion seed", &erosion.getSeedRef());
 		ImGui::InputInt("Droplet lifetime", &erosion.getConfigRef().dropletLifetime);
 		ImGui::InputFloat("Inertia", &erosion.getConfigRef().inertia);
 		ImGui::InputFloat("Droplet init capacity", &erosion.getConfigRef().initialCapacity, 0.01f, 1.0f);
@@ -326,6 +334,15 @@ namespace test
 		ImGui::InputFloat("Min slope", &erosion.getConfigRef().minSlope, 0.0f, 1.0f);
 		ImGui::InputInt("Erosion radius", &erosion.getConfigRef().erosionRadius);
 		ImGui::InputFloat("Blur", &erosion.getConfigRef().blur, 0.0f, 1.0f);
+		ImGui::InputInt("Thermal interval", &erosion.getConfigRef().thermalInterval);
+		ImGui::InputFloat("Talus slope", &erosion.getConfigRef().talusSlope, 0.0f, 1.0f);
+		ImGui::InputFloat("Thermal rate", &erosion.getConfigRef().thermalRate, 0.0f, 1.0f);
+		if (locked) {
+			ImGui::PopStyleVar();
+			ImGui::PopItemFlag();
+		}
+
+		ImGui::InputFloat("Erosion ms per frame", &erosionSliceTime, 1.0f, 10.0f);
 
 		ImGui::Checkbox("Show traces of droplets", &trackDraw);
 
@@ -334,25 +351,42 @@ namespace test
 		}
 		ImGui::SameLine();
 		if (ImGui::Button("Reset")) {
+			erosionSession.cancel();
 			erosionDraw = false;
 			trackDraw = false;
 		}
 
+		//Control of the erosion running in the background of the frames
+		if (erosionSession.isActive()) {
+			bool paused = erosionSession.getState() == erosion::SessionState::PAUSED;
+			if (ImGui::Button(paused ? "Resume" : "Pause")) {
+				if (paused)
+					erosionSession.resume();
+				else
+					erosionSession.pause();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel")) {
+				erosionSession.cancel();
+			}
+			ImGui::ProgressBar(erosionSession.getProgress());
+		}
+
 		ImGui::End();
 	}
 
-	//Function performing erosion on the terrain mesh
+	//Function starting the erosion of the terrain mesh, the erosion itself runs in the slices of the frames (see OnUpdate)
 	void TestNoiseMesh::PerformErosion() {
 		//If tracks of droplets are drawn we need to allocate memory for the trace vertices
+		//Session takes the droplet count and lifetime when it starts, the traces are sized for them and not for the later settings
+		delete[] traceVertices;
+		traceVertices = nullptr;
+		traceVertexCount = 0;
 		if(trackDraw)
 		{
-			delete[] traceVertices;
-			traceVertices = new float[(erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef() * 3];
-			
-			for (int i = 0; i < (erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef() * 3; i++) {
-				traceVertices[i] = 0.0f;
-			}
-			m_TrackBuffer = std::make_unique<VertexBuffer>(traceVertices, (erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef() * 3 * sizeof(float));
+			traceVertexCount = static_cast<size_t>(std::max(erosion.getConfigRef().dropletLifetime + 1, 0)) * std::max(erosion.getDropletCountRef(), 0);
+			traceVertices = new float[traceVertexCount * 3]();
+			m_TrackBuffer = std::make_unique<VertexBuffer>(traceVertices, static_cast<unsigned int>(traceVertexCount * 3 * sizeof(float)));
 		}
 
 		//If erosion vertices are not allocated we need to allocate memory for them
@@ -361,14 +395,26 @@ namespace test
 		}
 
 		erosion.SetMap(noise.getMap());
-		utilities::benchmark_void(utilities::PerformErosion, "PerformErosion", erosionVertices, meshIndices, m_Scaling_Factor, trackDraw ? std::optional<float*>(traceVertices) : std::nullopt, stride, 0, 3, erosion);	
+		if (!erosionSession.start(traceVertices ? std::optional<float*>(traceVertices) : std::nullopt))
+			return;
 		PaintMesh(erosion.getMap(), erosionVertices);
-
+		utilities::UpdateErosionMesh(erosionVertices, meshIndices, m_Scaling_Factor, stride, 0, 3, erosion);
 		m_erosionBuffer->UpdateData(erosionVertices, (height * width) * stride * sizeof(float));
 		erosionDraw = true;
+	}
+
+	//Function updating the eroded mesh to the map eroded so far, traces of the droplets are scaled once the erosion is finished
+	//Only the tiles changed since the previous update are rebuilt and uploaded, rows of every rectangle are uploaded
+	//as one range from its first to its last vertex
+	void TestNoiseMesh::UpdateErosionMesh() {
+		for (const erosion::DirtyRect& rect : utilities::UpdateErosionMeshDirty(erosionVertices, m_Scaling_Factor, stride, 0, 3, erosion)) {
+			size_t first = (static_cast<size_t>(rect.y) * width + rect.x) * stride;
+			size_t count = (static_cast<size_t>(rect.height - 1) * width + rect.width) * stride;
+			m_erosionBuffer->UpdateSubData(erosionVertices + first, static_cast<unsigned int>(first * sizeof(float)), static_cast<unsigned int>(count * sizeof(float)));
+		}
 
-		if (m_Scaling_Factor != 1.0f) {
-			for (int i = 0; i < (erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef() * 3; i++) {
+		if (erosionSession.getState() == erosion::SessionState::FINISHED && traceVertices && m_Scaling_Factor != 1.0f) {
+			for (size_t i = 0; i < traceVertexCount * 3; i++) {
 				traceVertices[i] *= m_Scaling_Factor;
 			}
 		}
@@ -378,7 +424,7 @@ namespace test
 	void TestNoiseMesh::PrintTrack(glm::mat4& model) {
 		if (trackDraw && traceVertices) {
 		    m_TrackVAO->Bind();
-			m_TrackBuffer->UpdateData(traceVertices, (erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef() * 3 * sizeof(float));
+			m_TrackBuffer->UpdateData(traceVertices, static_cast<unsigned int>(traceVertexCount * 3 * sizeof(float)));
 			m_TrackShader->SetMVP(model, *camera.GetViewMatrix(), *camera.GetProjectionMatrix());
 
 			m_TrackShader->Bind();
@@ -388,7 +434,7 @@ namespace test
 			GLCALL(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0));
 
 			GLCALL(glPointSize(2.0f * m_Scaling_Factor));
-			GLCALL(glDrawArrays(GL_POINTS, 0, (erosion.getConfigRef().dropletLifetime + 1) * erosion.getDropletCountRef()));
+			GLCALL(glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(traceVertexCount)));
 		}
 	}
 }
\ No newline at end of file
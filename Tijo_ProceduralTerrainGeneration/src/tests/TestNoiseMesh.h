@@ -37,12 +37,15 @@ namespace test
 		//Erosion functions
 		void ErosionWindowRender();
 		void PerformErosion();
+		void UpdateErosionMesh();
 		void PrintTrack(glm::mat4& model);
 
 	private:
 		//Vertices and indices arrays
 		float* meshVertices, *erosionVertices, *traceVertices;
 		unsigned int* meshIndices;
+		//Vertices of the traces of the droplets, counted for the settings of the erosion the traces were allocated for
+		size_t traceVertexCount;
 		
 		//Mesh variables
 		unsigned int width, height, stride;
@@ -58,12 +61,16 @@ namespace test
 		//Erosion booleans
 		bool erosionWindow, trackDraw, erosionDraw;
 
+		//Time of every frame spent on the erosion in milliseconds
+		float erosionSliceTime;
+
 		//Entities
 		Camera camera;
 		Player player;
 		LightSource lightSource;
 		noise::SimplexNoiseClass noise;
 		erosion::Erosion erosion;
+		erosion::ErosionSession erosionSession;
 		VertexBufferLayout layout;
 
 		//OpenGL stuff
@@ -82,16 +89,11 @@ namespace test
 		std::unique_ptr<Texture> m_Texture;
 
 		struct prevCheckers {
-			noise::Options prevOpt;
-			noise::IslandType prevIslandType;
-			float prevCheckSum;
-			bool prevRidge;
-			bool prevIsland;
-			bool symmetrical;
+			uint64_t prevHash;
 			int seed = 0;
 
-			prevCheckers(noise::Options prevOpt = noise::Options::REVERT_NEGATIVES, noise::IslandType prevIslandType = noise::IslandType::CONE, float prevCheckSum = 0, bool prevRidge = false, bool prevIsland = false, bool symmetrical = false, int seed = 0)
-				: prevOpt(prevOpt), prevCheckSum(prevCheckSum), prevRidge(prevRidge), prevIsland(prevIsland), prevIslandType(prevIslandType), seed(seed), symmetrical(symmetrical){}
+			prevCheckers(uint64_t prevHash = 0, int seed = 0)
+				: prevHash(prevHash), seed(seed){}
 		} prevCheck;
 
 		enum color {
@@ -1,7 +1,9 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 
 #include "utilities.h"
+#include "JobSystem.h"
 
+#include <algorithm>
 #include <math.h>
 #include <fstream>
 #include <sstream>
@@ -75,7 +77,7 @@ namespace utilities
 	//@param offset - offset in the vertex array to start with when filling the data
 
 	void parseNoiseIntoVertices(float* vertices, int width, int height, float* map, float scalingFactor, unsigned int stride, unsigned int offset) {
-		for (int y = 0; y < height; y++)
+		jobs::JobSystem::get().parallel_for(0, height, 32, [&](int y)
 		{
 			for (int x = 0; x < width; x++)
 			{
@@ -83,7 +85,7 @@ namespace utilities
 				vertices[((y * width) + x) * stride + offset + 1] = map[y * width + x] * scalingFactor;
 				vertices[((y * width) + x) * stride + offset + 2] = y / (float)height * scalingFactor;
 			}
-		}
+		});
 	}
 
 	//Parses noise map into vertices for openGL to draw as a mesh, stride is the number of floats per vertex
@@ -98,7 +100,7 @@ namespace utilities
 	//@param stride - number of floats per vertex
 	//@param offset - offset in the vertex array to start with when filling the data
 	void parseNoiseChunksIntoVertices(float* vertices, int width, int height, int chunkX, int chunkY, float* map, float scalingFactor, unsigned int stride, unsigned int offset) {
-		for (int y = 0; y < height * chunkY; y++)
+		jobs::JobSystem::get().parallel_for(0, height * chunkY, 32, [&](int y)
 		{
 			for (int x = 0; x < width * chunkX; x++)
 			{
@@ -106,7 +108,7 @@ namespace utilities
 				vertices[((y * width * chunkX) + x) * stride + offset + 1] = map[y * width * chunkX + x];
 				vertices[((y * width * chunkX) + x) * stride + offset + 2] = y / (float)chunkY * scalingFactor;
 			}
-		}
+		});
 	}
 
 	bool createTiledVertices(float* vertices, int width, int height, float* map, float scalingFactor, unsigned int stride, unsigned int offset) {
@@ -115,10 +117,11 @@ namespace utilities
 			return false;
 		}
 
-		int index = offset;
-
-		for (int y = 0; y < (height - 1); y++)
+		//Each row of quads starts at a known place in the array, so rows are filled in parallel
+		jobs::JobSystem::get().parallel_for(0, height - 1, 32, [&](int y)
 		{
+			int index = offset + y * (width - 1) * 4 * stride;
+
 			for (int x = 0; x < (width - 1); x++)
 			{
 				vertices[index] = x * scalingFactor;
@@ -145,7 +148,7 @@ namespace utilities
 
 				index += stride;
 			}
-		}
+		});
 
 		return true;
 	}
@@ -156,9 +159,8 @@ namespace utilities
 			return false;
 		}
 
-		int index = 0;
-
-		for (int i = 0; i < (height - 1) * (width - 1); i++) {
+		jobs::JobSystem::get().parallel_for(0, (height - 1) * (width - 1), 4096, [&](int i) {
+			int index = i * 6;
 			indices[index++] = i * 4;
 			indices[index++] = i * 4 + 1;
 			indices[index++] = i * 4 + 2;
@@ -166,7 +168,7 @@ namespace utilities
 			indices[index++] = i * 4;
 			indices[index++] = i * 4 + 2;
 			indices[index++] = i * 4 + 3;
-		}
+		});
 
 		return true;
 	}
@@ -221,22 +223,88 @@ namespace utilities
 		}
 	}
 
-	//Performs erosion simulation on the terrain map, updating vertices, indices and normals
+	//Updates vertices and normals of the mesh to the current map of the erosion, e.g. between the slices of the erosion session
 	//@param vertices - array of vertices to be filled with data
-	//@param indices - array of indices to be filled with data
-	//@param Track - optional array of floats representing the track of the erosion
+	//@param indices - array of indices of the mesh
 	//@param stride - number of floats per vertex
 	//@param positionsOffset - offset in the vertex array to start with when filling the data
 	//@param normalsOffset - offset in the vertex array to start with when filling the normals
 	//@param erosion - erosion object
-	void PerformErosion(float* vertices, unsigned int* indices, float scalingFactor, std::optional<float*> Track, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion) {
-		erosion.Erode(Track);
+	void UpdateErosionMesh(float* vertices, unsigned int* indices, float scalingFactor, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion) {
 		parseNoiseIntoVertices(vertices, erosion.getWidth(), erosion.getHeight(), erosion.getMap(), scalingFactor, stride, positionsOffset);
 		InitializeNormals(vertices, stride, normalsOffset, erosion.getHeight() * erosion.getWidth());
 		CalculateNormals(vertices, indices, stride, normalsOffset, (erosion.getWidth() - 1) * (erosion.getHeight() - 1) * 6);
 		NormalizeVector3f(vertices, stride, normalsOffset, erosion.getWidth() * erosion.getHeight());
 	}
 
+	//Updates vertices and normals of the mesh only in the tiles of the map changed by the erosion since the last update
+	//(see erosion::DirtyRegion) and clears them. Positions are written in the tiles with one vertex of border, normals of
+	//the border depend on the changed triangles. Every normal of the rectangle is summed from the same triangles in the same
+	//order as by CalculateNormals over the indices of SimpleMeshIndicies, so the mesh is the same as after UpdateErosionMesh.
+	//@param vertices - vertices of the mesh of SimpleMeshIndicies, width x height of the erosion map
+	//@param stride - number of floats per vertex
+	//@param positionsOffset - offset of the position in the vertex
+	//@param normalsOffset - offset of the normal in the vertex
+	//@param erosion - erosion object
+	//@return std::vector<erosion::DirtyRect> - rectangles of the updated vertices, e.g. for the upload of the changed vertices to the GPU
+	std::vector<erosion::DirtyRect> UpdateErosionMeshDirty(float* vertices, float scalingFactor, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion) {
+		const int width = erosion.getWidth(), height = erosion.getHeight(), mapStride = erosion.getStride();
+		const float* map = erosion.getMap();
+		std::vector<erosion::DirtyRect> rects = erosion.getDirtyRegion().getRects(1);
+		erosion.ClearDirtyRegion();
+
+		for (const erosion::DirtyRect& rect : rects) {
+			int x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.width, y1 = rect.y + rect.height;
+			auto vertex = [&](int x, int y) { return vertices + static_cast<size_t>(y * width + x) * stride; };
+
+			jobs::JobSystem::get().parallel_for(y0, y1, 32, [&](int y) {
+				for (int x = x0; x < x1; x++) {
+					float* v = vertex(x, y);
+					v[positionsOffset] = x / (float)width * scalingFactor;
+					v[positionsOffset + 1] = map[static_cast<size_t>(y) * mapStride + x] * scalingFactor;
+					v[positionsOffset + 2] = y / (float)height * scalingFactor;
+					v[normalsOffset] = v[normalsOffset + 1] = v[normalsOffset + 2] = 0.0f;
+				}
+			});
+
+			//Quads touching the rectangle in the order of the indices, their triangles are added only to the vertices inside of it
+			auto add = [&](int x, int y, glm::vec3 normal) {
+				if (x >= x0 && x < x1 && y >= y0 && y < y1)
+					AddVector3f(vertex(x, y), normalsOffset, normal);
+			};
+			auto position = [&](int x, int y) {
+				float* v = vertex(x, y);
+				return glm::vec3(v[positionsOffset], v[positionsOffset + 1], v[positionsOffset + 2]);
+			};
+			for (int y = std::max(y0 - 1, 0); y < std::min(y1, height - 1); y++) {
+				for (int x = std::max(x0 - 1, 0); x < std::min(x1, width - 1); x++) {
+					glm::vec3 first = position(x, y);
+					glm::vec3 normal = glm::cross(position(x, y + 1) - first, position(x + 1, y) - first);
+					add(x, y, normal);
+					add(x, y + 1, normal);
+					add(x + 1, y, normal);
+
+					first = position(x + 1, y);
+					normal = glm::cross(position(x, y + 1) - first, position(x + 1, y + 1) - first);
+					add(x + 1, y, normal);
+					add(x, y + 1, normal);
+					add(x + 1, y + 1, normal);
+				}
+			}
+
+			jobs::JobSystem::get().parallel_for(y0, y1, 32, [&](int y) {
+				for (int x = x0; x < x1; x++) {
+					float* v = vertex(x, y) + normalsOffset;
+					glm::vec3 normal = glm::normalize(glm::vec3(v[0], v[1], v[2]));
+					v[0] = normal.x;
+					v[1] = normal.y;
+					v[2] = normal.z;
+				}
+			});
+		}
+		return rects;
+	}
+
 	//Generates basic Perlin Fractal Noise and sets coords for texture sampling (painting biome)
 	//Its a very basic function, yet could be usefull for some simple terrain generation
 	//@param vertices - array of vertices to be filled with data
@@ -333,17 +401,18 @@ namespace utilities
 		}
 
 		std::cout << "Vertices saved" << std::endl;
-		// Write faces
+		// Write faces, indices of OBJ start at 1
 		for (int y = 0; y < indexSize; y += 3) {
-			int one = indices[y];
-			int two = indices[y + 1];
-			int three = indices[y + 2];
+			unsigned int one = indices[y] + 1;
+			unsigned int two = indices[y + 1] + 1;
+			unsigned int three = indices[y + 2] + 1;
 
 			file << "f " << one << "/" << one << "/" << one << " " << two << "/" << two << "/" << two << " " << three << "/" << three << "/" << three << "\n";
 		}
 
 		file.close();
 		std::cout << "Height map saved to " << filename << std::endl;
+		return true;
 	}
 
 	void AssignBiome(float* vertices, int* biomeMap, int width, int height, unsigned int stride, unsigned int offset)
@@ -405,6 +474,73 @@ namespace utilities
 		
 	}
 
+	//Builds the part of the tiled mesh (see createTiledVertices) covered by the quads starting inside of the given chunk
+	//Positions, normals and texture coordinates are the same as produced by createTiledVertices, InitializeNormals,
+	//CalculateNormals, NormalizeVector3f and AssignTexturesByBiomes for the whole map, since tiled quads do not share vertices.
+	//Quads on the right and bottom border of the chunk read the heights of the neighbouring chunks, so they have to be generated.
+	//Chunks write separate parts of the array, so many of them can be built at the same time
+	//Heights are read through the terrain generator, so the maps can be in any layout
+	//@param terraGen - terrain generator with the height and biome maps
+	//@param vertices - array of vertices of the whole map to be filled with data
+	//@param chunkX, chunkY - coordinates of the chunk
+	//@param chunkRes - resolution of the chunk
+	//@param scalingFactor - scaling factor of the positions
+	//@param texAtlasSize - number of textures in the row of the atlas
+	//@param stride - number of floats per vertex, positions are the first 3 of them
+	//@param normalOffset - offset of the normal in the vertex
+	//@param texOffset - offset of the texture coordinates in the vertex
+	bool createTiledChunkMesh(TerrainGenerator& terraGen, float* vertices, int chunkX, int chunkY, int chunkRes, float scalingFactor, int texAtlasSize, unsigned int stride, unsigned int normalOffset, unsigned int texOffset)
+	{
+		if (!vertices || !terraGen.getHeightMap() || !terraGen.getBiomeMap()) {
+			std::cout << "[ERROR] Arrays not initialized" << std::endl;
+			return false;
+		}
+
+		int width = terraGen.getWidth();
+		int height = terraGen.getHeight();
+		glm::vec3 corners[4], first, second;
+
+		for (int y = chunkY * chunkRes; y < std::min((chunkY + 1) * chunkRes, height - 1); y++)
+		{
+			for (int x = chunkX * chunkRes; x < std::min((chunkX + 1) * chunkRes, width - 1); x++)
+			{
+				int index = (y * (width - 1) + x) * 4 * stride;
+
+				corners[0] = glm::vec3(x * scalingFactor, terraGen.getHeightAt(x, y) * scalingFactor, y * scalingFactor);
+				corners[1] = glm::vec3((x + 1) * scalingFactor, terraGen.getHeightAt(x + 1, y) * scalingFactor, y * scalingFactor);
+				corners[2] = glm::vec3((x + 1) * scalingFactor, terraGen.getHeightAt(x + 1, y + 1) * scalingFactor, (y + 1) * scalingFactor);
+				corners[3] = glm::vec3(x * scalingFactor, terraGen.getHeightAt(x, y + 1) * scalingFactor, (y + 1) * scalingFactor);
+
+				//Normals of the two triangles of the quad, {0, 1, 2} and {0, 2, 3}
+				first = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				second = glm::cross(corners[2] - corners[0], corners[3] - corners[0]);
+				glm::vec3 normals[4] = { glm::normalize(first + second), glm::normalize(first), glm::normalize(first + second), glm::normalize(second) };
+
+				int tex = terraGen.getBiome(terraGen.getBiomeAt(x, y)).getTexOffset();
+				float texCoords[4][2] = {
+					{ tex % texAtlasSize / static_cast<float>(texAtlasSize), tex / texAtlasSize / static_cast<float>(texAtlasSize) },
+					{ static_cast<float>((tex % texAtlasSize) / static_cast<float>(texAtlasSize) + (0.99 / texAtlasSize)), tex / texAtlasSize / static_cast<float>(texAtlasSize) },
+					{ static_cast<float>((tex % texAtlasSize) / static_cast<float>(texAtlasSize) + (0.99 / texAtlasSize)), (tex / texAtlasSize + 1) / static_cast<float>(texAtlasSize) },
+					{ tex % texAtlasSize / static_cast<float>(texAtlasSize), (tex / texAtlasSize + 1) / static_cast<float>(texAtlasSize) }
+				};
+
+				for (int i = 0; i < 4; i++, index += stride) {
+					vertices[index] = corners[i].x;
+					vertices[index + 1] = corners[i].y;
+					vertices[index + 2] = corners[i].z;
+
+					vertices[index + normalOffset] = normals[i].x;
+					vertices[index + normalOffset + 1] = normals[i].y;
+					vertices[index + normalOffset + 2] = normals[i].z;
+
+					vertices[index + texOffset] = texCoords[i][0];
+					vertices[index + texOffset + 1] = texCoords[i][1];
+				}
+			}
+		}
+		return true;
+	}
+
 	//Initializes normals for the vertices to be 0.0f, its needed for the AddVector3f function
 	//@param vertices - array of vertices to be filled with data
 	//@param stride - number of floats per vertex
@@ -416,11 +552,11 @@ namespace utilities
 			return false;
 		}
 		
-		for (int i = 0; i < verticesCount; i++) {
+		jobs::JobSystem::get().parallel_for(0, verticesCount, 4096, [&](int i) {
 			vertices[i * stride + offSet] = 0.0f;
 			vertices[i * stride + offSet + 1] = 0.0f;
 			vertices[i * stride + offSet + 2] = 0.0f;
-		}
+		});
 
 		return true;
 	}
@@ -431,6 +567,7 @@ namespace utilities
 	//@param stride - number of floats per vertex
 	//@param offSet - offset in the vertex array to start with when filling the data
 	//@param indexSize - number of indices
+	//Triangles of the indexed meshes share vertices, so the accumulation stays serial to keep the sums in a fixed order
 	bool CalculateNormals(float* vertices, unsigned int* indices, unsigned int stride, unsigned int offSet, unsigned int indexSize) {
 		if (indexSize % 3 != 0) {
 			std::cout << "Index size is not a multiple of 3, hence its not a set of triangles" << std::endl;
@@ -460,6 +597,7 @@ namespace utilities
 			AddVector3f(vertices, indices[i + 1] * stride + offSet, tmp);
 			AddVector3f(vertices, indices[i + 2] * stride + offSet, tmp);
 		}
+		return true;
 	}
 	//Requires floats in vertices representing a normal vector to be initialized with some value (Func initializeNomals {0.0f, 0.0f, 0.0f)
 	//Adds vector3f to the normal vector in the vertices array
@@ -483,9 +621,8 @@ namespace utilities
 			return false;
 		}
 		
-		glm::vec3 tmp;
-		for (int i = 0; i < verticesCount; i++) {
-			tmp = glm::vec3(
+		jobs::JobSystem::get().parallel_for(0, verticesCount, 4096, [&](int i) {
+			glm::vec3 tmp = glm::vec3(
 				vertices[i * stride + offSet],
 				vertices[i * stride + offSet + 1],
 				vertices[i * stride + offSet + 2]);
@@ -493,7 +630,8 @@ namespace utilities
 			vertices[i * stride + offSet] = tmp.x;
 			vertices[i * stride + offSet + 1] = tmp.y;
 			vertices[i * stride + offSet + 2] = tmp.z;
-		}
+		});
+		return true;
 	}
 
 }
@@ -3,7 +3,7 @@
 #include <iostream>
 #include <chrono>
 #include <type_traits>
-#include <optional>
+#include <vector>
 
 #include "glm.hpp"
 
@@ -33,10 +33,12 @@ namespace utilities
 	//Terrain generation functions
     void GenerateTerrainMap(noise::SimplexNoiseClass& noise, float* vertices, unsigned int* indices, unsigned int stride);
     void CreateTerrainMesh(noise::SimplexNoiseClass& noise, float* vertices, unsigned int* indices, float scalingFactor, unsigned int stride, bool normals, bool first);
-    void PerformErosion(float* vertices, unsigned int* indices, float scalingFactor, std::optional<float*> Track, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion);
+    void UpdateErosionMesh(float* vertices, unsigned int* indices, float scalingFactor, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion);
+    std::vector<erosion::DirtyRect> UpdateErosionMeshDirty(float* vertices, float scalingFactor, int stride, int positionsOffset, int normalsOffset, erosion::Erosion& erosion);
     void PaintBiome(float* vertices, float* map, int width, int height, unsigned int stride, unsigned int offset);
 	void AssignBiome(float* vertices, int* biomeMap, int width, int height, unsigned int stride, unsigned int offset);
     void AssignTexturesByBiomes(TerrainGenerator& terraGen, float* vertices, int width, int height, int texAtlasSize, unsigned int stride, unsigned int offset);
+    bool createTiledChunkMesh(TerrainGenerator& terraGen, float* vertices, int chunkX, int chunkY, int chunkRes, float scalingFactor, int texAtlasSize, unsigned int stride, unsigned int normalOffset, unsigned int texOffset);
 
 	//Benchmarking function
     template <typename Func, typename... Args>